@@ -17,6 +17,7 @@ IMPLEMENT_CODELET(fwd_2048L,
     for (k=0; k<bots_arg_size_1; k++) 
         for (i=k+1; i<bots_arg_size_1; i++)
           col[i*bots_arg_size_1+j] = col[i*bots_arg_size_1+j] - diag[i*bots_arg_size_1+k]*col[k*bots_arg_size_1+j];
+  this->setFlops(2 * bots_arg_size_1 * bots_arg_size_1 * (bots_arg_size_1 - 1) / 2);
 );
 
 IMPLEMENT_CODELET(bdiv_2048L,
@@ -33,6 +34,7 @@ IMPLEMENT_CODELET(bdiv_2048L,
       for (j=k+1; j<bots_arg_size_1; j++)
         row[i*bots_arg_size_1+j] = row[i*bots_arg_size_1+j] - row[i*bots_arg_size_1+k]*diag[k*bots_arg_size_1+j];
     }
+  this->setFlops(bots_arg_size_1 * bots_arg_size_1 * bots_arg_size_1);
 );
 
 IMPLEMENT_CODELET(bmod_2048L,
@@ -47,6 +49,7 @@ IMPLEMENT_CODELET(bmod_2048L,
     for (j=0; j<bots_arg_size_1; j++)
       for (k=0; k<bots_arg_size_1; k++)
         inner[i*bots_arg_size_1+j] = inner[i*bots_arg_size_1+j] - row[i*bots_arg_size_1+k]*col[k*bots_arg_size_1+j];
+  this->setFlops(2 * bots_arg_size_1 * bots_arg_size_1 * bots_arg_size_1);
 );
 
 IMPLEMENT_CODELET(lu0_2048L,
@@ -62,6 +65,7 @@ IMPLEMENT_CODELET(lu0_2048L,
       diag[i*bots_arg_size_1+j] = diag[i*bots_arg_size_1+j] - diag[i*bots_arg_size_1+k] * diag[k*bots_arg_size_1+j];
     }
   
+  this->setFlops(bots_arg_size_1 * (bots_arg_size_1 - 1) / 2 + bots_arg_size_1 * (bots_arg_size_1 - 1) * (2 * bots_arg_size_1 - 1) / 3);
 );
 
 IMPLEMENT_CODELET(zero_2048L,
@@ -21,6 +21,7 @@ static uint64_t max_malloc_size;
 static struct {
   bool fileInput = false;
   char * fileName;
+  bool roofline = false;
 } program_options;
 
  // 4 GB
@@ -46,6 +47,7 @@ void sparselu_init (float ***pBENCH, char *pass);
 int main (int argc, char * argv[]) {
   unsigned char * memory;
   float **SEQ;
+  scm::memory_manager_module memManager(SIZEOFMEM);
   
   parseProgramOptions(argc, argv);
   // For now we only support the one file
@@ -55,27 +57,25 @@ int main (int argc, char * argv[]) {
   } else if (strcmp(program_options.fileName, "debug_luDecomp.scm") == 0) {
     dbg_stop_point = FULL;
   }
-  try {
-    memory = new unsigned char[SIZEOFMEM];
-    printf("SCM memory exists between 0x%lx and 0x%lx\n", (long unsigned)memory, ((long unsigned)memory) + (unsigned long)4e9);
-    lu_malloc_init(memory, SIZEOFMEM);
-    // do some setup here
-    printf("Initializing BENCH\n");
-    lu_sparselu_init(&BENCH, "benchmark"); // allocate BENCH into SCM memory space
-    printf("BENCH located at %p\n", BENCH);
-    printf("Initializing SEQ\n");
-    sparselu_init(&SEQ, "sequential"); // allocate SEQ into normal heap
-    printf("Performing pre-check...\n");
-    sparselu_check(SEQ, BENCH); // check to make sure the starting matrices are the same
-    printf("%d total errors detected in %d submatrices\n", errors, err_submats);
-    errors = 0;
-    err_submats = 0;
-    //lu_pre_allocate(BENCH); /preallocation probably causes incorrect results
-  }
-  catch (int e) {
-    std::cout << "An exception occurred. Exception Nr. " << e << '\n';
+  if (!memManager.isValid()) {
+    std::cout << "Could not allocate the SCM memory" << std::endl;
     return 1;
   }
+  memory = memManager.getL2Memory();
+  printf("SCM memory exists between 0x%lx and 0x%lx\n", (long unsigned)memory, ((long unsigned)memory) + (unsigned long)4e9);
+  lu_malloc_init(memory, SIZEOFMEM);
+  // do some setup here
+  printf("Initializing BENCH\n");
+  lu_sparselu_init(&BENCH, "benchmark"); // allocate BENCH into SCM memory space
+  printf("BENCH located at %p\n", BENCH);
+  printf("Initializing SEQ\n");
+  sparselu_init(&SEQ, "sequential"); // allocate SEQ into normal heap
+  printf("Performing pre-check...\n");
+  sparselu_check(SEQ, BENCH); // check to make sure the starting matrices are the same
+  printf("%d total errors detected in %d submatrices\n", errors, err_submats);
+  errors = 0;
+  err_submats = 0;
+  //lu_pre_allocate(BENCH); /preallocation probably causes incorrect results
   //scm::codelet_params vars;
   //vars.getParamAs(1) = reinterpret_cast<unsigned char*>(warmA); // Getting register 1
   //vars.getParamAs(2) = reinterpret_cast<unsigned char*>(warmB); // Getting register 2
@@ -85,7 +85,8 @@ int main (int argc, char * argv[]) {
   scm::scm_machine * myMachine;
   if (program_options.fileInput) {
     SCMULATE_INFOMSG(0, "Reading program file %s", program_options.fileName);
-    myMachine = new scm::scm_machine(program_options.fileName, memory, scm::OOO);
+    // Only 64B and 2048L registers are used. The rest of the budget goes to the renaming of 2048L registers
+    myMachine = new scm::scm_machine(program_options.fileName, &memManager, scm::OOO, "luDecomp.regs");
     //myMachine = new scm::scm_machine(program_options.fileName, memory, scm::SUPERSCALAR);
     //myMachine = new scm::scm_machine(program_options.fileName, memory, scm::SEQUENTIAL);
   } else {
@@ -93,6 +94,9 @@ int main (int argc, char * argv[]) {
     return 1;
   }
 
+  if (program_options.roofline)
+    myMachine->setRoofline();
+
   if (myMachine->run() != scm::SCM_RUN_SUCCESS) {
     SCMULATE_ERROR(0, "THERE WAS AN ERROR WHEN RUNNING THE SCM MACHINE");
     return 1;
@@ -122,7 +126,6 @@ int main (int argc, char * argv[]) {
   if (errors == 0)
     printf("SUCCESS!!!\n");
   delete myMachine;
-  delete [] memory;
   //delete [] SEQ;
   return 0;
 }
@@ -147,6 +150,11 @@ void * lu_malloc(uint64_t size) {
 }
 
 void parseProgramOptions(int argc, char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    // Roofline report of the codelets when the machine finishes
+    if (strcmp(argv[i], "-roofline") == 0)
+      program_options.roofline = true;
+  }
   // there are other arguments
   for (int i = 1; i + 1 < argc; i++) {
     if (strcmp(argv[i], "-i") == 0) {
@@ -55,6 +55,7 @@ IMPLEMENT_CODELET(MatMult_2048L,
     }
    }
 #endif
+  this->setFlops(2 * TILE_DIM * TILE_DIM * TILE_DIM);
 );
 
 MEMRANGE_CODELET(StoreSqTile_2048L, 
@@ -31,6 +31,7 @@ uint32_t KDIM;
 static struct {
   bool fileInput = false;
   char * fileName;
+  bool roofline = false;
 } program_options;
 
  // 4 GB
@@ -60,6 +61,7 @@ void alg_matmul2D_serial(int m, int n, int p, double* a, double* b, double* c) {
 
 int main (int argc, char * argv[]) {
   unsigned char * memory;
+  scm::memory_manager_module memManager(SIZEOFMEM, scm::PLACE_FIRST_TOUCH);
   
   parseProgramOptions(argc, argv);
   // TODO: Harcoding these for now, until we have a general 
@@ -78,13 +80,11 @@ int main (int argc, char * argv[]) {
     std::cout << "Unsupported SCM file" << std::endl;
     return 1;
   }
-  try {
-    memory = new unsigned char[SIZEOFMEM];
-  }
-  catch (int e) {
-    std::cout << "An exception occurred. Exception Nr. " << e << '\n';
+  if (!memManager.isValid()) {
+    std::cout << "Could not allocate the SCM memory" << std::endl;
     return 1;
   }
+  memory = memManager.getL2Memory();
 
   std::cout << "TILES = " << TILES << std::endl
             << "MDIM = " << MDIM << std::endl
@@ -114,6 +114,8 @@ int main (int argc, char * argv[]) {
   scm::_cod_MatMult_2048L warmCod(vars);
   warmCod.implementation();
 
+  // Tiles are placed close to the CU that owns them before initialization
+  memManager.firstTouch(0, C_offset + NumElements_C*sizeof(double));
   double *A = reinterpret_cast<double*> (memory); 
   double *B = reinterpret_cast<double*> (&memory[B_offset]); 
   double *C = reinterpret_cast<double*> (&memory[C_offset]);
@@ -129,12 +131,15 @@ int main (int argc, char * argv[]) {
   scm::scm_machine * myMachine;
   if (program_options.fileInput) {
     SCMULATE_INFOMSG(0, "Reading program file %s", program_options.fileName);
-    myMachine = new scm::scm_machine(program_options.fileName, memory, scm::OOO);
+    myMachine = new scm::scm_machine(program_options.fileName, &memManager, scm::OOO);
   } else {
     std::cout << "Need to give a file to read. use -i <filename>" << std::endl;
     return 1;
   }
 
+  if (program_options.roofline)
+    myMachine->setRoofline();
+
   if (myMachine->run() != scm::SCM_RUN_SUCCESS) {
     SCMULATE_ERROR(0, "THERE WAS AN ERROR WHEN RUNNING THE SCM MACHINE");
     return 1;
@@ -169,12 +174,16 @@ int main (int argc, char * argv[]) {
   if (success)
     printf("SUCCESS!!!\n");
   delete myMachine;
-  delete [] memory;
   delete [] testC;
   return 0;
 }
 
 void parseProgramOptions(int argc, char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    // Roofline report of the codelets when the machine finishes
+    if (strcmp(argv[i], "-roofline") == 0)
+      program_options.roofline = true;
+  }
   // there are other arguments
   for (int i = 1; i + 1 < argc; i++) {
     if (strcmp(argv[i], "-i") == 0) {
@@ -61,6 +61,71 @@ IMPLEMENT_CODELET(MatMult_2048L,
 #endif
 
 
+  this->setFlops(2 * TILE_DIM * TILE_DIM * TILE_DIM);
+);
+
+// Registers are big endian
+static inline uint64_t regToUint64(uint8_t * reg) {
+  uint64_t value = reg[0];
+  for (int i = 1; i < 8; i++) {
+    value <<= 8;
+    value += reg[i];
+  }
+  return value;
+}
+
+// Immediate operand. Read through the pointer of the parameter to avoid the type punning of getParamValueAs
+static inline int64_t immediate(scm::codelet_params & params, int op) {
+  return reinterpret_cast<int64_t>(params.getParamValueAs<uint8_t*>(op));
+}
+
+MEMRANGE_CODELET(GemmTile_2048L, 
+  // Obtaining the parameters
+  uint64_t addressC = regToUint64(this->getParams().getParamValueAs<uint8_t*>(1));
+  uint64_t addressA = regToUint64(this->getParams().getParamValueAs<uint8_t*>(2));
+  uint64_t addressB = regToUint64(this->getParams().getParamValueAs<uint8_t*>(3));
+  uint64_t ldistance = regToUint64(this->getParams().getParamValueAs<uint8_t*>(4));
+  uint64_t tile_i = regToUint64(this->getParams().getParamValueAs<uint8_t*>(5));
+  uint64_t tile_j = regToUint64(this->getParams().getParamValueAs<uint8_t*>(6));
+  int64_t beta = immediate(this->getParams(), 8);
+
+  // Add the ranges
+  for (uint64_t i = 0; i < TILE_DIM; i++) {
+    this->addReadMemRange(addressA+((tile_i*TILE_DIM + i)*ldistance)*sizeof(double), ldistance*sizeof(double));
+    if (beta != 0)
+      this->addReadMemRange(addressC+((tile_i*TILE_DIM + i)*ldistance + tile_j*TILE_DIM)*sizeof(double), TILE_DIM*sizeof(double));
+    this->addWriteMemRange(addressC+((tile_i*TILE_DIM + i)*ldistance + tile_j*TILE_DIM)*sizeof(double), TILE_DIM*sizeof(double));
+  }
+  for (uint64_t k = 0; k < ldistance; k++) {
+    this->addReadMemRange(addressB+(k*ldistance + tile_j*TILE_DIM)*sizeof(double), TILE_DIM*sizeof(double));
+  }
+);
+
+IMPLEMENT_CODELET(GemmTile_2048L,
+  // Obtaining the parameters
+  uint64_t ldistance = regToUint64(this->getParams().getParamValueAs<uint8_t*>(4));
+  uint64_t tile_i = regToUint64(this->getParams().getParamValueAs<uint8_t*>(5));
+  uint64_t tile_j = regToUint64(this->getParams().getParamValueAs<uint8_t*>(6));
+  double alpha = immediate(this->getParams(), 7);
+  double beta = immediate(this->getParams(), 8);
+  double *A = reinterpret_cast<double *> (getAddress(regToUint64(this->getParams().getParamValueAs<uint8_t*>(2)))) + tile_i*TILE_DIM*ldistance;
+  double *B = reinterpret_cast<double *> (getAddress(regToUint64(this->getParams().getParamValueAs<uint8_t*>(3)))) + tile_j*TILE_DIM;
+  double *C = reinterpret_cast<double *> (getAddress(regToUint64(this->getParams().getParamValueAs<uint8_t*>(1)))) + tile_i*TILE_DIM*ldistance + tile_j*TILE_DIM;
+
+#ifndef NOBLAS
+  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, TILE_DIM, TILE_DIM, ldistance, alpha, A, ldistance, B, ldistance, beta, C, ldistance);
+#else
+  for (int i=0; i<TILE_DIM; i=i+1) {
+    for (int j=0; j<TILE_DIM; j=j+1) {
+      double acc = 0;
+      for (uint64_t k=0; k<ldistance; k=k+1) {
+        acc += ((A[i*ldistance + k])*(B[k*ldistance + j]));
+      }
+      C[i*ldistance + j] = alpha*acc + beta*C[i*ldistance + j];
+    }
+   }
+#endif
+  this->setFlops(2 * TILE_DIM * TILE_DIM * ldistance);
 );
 
 // IMPLEMENT_CODELET(MatMultReduc_2048L,
@@ -10,6 +10,12 @@ DEFINE_MEMORY_CODELET(LoadSqTile_2048L, 3, scm::OP_IO::OP1_WR | scm::OP_IO::OP2_
 // C += AxB Where A, B, and C are 128x128 square matrices.
 DEFINE_CODELET(MatMult_2048L, 3, scm::OP_IO::OP1_WR | scm::OP_IO::OP1_RD | scm::OP_IO::OP2_RD | scm::OP_IO::OP3_RD); 
 
+// [address C, address A, address B, ldistance, i, j, alpha, beta]
+// C_ij = alpha*A_i*B_j + beta*C_ij, where C_ij is the 128x128 tile (i, j) of C, A_i is the row of tiles i of A and
+// B_j the column of tiles j of B. The three matrices are square, with ldistance elements per row. The tiles are
+// read and written directly in memory, so it does not use 2048L registers. alpha and beta are integer literals
+DEFINE_MEMORY_CODELET(GemmTile_2048L, 8, scm::OP_IO::OP1_RD | scm::OP_IO::OP2_RD | scm::OP_IO::OP3_RD | scm::OP_IO::OP4_RD | scm::OP_IO::OP5_RD | scm::OP_IO::OP6_RD, scm::OP_ADDRESS::OP1_IS_ADDRESS | scm::OP_ADDRESS::OP2_IS_ADDRESS | scm::OP_ADDRESS::OP3_IS_ADDRESS | scm::OP_ADDRESS::OP4_IS_ADDRESS | scm::OP_ADDRESS::OP5_IS_ADDRESS | scm::OP_ADDRESS::OP6_IS_ADDRESS); 
+
 // // C += AxB Where A, B, and C are 128x128 square matrices.
 // DEFINE_CODELET(MatMultReduc_2048L, 3, scm::OP_IO::OP1_WR | scm::OP_IO::OP1_RD | scm::OP_IO::OP2_RD | scm::OP_IO::OP3_RD); 
 
@@ -34,6 +34,9 @@ uint32_t KDIM;
 static struct {
   bool fileInput = false;
   char * fileName;
+  bool roofline = false;
+  char * scheduleRecord = nullptr;
+  char * scheduleReplay = nullptr;
   uint32_t MDIM_OPT;
   uint32_t NDIM_OPT;
   uint32_t KDIM_OPT;
@@ -76,14 +79,13 @@ int SCMUlate();
 
 int main (int argc, char * argv[]) {
   unsigned char * memory;
+  scm::memory_manager_module memManager(SIZEOFMEM, scm::PLACE_FIRST_TOUCH);
   // argv[1] = M_tiles, argv[2] = N_tiles, argv[3] = K_tiles
-  try {
-    memory = new unsigned char[SIZEOFMEM];
-  }
-  catch (int e) {
-    std::cout << "An exception occurred. Exception Nr. " << e << '\n';
+  if (!memManager.isValid()) {
+    std::cout << "Could not allocate the SCM memory" << std::endl;
     return 1;
   }
+  memory = memManager.getL2Memory();
 
   parseProgramOptions(argc, argv);
   MDIM = program_options.MDIM_OPT;
@@ -182,6 +184,8 @@ int main (int argc, char * argv[]) {
 
 
 
+  // Tiles are placed close to the CU that owns them before initialization
+  memManager.firstTouch(A_offset, C_offset + NumElements_C*sizeof(double) - A_offset);
   double *A = reinterpret_cast<double*> (&memory[A_offset]); 
   double *B = reinterpret_cast<double*> (&memory[B_offset]); 
   double *C = reinterpret_cast<double*> (&memory[C_offset]);
@@ -212,12 +216,21 @@ int main (int argc, char * argv[]) {
   scm::scm_machine * myMachine;
   if (program_options.fileInput) {
     SCMULATE_INFOMSG(0, "Reading program file %s", program_options.fileName);
-    myMachine = new scm::scm_machine(program_options.fileName, memory, scm::OOO);
+    myMachine = new scm::scm_machine(program_options.fileName, &memManager, scm::OOO);
   } else {
     std::cout << "Need to give a file to read. use -i <filename>" << std::endl;
     return 1;
   }
 
+  if (program_options.roofline)
+    myMachine->setRoofline();
+  if (program_options.scheduleReplay != nullptr) {
+    if (!myMachine->setScheduleReplay(program_options.scheduleReplay))
+      std::cout << "Could not replay the schedule " << program_options.scheduleReplay << std::endl;
+  } else if (program_options.scheduleRecord != nullptr && !myMachine->setScheduleRecord(program_options.scheduleRecord)) {
+    std::cout << "Could not create the schedule log " << program_options.scheduleRecord << std::endl;
+  }
+
   if (myMachine->run() != scm::SCM_RUN_SUCCESS) {
     SCMULATE_ERROR(0, "THERE WAS AN ERROR WHEN RUNNING THE SCM MACHINE");
     return 1;
@@ -251,7 +264,6 @@ int main (int argc, char * argv[]) {
   if (success)
     printf("SUCCESS!!!\n");
   delete myMachine;
-  delete [] memory;
   delete [] testC;
   delete [] warmA;
   delete [] warmB;
@@ -260,6 +272,11 @@ int main (int argc, char * argv[]) {
 }
 
 void parseProgramOptions(int argc, char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    // Roofline report of the codelets when the machine finishes
+    if (strcmp(argv[i], "-roofline") == 0)
+      program_options.roofline = true;
+  }
   // there are other arguments
   program_options.MDIM_OPT = 1;
   program_options.NDIM_OPT = 1;
@@ -279,6 +296,13 @@ void parseProgramOptions(int argc, char* argv[]) {
     if (strcmp(argv[i], "-K") == 0) {
       program_options.KDIM_OPT = std::atoi(argv[++i]);
     }
+    // Log the scheduling decisions of the run, or force the ones of a previous run
+    if (strcmp(argv[i], "-record") == 0) {
+      program_options.scheduleRecord = argv[++i];
+    }
+    if (strcmp(argv[i], "-replay") == 0) {
+      program_options.scheduleReplay = argv[++i];
+    }
   }
 }
 
@@ -0,0 +1,28 @@
+// C = A*B + C with one GemmTile_2048L per tile of C. A, B and C must be square (-M n -N n -K n)
+LDIMM R64B_1, 0;     // 
+LDOFF R64B_10, R64B_1, 0;    // Load M
+LDOFF R64B_11, R64B_1, 8;   // Load N
+LDOFF R64B_13, R64B_1, 24;  // Load Add_a
+LDOFF R64B_14, R64B_1, 32;  // Load Add_b
+LDOFF R64B_15, R64B_1, 40;  // Load Add_c
+LDOFF R64B_22, R64B_1, 96;  // Load Off_b (elements per row)
+
+LDIMM R64B_2, 0; // For i iteration variable
+LDIMM R64B_3, 0; // For j iteration variable
+
+loop_i:
+  BREQ R64B_2, R64B_10, after_loop_i;
+  loop_j:
+    BREQ R64B_3, R64B_11, after_loop_j;
+    COD GemmTile_2048L R64B_15, R64B_13, R64B_14, R64B_22, R64B_2, R64B_3, 1, 1;
+    ADD R64B_3, R64B_3, 1; // j++
+    JMPLBL loop_j;
+
+after_loop_j:
+  LDIMM R64B_3, 0; // Reset j index loop
+  ADD R64B_2, R64B_2, 1; // i++
+  JMPLBL loop_i;
+
+after_loop_i:
+
+COMMIT;
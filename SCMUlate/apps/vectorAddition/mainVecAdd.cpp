@@ -33,7 +33,14 @@ void parseProgramOptions(int argc, char* argv[]);
 int SCMUlate();
 
 int main (int argc, char * argv[]) {
-  l2_memory * memory = new l2_memory;
+  scm::memory_manager_module memManager(sizeof(l2_memory), scm::PLACE_FIRST_TOUCH);
+  // Each chunk of the vectors is placed close to the CU that owns it before initialization
+  if (!memManager.isValid()) {
+    std::cout << "Could not allocate the SCM memory" << std::endl;
+    return 1;
+  }
+  memManager.firstTouch(0, sizeof(l2_memory));
+  l2_memory * memory = reinterpret_cast<l2_memory *>(memManager.getL2Memory());
   parseProgramOptions(argc, argv);
   
   double *A = memory->A; 
@@ -48,7 +55,7 @@ int main (int argc, char * argv[]) {
   scm::scm_machine * myMachine;
   if (program_options.fileInput) {
     SCMULATE_INFOMSG(0, "Reading program file %s", program_options.fileName);
-    myMachine = new scm::scm_machine(program_options.fileName, (unsigned char *)memory, scm::OOO);
+    myMachine = new scm::scm_machine(program_options.fileName, &memManager, scm::OOO);
   } else {
     std::cout << "Need to give a file to read. use -i <filename>" << std::endl;
     return 1;
@@ -74,7 +81,6 @@ int main (int argc, char * argv[]) {
   if (success)
     printf("SUCCESS!!!\n");
   delete myMachine;
-  delete memory;
   return 0;
 }
 
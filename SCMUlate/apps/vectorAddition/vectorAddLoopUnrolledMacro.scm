@@ -0,0 +1,46 @@
+// Vector addition unrolled by the program preprocessor. With UNROLL = 8 it expands to the
+// same loop than vectorAddLoopUnrolled2.scm. Use -D UNROLL=<n> to change the factor.
+// UNROLL must divide ITERATIONS, and it can be at most 12 (3*UNROLL registers of 2048L)
+.set UNROLL 8
+.set ITERATIONS 4000
+.set CHUNK 131072 // Bytes of each vector processed by one copy of the body
+
+// Copy i of the body uses R2048L_{3i+1} and R2048L_{3i+2} as inputs, R2048L_{3i+3} as
+// output, and R64B_{i+5} as offset
+.macro load_inputs i
+  LDOFF R2048L_\{3*i+1}, R64B_1, R64B_\{i+5};
+  LDOFF R2048L_\{3*i+2}, R64B_2, R64B_\{i+5};
+.endm
+
+LDIMM R64B_1, 0; // Loading base address A
+LDIMM R64B_2, 524288000; // Loading base address B
+LDIMM R64B_3, 1048576000; // Loading base address C
+
+LDIMM R64B_4, 0; // For iteration variable
+.unroll i, UNROLL
+LDIMM R64B_\{i+5}, \{i*CHUNK}; // Offset of each copy
+.endr
+LDIMM R64B_29, \ITERATIONS; // For number of iterations
+
+loop:
+  BREQ R64B_4, R64B_29, end;
+  .unroll i, UNROLL
+  load_inputs \i;
+  .endr
+
+  .unroll i, UNROLL
+  COD vecAdd_2048L R2048L_\{3*i+3}, R2048L_\{3*i+1}, R2048L_\{3*i+2};
+  .endr
+
+  .unroll i, UNROLL
+  STOFF R2048L_\{3*i+3}, R64B_3, R64B_\{i+5};
+  .endr
+
+  ADD R64B_4, R64B_4, \UNROLL;
+  .unroll i, UNROLL
+  ADD R64B_\{i+5}, R64B_\{i+5}, \{UNROLL*CHUNK};
+  .endr
+  JMPLBL loop;
+
+end:
+COMMIT;
@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+#include "codelet.hpp"
+#include "system_codelets.hpp"
+
+/* Codelet creation benchmarks
+ *
+ * The decoder creates the codelet of a COD instruction from its name, and the SU clones it
+ * into the pool of its type for every copy of the instruction (see trace_cache.hpp)
+ */
+
+static void BM_CodeletCreateByName(benchmark::State & state) {
+  scm::codelet_params params;
+  std::string name = "print";
+  for (auto _ : state) {
+    scm::codelet * cod = scm::codeletFactory::createCodelet(name, params);
+    benchmark::DoNotOptimize(cod);
+    scm::codeletFactory::destroyCodelet(cod);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CodeletCreateByName);
+
+static void BM_CodeletCreateByID(benchmark::State & state) {
+  scm::codelet_params params;
+  int32_t id = scm::codeletFactory::getCodeletID("print");
+  if (id < 0) {
+    state.SkipWithError("the print codelet is not registered");
+    return;
+  }
+  for (auto _ : state) {
+    scm::codelet * cod = scm::codeletFactory::createCodelet(static_cast<uint32_t>(id), params);
+    benchmark::DoNotOptimize(cod);
+    scm::codeletFactory::destroyCodelet(cod);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CodeletCreateByID);
+
+static void BM_CodeletClone(benchmark::State & state) {
+  scm::codelet_params params;
+  scm::codelet * prototype = scm::codeletFactory::createCodelet("print", params);
+  if (prototype == nullptr) {
+    state.SkipWithError("the print codelet is not registered");
+    return;
+  }
+  for (auto _ : state) {
+    scm::codelet * cod = scm::codeletFactory::cloneCodelet(prototype);
+    benchmark::DoNotOptimize(cod);
+    scm::codeletFactory::destroyCodelet(cod);
+  }
+  scm::codeletFactory::destroyCodelet(prototype);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CodeletClone);
@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include "control_store.hpp"
+
+/* Execution slot benchmarks
+ *
+ * The SU inserts an instruction in the slot of a CU, the CU consumes it and marks it
+ * EXECUTION_DONE, and the SU sees the new state. This is the handoff of every dispatch.
+ * - InsertConsume: both sides in the same thread, the cost of the slot itself
+ * - RoundTrip: a thread plays the CU. With cross_core:1 the two threads are pinned to
+ *   different cores (the usual case of the machine), with cross_core:0 to the same one
+ */
+
+static void BM_ExecutionSlotInsertConsume(benchmark::State & state) {
+  scm::execution_slot slot;
+  scm::instruction_state_pair pair(nullptr, scm::instruction_state::READY);
+  for (auto _ : state) {
+    pair.second = scm::instruction_state::EXECUTING;
+    slot.try_insert(&pair);
+    slot.consume();
+    benchmark::DoNotOptimize(pair.second);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ExecutionSlotInsertConsume);
+
+static bool pinThread(pthread_t thread, int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+static void BM_ExecutionSlotRoundTrip(benchmark::State & state) {
+  bool crossCore = state.range(0) != 0;
+  unsigned numCPUs = std::thread::hardware_concurrency();
+  if (crossCore && numCPUs < 2) {
+    state.SkipWithError("cross_core needs 2 CPUs");
+    return;
+  }
+  cpu_set_t original;
+  pthread_getaffinity_np(pthread_self(), sizeof(original), &original);
+  if (!pinThread(pthread_self(), 0)) {
+    state.SkipWithError("could not pin the SU thread");
+    return;
+  }
+
+  scm::execution_slot slot;
+  scm::instruction_state_pair pair(nullptr, scm::instruction_state::READY);
+  std::atomic<bool> stop(false);
+  // On a single core the two sides must yield to each other
+  bool yield = !crossCore;
+  std::thread cu([&]() {
+    pinThread(pthread_self(), crossCore ? 1 : 0);
+    while (!stop.load(std::memory_order_relaxed)) {
+      if (!slot.is_empty())
+        slot.consume();
+      else if (yield)
+        std::this_thread::yield();
+    }
+  });
+
+  for (auto _ : state) {
+    pair.second = scm::instruction_state::EXECUTING;
+    while (!slot.try_insert(&pair))
+      ;
+    while (true) {
+      #pragma omp flush acquire
+      if (pair.second == scm::instruction_state::EXECUTION_DONE)
+        break;
+      if (yield)
+        std::this_thread::yield();
+    }
+  }
+  stop = true;
+  cu.join();
+  pthread_setaffinity_np(pthread_self(), sizeof(original), &original);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ExecutionSlotRoundTrip)->ArgName("cross_core")->Arg(1)->Arg(0)->UseRealTime();
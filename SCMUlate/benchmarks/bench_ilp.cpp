@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include "ilp_controller.hpp"
+#include "instruction_mem.hpp"
+#include "register.hpp"
+
+/* Out of order controller benchmark
+ *
+ * Runs the loop of the SU over a program of ADD instructions without the CUs: each
+ * iteration fetches one instruction into a window of the given size, checks the
+ * instructions that wait, and retires the executed ones with the ILP controller. The
+ * instructions execute until the window is full, then the oldest one finishes, so there
+ * are up to window instructions in the tables of the controller. The throughput is the
+ * number of retired instructions.
+ * - hazards:0 the instructions are independent
+ * - hazards:1 every instruction reads the results of the previous ones and overwrites
+ *   registers that are still read, so there are stalls and renames
+ */
+
+#define ILP_PROGRAM_SIZE 256
+
+static void generateILPProgram(const char * fileName, bool hazards) {
+  std::ofstream program(fileName);
+  for (int i = 0; i < ILP_PROGRAM_SIZE; i++) {
+    if (hazards)
+      program << "ADD R64B_" << 1 + i % 8 << ", R64B_" << 1 + (i + 7) % 8 << ", R64B_" << 1 + (i + 5) % 8 << ";\n";
+    else
+      program << "ADD R64B_" << 1 + i % 64 << ", R64B_100, R64B_101;\n";
+  }
+  program << "COMMIT;\n";
+}
+
+static void BM_ILPOoO(benchmark::State & state) {
+  bool hazards = state.range(0) != 0;
+  size_t window = state.range(1);
+  char fileName[] = "bench_ilp.scm";
+  generateILPProgram(fileName, hazards);
+  scm::reg_file_module reg_file_m;
+  scm::inst_mem_module inst_mem(fileName, &reg_file_m);
+  std::remove(fileName);
+  if (!inst_mem.isValid()) {
+    state.SkipWithError("could not load the program");
+    return;
+  }
+
+  // One copy of each instruction, as the trace cache of the SU. The program is larger than
+  // the window, so the copy of a PC has retired when the PC is fetched again
+  std::vector<std::unique_ptr<scm::decoded_instruction_t>> copies;
+  std::vector<scm::instruction_state_pair> pairs(ILP_PROGRAM_SIZE);
+  for (int pc = 0; pc < ILP_PROGRAM_SIZE; pc++) {
+    copies.emplace_back(new scm::decoded_instruction_t(*inst_mem.fetch(pc)));
+    pairs[pc].first = copies.back().get();
+  }
+
+  scm::ilp_OoO ilp(&reg_file_m);
+  std::deque<scm::instruction_state_pair *> buffer;
+  scm::instruction_state_pair * stalling = nullptr;
+  int pc = 0;
+  uint64_t retired = 0;
+  for (auto _ : state) {
+    if (buffer.size() == window) {
+      auto oldest = std::find_if(buffer.begin(), buffer.end(), [](scm::instruction_state_pair * pair) {
+        return pair->second == scm::instruction_state::EXECUTING; });
+      if (oldest != buffer.end())
+        (*oldest)->second = scm::instruction_state::EXECUTION_DONE;
+    }
+    if (stalling == nullptr && buffer.size() < window) {
+      scm::instruction_state_pair * pair = &pairs[pc];
+      pair->first->restore(*inst_mem.fetch(pc));
+      pair->second = scm::instruction_state::WAITING;
+      buffer.push_back(pair);
+      ilp.checkMarkInstructionToSched(pair);
+      if (pair->second == scm::instruction_state::STALL)
+        stalling = pair;
+      pc = (pc + 1) % ILP_PROGRAM_SIZE;
+    } else if (stalling != nullptr && stalling->second != scm::instruction_state::STALL) {
+      stalling = nullptr;
+    }
+    for (auto pair : buffer) {
+      switch (pair->second) {
+        case scm::instruction_state::STALL:
+        case scm::instruction_state::WAITING:
+          ilp.checkMarkInstructionToSched(pair);
+          if (pair->second == scm::instruction_state::STALL)
+            stalling = pair;
+          break;
+        case scm::instruction_state::READY:
+          pair->second = scm::instruction_state::EXECUTING;
+          break;
+        case scm::instruction_state::EXECUTION_DONE:
+          if (stalling == pair)
+            stalling = nullptr;
+          ilp.instructionFinished(pair);
+          pair->second = scm::instruction_state::DECOMMISSION;
+          retired++;
+          break;
+        default:
+          break;
+      }
+    }
+    buffer.erase(std::remove_if(buffer.begin(), buffer.end(), [](scm::instruction_state_pair * pair) {
+      return pair->second == scm::instruction_state::DECOMMISSION; }), buffer.end());
+  }
+  state.counters["retired_per_iteration"] = static_cast<double>(retired) / state.iterations();
+  state.SetItemsProcessed(retired);
+}
+BENCHMARK(BM_ILPOoO)->ArgNames({"hazards", "window"})->ArgsProduct({{0, 1}, {8, 64}});
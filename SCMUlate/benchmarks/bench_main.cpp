@@ -0,0 +1,61 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/* Microbenchmarks of the runtime
+ *
+ * Each bench_*.cpp registers the benchmarks of one component. The results are written to
+ * scm_bench_<commit>.json unless --benchmark_out is given, and the commit and the flags
+ * of the build are recorded in the context of the file. Compare two files with
+ * compare.py to find the regressions between two commits.
+ *
+ * Usage: scm_bench [--benchmark_filter=<regex>] [--benchmark_out=<file>] [...]
+ */
+
+static std::string runGit(const char * args) {
+  std::string command = std::string("git -C \"") + SCM_BENCH_SOURCE_DIR + "\" " + args + " 2>/dev/null";
+  FILE * pipe = popen(command.c_str(), "r");
+  if (pipe == nullptr)
+    return "";
+  std::string result;
+  char buffer[256];
+  while (fgets(buffer, sizeof(buffer), pipe) != nullptr)
+    result += buffer;
+  pclose(pipe);
+  while (!result.empty() && (result.back() == '\n' || result.back() == '\r'))
+    result.pop_back();
+  return result;
+}
+
+int main(int argc, char * argv[]) {
+  std::string commit = runGit("rev-parse --short HEAD");
+  if (commit.empty())
+    commit = "unknown";
+  else if (!runGit("status --porcelain --untracked-files=no").empty())
+    commit += "-dirty";
+
+  // Default output file, named after the commit
+  std::vector<char *> args(argv, argv + argc);
+  bool hasOut = false;
+  for (int i = 1; i < argc; i++)
+    if (strncmp(argv[i], "--benchmark_out=", 16) == 0)
+      hasOut = true;
+  std::string out = "--benchmark_out=scm_bench_" + commit + ".json";
+  std::string format = "--benchmark_out_format=json";
+  if (!hasOut) {
+    args.push_back(&out[0]);
+    args.push_back(&format[0]);
+  }
+  int numArgs = args.size();
+
+  benchmark::Initialize(&numArgs, args.data());
+  if (benchmark::ReportUnrecognizedArguments(numArgs, args.data()))
+    return 1;
+  benchmark::AddCustomContext("scm_commit", commit);
+  benchmark::AddCustomContext("scm_build", SCM_BENCH_BUILD);
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include "ilp_controller.hpp"
+
+/* Memory queue benchmarks
+ *
+ * The memory queue controller keeps the ranges of the memory instructions in flight. Each
+ * benchmark starts with range_pairs instructions in the queue (one read and one write range
+ * each) and measures the operations of the SU on a new instruction:
+ * - AddRemove: the instruction is issued and retired
+ * - OverlapMiss: the hazard check of an instruction that does not overlap
+ * - OverlapHit: the hazard check of an instruction that writes a range that is read
+ */
+
+#define RANGE_STRIDE 8192
+#define RANGE_SIZE 2048
+
+static l2_memory_t rangeAddress(uint64_t offset) {
+  // The ranges are never dereferenced
+  return reinterpret_cast<l2_memory_t>(static_cast<uintptr_t>(0x10000000 + offset));
+}
+
+// Reads at [0, 2048) and writes at [4096, 6144) of each stride
+static void fillQueue(scm::memory_queue_controller & queue, std::vector<scm::memranges_pair> & resident, int64_t numPairs) {
+  resident.resize(numPairs);
+  for (int64_t i = 0; i < numPairs; i++) {
+    resident[i].reads.insert(scm::memory_location(rangeAddress(i * RANGE_STRIDE), RANGE_SIZE));
+    resident[i].writes.insert(scm::memory_location(rangeAddress(i * RANGE_STRIDE + 4096), RANGE_SIZE));
+    queue.addRange(&resident[i]);
+  }
+}
+
+// An instruction in the gaps of the middle stride. removeRanges needs a read and a write
+static scm::memranges_pair missProbe(int64_t numPairs) {
+  scm::memranges_pair probe;
+  uint64_t base = (numPairs / 2) * RANGE_STRIDE;
+  probe.reads.insert(scm::memory_location(rangeAddress(base + 2048), 1024));
+  probe.writes.insert(scm::memory_location(rangeAddress(base + 6144), 1024));
+  return probe;
+}
+
+static void BM_MemoryQueueAddRemove(benchmark::State & state) {
+  scm::memory_queue_controller queue;
+  std::vector<scm::memranges_pair> resident;
+  fillQueue(queue, resident, state.range(0));
+  scm::memranges_pair probe = missProbe(state.range(0));
+  for (auto _ : state) {
+    queue.addRange(&probe);
+    queue.removeRanges(&probe);
+  }
+  state.counters["ranges"] = queue.numberOfRanges();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MemoryQueueAddRemove)->ArgName("range_pairs")->RangeMultiplier(8)->Range(1, 4096);
+
+static void BM_MemoryQueueOverlapMiss(benchmark::State & state) {
+  scm::memory_queue_controller queue;
+  std::vector<scm::memranges_pair> resident;
+  fillQueue(queue, resident, state.range(0));
+  scm::memranges_pair probe = missProbe(state.range(0));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(queue.itOverlaps(&probe));
+  if (queue.itOverlaps(&probe))
+    state.SkipWithError("the probe overlaps");
+  state.counters["ranges"] = queue.numberOfRanges();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MemoryQueueOverlapMiss)->ArgName("range_pairs")->RangeMultiplier(8)->Range(1, 4096);
+
+static void BM_MemoryQueueOverlapHit(benchmark::State & state) {
+  scm::memory_queue_controller queue;
+  std::vector<scm::memranges_pair> resident;
+  fillQueue(queue, resident, state.range(0));
+  scm::memranges_pair probe;
+  probe.writes.insert(scm::memory_location(rangeAddress((state.range(0) / 2) * RANGE_STRIDE + 1024), 2048));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(queue.itOverlaps(&probe));
+  if (!queue.itOverlaps(&probe))
+    state.SkipWithError("the probe does not overlap");
+  state.counters["ranges"] = queue.numberOfRanges();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MemoryQueueOverlapHit)->ArgName("range_pairs")->RangeMultiplier(8)->Range(1, 4096);
@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+#include "instruction_mem.hpp"
+#include "register.hpp"
+#include <fstream>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/* Program load benchmarks
+ *
+ * Generates synthetic programs of 1K, 10K and 100K lines, and measures the time to parse
+ * them (ProgramParse), and the time to load them into the instruction memory, parsing and
+ * decoding the operands (ProgramLoad). The throughput is in lines per second
+ */
+
+static void generateProgram(const char * fileName, uint64_t numLines) {
+  std::ofstream program(fileName);
+  uint64_t line = 0;
+  for (uint64_t block = 0; line + 9 < numLines; block++) {
+    program << "loop_" << block << ":\n"
+            << "LDIMM R64B_1, " << block << ";\n"
+            << "ADD R64B_2, R64B_1, 4;\n"
+            << "LDOFF R1L_3, R64B_2, 64;\n"
+            << "STOFF R1L_3, R64B_2, 128;\n"
+            << "SUB R64B_4, R64B_4, R64B_1; // Loop counter\n"
+            << "MULT R64B_5, R64B_2, 3;\n"
+            << "COD print R64B_5, 8;\n"
+            << "BGT R64B_1, R64B_2, loop_" << block << ";\n";
+    line += 9;
+  }
+  for (; line + 1 < numLines; line++)
+    program << "// padding\n";
+  program << "COMMIT;\n";
+}
+
+static void BM_ProgramParse(benchmark::State & state) {
+  char fileName[] = "bench_program_parse.scm";
+  generateProgram(fileName, state.range(0));
+  std::vector<std::string> lines;
+  std::ifstream program(fileName);
+  std::string line;
+  while (std::getline(program, line))
+    lines.push_back(line);
+  std::remove(fileName);
+
+  for (auto _ : state) {
+    for (auto & text : lines) {
+      scm::decoded_instruction_t * inst = nullptr;
+      std::string label, error;
+      scm::instructions::parseLine(text, &inst, label, error);
+      delete inst;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ProgramParse)->ArgName("lines")->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMillisecond);
+
+static void BM_ProgramLoad(benchmark::State & state) {
+  char fileName[] = "bench_program_load.scm";
+  generateProgram(fileName, state.range(0));
+  scm::reg_file_module reg_file_m;
+  for (auto _ : state) {
+    scm::inst_mem_module * inst_mem = new scm::inst_mem_module(fileName, &reg_file_m);
+    if (!inst_mem->isValid()) {
+      delete inst_mem;
+      state.SkipWithError("could not load the program");
+      break;
+    }
+    state.PauseTiming();
+    delete inst_mem;
+    state.ResumeTiming();
+  }
+  std::remove(fileName);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ProgramLoad)->ArgName("lines")->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,48 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include "register.hpp"
+
+/* Register file benchmarks
+ *
+ * The look ups done when the instructions are decoded (register by name and size) and
+ * renamed (next register of a size), over the classes of the default register file
+ */
+
+static const char * regSizes[] = {"64B", "1L", "256L", "2048L"};
+
+static void BM_RegisterByName(benchmark::State & state) {
+  scm::reg_file_module reg_file_m;
+  std::string size = regSizes[state.range(0)];
+  uint32_t numRegs = reg_file_m.getNumRegForSize(scm::reg_file_module::getRegisterSizeInBytes(size));
+  uint32_t num = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(reg_file_m.getRegisterByName(size, num));
+    if (++num == numRegs)
+      num = 0;
+  }
+  state.SetLabel(size);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RegisterByName)->ArgName("size")->DenseRange(0, 3);
+
+static void BM_RegisterSizeInBytes(benchmark::State & state) {
+  std::string size = regSizes[state.range(0)];
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(size);
+    benchmark::DoNotOptimize(scm::reg_file_module::getRegisterSizeInBytes(size));
+  }
+  state.SetLabel(size);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RegisterSizeInBytes)->ArgName("size")->DenseRange(0, 3);
+
+static void BM_RegisterNext(benchmark::State & state) {
+  scm::reg_file_module reg_file_m;
+  uint32_t size = scm::reg_file_module::getRegisterSizeInBytes(regSizes[state.range(0)]);
+  uint32_t num = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(reg_file_m.getNextRegister(size, num));
+  state.SetLabel(regSizes[state.range(0)]);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RegisterNext)->ArgName("size")->DenseRange(0, 3);
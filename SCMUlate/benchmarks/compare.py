@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""Compare two result files of scm_bench
+
+Prints the change of the time of each benchmark that is in both files, and exits with 1
+if any of them is slower than the threshold (a fraction, 0.1 by default).
+
+Usage: compare.py <base.json> <new.json> [threshold]
+"""
+
+import json
+import sys
+
+TIME_UNITS = {"ns": 1, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(file_name):
+    with open(file_name) as f:
+        data = json.load(f)
+    results = {}
+    for bench in data.get("benchmarks", []):
+        # Only the iterations, or the mean if there are repetitions
+        if bench.get("run_type") == "aggregate" and bench.get("aggregate_name") != "mean":
+            continue
+        if "error_occurred" in bench and bench["error_occurred"]:
+            continue
+        results[bench["run_name"] if "run_name" in bench else bench["name"]] = bench["real_time"] * TIME_UNITS[bench.get("time_unit", "ns")]
+    return data.get("context", {}).get("scm_commit", file_name), results
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__)
+        return 2
+    threshold = float(sys.argv[3]) if len(sys.argv) > 3 else 0.1
+    base_commit, base = load(sys.argv[1])
+    new_commit, new = load(sys.argv[2])
+
+    print("%-60s %14s %14s %8s" % ("benchmark (ns)", base_commit, new_commit, "change"))
+    regressions = 0
+    for name in base:
+        if name not in new or base[name] == 0:
+            continue
+        change = new[name] / base[name] - 1
+        mark = ""
+        if change > threshold:
+            mark = " SLOWER"
+            regressions += 1
+        elif change < -threshold:
+            mark = " faster"
+        print("%-60s %14.1f %14.1f %+7.1f%%%s" % (name, base[name], new[name], change * 100, mark))
+    missing = [name for name in base if name not in new]
+    if missing:
+        print("Not in %s: %s" % (sys.argv[2], ", ".join(missing)))
+    print("%d regressions over %.0f%%" % (regressions, threshold * 100))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
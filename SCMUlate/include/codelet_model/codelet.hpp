@@ -3,6 +3,8 @@
 
 #include <map>
 #include <set>
+#include <vector>
+#include <new>
 #include <iostream>
 #include "SCMUlate_tools.hpp"
 #include "instructions_def.hpp"
@@ -21,27 +23,11 @@ namespace scm {
    */
   class codelet_params {
     private: 
-      unsigned char** params;
-      bool *isAddress;
-      size_t size_params;
+      // Inline storage. Copying the parameters does not allocate memory
+      unsigned char* params[MAX_NUM_OPERANDS];
+      bool isAddress[MAX_NUM_OPERANDS];
     public:
-      codelet_params() {
-        size_params = MAX_NUM_OPERANDS * sizeof(unsigned char*);
-        params = new unsigned char* [size_params];
-        isAddress = new bool [MAX_NUM_OPERANDS];
-        std::memset(isAddress, 0, sizeof(bool)*MAX_NUM_OPERANDS);
-      }
-      // Copy constructor
-      codelet_params(const codelet_params &other) : size_params(other.size_params) {
-        if (other.params != nullptr) {
-          params = new unsigned char* [size_params];
-          std::memcpy(this->params, other.params, other.size_params);
-        } else {
-          this->params = nullptr;
-        }
-        isAddress = new bool [MAX_NUM_OPERANDS];
-        std::memcpy(this->isAddress, other.isAddress, sizeof(bool)*MAX_NUM_OPERANDS);
-      }
+      codelet_params() : params(), isAddress() { }
 
       void inline setParamAsAddress(uint32_t bitmapParams = scm::OP_ADDRESS::NO_ADDRESS) {
         int curParam = 0;
@@ -85,11 +71,6 @@ namespace scm {
       }
 
       void * getParams() { return this->params; }
-      ~codelet_params() {
-        if (this->params != nullptr)
-          delete[] params;
-        delete[] isAddress;
-      }
   };
   
   class codelet {
@@ -103,12 +84,19 @@ namespace scm {
       codelet_params params;
       std::uint_fast16_t op_in_out;
       cu_executor_module * myExecutor;
+      uint32_t codelet_id; /**< Position of the type in codeletFactory::registeredTypes */
+      bool pooled;         /**< The memory of the codelet belongs to the pool of its type */
+      uint64_t flops;      /**< Floating point operations declared by the implementation. 0 if not declared */
+      friend class codeletFactory;
     public:
-      codelet () {};
-      codelet (uint32_t nparms, codelet_params params, std::uint_fast16_t opIO) : numParams(nparms), memoryRanges(nullptr), params(params), op_in_out(opIO) {};
-      codelet (const codelet &other) : numParams(other.numParams), memoryRanges(nullptr), params(other.params), op_in_out(other.op_in_out), myExecutor(other.myExecutor) {}
+      codelet () : codelet_id(0), pooled(false), flops(0) {};
+      codelet (uint32_t nparms, codelet_params params, std::uint_fast16_t opIO) : numParams(nparms), memoryRanges(nullptr), params(params), op_in_out(opIO), myExecutor(nullptr), codelet_id(0), pooled(false), flops(0) {};
+      codelet (const codelet &other) : numParams(other.numParams), memoryRanges(nullptr), params(other.params), op_in_out(other.op_in_out), myExecutor(other.myExecutor), codelet_id(other.codelet_id), pooled(false), flops(0) {}
       virtual void implementation() = 0;
+      /** \brief copy construct this codelet in memory, which must be large enough for its type */
+      virtual codelet * clone_into(void * memory) const = 0;
       virtual bool isMemoryCodelet() { return false; }
+      virtual bool isLightweight() { return false; }
       virtual void calculateMemRanges() { };
       void setMemoryRange( memranges_pair * memRange ) { this->memoryRanges = memRange; };
       memranges_pair * getMemoryRange() { return memoryRanges; };
@@ -117,6 +105,10 @@ namespace scm {
       inline std::uint_fast16_t& getOpIO() { return op_in_out; };
       inline void setExecutor (cu_executor_module * exec) {this->myExecutor = exec;}
       inline cu_executor_module * getExecutor() {return this->myExecutor;}
+      inline uint32_t getCodeletID() const { return this->codelet_id; }
+      /** \brief declare the floating point operations of this execution. Called by the implementation, used by the roofline report */
+      inline void setFlops(uint64_t count) { this->flops = count; }
+      inline uint64_t getFlops() const { return this->flops; }
       l2_memory_t getAddress(uint64_t addr);
       l2_memory_t getAddress(l2_memory_t addr);
       virtual ~codelet() { }
@@ -124,11 +116,39 @@ namespace scm {
 
   typedef codelet* (*creatorFnc)(codelet_params);
 
+  /** \brief A codelet type registered in the factory
+   *
+   * The clones of the codelets are placed in a pool of memory of their type, so copying
+   * an instruction does not allocate memory once the pool has grown
+   */
+  struct codelet_type_t {
+    std::string name;
+    creatorFnc creator;
+    size_t size;                    /**< Size of the codelet class */
+    std::vector<void *> free_slots; /**< Memory of the pool that is not used */
+  };
+
   class codeletFactory {
+    private:
+      static void growPool(codelet_type_t & type);
     public:
-      static std::map <std::string, creatorFnc> *registeredCodelets;
-      static void registerCreator(std::string name, creatorFnc fnc);
+      /** Name of the codelet to its dense ID. The ID is the position in registeredTypes */
+      static std::map <std::string, uint32_t> *registeredCodelets;
+      static std::vector <codelet_type_t> *registeredTypes;
+      static void registerCreator(std::string name, creatorFnc fnc, size_t size);
+      /** \brief ID of a codelet, or -1 if it is not registered */
+      static int32_t getCodeletID(std::string const & name);
+      /** \brief create a codelet from its name. It must be deleted with destroyCodelet (or delete) */
       static codelet* createCodelet(std::string name, codelet_params usedParams);
+      static codelet* createCodelet(uint32_t id, codelet_params usedParams);
+      /** \brief copy a codelet into the pool of its type
+       *
+       * There is no look up by name and no allocation, unless the pool is empty.
+       * The pools are not thread safe. Clones are created and destroyed by the SU
+       */
+      static codelet* cloneCodelet(codelet const * prototype);
+      /** \brief delete a codelet, returning its memory to the pool if it is a clone */
+      static void destroyCodelet(codelet * cod);
   };
 }
 
@@ -137,7 +157,8 @@ namespace scm {
 #define COD_CLASS_NAME(name) _cod_ ## name
 #define COD_INSTANCE_NAME(name, post) _cod_ ## name ## post
 
-#define DEFINE_CODELET(name, nparms, opIO) \
+// Body shared by DEFINE_CODELET and DEFINE_LIGHT_CODELET. members is added to the class
+#define DEFINE_CODELET_CLASS(name, nparms, opIO, members) \
   namespace scm { \
    class COD_CLASS_NAME(name) : public codelet { \
     public: \
@@ -151,11 +172,14 @@ namespace scm {
       static codelet* codeletCreator(codelet_params usedParams) ; \
       static void registerCodelet() { \
         creatorFnc thisFunc = codeletCreator; \
-        codeletFactory::registerCreator( #name, thisFunc); \
+        codeletFactory::registerCreator( #name, thisFunc, sizeof(COD_CLASS_NAME(name))); \
       }\
       \
+      virtual codelet * clone_into(void * memory) const { return new (memory) COD_CLASS_NAME(name)(*this); } \
+      \
       /* Implementation function */ \
       virtual void implementation(); \
+      members \
       \
       /* destructor */ \
       ~COD_CLASS_NAME(name)() {} \
@@ -163,6 +187,14 @@ namespace scm {
     \
   }
 
+#define DEFINE_CODELET(name, nparms, opIO) \
+  DEFINE_CODELET_CLASS(name, nparms, opIO, )
+
+// Lightweight codelets are executed by the SU instead of being dispatched to a CU.
+// They must be short, and they cannot use getAddress() since there is no executor.
+#define DEFINE_LIGHT_CODELET(name, nparms, opIO) \
+  DEFINE_CODELET_CLASS(name, nparms, opIO, virtual bool isLightweight() { return true; })
+
 #define DEFINE_MEMORY_CODELET(name, nparms, opIO, opAddr) \
   namespace scm { \
    class COD_CLASS_NAME(name) : public codelet { \
@@ -179,7 +211,7 @@ namespace scm {
       static codelet* codeletCreator(codelet_params usedParams) ; \
       static void registerCodelet() { \
         creatorFnc thisFunc = codeletCreator; \
-        codeletFactory::registerCreator( #name, thisFunc); \
+        codeletFactory::registerCreator( #name, thisFunc, sizeof(COD_CLASS_NAME(name))); \
       }\
       void inline addReadMemRange(uint64_t start, uint32_t size) { \
         memoryRanges->reads.emplace(reinterpret_cast<l2_memory_t>(start), size); \
@@ -188,6 +220,8 @@ namespace scm {
         memoryRanges->writes.emplace(reinterpret_cast<l2_memory_t>(start), size); \
       } \
       \
+      virtual codelet * clone_into(void * memory) const { return new (memory) COD_CLASS_NAME(name)(*this); } \
+      \
       /* Implementation function */ \
       virtual void implementation(); \
       virtual bool isMemoryCodelet() { return true; } \
@@ -0,0 +1,106 @@
+#ifndef __INSTRUCTION_LEXER__
+#define __INSTRUCTION_LEXER__
+
+/**
+ * This file contains the tokenizer used to read a line of an SCM program. It does a single
+ * pass over the line without copying it. The tokens point to the original line, therefore
+ * the line must outlive the tokens.
+ *
+ * Tokens:
+ *   WORD      [a-zA-Z_][a-zA-Z0-9_]*  (instruction names, registers, labels, codelet names)
+ *   NUMBER    [-]?[0-9]+
+ *   COMMA     ,
+ *   SEMICOLON ;
+ *   COLON     :
+ *   END       end of the line or beginning of a // comment
+ *   INVALID   any other character
+ *
+ * Spaces and tabs are ignored
+ */
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include "instructions_def.hpp"
+
+namespace scm {
+
+  struct inst_token_t {
+    enum token_type {END, WORD, NUMBER, COMMA, SEMICOLON, COLON, INVALID} type;
+    const char * start;
+    uint32_t length;
+
+    inline std::string str() const { return std::string(start, length); }
+    inline bool is(const char * word) const {
+      return type == WORD && std::strncmp(start, word, length) == 0 && word[length] == '\0';
+    }
+
+    /** \brief kind of operand this token represents (OP_KIND::NONE if it is not an operand)
+     *
+     * Registers are R followed by [BbLl0-9_]+, labels are any other word that starts with a letter
+     */
+    inline std::uint_fast8_t operandKind() const {
+      if (type == NUMBER)
+        return OP_KIND::IMM;
+      if (type != WORD)
+        return OP_KIND::NONE;
+      if (start[0] == 'R' && length > 1) {
+        bool reg = true;
+        for (uint32_t i = 1; i < length && reg; i++) {
+          char c = start[i];
+          reg = (c >= '0' && c <= '9') || c == 'B' || c == 'b' || c == 'L' || c == 'l' || c == '_';
+        }
+        if (reg)
+          return OP_KIND::REG;
+      }
+      return start[0] != '_' ? OP_KIND::LBL : OP_KIND::NONE;
+    }
+  };
+
+  class inst_lexer {
+    private:
+      const char * cur;
+      const char * end;
+
+      static inline bool isWordChar(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+      }
+      static inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    public:
+      inst_lexer(std::string const & line) : cur(line.data()), end(line.data() + line.size()) { }
+
+      /** \brief the rest of the line that has not been tokenized */
+      inline std::string rest() const { return std::string(cur, end - cur); }
+
+      inst_token_t next() {
+        while (cur != end && (*cur == ' ' || *cur == '\t' || *cur == '\r'))
+          cur++;
+        inst_token_t tok = {inst_token_t::END, cur, 0};
+        if (cur == end || (*cur == '/' && cur + 1 != end && cur[1] == '/'))
+          return tok;
+        const char * start = cur;
+        if (isWordChar(*cur) && !isDigit(*cur)) {
+          while (cur != end && isWordChar(*cur))
+            cur++;
+          tok.type = inst_token_t::WORD;
+        } else if (isDigit(*cur) || (*cur == '-' && cur + 1 != end && isDigit(cur[1]))) {
+          cur++;
+          while (cur != end && isDigit(*cur))
+            cur++;
+          tok.type = inst_token_t::NUMBER;
+        } else {
+          switch (*cur++) {
+            case ',': tok.type = inst_token_t::COMMA; break;
+            case ';': tok.type = inst_token_t::SEMICOLON; break;
+            case ':': tok.type = inst_token_t::COLON; break;
+            default: tok.type = inst_token_t::INVALID; break;
+          }
+        }
+        tok.length = cur - start;
+        return tok;
+      }
+  };
+}
+
+#endif
@@ -2,29 +2,23 @@
 #define __INSTRUCTIONS__
 
 /**
- * This file contains all the definitions of the regular expressions that allow to identify 
- * an instruction and its operands. It also defines the enum with the different instruction types
- * that is used by the SCM machine during fetch_decode of the program
- *
- * This file also defines the scm::instructions class that contains static methods that can be used
- * to identify the type of an instruction, as well as to extract the operands of the instruction
+ * This file contains the decoded instruction, and the scm::instructions class that contains
+ * static methods that can be used to parse a line of a program, identify the type of an
+ * instruction, as well as to extract the operands of the instruction
  *
  * The purpose of this file is to separate the definiton of the supported instructions
  * from the fetch_decode operation, as well as the instruction meomry operation
  *
- * TODO: This file should be replace by some sort of parser, but for now I have not definied the 
- * language correctly, and I am no front end expert, so this will have to do until then. 
- *
  */
 
 #include <string>
-#include <regex>
 #include <iostream>
 #include "codelet.hpp"
 #include "SCMUlate_tools.hpp"
 #include "stringHelper.hpp"
 #include "register.hpp"
 #include "instructions_def.hpp"
+#include "instruction_lexer.hpp"
 #include <unordered_map>
 
 
@@ -44,36 +38,43 @@ namespace scm {
     private:
       /** \brief contains the break down of an instruction
        * This class splits out an instruction into its instruction kind and the different operands 
-       * innitially we use only 3 address instructions. If it contains 2 or 1 operands the other 
-       * are ignored by the fetch_decode
+       * An instruction has up to MAX_NUM_OPERANDS operands. The operands that are not used have
+       * an empty string, and they are ignored by the fetch_decode
        *
        */
       instType type;
       opcode_t opcode;
       std::string instruction;
-      std::string op1_s;
-      std::string op2_s;
-      std::string op3_s;
+      std::string ops_s[MAX_NUM_OPERANDS];
       std::uint_fast16_t op_in_out;
       codelet * cod_exec;
-      operand_t op1;
-      operand_t op2;
-      operand_t op3;
+      operand_t ops[MAX_NUM_OPERANDS];
       memranges_pair memRanges;
       std::unordered_map<decoded_reg_t, reg_state> inst_operand_dir;
+      uint32_t pc; /**< Address of the instruction in the instruction memory. Set in the copies of the SU */
+      bool traced; /**< Its events are recorded in the trace. Decided by the SU when it is fetched */
+      uint64_t fetch_seq; /**< Number of instructions the SU fetched before this one. Set by the SU when it is fetched */
 
    public:
       // Constructors
       decoded_instruction_t (instType type, opcode_t opc) :
-        type(type), opcode(opc), instruction(""), op1_s(""), op2_s(""), op3_s(""), op_in_out(OP_IO::NO_RD_WR), cod_exec(nullptr), op1(), op2(), op3() {}
+        type(type), opcode(opc), instruction(""), op_in_out(OP_IO::NO_RD_WR), cod_exec(nullptr), pc(0), traced(true), fetch_seq(0) {}
       decoded_instruction_t (instType type, opcode_t opcode, std::string inst, std::string op1s = std::string(), std::string op2s = std::string(), std::string op3s = std::string()) :
-        type(type), opcode(opcode), instruction(inst), op1_s(op1s), op2_s(op2s), op3_s(op3s), op_in_out(OP_IO::NO_RD_WR), cod_exec(nullptr), op1(), op2(), op3()  {}
+        type(type), opcode(opcode), instruction(inst), op_in_out(OP_IO::NO_RD_WR), cod_exec(nullptr), pc(0), traced(true), fetch_seq(0)  {
+          ops_s[0] = op1s;
+          ops_s[1] = op2s;
+          ops_s[2] = op3s;
+        }
 
       decoded_instruction_t (const decoded_instruction_t &other) :
-              type(other.type), opcode(other.opcode), instruction(other.instruction), op1_s(other.op1_s), op2_s(other.op2_s), op3_s(other.op3_s), op_in_out(other.op_in_out),cod_exec(nullptr), op1(other.op1), op2(other.op2), op3(other.op3), memRanges(other.memRanges), inst_operand_dir(other.inst_operand_dir) {
+              type(other.type), opcode(other.opcode), instruction(other.instruction), op_in_out(other.op_in_out),cod_exec(nullptr), memRanges(other.memRanges), inst_operand_dir(other.inst_operand_dir), pc(other.pc), traced(other.traced), fetch_seq(other.fetch_seq) {
+                for (int i = 0; i < MAX_NUM_OPERANDS; i++) {
+                  ops_s[i] = other.ops_s[i];
+                  ops[i] = other.ops[i];
+                }
+                // The codelet is cloned into the pool of its type. No look up by name or allocation
                 if (other.cod_exec != nullptr) {
-                  codelet_params newParams = other.cod_exec->getParams();
-                  this->cod_exec = codeletFactory::createCodelet(getInstruction(), newParams);
+                  this->cod_exec = codeletFactory::cloneCodelet(other.cod_exec);
                   this->cod_exec->setMemoryRange(&memRanges);
                 }
               }
@@ -94,11 +95,27 @@ namespace scm {
       inline std::string getFullInstruction() { 
         std::string fullInstWithRename("");
         fullInstWithRename += instruction + std::string(" ");
-        fullInstWithRename += (op1.type == operand_t::REGISTER ? op1.value.reg.reg_name : op1_s) + (op2_s.length() != 0? std::string(", "): std::string(""));
-        fullInstWithRename += (op2.type == operand_t::REGISTER ? op2.value.reg.reg_name : op2_s) + (op3_s.length() != 0? std::string(", "): std::string(""));
-        fullInstWithRename += (op3.type == operand_t::REGISTER ? op3.value.reg.reg_name : op3_s);
+        for (int i = 0; i < MAX_NUM_OPERANDS && ops_s[i].length() != 0; i++) {
+          if (i != 0)
+            fullInstWithRename += std::string(", ");
+          fullInstWithRename += (ops[i].type == operand_t::REGISTER ? ops[i].value.reg.reg_name : ops_s[i]);
+        }
         return fullInstWithRename; 
       }
+      /** \brief get the address of the instruction in the instruction memory
+       */
+      inline uint32_t getPC() { return pc; }
+      /** \brief set the address of the instruction in the instruction memory
+       */
+      inline void setPC(uint32_t address) { pc = address; }
+      /** \brief the events of the instruction are recorded in the trace (see trace_mode_t)
+       */
+      inline bool isTraced() { return traced; }
+      inline void setTraced(bool isTraced) { traced = isTraced; }
+      /** \brief position of the instruction in the order of fetch. The same in every run of a program
+       */
+      inline uint64_t getFetchSeq() { return fetch_seq; }
+      inline void setFetchSeq(uint64_t seq) { fetch_seq = seq; }
       /** \brief get Codelet
        */
       inline codelet * getExecCodelet() { return cod_exec; }
@@ -113,70 +130,66 @@ namespace scm {
       inline std::uint_fast16_t getOpIO() { return op_in_out; }
       /** \brief set the op1 
        */
-      inline void setOp1(operand_t newOpVal) { op1 = newOpVal; }
+      inline void setOp1(operand_t newOpVal) { ops[0] = newOpVal; }
       /** \brief set the op2
        */
-      inline void setOp2(operand_t newOpVal) { op2 = newOpVal; }
+      inline void setOp2(operand_t newOpVal) { ops[1] = newOpVal; }
       /** \brief set the op3
        */
-      inline void setOp3(operand_t newOpVal) { op3 = newOpVal; }
-      /** \brief get operand by number
-       * TODO: This is wrong in so many levels. We need to remove the limit
-       * on three operands. It should be a little bit more clever than this.
+      inline void setOp3(operand_t newOpVal) { ops[2] = newOpVal; }
+      /** \brief get operand by number. Operands start in 1
        */
       inline operand_t& getOp(int num) {
         if (num < 1 || num > MAX_NUM_OPERANDS) {
           SCMULATE_ERROR(0, "getOp(num) called with an incorrect operand number");
           num = (num % MAX_NUM_OPERANDS) + 1;
         } 
-        if (num == 1)
-          return op1;
-        else if (num == 2)
-          return op2;
-        return op3;
+        return ops[num-1];
       }
-      /** \brief get operand string by number
-       * TODO: This is wrong in so many levels. We need to remove the limit
-       * on three operands. It should be a little bit more clever than this.
+      /** \brief get operand string by number. Operands start in 1
        */
       inline std::string& getOpStr(int num) {
         if (num < 1 || num > MAX_NUM_OPERANDS) {
           SCMULATE_ERROR(0, "getOp(num) called with an incorrect operand number");
           num = (num % MAX_NUM_OPERANDS) + 1;
         } 
-        if (num == 1)
-          return op1_s;
-        else if (num == 2)
-          return op2_s;
-        return op3_s;
+        return ops_s[num-1];
+      }
+      /** \brief number of operands of the instruction
+       */
+      inline int getNumOps() {
+        int num = 0;
+        while (num < MAX_NUM_OPERANDS && ops_s[num].length() != 0)
+          num++;
+        return num;
       }
       /** \brief get the op1 
        */
-      inline operand_t& getOp1() { return op1; }
+      inline operand_t& getOp1() { return ops[0]; }
       /** \brief get the op2
        */
-      inline operand_t& getOp2() { return op2; }
+      inline operand_t& getOp2() { return ops[1]; }
       /** \brief get the op3
        */
-      inline operand_t& getOp3() { return op3; }
+      inline operand_t& getOp3() { return ops[2]; }
       /** \brief get the op1_s
        */
-      inline std::string getOp1Str() { return op1_s; }
+      inline std::string getOp1Str() { return ops_s[0]; }
       /** \brief get the op2_s
        */
-      inline std::string getOp2Str() { return op2_s; }
+      inline std::string getOp2Str() { return ops_s[1]; }
       /** \brief get the op3_s
        */
-      inline std::string getOp3Str() { return op3_s; }
+      inline std::string getOp3Str() { return ops_s[2]; }
       /** \brief set the op1_s 
        */
-      inline void setOp1Str(std::string str) { op1_s = str; }
+      inline void setOp1Str(std::string str) { ops_s[0] = str; }
       /** \brief set the op2_s
        */
-      inline void setOp2Str(std::string str) { op2_s = str; }
+      inline void setOp2Str(std::string str) { ops_s[1] = str; }
       /** \brief set the op3_s
        */
-      inline void setOp3Str(std::string str) { op3_s = str; }
+      inline void setOp3Str(std::string str) { ops_s[2] = str; }
 
       bool decodeOperands(inst_mem_module * const reg_file_m);
 
@@ -209,6 +222,23 @@ namespace scm {
 
       std::unordered_map<decoded_reg_t, reg_state>* getOperandsDirs() {return &inst_operand_dir; }
 
+      /** \brief restore a copy of an instruction so it can be scheduled again
+       *
+       * The ILP controller renames the operands of the copies in the instruction buffer, and it
+       * changes the directions, the memory ranges and the codelet parameters. This method sets
+       * them back to the values of the original instruction. The strings and the codelet of the
+       * copy are kept, which is cheaper than a new copy (see trace_cache.hpp)
+       */
+      inline void restore(decoded_instruction_t & original) {
+        op_in_out = original.op_in_out;
+        for (int i = 0; i < MAX_NUM_OPERANDS; i++)
+          ops[i] = original.ops[i];
+        memRanges.reads.clear();
+        memRanges.writes.clear();
+        inst_operand_dir = original.inst_operand_dir;
+        updateCodeletParams();
+      }
+
       /** \brief Tells if a register represents an address value of a memory instruction or codelet
        * 
        * When an operand represents an address and this one has not been calculated, it is not 
@@ -222,8 +252,7 @@ namespace scm {
 
       ~decoded_instruction_t() {
         if (type == EXECUTE_INST) {
-          // TODO depending on the type this to change the casting
-          delete cod_exec;
+          codeletFactory::destroyCodelet(cod_exec);
         }
       }
   };
@@ -243,279 +272,75 @@ namespace scm {
        *
        *  This class provides the necessary methods to identify what type of instructions 
        *  there a particular string is. It also contains other helper functions 
+       *
+       *  Lines are read with a single pass tokenizer (see instruction_lexer.hpp), and the
+       *  instruction is found in a table built from the instruction definitions
        */
       instructions() {};
 
+      /** \brief Kind of line in a program */
+      enum line_kind {EMPTY_LINE, LABEL_LINE, INSTRUCTION_LINE, INVALID_LINE};
+
+      /** \brief Parse a line of a program
+       *  \param line the text of the line
+       *  \param decInst set to the new instruction when the line is INSTRUCTION_LINE, or to
+       *         an UNKNOWN instruction when the line is INVALID_LINE
+       *  \param label set to the label when the line is LABEL_LINE
+       *  \param error set to the reason when the line is INVALID_LINE
+       *  \returns the kind of line
+       *
+       *  Empty lines and comment lines are EMPTY_LINE. Anything after the ':' of a label, or
+       *  after the ';' of an instruction is ignored.
+       */
+      static line_kind parseLine(std::string const & line, decoded_instruction_t ** decInst, std::string & label, std::string & error);
+
       /** \brief Find the instruction type
        *  \param inst the corresponding instruction text to identify
        *  \returns the instType with the corresponding type
        *  \sa instType
        */
-      static inline decoded_instruction_t* findInstType(std::string const inst);
+      static decoded_instruction_t* findInstType(std::string const & inst);
 
       /** \brief Is the instruction type COMMENT
        *  \param inst the corresponding instruction text to identify
        *  \returns true or false if the instruction is COMMENT type
        */
-      static inline bool isComment(std::string const inst);
+      static bool isComment(std::string const & inst);
 
       /** \brief Is the instruction type LABEL
        *  \param inst the corresponding instruction text to identify
        *  \returns true or false if the instruction is LABEL type
        */
-      static inline bool isLabelInst(std::string const inst);
+      static bool isLabelInst(std::string const & inst);
 
       /** \brief Is the operand a LABEL
        *  \param op the corresponding operand text to identify
        *  \returns true or false if the operand is LABEL type
        */
-      static inline bool isLabel(std::string const op);
-
-      /** \brief Is the instruction type COMMIT
-       *  \param inst the corresponding instruction text to identify
-       *  \returns true or false if the instruction is COMMIT type
-       */
-      static inline bool isCommit(std::string const inst, decoded_instruction_t ** decInst);
+      static bool isLabel(std::string const & op);
 
       /** \brief Obtain name and size of register
        *  \param op the operand that contains the enconded register
        *  \returns a decoded_reg_t that contains name and value separately
        *  \sa decoded_reg_t
        */
-      static inline decoded_reg_t decodeRegister(std::string const op);
+      static decoded_reg_t decodeRegister(std::string const & op);
 
       /** \brief Is the operand a register type or inmediate value
        *  \param op the operand that we want to check
        *  \returns true if the operand encodes a register, false otherwise 
        */
-      static inline bool isRegister(std::string const op);
-
-      /** \brief Is the instruction type CONTROL_INST
-       *  \param inst the corresponding instruction text to identify
-       *  \returns true or false if the instruction is CONTROL type
-       *  \sa instType
-       */
-      static inline bool isControlInst(std::string const inst, decoded_instruction_t ** decInst);
-
-      /** \brief Is the instruction type BASIC_ARITH_INST
-       *  \param inst the corresponding instruction text to identify
-       *  \returns true or false if the instruction is CONTROL type
-       *  \sa instType
-       */
-      static inline bool isBasicArith(std::string const inst, decoded_instruction_t ** decInst);
-
-      /** \brief Is the instruction type EXECUTE_INST
-       *  \param inst the corresponding instruction text to identify
-       *  \returns true or false if the instruction is CONTROL type
-       *  \sa instType
-       */
-      static inline bool isExecution(std::string const inst, decoded_instruction_t ** decInst);
-      
-      /** \brief Is the instruction type MEMORY_INST
-       *  \param inst the corresponding instruction text to identify
-       *  \returns true or false if the instruction is CONTROL type
-       *  \sa instType
-       */
-      static inline bool isMemory(std::string const ints, decoded_instruction_t ** decInst);
+      static bool isRegister(std::string const & op);
 
       /** \brief extract the label from the instruction name
        *  \param inst the corresponding instruction text to extract the label from
        *  \returns the label in a string
        *  \se isLabel
        */
-      static inline std::string getLabel(std::string const inst);
+      static std::string getLabel(std::string const & inst);
 
   };
 
-  decoded_instruction_t *
-    instructions::findInstType(std::string const instruction) {
-      decoded_instruction_t* dec = NULL;
-      isCommit(instruction, &dec);
-      if (!dec) isControlInst(instruction, &dec);
-      if (!dec) isBasicArith(instruction, &dec);
-      if (!dec) isExecution(instruction, &dec);
-      if (!dec) isMemory(instruction, &dec);
-      if (!dec) dec = new decoded_instruction_t(UNKNOWN, 0xFF);
-      return dec;
-    }
-
-  bool 
-    instructions::isCommit(std::string const inst, decoded_instruction_t ** decInst) {
-      std::regex search_exp(COMMIT_INST.inst_regex, std::regex_constants::ECMAScript);
-      std::smatch matches;
-      if (std::regex_search(inst.begin(), inst.end(), matches, search_exp)) {
-        *decInst = new decoded_instruction_t(COMMIT, COMMIT_INST.opcode, matches[1]);
-        return true;
-      }
-      decInst = NULL;
-      return false;
-    }
-
-  bool 
-    instructions::isRegister(std::string const op) {
-      std::regex search_exp(REGISTER_REGEX, std::regex_constants::ECMAScript);
-      if (std::regex_match(op, search_exp))
-        return true;
-      return false;
-    }
-
-  bool 
-    instructions::isComment(std::string const inst) {
-      std::regex search_exp(COMMENT_REGEX, std::regex_constants::ECMAScript);
-      if (std::regex_match(inst, search_exp))
-        return true;
-      return false;
-    }
-
-  bool 
-    instructions::isLabel(std::string const op) {
-      std::regex search_exp(LABEL_REGEX, std::regex_constants::ECMAScript);
-      if (std::regex_match(op, search_exp))
-        return true;
-      return false;
-    }
-
-  bool 
-    instructions::isLabelInst(std::string const inst) {
-      std::regex search_exp(LABEL_INST.inst_regex, std::regex_constants::ECMAScript);
-      if (std::regex_match(inst, search_exp))
-        return true;
-      return false;
-    }
-
-  decoded_reg_t
-    instructions::decodeRegister(std::string const op) {
-      std::regex search_exp(REGISTER_SPLIT_REGEX, std::regex_constants::ECMAScript);
-      std::smatch matches;
-      decoded_reg_t res(op, std::string(""), 0, 0, nullptr);
-      if (std::regex_search(op.begin(), op.end(), matches, search_exp)) {
-         res.reg_size = matches[1];
-         res.reg_number = std::stoi(matches[2]);
-      }
-      return res;
-    }
-
-  std::string
-    instructions::getLabel(std::string const inst) {
-      std::regex search_exp(LABEL_INST.inst_regex, std::regex_constants::ECMAScript);
-      std::smatch matches;
-      if (std::regex_search(inst.begin(), inst.end(), matches, search_exp)) {
-        return matches[1];
-      }
-      return "";
-    }
-
-  bool 
-    instructions::isControlInst(std::string const inst, decoded_instruction_t ** decInst) {
-      for (size_t i = 0; i < NUM_OF_INST(controlInsts); i++) {
-        std::regex search_exp(controlInsts[i].inst_regex, std::regex_constants::ECMAScript);
-        std::smatch matches;
-        if (std::regex_search(inst.begin(), inst.end(), matches, search_exp)) {
-          if (controlInsts[i].num_op == 0) {
-            *decInst = new decoded_instruction_t(CONTROL_INST, controlInsts[i].opcode, matches[1], "" , "", "");
-          } else if (controlInsts[i].num_op == 1) {
-            *decInst = new decoded_instruction_t(CONTROL_INST, controlInsts[i].opcode, matches[1], matches[2] , "", "");
-          } else if (controlInsts[i].num_op == 2) {
-            *decInst = new decoded_instruction_t(CONTROL_INST, controlInsts[i].opcode, matches[1], matches[2] , matches[3], "");
-          } else if (controlInsts[i].num_op == 3) {
-            *decInst = new decoded_instruction_t(CONTROL_INST, controlInsts[i].opcode, matches[1], matches[2] , matches[3], matches[4]);
-          } else {
-            SCMULATE_ERROR(0, "Unsupported number of operands for CONTROL instruction");
-          }
-          (*decInst)->setOpIO(controlInsts[i].op_in_out);
-          return true; 
-        }
-      }
-      decInst = NULL;
-      return false;
-    }
-
-  bool 
-    instructions::isBasicArith(std::string const inst, decoded_instruction_t ** decInst) {
-      for (size_t i = 0; i < NUM_OF_INST(basicArithInsts); i++) {
-        std::regex search_exp(basicArithInsts[i].inst_regex, std::regex_constants::ECMAScript);
-        std::smatch matches;
-        if (std::regex_search(inst.begin(), inst.end(), matches, search_exp)) {
-          if (basicArithInsts[i].num_op == 0) {
-            *decInst = new decoded_instruction_t(BASIC_ARITH_INST, basicArithInsts[i].opcode, matches[1], "" , "", "");
-          } else if (basicArithInsts[i].num_op == 1) {
-            *decInst = new decoded_instruction_t(BASIC_ARITH_INST, basicArithInsts[i].opcode, matches[1], matches[2] , "", "");
-          } else if (basicArithInsts[i].num_op == 2) {
-            *decInst = new decoded_instruction_t(BASIC_ARITH_INST, basicArithInsts[i].opcode, matches[1], matches[2] , matches[3], "");
-          } else if (basicArithInsts[i].num_op == 3) {
-            *decInst = new decoded_instruction_t(BASIC_ARITH_INST, basicArithInsts[i].opcode, matches[1], matches[2] , matches[3], matches[4]);
-          } else {
-            SCMULATE_ERROR(0, "Unsupported number of operands for BASIC_ARITH_INST instruction");
-          }
-          (*decInst)->setOpIO(basicArithInsts[i].op_in_out);
-          return true; 
-        }
-      }
-      decInst = NULL;
-      return false;
-    }
-
-  bool 
-    instructions::isExecution(std::string const inst, decoded_instruction_t ** decInst) {
-      std::regex search_exp(CODELET_INST.inst_regex, std::regex_constants::ECMAScript);
-      std::smatch matches;
-      if (std::regex_search(inst.begin(), inst.end(), matches, search_exp)) {
-        std::string operands = matches[2];
-        std::string delimiter(",");
-        size_t pos = 0;
-        size_t opNum = 0;
-        std::string token;
-        *decInst = new decoded_instruction_t(EXECUTE_INST, CODELET_INST.opcode);
-        (*decInst)->setInstruction(matches[1]);
-        while (operands.length() != 0) {
-          pos = operands.find(delimiter);
-          if (pos == std::string::npos) pos = operands.length();
-          token = operands.substr(0, pos);
-          token = trim(token);
-          if (opNum == 0) {
-            (*decInst)->setOp1Str(token);
-          } else if (opNum == 1) {
-            (*decInst)->setOp2Str(token);
-          } else if (opNum == 2) {
-            (*decInst)->setOp3Str(token);
-          } else {
-            SCMULATE_ERROR(0, "Unsupported number of operands for EXECUTE_INST instruction");
-            break;
-          }
-          operands.erase(0, pos + delimiter.length());
-          opNum++;
-        }
-        return true; 
-      }
-      decInst = NULL;
-      return false;
-    }
-    
-  bool 
-    instructions::isMemory(std::string const inst, decoded_instruction_t ** decInst) {
-      for (size_t i = 0; i < NUM_OF_INST(memInsts); i++) {
-        std::regex search_exp(memInsts[i].inst_regex, std::regex_constants::ECMAScript);
-        std::smatch matches;
-        if (std::regex_search(inst.begin(), inst.end(), matches, search_exp)) {
-          if (memInsts[i].num_op == 0) {
-            *decInst = new decoded_instruction_t(MEMORY_INST, memInsts[i].opcode, matches[1], "" , "", "");
-          } else if (memInsts[i].num_op == 1) {
-            *decInst = new decoded_instruction_t(MEMORY_INST, memInsts[i].opcode, matches[1], matches[2] , "", "");
-          } else if (memInsts[i].num_op == 2) {
-            *decInst = new decoded_instruction_t(MEMORY_INST, memInsts[i].opcode, matches[1], matches[2] , matches[3], "");
-          } else if (memInsts[i].num_op == 3) {
-            *decInst = new decoded_instruction_t(MEMORY_INST, memInsts[i].opcode, matches[1], matches[2] , matches[3], matches[4]);
-          } else {
-            SCMULATE_ERROR(0, "Unsupported number of operands for MEMORY_INST instruction");
-          }
-          (*decInst)->setOpIO(memInsts[i].op_in_out);
-          return true; 
-        }
-      }
-      decInst = NULL;
-      return false;
-    }
-
 }
 
 #endif
@@ -3,30 +3,26 @@
 
 
 /**
- * This file contains all the definitions of the regular expressions that allow to identify 
- * an instruction and its operands. It also defines the enum with the different instruction types
- * that is used by the SCM machine during fetch_decode of the program
+ * This file contains the definition of the instructions and the kind of operands each one
+ * accepts. It also defines the enum with the different instruction types that is used by
+ * the SCM machine during fetch_decode of the program
  *
- * This file also defines the scm::instructions class that contains static methods that can be used
- * to identify the type of an instruction, as well as to extract the operands of the instruction
+ * The instruction tables are used by the parser (see instruction_lexer.hpp) to identify
+ * an instruction and to check its operands. The syntax of an instruction is:
+ *   NAME op1, op2, op3; // comment
+ * where each operand is a register (R<size>_<num>), an immediate ([-]<digits>) or a label
+ * ([a-zA-Z][a-zA-Z0-9_]*), according to the kinds in its definition.
  *
  * The purpose of this file is to separate the definiton of the supported instructions
  * from the fetch_decode operation, as well as the instruction meomry operation
  *
- * TODO: This file should be replace by some sort of parser, but for now I have not definied the 
- * language correctly, and I am no front end expert, so this will have to do until then. 
- *
  */
 
 #include <string>
+#include <set>
+#include "system_config.hpp"
 
-#define REGISTER_REGEX "R[BbLl0-9_]+"
-#define REGISTER_SPLIT_REGEX "R([BbLl0-9]+)_([0-9]+)"
-#define INMIDIATE_REGEX "[-]?[0-9]+"
-#define LABEL_REGEX "([a-zA-Z][a-zA-Z0-9_]*)"
-#define COMMENT_REGEX "([ ]*//.*|^[ ]+$)"
-
-#define DEF_INST(opcode, name, regExp, numOp, opInOut) {opcode, #name, regExp, numOp, opInOut}
+#define DEF_INST(opcode, name, numOp, opInOut, ...) {opcode, #name, numOp, opInOut, {__VA_ARGS__}}
 #define NUM_OF_INST(a) sizeof(a)/sizeof(inst_def_t)
 
 namespace scm {
@@ -97,6 +93,21 @@ namespace scm {
 
   };
 
+  static_assert(MAX_NUM_OPERANDS <= 8, "OP_IO and OP_ADDRESS only define 8 operands");
+
+  /** \brief Kinds of operands accepted by an instruction
+   *
+   *  Each operand of an instruction definition has a mask with the kinds it accepts
+   */
+  class OP_KIND {
+    public:
+      static constexpr std::uint_fast8_t NONE { 0b000 };
+      static constexpr std::uint_fast8_t REG  { 0b001 }; // R64B_1, R2048L_3
+      static constexpr std::uint_fast8_t IMM  { 0b010 }; // -100, 42
+      static constexpr std::uint_fast8_t LBL  { 0b100 }; // myLabel
+      static constexpr std::uint_fast8_t ANY  { 0b111 };
+  };
+
   typedef uint32_t opcode_t;
 
   /** \brief Instruction definition
@@ -105,7 +116,7 @@ namespace scm {
    *  from the language perspective
    *
    *  To add an instruction you must create it with DEF_INST() and then add it to the vector for 
-   *  the corresponding group
+   *  the corresponding group. The last arguments of DEF_INST() are the OP_KIND of each operand
    * 
    *  OPCODE:
    *  0b 0000 0000 
@@ -121,9 +132,9 @@ namespace scm {
   struct inst_def_t {
     const opcode_t opcode; // 1 bytes. msb => type, lsb =>ID
     std::string inst_name;
-    std::string inst_regex;
     int num_op;
     std::uint_fast16_t op_in_out;
+    std::uint_fast8_t op_kinds[MAX_NUM_OPERANDS]; // OP_KIND mask of each operand
   };
 
   struct memory_location
@@ -154,25 +165,25 @@ namespace scm {
   typedef struct {std::set<memory_location> reads; std::set<memory_location> writes;} memranges_pair;
 
   // SCM specific insctructions
-  const inst_def_t COMMIT_INST = DEF_INST(0x00, COMMIT, "[ ]*(COMMIT;).*", 0, OP_IO::NO_RD_WR);                                          /* COMMIT; */
-  const inst_def_t LABEL_INST = DEF_INST(0x01, LABEL,   "[ ]*" LABEL_REGEX "[ ]*:.*", 0, OP_IO::NO_RD_WR);                                 /* myLabel: */
-  const inst_def_t CODELET_INST = DEF_INST(0x10, CODELET, "[ ]*COD[ ]+([a-zA-Z0-9_]+)[ ]+([a-zA-Z0-9_, ]*);.*", 0, OP_IO::NO_RD_WR);      /* COD codelet_name arg1, arg2, arg3; */
+  const inst_def_t COMMIT_INST = DEF_INST(0x00, COMMIT, 0, OP_IO::NO_RD_WR, OP_KIND::NONE);                                     /* COMMIT; */
+  const inst_def_t LABEL_INST = DEF_INST(0x01, LABEL, 0, OP_IO::NO_RD_WR, OP_KIND::NONE);                                       /* myLabel: */
+  const inst_def_t CODELET_INST = DEF_INST(0x10, CODELET, 0, OP_IO::NO_RD_WR, OP_KIND::NONE);                                   /* COD codelet_name arg1, arg2, ..., arg8; */
   
   // CONTROL FLOW INSTRUCTIONS
   /** \brief All the control instructions
    *
-   * All the different regular expressions used for Control flow instructions.  
-   * each has its own format. This regexp can be used to identify the instruction
-   * or to obtain the parameters
+   * All the different definitions used for Control flow instructions.  
+   * each has its own format. The operand kinds are used to identify the instruction
+   * and to check the parameters
    */
   static inst_def_t const controlInsts[] = {
-    DEF_INST(0x20, JMPLBL,  "[ ]*(JMPLBL)[ ]+(" LABEL_REGEX ");.*", 1, OP_IO::NO_RD_WR),                                                   /* JMPLBL destination;*/
-    DEF_INST(0x21, JMPPC,   "[ ]*(JMPPC)[ ]+(" INMIDIATE_REGEX ");.*", 1, OP_IO::NO_RD_WR),                                                      /* JMPPC -100;*/
-    DEF_INST(0x22, BREQ,    "[ ]*(BREQ)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" LABEL_REGEX ");.*", 3, OP_IO::OP1_RD | OP_IO::OP2_RD),            /* BREQ R1, R2, -100; */
-    DEF_INST(0x23, BGT,     "[ ]*(BGT)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" LABEL_REGEX ");.*", 3, OP_IO::OP1_RD | OP_IO::OP2_RD),             /* BGT R1, R2, -100; */
-    DEF_INST(0x24, BGET,    "[ ]*(BGET)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" LABEL_REGEX ");.*", 3, OP_IO::OP1_RD | OP_IO::OP2_RD),            /* BGET R1, R2, -100; */
-    DEF_INST(0x25, BLT,     "[ ]*(BLT)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" LABEL_REGEX ");.*", 3, OP_IO::OP1_RD | OP_IO::OP2_RD),             /* BLT R1, R2, -100; */
-    DEF_INST(0x26, BLET,    "[ ]*(BLET)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" LABEL_REGEX ");.*", 3, OP_IO::OP1_RD | OP_IO::OP2_RD)};            /* BLET R1, R2, -100; */
+    DEF_INST(0x20, JMPLBL, 1, OP_IO::NO_RD_WR, OP_KIND::LBL),                                                         /* JMPLBL destination;*/
+    DEF_INST(0x21, JMPPC,  1, OP_IO::NO_RD_WR, OP_KIND::IMM),                                                         /* JMPPC -100;*/
+    DEF_INST(0x22, BREQ,   3, OP_IO::OP1_RD | OP_IO::OP2_RD, OP_KIND::REG, OP_KIND::REG, OP_KIND::IMM | OP_KIND::LBL), /* BREQ R1, R2, -100; */
+    DEF_INST(0x23, BGT,    3, OP_IO::OP1_RD | OP_IO::OP2_RD, OP_KIND::REG, OP_KIND::REG, OP_KIND::IMM | OP_KIND::LBL), /* BGT R1, R2, -100; */
+    DEF_INST(0x24, BGET,   3, OP_IO::OP1_RD | OP_IO::OP2_RD, OP_KIND::REG, OP_KIND::REG, OP_KIND::IMM | OP_KIND::LBL), /* BGET R1, R2, -100; */
+    DEF_INST(0x25, BLT,    3, OP_IO::OP1_RD | OP_IO::OP2_RD, OP_KIND::REG, OP_KIND::REG, OP_KIND::IMM | OP_KIND::LBL), /* BLT R1, R2, -100; */
+    DEF_INST(0x26, BLET,   3, OP_IO::OP1_RD | OP_IO::OP2_RD, OP_KIND::REG, OP_KIND::REG, OP_KIND::IMM | OP_KIND::LBL)};/* BLET R1, R2, -100; */
 
   #define JMPLBL_INST controlInsts[0]
   #define JMPPC_INST controlInsts[1]
@@ -185,16 +196,16 @@ namespace scm {
   //BASIC ARITHMETIC INSTRUCTIONS
   /** \brief All the basic arithmetic instructions
    *
-   * All the different regular expressions used for basic arithmetic instructions.  
-   * each has its own format. This regexp can be used to identify the instruction
-   * or to obtain the parameters
+   * All the different definitions used for basic arithmetic instructions.  
+   * each has its own format. The operand kinds are used to identify the instruction
+   * and to check the parameters
    */
   static inst_def_t const basicArithInsts[] = {
-  DEF_INST(0x30, ADD,  "[ ]*(ADD)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" REGISTER_REGEX ")[ ]*;.*", 3, OP_IO::OP1_WR | OP_IO::OP2_RD | OP_IO::OP3_RD),     /* ADD R1, R2, R3; R2 and R3 can be literals*/
-  DEF_INST(0x31, SUB,  "[ ]*(SUB)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" REGISTER_REGEX ")[ ]*;.*", 3, OP_IO::OP1_WR | OP_IO::OP2_RD | OP_IO::OP3_RD),     /* SUB R1, R2, R3; R2 and R3 can be literals*/
-  DEF_INST(0x32, SHFL, "[ ]*(SHFL)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" REGISTER_REGEX ")[ ]*;.*", 2, OP_IO::OP1_RD | OP_IO::OP1_WR | OP_IO::OP2_RD),                            /* SHFL R1, R2; R2 can be a literal representing how many positions to shift*/
-  DEF_INST(0x33, SHFR, "[ ]*(SHFR)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" REGISTER_REGEX ")[ ]*;.*", 2, OP_IO::OP1_RD | OP_IO::OP1_WR | OP_IO::OP2_RD),                            /* SHFR R1, R2; R2 can be a literal representing how many positions to shift*/
-  DEF_INST(0x34, MULT,  "[ ]*(MULT)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" REGISTER_REGEX ")[ ]*;.*", 3, OP_IO::OP1_WR | OP_IO::OP2_RD | OP_IO::OP3_RD)};    /* MULT R1, R2, R3; R2 and R3 can be literals*/
+  DEF_INST(0x30, ADD,  3, OP_IO::OP1_WR | OP_IO::OP2_RD | OP_IO::OP3_RD, OP_KIND::REG, OP_KIND::REG, OP_KIND::IMM | OP_KIND::REG),  /* ADD R1, R2, R3; R3 can be a literal*/
+  DEF_INST(0x31, SUB,  3, OP_IO::OP1_WR | OP_IO::OP2_RD | OP_IO::OP3_RD, OP_KIND::REG, OP_KIND::REG, OP_KIND::IMM | OP_KIND::REG),  /* SUB R1, R2, R3; R3 can be a literal*/
+  DEF_INST(0x32, SHFL, 2, OP_IO::OP1_RD | OP_IO::OP1_WR | OP_IO::OP2_RD, OP_KIND::REG, OP_KIND::REG),                               /* SHFL R1, R2; R2 represents how many positions to shift*/
+  DEF_INST(0x33, SHFR, 2, OP_IO::OP1_RD | OP_IO::OP1_WR | OP_IO::OP2_RD, OP_KIND::REG, OP_KIND::REG),                               /* SHFR R1, R2; R2 represents how many positions to shift*/
+  DEF_INST(0x34, MULT, 3, OP_IO::OP1_WR | OP_IO::OP2_RD | OP_IO::OP3_RD, OP_KIND::REG, OP_KIND::REG, OP_KIND::IMM | OP_KIND::REG)}; /* MULT R1, R2, R3; R3 can be a literal*/
 
   #define ADD_INST basicArithInsts[0]
   #define SUB_INST basicArithInsts[1]
@@ -205,16 +216,16 @@ namespace scm {
   //MEMORY INSTRUNCTIONS
   /** \brief All the memory related instructions
    *
-   * All the different regular expressions used for Control flow instructions.  
-   * each has its own format. This regexp can be used to identify the instruction
-   * or to obtain the parameters
+   * All the different definitions used for memory instructions.  
+   * each has its own format. The operand kinds are used to identify the instruction
+   * and to check the parameters
    */
   static inst_def_t const memInsts[] = {
-  DEF_INST(0x40, LDIMM, "[ ]*(LDIMM)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX ")[ ]*;.*", 2, OP_IO::OP1_WR),                          /* LDADR R1, R2; R2 can be a literal or the address in a the register*/
-  DEF_INST(0x41, LDADR, "[ ]*(LDADR)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" REGISTER_REGEX ")[ ]*;.*", 2, OP_IO::OP1_WR | OP_IO::OP2_RD),                          /* LDADR R1, R2; R2 can be a literal or the address in a the register*/
-  DEF_INST(0x42, LDOFF, "[ ]*(LDOFF)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" REGISTER_REGEX ")[ ]*;.*", 3, OP_IO::OP1_WR | OP_IO::OP2_RD | OP_IO::OP3_RD),  /* LDOFF R1, R2, R3; R1 is the base destination register, R2 is the base address, R3 is the offset. R2 and R3 can be literals */
-  DEF_INST(0x43, STADR, "[ ]*(STADR)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" REGISTER_REGEX ")[ ]*;.*", 2, OP_IO::OP1_RD| OP_IO::OP2_RD),                          /* STADR R1, R2; R2 can be a literal or the address in a the register*/
-  DEF_INST(0x44, STOFF, "[ ]*(STOFF)[ ]+(" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" REGISTER_REGEX ")[ ]*,[ ]*(" INMIDIATE_REGEX "|" REGISTER_REGEX ")[ ]*;.*", 3, OP_IO::OP1_RD | OP_IO::OP2_RD | OP_IO::OP3_RD)};  /* STOFF R1, R2, R3; R1 is the base destination register, R2 is the base address, R3 is the offset. R2 and R3 can be literals */
+  DEF_INST(0x40, LDIMM, 2, OP_IO::OP1_WR, OP_KIND::REG, OP_KIND::IMM),                                                              /* LDIMM R1, 100; */
+  DEF_INST(0x41, LDADR, 2, OP_IO::OP1_WR | OP_IO::OP2_RD, OP_KIND::REG, OP_KIND::IMM | OP_KIND::REG),                               /* LDADR R1, R2; R2 can be a literal or the address in a the register*/
+  DEF_INST(0x42, LDOFF, 3, OP_IO::OP1_WR | OP_IO::OP2_RD | OP_IO::OP3_RD, OP_KIND::REG, OP_KIND::IMM | OP_KIND::REG, OP_KIND::IMM | OP_KIND::REG),  /* LDOFF R1, R2, R3; R1 is the base destination register, R2 is the base address, R3 is the offset. R2 and R3 can be literals */
+  DEF_INST(0x43, STADR, 2, OP_IO::OP1_RD | OP_IO::OP2_RD, OP_KIND::REG, OP_KIND::IMM | OP_KIND::REG),                               /* STADR R1, R2; R2 can be a literal or the address in a the register*/
+  DEF_INST(0x44, STOFF, 3, OP_IO::OP1_RD | OP_IO::OP2_RD | OP_IO::OP3_RD, OP_KIND::REG, OP_KIND::IMM | OP_KIND::REG, OP_KIND::IMM | OP_KIND::REG)};  /* STOFF R1, R2, R3; R1 is the base destination register, R2 is the base address, R3 is the offset. R2 and R3 can be literals */
 
   #define LDIMM_INST memInsts[0]
   #define LDADR_INST memInsts[1]
@@ -0,0 +1,82 @@
+#ifndef __PROGRAM_PREPROCESSOR__
+#define __PROGRAM_PREPROCESSOR__
+
+/**
+ * This file contains the preprocessor of SCM programs. It expands the directives of a
+ * program before the lines are parsed, so the same program can be unrolled by different
+ * factors without keeping a hand-unrolled copy of each variant.
+ *
+ * Directives:
+ *   .set NAME expr            Defines a symbol. Symbols given in the command line (-D NAME=VALUE)
+ *                             take precedence, so the program can be tuned without editing it
+ *   .rept expr ... .endr      Repeats the lines expr times
+ *   .unroll VAR, expr ... .endr
+ *                             Repeats the lines expr times. VAR is the number of the copy (0, 1, ...)
+ *   .macro NAME [P1, P2 ...] ... .endm
+ *                             Defines a macro. It is used as 'NAME arg1, arg2;' (the ';' is optional)
+ *
+ * Substitutions inside lines:
+ *   \NAME      Value of a macro parameter, unroll variable or symbol
+ *   \{expr}    Value of an integer expression (+ - * / % and parentheses) of numbers and names
+ *   \@         Number of the current expansion. Used to create unique labels in macros and loops
+ *
+ * Comments (//) are not expanded. The expanded lines keep the line number of the line of the
+ * program they come from.
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <istream>
+#include <cstdint>
+
+namespace scm {
+
+  struct source_line_t {
+    std::string text;
+    uint32_t line;
+  };
+
+  class program_preprocessor {
+    private:
+      typedef std::map<std::string, std::string> scope_t;
+      struct macro_t {
+        std::vector<std::string> params;
+        std::vector<source_line_t> body;
+      };
+
+      std::map<std::string, int64_t> symbols;
+      std::map<std::string, macro_t> macros;
+      uint64_t expansions;
+      std::string error;
+
+      static std::map<std::string, int64_t> & predefined();
+
+      bool process(std::vector<source_line_t> const & lines, size_t begin, size_t end, scope_t const & scope, uint64_t expansion, uint32_t depth, std::vector<source_line_t> & out);
+      bool findEnd(std::vector<source_line_t> const & lines, size_t begin, size_t end, size_t & found);
+      bool substitute(std::string const & text, scope_t const & scope, uint64_t expansion, uint32_t line, std::string & result);
+      bool evaluate(std::string const & expr, scope_t const & scope, uint32_t line, int64_t & value);
+      bool setError(uint32_t line, std::string const & msg);
+
+    public:
+      program_preprocessor();
+
+      /** \brief expand the program in input into out
+       *
+       * Returns false if a directive is not valid. The message is available in getError()
+       */
+      bool expand(std::istream & input, std::vector<source_line_t> & out);
+      inline std::string const & getError() { return error; }
+
+      /** \brief define a symbol for all the programs loaded after this call
+       *
+       * The symbol cannot be changed by a .set in the program
+       */
+      static void predefine(std::string const & name, int64_t value);
+
+      /** \brief parse and predefine a NAME=VALUE definition from the command line */
+      static bool predefine(std::string const & definition);
+  };
+}
+
+#endif
@@ -4,15 +4,80 @@
 
 namespace scm {
     enum ILP_MODES {SEQUENTIAL, SUPERSCALAR, OOO};
+    enum DISPATCH_POLICIES {ROUND_ROBIN, LEAST_LOADED, REG_AFFINITY};
 }
 
-// This cannot be freely changed. it still has
-// some hardcoded code in the program
-#define MAX_NUM_OPERANDS 3
+// Operands of an instruction or codelet. OP_IO and OP_ADDRESS define
+// the bits of up to 8 operands, so this cannot be larger than 8
+#define MAX_NUM_OPERANDS 8
 
 #define INSTRUCTIONS_BUFFER_SIZE 128
 #define EXECUTION_QUEUE_SIZE 1
 #define INSTRUCTION_FETCH_WINDOW 2
+// Loads and stores of registers up to this size (in bytes) are executed by the SU
+// instead of being dispatched to a CU. LDIMM is always executed by the SU
+#ifndef SU_INLINE_MEM_THRESHOLD
+#define SU_INLINE_MEM_THRESHOLD 64
+#endif
+// A basic block is kept in the trace cache of the SU after the SU enters it this
+// number of times (e.g. the second iteration of a loop). 0 disables the trace cache
+#ifndef TRACE_CACHE_HOT_THRESHOLD
+#define TRACE_CACHE_HOT_THRESHOLD 2
+#endif
+// Copies of the same instruction kept by the trace cache. There can be as many
+// copies in flight as iterations of the loop in the instruction buffer
+#ifndef TRACE_CACHE_MAX_COPIES
+#define TRACE_CACHE_MAX_COPIES 16
+#endif
+// Instructions kept in memory for streamed programs (see instruction_mem.hpp). Power of 2
+#ifndef STREAM_WINDOW_SIZE
+#define STREAM_WINDOW_SIZE 65536
+#endif
+// Instructions behind the PC of a streamed program that are not evicted. This is the
+// longest backward jump. It must be smaller than STREAM_WINDOW_SIZE / 2
+#ifndef STREAM_HISTORY_SIZE
+#define STREAM_HISTORY_SIZE 16384
+#endif
+// Codelets allocated at once when the pool of a codelet type is empty
+#ifndef CODELET_POOL_CHUNK
+#define CODELET_POOL_CHUNK 64
+#endif
+// Events kept in the trace ring of each timer (see timers_counters.hpp). Power of 2
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 65536
+#endif
+// Hardware counters (PAPI or perf_event) kept in each trace record and in the aggregates
+#ifndef TRACE_MAX_HW_COUNTERS
+#define TRACE_MAX_HW_COUNTERS 8
+#endif
+// Milliseconds between two flushes of the trace rings to the binary trace file (-trace)
+#ifndef TRACE_FLUSH_INTERVAL_MS
+#define TRACE_FLUSH_INTERVAL_MS 10
+#endif
+// Milliseconds between two samples of the live metrics (-metrics). -mi overrides it
+#ifndef LIVE_METRICS_INTERVAL_MS
+#define LIVE_METRICS_INTERVAL_MS 1000
+#endif
+// Doubles of each array of the triad that measures the bandwidth of a CU for the roofline report
+#ifndef ROOFLINE_STREAM_ELEMENTS
+#define ROOFLINE_STREAM_ELEMENTS (1 << 23)
+#endif
+// Iterations of the multiply-adds that measure the GFLOP/s of a CU for the roofline report
+#ifndef ROOFLINE_FLOP_ITERATIONS
+#define ROOFLINE_FLOP_ITERATIONS (1 << 20)
+#endif
+// Runs of each peak measurement. The best one is kept
+#ifndef ROOFLINE_PEAK_REPS
+#define ROOFLINE_PEAK_REPS 5
+#endif
+// Bytes of the schedule log (-record) buffered by the SU before they are written
+#ifndef SCHED_LOG_BUFFER_SIZE
+#define SCHED_LOG_BUFFER_SIZE (1 << 20)
+#endif
+// Iterations of the SU without progress after which a replay (-replay) is considered diverged
+#ifndef SCHED_REPLAY_STALL_ITERATIONS
+#define SCHED_REPLAY_STALL_ITERATIONS 100000
+#endif
 #ifndef DEBUGER_MODE
 #define DEBUGER_MODE 0
 #endif
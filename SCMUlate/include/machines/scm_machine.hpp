@@ -2,6 +2,8 @@
 #define __MACHINE_CONFIGURATION__
 
 #include <omp.h>
+#include <istream>
+#include <memory>
 #include <string>
 
 // SCM Related Includes
@@ -9,12 +11,16 @@
 #include "system_config.hpp"
 #include "threads_configuration.hpp"
 #include "register.hpp"
+#include "memory_manager.hpp"
 #include "control_store.hpp"
 #include "executor.hpp"
 #include "instruction_mem.hpp"
 #include "fetch_decode.hpp"
 #include "system_codelets.hpp"
 #include "timers_counters.hpp"
+#include "live_metrics.hpp"
+#include "roofline.hpp"
+#include "schedule_log.hpp"
 
 
 namespace scm {
@@ -26,32 +32,86 @@ namespace scm {
     private: 
       bool alive;
       bool init_correct;
-      char* filename;
+      std::string filename; /**< Program that is loaded */
       TIMERS_COUNTERS_GUARD(timers_counters time_cnt_m;)
       
       // Modules
+      memory_manager_module * mem_manager_m; /**< Owns the L2 memory and the register file memory. Not owned by the machine */
       reg_file_module reg_file_m;
-      inst_mem_module inst_mem_m;
+      std::unique_ptr<inst_mem_module> inst_mem_m; /**< Program that is executed. Replaced by loadProgram. Destroyed after the modules that use it */
       control_store_module control_store_m;
       fetch_decode_module fetch_decode_m;
       std::vector<cu_executor_module*> executors_m;
+      live_metrics_module metrics_m;
+      roofline_module roofline_m;
+      schedule_log_module sched_log_m;
+
+      /** \brief behavior of the calling thread of the parallel region: the SU or one of the CUs */
+      void threadBehavior();
 
     public: 
       scm_machine() = delete;
-      scm_machine(char * in_filename, unsigned char * const external_memory, ILP_MODES ilp_mode = ILP_MODES::SEQUENTIAL); 
+      scm_machine(char * in_filename, memory_manager_module * const mem_manager, ILP_MODES ilp_mode = ILP_MODES::SEQUENTIAL, const char * reg_config = nullptr); 
 
       // getters
+      inline memory_manager_module * getMemoryManager() {return mem_manager_m; }
       inline reg_file_module * getRegFile() {return &reg_file_m; }
-      inline inst_mem_module * getInstMemory() { return &inst_mem_m; }
+      inline inst_mem_module * getInstMemory() { return inst_mem_m.get(); }
+      inline const std::string & getProgramName() { return filename; }
       inline control_store_module * getControlStore() { return &control_store_m; }
       inline fetch_decode_module * getFetchDecode() { return &fetch_decode_m; }
       inline cu_executor_module * getExecutorCU (uint32_t execID) { return executors_m[execID]; }
+      TIMERS_COUNTERS_GUARD(
+        inline timers_counters * getTimersCounters() { return &time_cnt_m; }
+      )
+
+      // setters
+      inline void setDispatchPolicy(DISPATCH_POLICIES policy) { fetch_decode_m.setDispatchPolicy(policy); }
+      inline void setInlineThreshold(uint32_t threshold) { fetch_decode_m.setInlineThreshold(threshold); }
+      /** \brief write the live metrics to a file or a Unix domain socket (unix:<path>) every interval ms while the machine runs. Call it before run() */
+      bool setMetricsOutput(std::string output, uint32_t interval = LIVE_METRICS_INTERVAL_MS);
+      /** \brief account the bytes, flops and time of each codelet, and print the roofline report when the machine is destroyed. Call it before run() */
+      void setRoofline(std::string jsonOutput = std::string());
+      /** \brief peaks of one CU used by the roofline report, instead of measuring them */
+      inline void setRooflinePeaks(double gflops, double gbs) { roofline_m.setPeaks(gflops, gbs); }
+      /** \brief log the scheduling decisions of the run (the CU of each dispatch and the renamed registers) to a file. Call it before run() */
+      bool setScheduleRecord(std::string file);
+      /** \brief force the scheduling decisions logged by a previous run of the same program and machine. Call it before run() */
+      bool setScheduleReplay(std::string file);
 
       TIMERS_COUNTERS_GUARD( 
         void inline setTimersOutput(std::string outputName) { this->time_cnt_m.setFilename(outputName); }
+        /** \brief stream the trace to a binary file while the machine runs, instead of dumping JSON at the end. Call it before run() */
+        bool inline setTraceOutput(std::string outputName) { return this->time_cnt_m.setTraceOutput(outputName); }
+        /** \brief select the events that are recorded (see timers_counters::setTraceMode). Call it before run() */
+        bool inline setTraceMode(std::string mode) { return this->time_cnt_m.setTraceMode(mode); }
       )
 
       run_status run();
+
+      /** \brief replace the program of the machine, so it can be run again
+       *
+       * The register file, the L2 memory, the codelets and the other settings are kept. The
+       * previous program must have finished with a COMMIT. If the new program is not valid the
+       * previous one is kept and false is returned
+       */
+      bool loadProgram(char * in_filename);
+
+      /** \brief set the register file (and the hidden registers of the OoO mode) to zero. Only between runs */
+      void resetRegisters();
+
+      /** \brief service mode. Runs the loaded program, then the programs in jobs, one path per line
+       *
+       * The threads of the machine stay in a single parallel region. Between jobs the CUs wait
+       * in a barrier while the SU reads and loads the next program, so a job costs its load and
+       * its execution only. jobs can be a file, stdin or a FIFO used as a job queue. Empty lines
+       * and lines starting with # are skipped, and invalid programs are reported and skipped.
+       * With reset, the registers are cleared once the next job is loaded; otherwise a program sees the
+       * registers left by the previous one. The L2 memory is never cleared.
+       * The live metrics, the schedule log and the timers cover the whole service. Each job
+       * has its own instruction IDs in the trace, so its events keep the text of its program.
+       */
+      run_status serve(std::istream & jobs, bool reset = false);
     
       ~scm_machine();
   
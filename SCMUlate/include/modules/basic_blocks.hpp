@@ -0,0 +1,62 @@
+#ifndef __BASIC_BLOCKS__
+#define __BASIC_BLOCKS__
+
+/** \brief Basic blocks of the program
+ *
+ * When a program is loaded, it is split in basic blocks. A basic block starts at the
+ * beginning of the program, at the target of a jump or branch, or after a control
+ * instruction or a COMMIT, and it ends before the next start. Inside a block the instructions
+ * are always executed in order, one after the other.
+ *
+ * The blocks depend only on the static program, so they are found once. The SU uses them
+ * to fetch a whole block at once, and the trace cache keeps the copies of hot blocks.
+ */
+
+#include "SCMUlate_tools.hpp"
+#include "system_config.hpp"
+#include "instructions.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace scm {
+
+  struct basic_block_t {
+    uint32_t first_pc;
+    uint32_t last_pc;                      /**< Last instruction that belongs to the block */
+    std::vector<uint32_t> successors;      /**< Number of the blocks that can follow this one */
+
+    inline uint32_t size() const { return last_pc - first_pc + 1; }
+  };
+
+  class program_blocks {
+    private:
+      std::vector<basic_block_t> blocks;
+      std::vector<uint32_t> block_of_pc;
+
+      void findBlocks(std::vector<decoded_instruction_t *> & program);
+
+    public:
+      program_blocks() { }
+
+      /** \brief split the program in blocks. Replaces the blocks of the previous program */
+      void analyze(std::vector<decoded_instruction_t *> & program);
+
+      inline uint32_t numBlocks() const { return blocks.size(); }
+      inline const basic_block_t & getBlock(uint32_t num) const { return blocks[num]; }
+
+      /** \brief block that contains the instruction at pc. nullptr if pc is outside the program */
+      inline const basic_block_t * blockAt(uint32_t pc) const {
+        return pc < block_of_pc.size() ? &blocks[block_of_pc[pc]] : nullptr;
+      }
+
+      /** \brief number of the block that contains the instruction at pc. pc must be inside the program */
+      inline uint32_t blockNumAt(uint32_t pc) const { return block_of_pc[pc]; }
+
+      /** \brief target of a control instruction, or -1 if it is not known statically */
+      static int64_t controlTarget(decoded_instruction_t * inst, uint32_t pc);
+
+      void dump();
+  };
+}
+
+#endif
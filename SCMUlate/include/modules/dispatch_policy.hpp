@@ -0,0 +1,142 @@
+#ifndef __DISPATCH_POLICY__
+#define __DISPATCH_POLICY__
+
+/** \brief Dispatch policies
+ *
+ * This file contains the policies that the SU uses to select the CU that will execute
+ * a codelet or a memory instruction. A policy only chooses the order in which the
+ * execution slots are tried. The dispatch_controller wraps the selected policy, keeps
+ * track of which CU executes each instruction, and counts the register migrations.
+ *
+ * A register migration happens when an instruction reads a register that was last
+ * written by a different CU. The data of the register is then in the private caches
+ * of another core.
+ *
+ * Policies:
+ * - ROUND_ROBIN: Start from the last CU that received work, and try the next ones.
+ * - LEAST_LOADED: Prefer the CU with less instructions in flight, and then the one that
+ *   has received less instructions.
+ * - REG_AFFINITY: Prefer the CU that last wrote the most bytes of the input registers.
+ *   If that CU is busy, the next best is used (and the migration is counted).
+ *
+ * With a schedule log, the controller records the CU of each dispatch, or replays the
+ * dispatches of a previous run instead of using the policy (see schedule_log.hpp).
+ */
+
+#include "SCMUlate_tools.hpp"
+#include "system_config.hpp"
+#include "control_store.hpp"
+#include "instructions.hpp"
+#include "schedule_log.hpp"
+#include <unordered_map>
+#include <vector>
+#include <string>
+
+namespace scm {
+
+  // Which CU wrote each register last
+  typedef std::unordered_map<unsigned char *, uint32_t> reg_owner_map_t;
+
+  class dispatch_policy {
+    protected:
+      control_store_module * ctrl_st_m;
+      const reg_owner_map_t * last_writer;
+      std::vector<uint32_t> cu_order; /**< Scratch space for the order of the CUs to try */
+
+      /** \brief try the execution slots in the order of cu_order */
+      int tryInOrder(instruction_state_pair * inst) {
+        for (auto it = cu_order.begin(); it != cu_order.end(); ++it)
+          if (this->ctrl_st_m->get_executor(*it)->try_insert(inst))
+            return *it;
+        return -1;
+      }
+
+    public:
+      dispatch_policy(control_store_module * const control_store_m, const reg_owner_map_t * owners) :
+        ctrl_st_m(control_store_m), last_writer(owners), cu_order(control_store_m->numExecutors()) { }
+
+      /** \brief insert the instruction in an execution slot
+       *
+       * Returns the number of the CU that received the instruction, or -1 if all the CUs are busy
+       */
+      virtual int dispatch(instruction_state_pair * inst) = 0;
+      /** \brief insert the instruction in the execution slot of a given CU (replays). Returns false if it is busy */
+      virtual bool dispatchTo(instruction_state_pair * inst, uint32_t cu) { return this->ctrl_st_m->get_executor(cu)->try_insert(inst); }
+      virtual void instructionFinished(uint32_t cu) { (void) cu; }
+      virtual const char * getName() = 0;
+      virtual ~dispatch_policy() { }
+  };
+
+  class round_robin_policy : public dispatch_policy {
+    private:
+      uint32_t curSched;
+    public:
+      round_robin_policy(control_store_module * const control_store_m, const reg_owner_map_t * owners) :
+        dispatch_policy(control_store_m, owners), curSched(0) { }
+      int dispatch(instruction_state_pair * inst);
+      const char * getName() { return "round_robin"; }
+  };
+
+  class least_loaded_policy : public dispatch_policy {
+    private:
+      std::vector<uint32_t> in_flight;
+      std::vector<uint64_t> assigned;
+    public:
+      least_loaded_policy(control_store_module * const control_store_m, const reg_owner_map_t * owners) :
+        dispatch_policy(control_store_m, owners), in_flight(control_store_m->numExecutors(), 0), assigned(control_store_m->numExecutors(), 0) { }
+      int dispatch(instruction_state_pair * inst);
+      bool dispatchTo(instruction_state_pair * inst, uint32_t cu);
+      void instructionFinished(uint32_t cu) { in_flight[cu]--; }
+      const char * getName() { return "least_loaded"; }
+  };
+
+  class register_affinity_policy : public dispatch_policy {
+    private:
+      uint32_t curSched;
+      std::vector<uint64_t> score;
+    public:
+      register_affinity_policy(control_store_module * const control_store_m, const reg_owner_map_t * owners) :
+        dispatch_policy(control_store_m, owners), curSched(0), score(control_store_m->numExecutors(), 0) { }
+      int dispatch(instruction_state_pair * inst);
+      const char * getName() { return "register_affinity"; }
+  };
+
+  class dispatch_controller {
+    private:
+      control_store_module * ctrl_st_m;
+      dispatch_policy * policy;
+      schedule_log_module * sched_log; /**< Records or replays the dispatches. nullptr when disabled */
+      reg_owner_map_t last_writer;
+      std::unordered_map<instruction_state_pair *, uint32_t> executing_cu;
+      uint64_t dispatched;
+      uint64_t migrations;
+      uint64_t migrated_bytes;
+
+    public:
+      dispatch_controller() = delete;
+      dispatch_controller(control_store_module * const control_store_m, DISPATCH_POLICIES policy_type = ROUND_ROBIN);
+
+      void setPolicy(DISPATCH_POLICIES policy_type);
+      inline const char * getPolicyName() { return policy->getName(); }
+      /** \brief record or replay the dispatches. Must be called before the machine starts running */
+      inline void setScheduleLog(schedule_log_module * log) { this->sched_log = log; }
+
+      /** \brief attempt to insert the instruction in one of the CUs. Returns false if all are busy */
+      bool attemptDispatch(instruction_state_pair * inst);
+
+      /** \brief the SU must call this when a dispatched instruction is done */
+      void instructionFinished(instruction_state_pair * inst);
+
+      inline uint64_t getDispatched() { return dispatched; }
+      inline uint64_t getMigrations() { return migrations; }
+      inline uint64_t getMigratedBytes() { return migrated_bytes; }
+
+      /** \brief parse the name of a policy (rr, ll, affinity) */
+      static bool parsePolicy(std::string name, DISPATCH_POLICIES & policy_type);
+
+      ~dispatch_controller() { delete policy; }
+  };
+
+}
+
+#endif
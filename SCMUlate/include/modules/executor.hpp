@@ -5,6 +5,8 @@
 #include "control_store.hpp"
 #include "timers_counters.hpp"
 #include "memory_interface.hpp"
+#include "live_metrics.hpp"
+#include "roofline.hpp"
 
 namespace scm {
 
@@ -19,8 +21,12 @@ namespace scm {
       execution_slot * myExecutor;
       mem_interface_module *mem_interface_t;
       volatile bool* aliveSignal;
+      unsigned int cu_slot; /**< Number of the execution slot, also used in the live metrics */
+      live_metrics_module * metrics_m; /**< nullptr when the live metrics are disabled */
+      roofline_module * roofline_m; /**< nullptr when the roofline accounting is disabled */
       TIMERS_COUNTERS_GUARD(
         std::string cu_timer_name;
+        timer_id_t cu_timer_id;
         timers_counters* timer_cnt_m;
       )
       
@@ -33,10 +39,15 @@ namespace scm {
         inline void setTimerCnt(timers_counters * tmc) { 
           this->timer_cnt_m = tmc;
           this->cu_timer_name = std::string("CUMEM_") + std::to_string(this->cu_executor_id);
-          this->timer_cnt_m->addTimer(this->cu_timer_name, CUMEM_TIMER);
+          this->cu_timer_id = this->timer_cnt_m->addTimer(this->cu_timer_name, CUMEM_TIMER);
         }
       )
 
+      /** \brief publish the busy time of this CU in the live metrics. Must be called before the machine starts running */
+      inline void setLiveMetrics(live_metrics_module * metrics) { this->metrics_m = metrics; }
+      /** \brief account the time and bytes of the codelets of this CU. Must be called before the machine starts running */
+      inline void setRoofline(roofline_module * roofline) { this->roofline_m = roofline; }
+
       int behavior();
       int codeletExecutor();
 
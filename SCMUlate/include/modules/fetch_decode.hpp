@@ -38,6 +38,11 @@
 #include "timers_counters.hpp"
 #include "ilp_controller.hpp"
 #include "instruction_buffer.hpp"
+#include "trace_cache.hpp"
+#include "dispatch_policy.hpp"
+#include "memory_interface.hpp"
+#include "live_metrics.hpp"
+#include "schedule_log.hpp"
 #include "system_config.hpp"
 #include <string>
 
@@ -59,18 +64,30 @@ namespace scm {
       int PC; /**< Program counter, this corresponds to the current instruction being executed */
       uint32_t su_number; /**< This corresponds to the current SU number */
       ilp_controller instructionLevelParallelism;
+      dispatch_controller dispatcher; /**< Selects the CU for codelets and memory instructions */
+      mem_interface_module su_mem_interface; /**< Used for the memory instructions executed by the SU */
+      uint32_t inline_mem_threshold; /**< Largest register (bytes) of a load or store executed by the SU */
+      uint64_t inlined_ldimm, inlined_mem, inlined_codelets; /**< Dispatches saved by executing on the SU */
+      bool block_fetch; /**< Fetch the rest of the basic block at once, instead of INSTRUCTION_FETCH_WINDOW instructions */
+      uint64_t block_fetches; /**< Times the SU fetched more than INSTRUCTION_FETCH_WINDOW instructions */
+      trace_cache traces; /**< Copies of the instructions of hot blocks. Must be declared before inst_buff_m */
       instructions_buffer_module inst_buff_m;
       instruction_state_pair * stallingInstruction;
+      live_metrics_module * metrics_m; /**< Live metrics of the run. nullptr when disabled */
+      schedule_log_module * sched_log; /**< Records or replays the scheduling decisions. nullptr when disabled */
+      uint64_t fetched_instructions; /**< Position of the next instruction in the order of fetch */
+      uint64_t retired_instructions, moved_bytes; /**< Published in the live metrics */
       //const bool debugger;
 
       TIMERS_COUNTERS_GUARD(
         std::string su_timer_name;
+        timer_id_t su_timer_id;
         timers_counters *time_cnt_m;
       );
 
     public: 
       fetch_decode_module() = delete;
-      fetch_decode_module(inst_mem_module * const inst_mem, control_store_module * const, bool * const aliveSig, ILP_MODES ilp_mode);
+      fetch_decode_module(inst_mem_module * const inst_mem, control_store_module * const, bool * const aliveSig, ILP_MODES ilp_mode, l2_memory_t const memory);
 
       /** \brief logic to execute an instruction
        * 
@@ -78,6 +95,12 @@ namespace scm {
        */
       inline void executeControlInstruction(decoded_instruction_t * inst);
 
+      /** \brief PC of the label in the operand op_num of a control instruction
+       *
+       *  Labels that were not loaded when the instruction was decoded are resolved here
+       */
+      inline int getLabelTarget(decoded_instruction_t * inst, int op_num);
+
       /** \brief logic to execute an arithmetic instruction
        *
        *  We will execute arithmetic instructions in the SU when they are simple enough. Other arithmetic
@@ -92,6 +115,46 @@ namespace scm {
        */
       inline bool attemptAssignExecuteInstruction(instruction_state_pair * inst);
 
+      /** \brief determine if the instruction is executed by the SU
+       *
+       *  LDIMM, loads and stores of registers up to inline_mem_threshold bytes, and
+       *  lightweight codelets do not need a CU. The dispatch round trip is avoided
+       */
+      inline bool isInlineInstruction(decoded_instruction_t * inst);
+
+      /** \brief execute a memory instruction or a lightweight codelet in the SU */
+      inline void executeInlineInstruction(decoded_instruction_t * inst);
+
+      /** \brief set the largest register size (in bytes) of the loads and stores executed by the SU */
+      inline void setInlineThreshold(uint32_t threshold) { this->inline_mem_threshold = threshold; }
+
+      /** \brief select the policy used to assign instructions to the CUs
+       *
+       *  Must be called before the machine starts running
+       */
+      inline void setDispatchPolicy(DISPATCH_POLICIES policy) { this->dispatcher.setPolicy(policy); }
+
+      /** \brief publish the state of the SU in the live metrics. Must be called before the machine starts running */
+      inline void setLiveMetrics(live_metrics_module * metrics) { this->metrics_m = metrics; }
+
+      /** \brief record or replay the dispatches and the renamed registers. Must be called before the machine starts running */
+      inline void setScheduleLog(schedule_log_module * log) {
+        this->sched_log = log;
+        this->dispatcher.setScheduleLog(log);
+        this->instructionLevelParallelism.setScheduleLog(log);
+      }
+
+      /** \brief fetch from another program, starting at PC 0
+       *
+       *  The previous program must have finished with a COMMIT. Returns false if there are
+       *  instructions left in the buffer (the machine stopped on an error), since they may
+       *  still be in the CUs. The registers keep their values, unless clearRegisters() is called
+       */
+      bool loadProgram(inst_mem_module * const inst_mem);
+
+      /** \brief drop the renamed registers of the OoO mode. Only between two programs */
+      inline void clearRegisters() { this->instructionLevelParallelism.clearRegisters(); }
+
       /** \brief get the SU number
        *
        *  We select a CU and we assign a new codelet to it. When it is done, we delete the codelet
@@ -108,7 +171,7 @@ namespace scm {
         void setTimerCounter(timers_counters * newTC) { 
           this->time_cnt_m = newTC; 
           this->su_timer_name = std::string("SU_") + std::to_string(this->su_number);
-          this->time_cnt_m->addTimer(this->su_timer_name, SU_TIMER);
+          this->su_timer_id = this->time_cnt_m->addTimer(this->su_timer_name, SU_TIMER);
         }
       );
   
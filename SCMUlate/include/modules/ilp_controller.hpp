@@ -12,6 +12,7 @@
 #include "system_config.hpp"
 #include "instructions.hpp"
 #include "instruction_mem.hpp"
+#include "schedule_log.hpp"
 #include <set>
 #include <unordered_set>
 #include <unordered_map>
@@ -243,17 +244,12 @@ namespace scm {
           return false;
         }
 
-        if (inst->getOp1().type == operand_t::REGISTER && hazardExist(inst->getOp1().value.reg.reg_ptr, (inst->getOpIO() & (OP_IO::OP1_RD | OP_IO::OP1_WR)))) {
-          inst_state->second = instruction_state::STALL;
-          return false;
-        }
-        if (inst->getOp2().type == operand_t::REGISTER && hazardExist(inst->getOp2().value.reg.reg_ptr, (inst->getOpIO() & (OP_IO::OP2_RD | OP_IO::OP2_WR))>>2)) {
-          inst_state->second = instruction_state::STALL;
-          return false;
-        }
-        if (inst->getOp3().type == operand_t::REGISTER && hazardExist(inst->getOp3().value.reg.reg_ptr, (inst->getOpIO() & (OP_IO::OP3_RD | OP_IO::OP3_WR))>>4)) {
-          inst_state->second = instruction_state::STALL;
-          return false;
+        for (int op_num = 1; op_num <= MAX_NUM_OPERANDS; op_num++) {
+          operand_t & op = inst->getOp(op_num);
+          if (op.type == operand_t::REGISTER && hazardExist(op.value.reg.reg_ptr, opIO(inst, op_num))) {
+            inst_state->second = instruction_state::STALL;
+            return false;
+          }
         }
 
         // In memory instructions we need to figure out if there is a hazard in the memory
@@ -270,24 +266,15 @@ namespace scm {
           memCtrl.addRange( ranges );
         }
         // Mark the registers
-        if (inst->getOp1().type == operand_t::REGISTER) {
-          uint_fast16_t io = inst->getOpIO() & (OP_IO::OP1_RD | OP_IO::OP1_WR);
-          SCMULATE_INFOMSG(5, "Marking register %s as busy with IO %lX", inst->getOp1().value.reg.reg_name.c_str(), io);
-          register_reservation reserv(inst->getOp1().value.reg.reg_ptr, io);
-          busyRegisters.insert(reserv);
-        }
-        if (inst->getOp2().type == operand_t::REGISTER) {
-          uint_fast16_t io = (inst->getOpIO() & (OP_IO::OP2_RD | OP_IO::OP2_WR)) >> 2;
-          SCMULATE_INFOMSG(5, "Marking register %s as busy with IO %lX", inst->getOp2().value.reg.reg_name.c_str(), io);
-          register_reservation reserv(inst->getOp2().value.reg.reg_ptr, io);
-          busyRegisters.insert(reserv);          
-          }
-        if (inst->getOp3().type == operand_t::REGISTER) {
-          uint_fast16_t io = (inst->getOpIO() & (OP_IO::OP3_RD | OP_IO::OP3_WR)) >> 4;
-          SCMULATE_INFOMSG(5, "Marking register %s as busy with IO %lX", inst->getOp3().value.reg.reg_name.c_str(), io);
-          register_reservation reserv(inst->getOp3().value.reg.reg_ptr, io);
-          busyRegisters.insert(reserv);          
+        for (int op_num = 1; op_num <= MAX_NUM_OPERANDS; op_num++) {
+          operand_t & op = inst->getOp(op_num);
+          if (op.type == operand_t::REGISTER) {
+            uint_fast16_t io = opIO(inst, op_num);
+            SCMULATE_INFOMSG(5, "Marking register %s as busy with IO %lX", op.value.reg.reg_name.c_str(), io);
+            register_reservation reserv(op.value.reg.reg_ptr, io);
+            busyRegisters.insert(reserv);
           }
+        }
         inst_state->second = instruction_state::READY;
         return true;
       }
@@ -301,24 +288,24 @@ namespace scm {
             memCtrl.removeRanges( ranges ); 
         } 
 
-        if (inst->getOp1().type == operand_t::REGISTER) {
-          uint_fast16_t io = (inst->getOpIO() & (OP_IO::OP1_RD | OP_IO::OP1_WR));
-          SCMULATE_INFOMSG(5, "Unmariking register %s as busy with IO %lX", inst->getOp1().value.reg.reg_name.c_str(), io );
-          eraseReg(inst->getOp1().value.reg.reg_ptr, io);
-        }
-        if (inst->getOp2().type == operand_t::REGISTER) {
-          uint_fast16_t io = (inst->getOpIO() & (OP_IO::OP2_RD | OP_IO::OP2_WR)) >> 2;
-          SCMULATE_INFOMSG(5, "Unmariking register %s as busy with IO %lX",inst->getOp2().value.reg.reg_name.c_str(), io );
-          eraseReg(inst->getOp2().value.reg.reg_ptr, io);
-        }
-        if (inst->getOp3().type == operand_t::REGISTER) {
-          uint_fast16_t io = (inst->getOpIO() & (OP_IO::OP3_RD | OP_IO::OP3_WR)) >> 4;
-          SCMULATE_INFOMSG(5, "Unmariking register %s as busy with IO %lX",inst->getOp3().value.reg.reg_name.c_str(), io);
-          eraseReg(inst->getOp3().value.reg.reg_ptr, io);
+        for (int op_num = 1; op_num <= MAX_NUM_OPERANDS; op_num++) {
+          operand_t & op = inst->getOp(op_num);
+          if (op.type == operand_t::REGISTER) {
+            uint_fast16_t io = opIO(inst, op_num);
+            SCMULATE_INFOMSG(5, "Unmariking register %s as busy with IO %lX", op.value.reg.reg_name.c_str(), io);
+            eraseReg(op.value.reg.reg_ptr, io);
+          }
         }
         SCMULATE_INFOMSG(5, "The number of busy regs is %lu", this->busyRegisters.size());
       }
 
+      uint32_t inline getNumberOfRanges() { return memCtrl.numberOfRanges(); }
+
+      /** \brief IO bits of an operand, shifted to the position of the first operand (OP1_RD | OP1_WR) */
+      static inline uint_fast16_t opIO(decoded_instruction_t * inst, int op_num) {
+        return (inst->getOpIO() & (OP_IO::getOpRDIO(op_num) | OP_IO::getOpWRIO(op_num))) >> (2 * (op_num - 1));
+      }
+
       bool inline hazardExist(unsigned char * regName, uint_fast16_t io_dir) { 
         auto foundReg = busyRegisters.find(register_reservation(regName, io_dir));
         bool isFound = busyRegisters.find(register_reservation(regName, io_dir)) != busyRegisters.end();
@@ -535,8 +522,10 @@ namespace scm {
       instruction_state_pair * hazzard_inst_state;
       std::unordered_set<int> already_processed_operands;
 
+      schedule_log_module * sched_log; /**< Records or replays the renamed registers. nullptr when disabled */
+
     public:
-      ilp_OoO() : hidden_register_file(new reg_file_module()), hazzard_inst_state(nullptr) { }
+      ilp_OoO(const reg_file_module * arch_reg_file) : hidden_register_file(new reg_file_module(arch_reg_file->getMemoryManager(), arch_reg_file->getRegisterClasses())), hazzard_inst_state(nullptr), sched_log(nullptr) { }
       /** \brief check if instruction can be scheduled 
       * Returns true if the instruction could be scheduled according to
       * the current detected hazards. If it is possible to schedule it, then
@@ -548,7 +537,16 @@ namespace scm {
         SCMULATE_INFOMSG(6,"%lu\t%lu\t%lu\t%lu\t%lu\t%lu\n", used.size(), registerRenaming.size(), renamedInUse.size(), subscribers.size(), broadcasters.size(), reservationTable.size());
       }
 
-      decoded_reg_t inline getRenamedRegister(decoded_reg_t & otherReg);
+      /** \brief hidden register for the operand op_num of inst. Returns otherReg if none is free
+       *
+       * In a replay, the register of the schedule log is used if it is free
+       */
+      decoded_reg_t inline getRenamedRegister(decoded_reg_t & otherReg, decoded_instruction_t * inst, int op_num);
+      inline void setScheduleLog(schedule_log_module * log) { this->sched_log = log; }
+
+      uint32_t inline getNumberOfRanges() { return memCtrl.numberOfRanges(); }
+      /** \brief registers of the hidden register file in use by renaming */
+      uint64_t inline getRenamedInUse() const { return renamedInUse.size(); }
 
       void instructionFinished(instruction_state_pair * inst_state);
 
@@ -556,6 +554,20 @@ namespace scm {
 
       bool inline stallMemoryInstruction(decoded_instruction_t * inst);
 
+      /** \brief forget the instructions of the previous program. The renamed registers are kept */
+      void inline newProgram() {
+        reservationTable.clear();
+        hazzard_inst_state = nullptr;
+        already_processed_operands.clear();
+      }
+
+      /** \brief drop the renamed registers and set the hidden register file to zero */
+      void inline clearRegisters() {
+        registerRenaming.clear();
+        renamedInUse.clear();
+        hidden_register_file->clear();
+      }
+
       ~ilp_OoO() {
         delete hidden_register_file;
       }
@@ -581,6 +593,10 @@ namespace scm {
       void inline instructionFinished() {
         sequential_sw = true;
       }
+      /** \brief the COMMIT of the previous program is never finished */
+      void inline newProgram() {
+        sequential_sw = true;
+      }
   };
 
   class ilp_controller {
@@ -589,7 +605,7 @@ namespace scm {
       ilp_superscalar supscl_ctrl;
       ilp_OoO ooo_ctrl;
     public:
-      ilp_controller (const ILP_MODES ilp_mode) : SCMULATE_ILP_MODE(ilp_mode) {
+      ilp_controller (const ILP_MODES ilp_mode, const reg_file_module * arch_reg_file) : SCMULATE_ILP_MODE(ilp_mode), ooo_ctrl(arch_reg_file) {
         SCMULATE_INFOMSG_IF(3, SCMULATE_ILP_MODE == ILP_MODES::SEQUENTIAL, "Using %d ILP_MODES::SEQUENTIAL",SCMULATE_ILP_MODE );
         SCMULATE_INFOMSG_IF(3, SCMULATE_ILP_MODE == ILP_MODES::SUPERSCALAR, "Using %d ILP_MODES::SUPERSCALAR", SCMULATE_ILP_MODE);
         SCMULATE_INFOMSG_IF(3, SCMULATE_ILP_MODE == ILP_MODES::OOO, "Using %d ILP_MODES::OOO", SCMULATE_ILP_MODE);
@@ -614,6 +630,31 @@ namespace scm {
           ooo_ctrl.printStats();
         }
       }
+      /** \brief memory ranges in flight, tracked for the memory hazards */
+      uint32_t inline getNumberOfRanges() {
+        if (SCMULATE_ILP_MODE == ILP_MODES::SUPERSCALAR)
+          return supscl_ctrl.getNumberOfRanges();
+        if (SCMULATE_ILP_MODE == ILP_MODES::OOO)
+          return ooo_ctrl.getNumberOfRanges();
+        return 0;
+      }
+      /** \brief occupancy of the rename pool (OoO only) */
+      uint64_t inline getRenamedInUse() {
+        return SCMULATE_ILP_MODE == ILP_MODES::OOO ? ooo_ctrl.getRenamedInUse() : 0;
+      }
+      /** \brief reset the state of the previous program, which must have finished (see scm_machine::loadProgram) */
+      void inline newProgram() {
+        seq_ctrl.newProgram();
+        ooo_ctrl.newProgram();
+      }
+      /** \brief drop the renamed registers (OoO only) */
+      void inline clearRegisters() {
+        ooo_ctrl.clearRegisters();
+      }
+      /** \brief record or replay the renamed registers (OoO only) */
+      void inline setScheduleLog(schedule_log_module * log) {
+        ooo_ctrl.setScheduleLog(log);
+      }
       void inline instructionFinished(instruction_state_pair * inst) {
         if (SCMULATE_ILP_MODE == ILP_MODES::SEQUENTIAL) {
           seq_ctrl.instructionFinished();
@@ -626,6 +667,9 @@ namespace scm {
           SCMULATE_ERROR(0, "What are you doing here?");
         }
       }
+
+      /** \brief parse the name of an ILP mode (seq, superscalar, ooo) */
+      static bool parseMode(std::string const & name, ILP_MODES & mode);
   };
 
 } // namespace scm
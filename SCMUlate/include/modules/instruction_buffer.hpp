@@ -7,6 +7,7 @@
  *  near the current program counter. It represents the instruction window. 
  *  The instructions are copied over the window and marked with a state
  *  depending on the ILP mode (e.g. sequential, superscalar or Out of Order).
+ *  The copies are owned by the trace cache, which reuses them for hot loops.
  *  
  *  The decoded instruction is marked through a pair: instruction + state.
  *  The current states are:
@@ -22,7 +23,7 @@
 
 #include "SCMUlate_tools.hpp"
 #include "instructions.hpp"
-#include "instruction_buffer.hpp"
+#include "trace_cache.hpp"
 #include <deque>
 #include <utility>
 
@@ -31,22 +32,30 @@ namespace scm {
   class instructions_buffer_module {
     private:
       std::deque <instruction_state_pair *> instruction_buffer;
+      trace_cache * traces; /**< Where the instructions are returned when they leave the buffer */
     public: 
       // TODO: this may not be the best way of doing this. The position will change if the 
       // elements in the front of the queue change. Therefore it cannot be used as 
       // a reference in the subscription.
       // Because of this we will need to use a vector in the subscribers of ILP with a pointer
       // to the actual instruction_state_pair
-      instructions_buffer_module() { }
+      instructions_buffer_module(trace_cache * const cache) : traces(cache) { }
 
-      bool add_instruction(decoded_instruction_t & new_instruction) {
+      bool can_add_instruction() {
         // Check if we have reached the limit size
-        if (isBufferFull() || (this->instruction_buffer.size() != 0  && this->instruction_buffer.back()->second == STALL))
+        return !(isBufferFull() || (this->instruction_buffer.size() != 0  && this->instruction_buffer.back()->second == STALL));
+      }
+
+      /** \brief insert a copy of an instruction obtained from the trace cache
+       *
+       *  The buffer gives the copy back to the trace cache when the instruction is decommissioned
+       */
+      bool add_instruction(decoded_instruction_t * new_instruction) {
+        if (!can_add_instruction())
           return false;
-        instruction_state_pair * newPair = new instruction_state_pair(new decoded_instruction_t(new_instruction), WAITING);
-        // Avoid calling copy constructor twice
+        instruction_state_pair * newPair = new instruction_state_pair(new_instruction, WAITING);
         SCMULATE_INFOMSG(5, "Adding Instruction %s to buffer", newPair->first->getFullInstruction().c_str());
-        this->instruction_buffer.push_back(newPair); // Call constructor
+        this->instruction_buffer.push_back(newPair);
         return true;
       }
 
@@ -54,7 +63,7 @@ namespace scm {
         for (auto it = instruction_buffer.begin(); it != instruction_buffer.end() ;) {
           if ((*it)->second == instruction_state::DECOMMISSION) {
             SCMULATE_INFOMSG(5, "Deleting Instruction %s from buffer", (*it)->first->getFullInstruction().c_str());
-            delete (*it)->first;
+            traces->release((*it)->first);
             delete *it;
             it = instruction_buffer.erase(it);
           } else {
@@ -77,7 +86,7 @@ namespace scm {
       ~instructions_buffer_module () {
         for (auto it = instruction_buffer.begin(); it != instruction_buffer.end() ;) {
           SCMULATE_INFOMSG(5, "Deleting Instruction %s from buffer", (*it)->first->getFullInstruction().c_str());
-          delete (*it)->first;
+          traces->release((*it)->first);
           delete *it;
           it = instruction_buffer.erase(it);
         }
@@ -4,11 +4,18 @@
 #include "SCMUlate_tools.hpp"
 #include "instructions.hpp"
 #include "register.hpp"
+#include "program_image.hpp"
+#include "program_preprocessor.hpp"
+#include "basic_blocks.hpp"
 #include <vector>
 #include <map>
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 namespace scm {
   /* This module corresponds to the instruction memory, it is in charge 
@@ -19,12 +26,34 @@ namespace scm {
    * and raise a warning. Additionally, it is possible to fetch any instruction
    * by passing the corresponding address
    *
+   * Programs that come from stdin or from a pipe (or any file when streaming is
+   * enabled) are streamed: a loader thread parses them while the SU executes the
+   * instructions that have already arrived. Only a window of STREAM_WINDOW_SIZE
+   * instructions is kept in memory. The instructions more than STREAM_HISTORY_SIZE
+   * instructions behind the PC are evicted, so the memory is bounded for long
+   * generated programs, and loops can jump back up to STREAM_HISTORY_SIZE
+   * instructions. Labels that are used before they are defined are resolved when
+   * the jump or branch executes (see resolveLabel()). The preprocessor directives
+   * are not available in streamed programs
+   *
    */
   class inst_mem_module {
     private: 
       std::vector<decoded_instruction_t*> memory;
       std::map<std::string, int> labels;
       reg_file_module * reg_file_m;
+      program_blocks blocks; /**< Basic blocks of the program */
+
+      // Streamed programs. memory is a ring of STREAM_WINDOW_SIZE instructions
+      bool streaming;
+      int stream_fd;
+      std::thread stream_loader;
+      std::mutex stream_lock; /**< Protects the labels and the waits of the SU and the loader */
+      std::condition_variable stream_cv;
+      std::atomic<uint64_t> loaded;  /**< Instructions parsed so far */
+      std::atomic<uint64_t> evicted; /**< Instructions before this PC were deleted */
+      std::atomic<bool> stream_done;
+      std::atomic<bool> stream_stop;
 
       /* This flag checks if the file that is received is a valid flag
        * otherwise it should set it to stop running the machine
@@ -38,6 +67,31 @@ namespace scm {
        */
       bool loader(char * filename);
 
+      /* This method maps a program image created by scm-as. There is no
+       * parsing, only the registers and codelets are resolved. It returns
+       * false if the image does not match this simulator
+       * (see program_image.hpp)
+       */
+      bool imageLoader(const char * filename);
+
+      /* This method opens a program that is streamed and starts the loader
+       * thread. It returns false if the program cannot be opened
+       */
+      bool streamOpen(const char * filename);
+
+      /* Body of the loader thread of the streamed programs */
+      void streamLoader();
+      bool streamLine(std::string const & line, uint32_t lineNumber);
+
+      /* Fetch of the streamed programs. It waits for the instruction if it has
+       * not arrived yet. Returns nullptr if the program ends before pc, or if pc
+       * was evicted
+       */
+      decoded_instruction_t* streamFetch(uint64_t pc);
+
+      static bool & forceStreaming();
+      static bool isStreamedProgram(const char * filename);
+
     public:
       inst_mem_module() = delete;
       inst_mem_module(char * filename, reg_file_module * const reg_file_m);
@@ -45,13 +99,20 @@ namespace scm {
       /* This method allows to fetch an instruction from the instruction 
        * memory by passing the address (PC)
        */
-      inline decoded_instruction_t* fetch(int address) { return memory[address]; };
+      inline decoded_instruction_t* fetch(int address) { 
+        if (streaming)
+          return address >= 0 ? streamFetch(address) : nullptr;
+        return (address >= 0 && static_cast<uint32_t>(address) < memory.size()) ? memory[address] : nullptr;
+      };
 
       /** \brief translate label to memory
        *
        *
        */
       inline int getMemoryLabel(std::string label) { 
+        std::unique_lock<std::mutex> lock(stream_lock, std::defer_lock);
+        if (streaming)
+          lock.lock();
         auto it = labels.find(label); 
         if (it != labels.end())
           return it->second;
@@ -59,9 +120,25 @@ namespace scm {
           return -1;
       }
 
+      /** \brief translate a label that may not have been loaded yet
+       *
+       * In streamed programs it waits until the label is defined. Returns -1 if
+       * the program ends without defining it
+       */
+      int resolveLabel(std::string const & label);
+
+      /** \brief stream all the programs that are loaded after this call, also regular files
+       *
+       * Programs read from stdin or from a pipe are always streamed
+       */
+      static inline void setStreaming(bool stream) { forceStreaming() = stream; }
+      inline bool isStreaming() { return this->streaming; }
+
       bool isValid() { return this->is_valid; }
 
-      inline uint32_t getMemSize() { return this->memory.size(); }
+      /** \brief instructions in the program. For streamed programs, the instructions loaded so far */
+      inline uint32_t getMemSize() { return this->streaming ? this->loaded.load() : this->memory.size(); }
+      inline const program_blocks & getBlocks() { return this->blocks; }
       inline reg_file_module* getRegisterFileModule() {return this->reg_file_m; }
 
       /* This method allows to dump the content of the instruction 
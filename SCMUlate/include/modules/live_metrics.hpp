@@ -0,0 +1,128 @@
+#ifndef __LIVE_METRICS__
+#define __LIVE_METRICS__
+
+/** \brief Live metrics of a running machine
+ *
+ * The timers are only dumped when the machine is destroyed. This module lets a long run be
+ * watched while it executes. The SU and the CUs publish a few counters in their own cache
+ * lines with relaxed atomic stores (no locks, nothing shared between two writers), and a
+ * sampler thread reads them every interval and writes one line of JSON per sample:
+ *
+ *   {"t": 2.001, "pc": 41, "retired": 90210, "ips": 45104.5, "window": 12, "ranges": 3,
+ *    "renamed": 5, "bytes": 1048576, "bps": 524288.0, "cu_busy": [0.98, 0.97, ...]}
+ *
+ * t is in seconds since run() started. ips and bps are per second since the previous
+ * sample, and cu_busy is the fraction of the interval each CU spent executing instructions,
+ * including the instruction in progress. window is the occupancy of the instruction buffer,
+ * ranges the memory ranges tracked by the ILP controller, and renamed the registers of the
+ * rename pool in use (OoO only). The first line describes the machine, and the last one
+ * has "done": true.
+ *
+ * The output is a file (flushed after each sample), or a Unix domain socket
+ * with unix:<path>. The sampler listens on the socket and sends the samples to all the
+ * clients connected, so tools/scm_top.py can attach and detach while the machine runs.
+ *
+ * The SU publishes once per iteration of its loop, and each CU twice per instruction. The
+ * modules do not publish when the metrics are disabled (their pointer is null)
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SCMUlate_tools.hpp"
+#include "system_config.hpp"
+
+namespace scm {
+
+  class live_metrics_module {
+    private:
+      /** \brief published by the SU */
+      struct alignas(64) su_metrics_t {
+        std::atomic<uint64_t> pc{0};
+        std::atomic<uint64_t> retired{0};
+        std::atomic<uint64_t> window{0};
+        std::atomic<uint64_t> ranges{0};
+        std::atomic<uint64_t> renamed{0};
+        std::atomic<uint64_t> bytes{0};
+      };
+      /** \brief published by a CU. Times in ns of the steady clock */
+      struct alignas(64) cu_metrics_t {
+        std::atomic<uint64_t> busy{0};     /**< Time executing finished instructions */
+        std::atomic<uint64_t> busy_since{0}; /**< Start of the instruction in progress, 0 if idle */
+      };
+
+      su_metrics_t su;
+      std::vector<cu_metrics_t> cus;
+      uint32_t interval_ms;
+      std::string outputName;
+      FILE * outputFile;
+      int listenSocket;          /**< unix:<path> outputs */
+      std::vector<int> clients;
+      bool enabled;
+
+      std::thread sampler;
+      std::mutex samplerLock;
+      std::condition_variable samplerCond;
+      bool stopSampler;          /**< Protected by samplerLock */
+
+      // State of the previous sample
+      uint64_t start_ns;
+      uint64_t last_ns;
+      uint64_t last_retired;
+      uint64_t last_bytes;
+      std::vector<uint64_t> last_busy;
+
+      void samplerBehavior();
+      /** \brief read the counters and write a line. Sampler only */
+      void sample(bool done);
+      void write(std::string const & line);
+      void acceptClients();
+
+    public:
+      live_metrics_module(uint32_t numCUs);
+
+      /** \brief steady clock in ns */
+      static inline uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+      }
+
+      /** \brief open the output (a file, or unix:<path>). Call it before start() */
+      bool setOutput(std::string const & output, uint32_t interval = LIVE_METRICS_INTERVAL_MS);
+      inline bool isEnabled() const { return this->enabled; }
+
+      /** \brief start and stop the sampler. Called by the machine around the run */
+      void start();
+      void stop();
+
+      /** \brief state of the SU. Called by the SU thread only */
+      inline void publishSU(uint64_t pc, uint64_t retired, uint64_t window, uint64_t ranges, uint64_t renamed, uint64_t bytes) {
+        su.pc.store(pc, std::memory_order_relaxed);
+        su.retired.store(retired, std::memory_order_relaxed);
+        su.window.store(window, std::memory_order_relaxed);
+        su.ranges.store(ranges, std::memory_order_relaxed);
+        su.renamed.store(renamed, std::memory_order_relaxed);
+        su.bytes.store(bytes, std::memory_order_relaxed);
+      }
+
+      /** \brief a CU starts and finishes an instruction. Called by the thread of the CU only */
+      inline void cuBegin(uint32_t cu) {
+        cus[cu].busy_since.store(now(), std::memory_order_relaxed);
+      }
+      inline void cuEnd(uint32_t cu) {
+        uint64_t since = cus[cu].busy_since.load(std::memory_order_relaxed);
+        cus[cu].busy.store(cus[cu].busy.load(std::memory_order_relaxed) + now() - since, std::memory_order_relaxed);
+        cus[cu].busy_since.store(0, std::memory_order_relaxed);
+      }
+
+      ~live_metrics_module();
+  };
+
+}
+
+#endif
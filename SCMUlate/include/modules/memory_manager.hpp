@@ -0,0 +1,167 @@
+#ifndef __MEMORY_MANAGER__
+#define __MEMORY_MANAGER__
+
+/** \brief Memory manager module
+ *
+ * This file contains the definition of the memory manager. The memory manager owns
+ * the memory regions that the machine uses: The L2 memory that is exposed to the
+ * programs (the SCM memory), and the backing memory of the register files
+ * (including the hidden register file used for renaming).
+ *
+ * Regions are reserved with mmap instead of new[], which gives us:
+ * - Pages that are zero on first access, so there is no need to clear the register file.
+ * - Control over the page size. Either transparent huge pages (madvise) or explicit
+ *   huge pages (MAP_HUGETLB) that fall back to THP when the hugetlb pool is empty.
+ * - Control over the NUMA placement of the region. We use the mbind system call directly,
+ *   instead of libnuma, since libnuma is not always available where this runs.
+ *
+ * Placement policies:
+ * - PLACE_DEFAULT: Do not touch the kernel's policy.
+ * - PLACE_INTERLEAVE: Interleave the pages of the region over all the NUMA nodes.
+ * - PLACE_FIRST_TOUCH: The pages of a range are touched by the CU that owns the tile they
+ *   belong to (tile i is owned by CU i % NUM_CUS). Threads should be pinned
+ *   (e.g. OMP_PROC_BIND=true) for the placement to be kept during execution.
+ * - PLACE_BIND_NODE: Bind the whole region to a single NUMA node.
+ *
+ * File backed datasets:
+ * Files can be mapped directly into page aligned ranges of the L2 memory. This avoids
+ * the host side load and copy of the inputs, and several runs can share the same
+ * page cached dataset. Modes:
+ * - FILE_READ_ONLY: Shared read only mapping. Writes to the range are a segmentation fault.
+ * - FILE_COPY_ON_WRITE: Private mapping. Writes are visible to the program only.
+ * - FILE_WRITE_BACK: Shared writable mapping. The file is created (or resized) to the
+ *   size of the range, and the content is flushed with msync on syncFiles() and at destruction.
+ *
+ * Regions can be described in a manifest file, one region per line:
+ *   <name> <offset> <size> <ro|cow|rw> <path>
+ * Offset and size accept decimal or 0x prefixed hexadecimal values. A size of 0 uses
+ * the size of the file. Empty lines and lines starting with # are ignored.
+ */
+
+#include "SCMUlate_tools.hpp"
+#include "threads_configuration.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+
+// Default tile used for first touch. Same as the largest register (2048 lines)
+#define MEM_FIRST_TOUCH_TILE (64l*2048l)
+// Alignment of huge pages
+#define MEM_HUGE_PAGE_SIZE (2l*1024l*1024l)
+
+namespace scm {
+
+  enum mem_placement_policy {PLACE_DEFAULT, PLACE_INTERLEAVE, PLACE_FIRST_TOUCH, PLACE_BIND_NODE};
+  enum mem_page_mode {PAGES_DEFAULT, PAGES_THP, PAGES_HUGETLB};
+  enum mem_file_mode {FILE_READ_ONLY, FILE_COPY_ON_WRITE, FILE_WRITE_BACK};
+
+  typedef struct {
+    l2_memory_t base; /**< Address returned to the user */
+    uint64_t size; /**< Size requested by the user */
+    void * mapping; /**< Address returned by mmap, it may be different because of alignment */
+    uint64_t mapping_size; /**< Size of the mmap */
+    bool hugetlb; /**< The mapping uses explicit huge pages (MAP_HUGETLB) */
+  } mem_region_t;
+
+  typedef struct {
+    std::string name; /**< Name used to find the region from the host code */
+    std::string path; /**< File mapped into the region */
+    uint64_t offset; /**< Offset within the L2 memory */
+    uint64_t size; /**< Size of the region in bytes */
+    mem_file_mode mode;
+  } file_region_t;
+
+  class memory_manager_module {
+    private:
+      mem_placement_policy placement;
+      mem_page_mode pages;
+      int bind_node;
+      uint64_t tile_size;
+      int num_nodes;
+      mem_region_t l2_region;
+      std::vector<mem_region_t> regions; /**< Other regions (e.g. register files) */
+      std::vector<file_region_t> file_regions; /**< Files mapped into the L2 memory */
+
+      /** \brief reserve the virtual space and configure the page size */
+      bool mapRegion(uint64_t size, mem_region_t & region);
+
+      /** \brief apply the NUMA policy to a range
+       *
+       * Uses the mbind system call. Failures are not fatal,
+       * the kernel default policy is kept and a warning is printed
+       */
+      bool applyPlacement(l2_memory_t base, uint64_t size, mem_placement_policy policy);
+
+    public:
+      memory_manager_module() = delete;
+      memory_manager_module(uint64_t l2_size, mem_placement_policy policy = PLACE_DEFAULT, mem_page_mode page_mode = PAGES_THP, int node = 0);
+
+      inline l2_memory_t getL2Memory() { return l2_region.base; }
+      inline uint64_t getL2Size() { return l2_region.size; }
+      inline mem_placement_policy getPlacement() { return placement; }
+      inline mem_page_mode getPageMode() { return pages; }
+      inline int getNumNodes() { return num_nodes; }
+      inline bool isValid() { return l2_region.base != nullptr; }
+      /** \brief alignment of the offsets and sizes of the file regions. Huge pages with PAGES_HUGETLB */
+      uint64_t getFilePageSize();
+      inline void setFirstTouchTile(uint64_t newTile) { tile_size = newTile; }
+
+      /** \brief allocate a region that is owned by the memory manager
+       *
+       * Used by the register files. The memory is zero initialized.
+       * Register files are shared by all the CUs, therefore the first
+       * touch policy is treated as the default policy for these regions
+       */
+      l2_memory_t allocateRegion(uint64_t size);
+
+      /** \brief return a region obtained with allocateRegion */
+      void releaseRegion(l2_memory_t base);
+
+      /** \brief place a range of the L2 memory according to its owner CU
+       *
+       * When the policy is PLACE_FIRST_TOUCH, each CU thread touches the pages of the tiles
+       * it owns within [offset, offset + size). This must be called before the
+       * data is initialized. For other policies this does nothing.
+       */
+      void firstTouch(uint64_t offset, uint64_t size);
+
+      /** \brief map a file into the L2 memory
+       *
+       * The offset must be page aligned and the range must fit in the L2 memory. With PAGES_HUGETLB
+       * the offset and the size must be multiples of the huge page size (MEM_HUGE_PAGE_SIZE), since
+       * the kernel cannot split an explicit huge page of the L2 memory. A size of 0
+       * uses the size of the file (not allowed for FILE_WRITE_BACK on a new file). Read only and
+       * copy on write regions cannot be larger than the file, and regions cannot share a page.
+       * Returns false if the region could not be mapped. The L2 memory of the range is kept then.
+       */
+      bool mapFile(std::string name, std::string path, uint64_t offset, uint64_t size, mem_file_mode mode);
+
+      /** \brief map all the regions described in a manifest file */
+      bool loadManifest(std::string manifestFile);
+
+      /** \brief write the manifest of the currently mapped files */
+      void dumpManifest(std::ostream & out);
+
+      /** \brief find a file region by name. Returns nullptr if it does not exist */
+      const file_region_t * getFileRegion(std::string name);
+
+      /** \brief flush the FILE_WRITE_BACK regions to their files */
+      bool syncFiles();
+
+      /** \brief parse the name of a policy.
+       *
+       * Accepted values are default, interleave, firsttouch, bind:<node>.
+       * The node is returned through node. Returns false if the name or the node is not valid
+       */
+      static bool parsePlacement(std::string name, mem_placement_policy & policy, int & node);
+
+      /** \brief parse the name of a page mode (default, thp, hugetlb) */
+      static bool parsePageMode(std::string name, mem_page_mode & mode);
+
+      ~memory_manager_module();
+  };
+
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef __PAPI_COUNTERS__
+#define __PAPI_COUNTERS__
+
+/** \brief PAPI backend of the hardware counters of timers_counters (compiled with PAPI_COUNT)
+ *
+ * Each thread that counts (the CUs) has its own EventSet. perf_counters.hpp has the same interface
+ */
+
+#include <string>
+#include <vector>
+#include "SCMUlate_tools.hpp"
+#include "system_config.hpp"
+#include "omp.h"
+#include "papi.h"
+
+// Default hardware counters. They are selected at runtime with the SCM_HW_EVENTS environment
+// variable or timers_counters::setHWCounters (e.g. "PAPI_TOT_CYC,PAPI_DP_OPS,PAPI_L3_TCM")
+#define PAPI_EVENTS "PAPI_TOT_CYC,PAPI_DP_OPS"
+
+namespace scm {
+
+  /** \brief EventSet of the hardware counters of one thread
+   *
+   * The values are given in the order of the selected events. Events that could not be added are 0.
+   * With multiplexing, PAPI time-shares the physical counters and scales the values
+   */
+  class papi_counters_t {
+    private:
+      int EventSet;
+      int numEvents;                /**< Selected events */
+      std::vector<int> counterIndex; /**< Position in the selected events of each value read by PAPI */
+      long long values[TRACE_MAX_HW_COUNTERS];
+      long long readValues[TRACE_MAX_HW_COUNTERS];
+      static unsigned long omp_get_thread_num_wrapper(void) {
+        return (unsigned long)omp_get_thread_num();
+      }
+    public:
+      typedef int event_t;
+
+      /** \brief initialize PAPI and its thread support. Returns false if the counters cannot be used */
+      static bool initLibrary() {
+        if( PAPI_library_init( PAPI_VER_CURRENT ) != PAPI_VER_CURRENT ) {
+          SCMULATE_ERROR(0, "PAPI! I could not load.");
+          return false;
+        }
+        SCMULATE_INFOMSG(3, "Your PAPI has been initialized!");
+        if (PAPI_get_hardware_info() == NULL)
+          SCMULATE_ERROR(0, "PAPI Could not get your HW info!");
+        int retval = PAPI_thread_init( omp_get_thread_num_wrapper);
+        if (retval != PAPI_OK) {
+          SCMULATE_ERROR(0, "PAPI! Problems with your threads")
+          SCMULATE_ERROR_IF(0, retval != PAPI_ECMP , "PAPI! Trouble with the threads")
+        }
+        return true;
+      }
+      /** \brief event of a PAPI event name (e.g. PAPI_TOT_CYC) if it is available */
+      static bool findEvent(std::string const & name, event_t & event) {
+        return PAPI_event_name_to_code(const_cast<char *>(name.c_str()), &event) == PAPI_OK && PAPI_query_event(event) == PAPI_OK;
+      }
+      static int numHWCounters() { return PAPI_num_cmp_hwctrs(0); }
+      static bool initMultiplex() { return PAPI_multiplex_init() == PAPI_OK; }
+      static void finishThread() { PAPI_unregister_thread(); }
+
+      papi_counters_t(std::vector<event_t> &events, std::vector<std::string> &eventNames, bool multiplex) : EventSet(PAPI_NULL), numEvents(events.size()), values(), readValues() {
+        // Create an event set and add the different events. 
+        int retVal; 
+        retVal = PAPI_create_eventset(&EventSet);
+        if (retVal != PAPI_OK) {
+          SCMULATE_ERROR(0, "PAPI Error starting the EventSet");
+          EventSet = PAPI_NULL;
+          return;
+        }
+        if (multiplex) {
+          // The component has to be assigned before the EventSet is multiplexed
+          retVal = PAPI_assign_eventset_component(EventSet, 0);
+          if (retVal == PAPI_OK)
+            retVal = PAPI_set_multiplex(EventSet);
+          if (retVal != PAPI_OK)
+            SCMULATE_ERROR(0, "PAPI, could not multiplex the EventSet %d", EventSet);
+        }
+        for (int i = 0; i < numEvents; i++) {
+          retVal = PAPI_add_event(EventSet, events[i]);
+          SCMULATE_INFOMSG(4,"PAPI, Adding event to event %s to Evenset %d", eventNames[i].c_str(), EventSet);
+          if (retVal != PAPI_OK) {
+            SCMULATE_ERROR(0, "PAPI, error adding the Event %s to Evenset %d", eventNames[i].c_str(), EventSet);
+            continue;
+          }
+          counterIndex.push_back(i);
+        }
+      }
+
+      void startCounting () {
+        if (EventSet != PAPI_NULL) {
+          PAPI_reset(EventSet);
+          PAPI_start(EventSet);
+        }
+      }
+
+      /** \brief values of the last stopCounting, one per selected event */
+      inline long long const * getValues() const { return values; }
+      inline int getNumValues() const { return numEvents; }
+
+      void stopCounting() {
+        if (EventSet != PAPI_NULL) {
+          PAPI_stop(EventSet, readValues);
+          for (size_t i = 0; i < counterIndex.size(); i++)
+            values[counterIndex[i]] = readValues[i];
+          PAPI_reset(EventSet);
+        }
+      }
+
+      ~papi_counters_t() {
+        // Delete the event set and stop counters
+        if (EventSet != PAPI_NULL) {
+          PAPI_cleanup_eventset(EventSet);
+          PAPI_destroy_eventset(&EventSet);
+        }
+      }
+  };
+}
+
+#endif
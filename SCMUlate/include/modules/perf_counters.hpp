@@ -0,0 +1,83 @@
+#ifndef __PERF_COUNTERS__
+#define __PERF_COUNTERS__
+
+/** \brief perf_event_open backend of the hardware counters of timers_counters (compiled with PERF_COUNT)
+ *
+ * Linux only, without external libraries. Each thread that counts (the CUs) opens a group with
+ * the selected events, counting only that thread in user space. The group counts all the time,
+ * and the values of a codelet are the difference of two reads. The counters are read with
+ * rdpmc from the page that the kernel maps for each event, without system calls, when the
+ * processor allows it. Otherwise, or when the counters are multiplexed, they are read with
+ * read() and scaled by the time each event was counting.
+ *
+ * Events that cannot be opened in this machine (e.g. stalled cycles in some processors) are
+ * skipped, and their values are 0. The number of counters of the PMU is not known, so a group
+ * that does not fit is never scheduled. When that is detected (time running 0), the events are
+ * opened again one by one, multiplexed and scaled. papi_counters.hpp has the same interface
+ */
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "SCMUlate_tools.hpp"
+#include "system_config.hpp"
+
+struct perf_event_mmap_page;
+
+// Default hardware counters. They are selected at runtime with the SCM_HW_EVENTS environment
+// variable or timers_counters::setHWCounters (e.g. "cycles,instructions,LLC-load-misses")
+#define PERF_EVENTS "cycles,instructions,cache-misses,stalled-cycles-backend"
+
+namespace scm {
+
+  /** \brief type and config of a perf_event_attr */
+  struct perf_event_code_t {
+    uint32_t type;
+    uint64_t config;
+  };
+
+  class perf_counters_t {
+    private:
+      struct counter_t {
+        int fd;
+        perf_event_mmap_page * page; /**< nullptr if it could not be mapped */
+      };
+      int numEvents;                 /**< Selected events */
+      std::vector<perf_event_code_t> events;  /**< Kept to open the events again multiplexed */
+      std::vector<std::string> eventNames;
+      std::vector<counter_t> counters; /**< Events that could be opened */
+      std::vector<int> counterIndex;   /**< Position in the selected events of each opened event */
+      bool useRdpmc;
+      bool scaled;
+      bool unscheduled; /**< An event of the group was enabled but never counted in the last read */
+      long long startValues[TRACE_MAX_HW_COUNTERS];
+      long long values[TRACE_MAX_HW_COUNTERS];
+      long long readCounter(counter_t & counter);
+      void openCounters(bool multiplex);
+      void closeCounters();
+    public:
+      typedef perf_event_code_t event_t;
+
+      /** \brief there is nothing to initialize. Returns false if perf_event_open is not allowed */
+      static bool initLibrary();
+      /** \brief event of a name as in perf list (e.g. cycles, LLC-load-misses), or a raw event rNNNN */
+      static bool findEvent(std::string const & name, event_t & event);
+      /** \brief the number is not known. Groups that do not fit fall back to multiplexing (see stopCounting) */
+      static int numHWCounters() { return 0; }
+      static bool initMultiplex() { return true; }
+      static void finishThread() { }
+
+      perf_counters_t(std::vector<event_t> &events, std::vector<std::string> &eventNames, bool multiplex);
+
+      void startCounting();
+      /** \brief read the values. If the group was never scheduled, the events are opened again multiplexed */
+      void stopCounting();
+      /** \brief values of the last stopCounting, one per selected event */
+      inline long long const * getValues() const { return values; }
+      inline int getNumValues() const { return numEvents; }
+
+      ~perf_counters_t();
+  };
+}
+
+#endif
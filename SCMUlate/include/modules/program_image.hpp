@@ -0,0 +1,104 @@
+#ifndef __PROGRAM_IMAGE__
+#define __PROGRAM_IMAGE__
+
+/** \brief Pre-assembled programs
+ *
+ * A program image is an SCM program that has already been parsed. It is produced by the
+ * scm-as tool and the instruction memory maps it directly instead of reading the text.
+ * This saves the parsing time when the same program is run thousands of times.
+ *
+ * Layout (all the offsets are from the beginning of the file):
+ *
+ *   image_header_t
+ *   image_instruction_t[num_instructions]
+ *   image_label_t[num_labels]
+ *   uint32_t codelets[num_codelets]    string ids of the codelets that the program uses
+ *   char strings[strings_size]         '\0' terminated strings. A string id is its offset
+ *
+ * The header contains the version of the format, and a checksum of the instruction
+ * tables (see isaChecksum()). An image is rejected when any of them does not match the
+ * simulator. The codelets are identified by name, and they are checked against the
+ * codelets registered in the simulator when the image is loaded.
+ *
+ * Register pointers and codelet objects cannot be stored in the image. They are resolved
+ * when the image is loaded, using the register file and the codelet factory.
+ */
+
+#include "SCMUlate_tools.hpp"
+#include "system_config.hpp"
+#include "instructions_def.hpp"
+#include <cstdint>
+#include <string>
+
+#define PROGRAM_IMAGE_MAGIC "SCMIMG\0"
+#define PROGRAM_IMAGE_MAGIC_SIZE 8
+#define PROGRAM_IMAGE_VERSION 1
+
+namespace scm {
+
+  struct image_header_t {
+    char magic[PROGRAM_IMAGE_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t max_operands;        /**< MAX_NUM_OPERANDS of the assembler */
+    uint64_t isa_checksum;        /**< isaChecksum() of the assembler */
+    uint64_t codelet_checksum;    /**< checksum of the names in the codelets table */
+    uint32_t num_instructions;
+    uint32_t num_labels;
+    uint32_t num_codelets;
+    uint32_t strings_size;
+    uint64_t instructions_offset;
+    uint64_t labels_offset;
+    uint64_t codelets_offset;
+    uint64_t strings_offset;
+  };
+
+  struct image_operand_t {
+    uint8_t type;      /**< operand_t::operand_type */
+    uint8_t pad[3];
+    uint32_t str_id;   /**< text of the operand */
+    uint32_t size_id;  /**< size of the register (e.g. 64B). Only for registers */
+    uint32_t pad2;
+    uint64_t value;    /**< immediate value, PC of the label, or number of the register */
+  };
+
+  struct image_instruction_t {
+    uint8_t type;      /**< instType */
+    uint8_t num_ops;
+    uint16_t op_in_out;
+    uint32_t opcode;
+    uint32_t name_id;  /**< name of the instruction or of the codelet */
+    uint32_t pad;
+    image_operand_t ops[MAX_NUM_OPERANDS];
+  };
+
+  struct image_label_t {
+    uint32_t name_id;
+    uint32_t pc;
+  };
+
+  class program_image {
+    public:
+      /** \brief checksum of the instruction definitions
+       *
+       * Covers the names, opcodes, number of operands, operand directions and kinds of all
+       * the instructions. Any change to the ISA changes it
+       */
+      static uint64_t isaChecksum();
+
+      /** \brief checksum of a list of strings */
+      static uint64_t stringsChecksum(const char * const * strings, uint32_t count);
+
+      /** \brief true if the file starts with the magic number of the program images */
+      static bool isImage(const char * filename);
+
+      /** \brief parse a text program and write its image
+       *
+       * Labels are resolved, and the syntax of all the instructions is checked. The
+       * registers and codelets are not checked against the simulator here, since they
+       * depend on the configuration of the run. Returns false and sets error on failure
+       */
+      static bool assemble(const char * programFile, const char * imageFile, std::string & error);
+  };
+}
+
+#endif
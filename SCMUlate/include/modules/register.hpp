@@ -3,131 +3,126 @@
 
 #include "register_config.hpp"
 #include "SCMUlate_tools.hpp"
+#include "memory_manager.hpp"
+#include <cstring>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <iostream>
 
 namespace scm {
-  typedef union {
-    // the 1000 is because the register file size is in KB
-    unsigned char space[REG_FILE_SIZE_KB*1000];
-    registers_t registers;
-  } register_file_t;
+
+  typedef struct {
+    std::string name; /**< Size as written in the program. e.g. 64B or 2048L */
+    uint32_t size_bytes; /**< Size of each register */
+    uint32_t num_regs; /**< Number of registers in the class */
+    uint64_t stride; /**< Distance between two registers of the class */
+    uint64_t offset; /**< Position of the first register within the register file */
+  } reg_class_t;
 
   class reg_file_module {
-    private: 
-      register_file_t *reg_file;
-    
-    public: 
-      reg_file_module();
+    private:
+      unsigned char *reg_file;
+      uint64_t reg_file_size;
+      uint64_t budget; /**< Size of the cache the register file should fit in */
+      memory_manager_module * mem_manager; /**< Owner of the memory of the register file. If nullptr the heap is used */
+      std::vector<reg_class_t> reg_classes;
+      // Lookup table from the register size in lines to the index of the class in reg_classes.
+      // Position 0 corresponds to the 64B class, since there is no register of 0 lines.
+      std::vector<int32_t> class_table;
+      // Index of the class in reg_classes by the name of its size (64B or <lines>L), used for the names in the programs
+      std::unordered_map<std::string, int32_t> class_names;
+      bool valid_config;
+
+      void buildRegisterFile();
+
+      inline static uint32_t sizeToLines(uint32_t size) {
+        return size == 8 ? 0 : size / CACHE_LINE_SIZE;
+      }
+
+      inline const reg_class_t * getClassBySize(uint32_t size) const {
+        uint32_t lines = sizeToLines(size);
+        if ((size != 8 && size % CACHE_LINE_SIZE != 0) || lines >= class_table.size() || class_table[lines] == -1)
+          return nullptr;
+        return &reg_classes[class_table[lines]];
+      }
+
+    public:
+      /** \brief Register file from a configuration file
+       *
+       * When configFile is nullptr, DEFAULT_REGISTER_CONFIG is used
+       */
+      reg_file_module(memory_manager_module * const mem_manager = nullptr, const char * configFile = nullptr);
+
+      /** \brief Register file with the same classes than another one
+       *
+       * Used for the hidden register file used in renaming
+       */
+      reg_file_module(memory_manager_module * const mem_manager, const std::vector<reg_class_t> & classes);
+
+      inline memory_manager_module * getMemoryManager() const { return mem_manager; }
+      inline const std::vector<reg_class_t> & getRegisterClasses() const { return reg_classes; }
+
+      /** \brief Parse a register configuration
+       *
+       * Adds the classes to the vector, and updates the budget if it is defined.
+       * Returns false if the configuration is not valid.
+       */
+      static bool parseRegisterConfig(std::istream & config, std::vector<reg_class_t> & classes, uint64_t & budget);
+
       void describeRegisterFile();
       bool checkRegisterConfig();
-      static inline uint32_t getRegisterSizeInBytes(std::string size) {
+      /** \brief set all the registers to zero. The memory of the register file is kept */
+      inline void clear() { std::memset(reg_file, 0, reg_file_size); }
+      static inline uint32_t getRegisterSizeInBytes(const std::string & size) {
         uint32_t result = 0;
-        if (size == std::string("64B"))
+        if (size == "64B") {
           result = 8;
-        else if (size == std::string("1L"))
-          result = CACHE_LINE_SIZE;
-        else if (size == std::string("8L"))
-          result = CACHE_LINE_SIZE*8;
-        else if (size == std::string("16L"))
-          result = CACHE_LINE_SIZE*16;
-        else if (size == std::string("256L"))
-          result = CACHE_LINE_SIZE*256;
-        else if (size == std::string("512L"))
-          result = CACHE_LINE_SIZE*512;
-        else if (size == std::string("1024L"))
-          result = CACHE_LINE_SIZE*1024;
-        else if (size == std::string("2048L"))
-          result = CACHE_LINE_SIZE*2048;
-        else
-          SCMULATE_ERROR(0, "DECODED REGISTER DOES NOT EXIST!!!")
+        } else if (size.size() > 1 && size.back() == 'L') {
+          uint32_t lines = 0;
+          for (size_t i = 0; i + 1 < size.size() && lines < MAX_REG_LINES; i++) {
+            if (size[i] < '0' || size[i] > '9') {
+              lines = 0;
+              break;
+            }
+            lines = lines*10 + (size[i] - '0');
+          }
+          result = lines * CACHE_LINE_SIZE;
+        }
+        SCMULATE_ERROR_IF(0, result == 0, "DECODED REGISTER DOES NOT EXIST!!!")
         return result;
       };
-      inline unsigned char * getRegisterByName(std::string size, int num) const {
-        unsigned char * result = NULL;
-        if (size == std::string("64B"))
-          result = REG_64B(num).data;
-        else if (size == std::string("1L"))
-          result = REG_1L(num).data;
-        else if (size == std::string("8L"))
-          result = REG_8L(num).data;
-        else if (size == std::string("16L"))
-          result = REG_16L(num).data;
-        else if (size == std::string("256L"))
-          result = REG_256L(num).data;
-        else if (size == std::string("512L"))
-          result = REG_512L(num).data;
-        else if (size == std::string("1024L"))
-          result = REG_1024L(num).data;
-        else if (size == std::string("2048L"))
-          result = REG_2048L(num).data;
-        else
+      inline unsigned char * getRegisterByName(const std::string & size, int num) const {
+        auto name = class_names.find(size);
+        // Other spellings of a size (e.g. 016L) are parsed
+        const reg_class_t * reg_class = name != class_names.end() ? &reg_classes[name->second] : getClassBySize(getRegisterSizeInBytes(size));
+        if (reg_class == nullptr || num < 0 || static_cast<uint32_t>(num) >= reg_class->num_regs) {
           SCMULATE_ERROR(0, "DECODED REGISTER DOES NOT EXIST!!!")
-        return result;
+          return NULL;
+        }
+        return reg_file + reg_class->offset + reg_class->stride*num;
       };
       // Function used for renaming provides the next register but from the end of the register file
       // This is to avoid coliding with nearby registers hopefully saving time in renaming process
       // It modifies the num by reference. Resulting in the new register number
       inline unsigned char * getNextRegister(uint32_t size, uint32_t & num) {
-        unsigned char * result = NULL;
-        if (size == 8) {
-          // size == "64B"
-          num = (num + 1) % NUM_REG_64BITS;
-          result = REG_64B(num).data;
-        } else if (size == CACHE_LINE_SIZE) {
-          // size == "1L"
-          num = (num + 1) % NUM_REG_1LINE;
-          result = REG_1L(num).data;
-        } else if (size == CACHE_LINE_SIZE*8) {
-          // size == "8L"
-          num = (num + 1) % NUM_REG_8LINE;
-          result = REG_8L(num).data;
-        } else if (size == CACHE_LINE_SIZE*16) {
-          // size == "16L"
-          num = (num + 1) % NUM_REG_16LINE;
-          result = REG_16L(num).data;
-        } else if (size == CACHE_LINE_SIZE*256) {
-          // size == "256L"
-          num = (num + 1) % NUM_REG_256LINE;
-          result = REG_256L(num).data;
-        } else if (size == CACHE_LINE_SIZE*512) {
-          // size == "512L"
-          num = (num + 1) % NUM_REG_512LINE;
-          result = REG_512L(num).data;
-        } else if (size == CACHE_LINE_SIZE*1024) {
-          // size == "1024L"
-          num = (num + 1) % NUM_REG_1024LINE;
-          result = REG_1024L(num).data;
-        } else if (size == CACHE_LINE_SIZE*2048) {
-          // size == "2048L"
-          num = (num + 1) % NUM_REG_2048LINE;
-          result = REG_2048L(num).data;
-        } else
+        const reg_class_t * reg_class = getClassBySize(size);
+        if (reg_class == nullptr) {
           SCMULATE_ERROR(0, "DECODED REGISTER DOES NOT EXIST!!!")
-        return result;
+          return NULL;
+        }
+        num = (num + 1) % reg_class->num_regs;
+        return reg_file + reg_class->offset + reg_class->stride*num;
       }
 
       // Get the number of registers of a given size
       inline uint32_t getNumRegForSize(uint32_t size) const {
-        if (size == 8)
-          return NUM_REG_64BITS;
-        else if (size == CACHE_LINE_SIZE)
-          return NUM_REG_1LINE;
-        else if (size == CACHE_LINE_SIZE*8)
-          return NUM_REG_8LINE;
-        else if (size == CACHE_LINE_SIZE*16)
-          return NUM_REG_16LINE;
-        else if (size == CACHE_LINE_SIZE*256)
-          return NUM_REG_256LINE;
-        else if (size == CACHE_LINE_SIZE*512)
-          return NUM_REG_512LINE;
-        else if (size == CACHE_LINE_SIZE*1024)
-          return NUM_REG_1024LINE;
-        else if (size == CACHE_LINE_SIZE*2048)
-          return NUM_REG_2048LINE;
-
-        SCMULATE_ERROR(0, "DECODED REGISTER DOES NOT EXIST!!!")
-        return 0;
+        const reg_class_t * reg_class = getClassBySize(size);
+        if (reg_class == nullptr) {
+          SCMULATE_ERROR(0, "DECODED REGISTER DOES NOT EXIST!!!")
+          return 0;
+        }
+        return reg_class->num_regs;
       }
      void dumpRegisterFile();
      void dumpRegister(std::string size, int num);
@@ -1,91 +1,45 @@
 #ifndef __REGISTER_CONFIG__
 #define __REGISTER_CONFIG__
 
+/** \brief Register file configuration
+ *
+ * The register file is divided in register classes. A class is defined by the size
+ * of its registers and the number of registers. Sizes are either 64B (a 64 bits register)
+ * or any multiple of the cache line, written as <n>L (e.g. 1L, 157L, 2048L).
+ *
+ * Classes are loaded at startup from a configuration file with one class per line:
+ *   <size> <count>
+ * Empty lines and lines starting with # are ignored. The line
+ *   budget_kb <n>
+ * changes the size (in KB) of the cache the register file is meant to fit in.
+ *
+ * Layout: Each class starts at a REG_CLASS_ALIGNMENT (4 KB) boundary, and each register
+ * starts at a REG_ALIGNMENT (cache line) boundary. Therefore, two registers never share a
+ * cache line, even when they are 64B registers used by different CUs.
+ *
+ * When no configuration is given, DEFAULT_REGISTER_CONFIG is used.
+ */
+
 // Size of L3 in KB
 #define REG_FILE_SIZE_KB 12288l
 // Cache line in bytes
 #define CACHE_LINE_SIZE 64l
+// Alignment of each register
+#define REG_ALIGNMENT CACHE_LINE_SIZE
+// Alignment of each register class
+#define REG_CLASS_ALIGNMENT 4096l
+// Largest register in cache lines. This is the size of the lookup table of classes
+#define MAX_REG_LINES 65536l
 
-// Number of registers created
-#define NUM_REG_64BITS 160l
-#define NUM_REG_1LINE 140l
-#define NUM_REG_8LINE 100l
-#define NUM_REG_16LINE 100l
-#define NUM_REG_256LINE 60l
-#define NUM_REG_512LINE 60l
-#define NUM_REG_1024LINE 60l
-#define NUM_REG_2048LINE 40l
-
-#define CALCULATE_REG_SIZE (NUM_REG_64BITS*8l + \
-    (NUM_REG_1LINE + \
-     NUM_REG_8LINE*8l + \
-     NUM_REG_16LINE*16l + \
-     NUM_REG_256LINE*256l + \
-     NUM_REG_512LINE*512l + \
-     NUM_REG_1024LINE*1024l + \
-     NUM_REG_2048LINE*2048l)*CACHE_LINE_SIZE)
-
-namespace scm {
-
-  typedef struct{
-      unsigned char data[8];
-  } _reg_64bits;
-  typedef struct{
-      unsigned char data[CACHE_LINE_SIZE];
-  } _reg_1line;
-  typedef struct{
-      unsigned char data[CACHE_LINE_SIZE*8];
-  } _reg_8line;
-  typedef struct{
-      unsigned char data[CACHE_LINE_SIZE*16];
-  } _reg_16line;
-  typedef struct{
-      unsigned char data[CACHE_LINE_SIZE*256];
-  } _reg_256line;
-  typedef struct{
-      unsigned char data[CACHE_LINE_SIZE*512];
-  } _reg_512line;
-  typedef struct{
-      unsigned char data[CACHE_LINE_SIZE*1024];
-  } _reg_1024line;
-  typedef struct{
-      unsigned char data[CACHE_LINE_SIZE*2048];
-  } _reg_2048line;
-  
-  typedef struct {
-  #if NUM_REG_64BITS != 0
-          _reg_64bits reg_64[NUM_REG_64BITS];
-  #endif
-  #if NUM_REG_1LINE != 0
-          _reg_1line reg_1l[NUM_REG_1LINE];
-  #endif
-  #if NUM_REG_8LINE != 0
-          _reg_8line reg_8l[NUM_REG_8LINE];
-  #endif
-  #if NUM_REG_16LINE != 0
-          _reg_16line reg_16l[NUM_REG_16LINE];
-  #endif
-  #if NUM_REG_256LINE != 0
-          _reg_256line reg_256l[NUM_REG_256LINE];
-  #endif
-  #if NUM_REG_512LINE != 0
-          _reg_512line reg_512l[NUM_REG_512LINE];
-  #endif
-  #if NUM_REG_1024LINE != 0
-          _reg_1024line reg_1024l[NUM_REG_1024LINE];
-  #endif
-  #if NUM_REG_2048LINE != 0
-          _reg_2048line reg_2048l[NUM_REG_2048LINE];
-  #endif
-      } registers_t;
-}
-#define REG_64B(num) (reg_file->registers.reg_64[num])
-#define REG_1L(num) (reg_file->registers.reg_1l[num])
-#define REG_8L(num) (reg_file->registers.reg_8l[num])
-#define REG_16L(num) (reg_file->registers.reg_16l[num])
-#define REG_256L(num) (reg_file->registers.reg_256l[num])
-#define REG_512L(num) (reg_file->registers.reg_512l[num])
-#define REG_1024L(num) (reg_file->registers.reg_1024l[num])
-#define REG_2048L(num) (reg_file->registers.reg_2048l[num])
+// Default register file
+#define DEFAULT_REGISTER_CONFIG \
+  "64B 160\n"                   \
+  "1L 140\n"                    \
+  "8L 100\n"                    \
+  "16L 100\n"                   \
+  "256L 60\n"                   \
+  "512L 60\n"                   \
+  "1024L 60\n"                  \
+  "2048L 40\n"
 
 #endif
@@ -0,0 +1,88 @@
+#ifndef __ROOFLINE__
+#define __ROOFLINE__
+
+/** \brief Roofline accounting of the codelets
+ *
+ * Each CU accumulates, per codelet type (and per memory instruction), the number of
+ * executions, the time executing them, the bytes moved and the floating point operations.
+ * The bytes of memory codelets and memory instructions are their memory ranges (reads are
+ * L2 to register, writes register to L2). The bytes of compute codelets are the sizes of
+ * their register operands, read or written according to their OP_IO. The flops are declared
+ * by the implementation of the codelet with setFlops(). Codelets that do not declare them
+ * only report bandwidth.
+ *
+ * When the machine is destroyed, the arithmetic intensity (flops per byte), the achieved
+ * bandwidth and GFLOP/s of each codelet are compared against the peaks of one CU: the
+ * attainable performance is min(peak GFLOP/s, intensity * peak GB/s). Codelets with an
+ * intensity under the ridge point (peak GFLOP/s / peak GB/s) are memory bound. The peaks
+ * are measured with a single thread (a triad for the bandwidth, independent multiply-adds
+ * for the flops) after the run, unless they are given with setPeaks.
+ *
+ * Each CU only writes its own accounts. Nothing is accounted when the roofline is disabled
+ */
+
+#include <cstdint>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include "SCMUlate_tools.hpp"
+#include "instructions.hpp"
+#include "system_config.hpp"
+
+namespace scm {
+
+  class roofline_module {
+    private:
+      struct codelet_account_t {
+        uint64_t calls;
+        uint64_t ns;
+        uint64_t bytes_read;
+        uint64_t bytes_written;
+        uint64_t flops;
+        codelet_account_t() : calls(0), ns(0), bytes_read(0), bytes_written(0), flops(0) { }
+        void add(codelet_account_t const & other);
+      };
+      /** \brief accounts of a CU */
+      struct cu_accounts_t {
+        std::vector<codelet_account_t> codelets;          /**< Indexed by codelet ID */
+        std::map<opcode_t, codelet_account_t> memInsts;   /**< Memory instructions by opcode */
+        std::map<opcode_t, std::string> memInstNames;
+      };
+
+      std::vector<cu_accounts_t> cus;
+      bool enabled;
+      std::string outputName;
+      double peakGFlops, peakGBs;
+      bool peaksMeasured;
+
+      void measurePeaks();
+      /** \brief name and totals of each codelet type and memory instruction executed */
+      std::vector<std::pair<std::string, codelet_account_t> > totals();
+
+    public:
+      roofline_module(uint32_t numCUs);
+
+      /** \brief steady clock in ns */
+      static inline uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+      }
+
+      /** \brief account the codelets. The report is also written as JSON to outputName if it is not empty */
+      void enable(std::string outputName = std::string());
+      inline bool isEnabled() const { return this->enabled; }
+      /** \brief peaks of one CU. The peaks are not measured if they are set */
+      void setPeaks(double gflops, double gbs);
+      /** \brief parse GFLOPS,GBs (e.g. 50,12.5) */
+      static bool parsePeaks(std::string const & peaks, double & gflops, double & gbs);
+
+      /** \brief an instruction executed by the CU took ns. Called by the thread of the CU only */
+      void account(uint32_t cu, decoded_instruction_t * inst, uint64_t ns);
+
+      /** \brief print the report and write the JSON output. Called when the machine is done */
+      void report();
+  };
+
+}
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef __SCHEDULE_LOG__
+#define __SCHEDULE_LOG__
+
+/** \brief Record and replay of the scheduling decisions
+ *
+ * The decisions of the SU depend on the timing of the CUs: the CU that receives each
+ * instruction, the order of the dispatches, and the hidden registers used by the renaming
+ * of the OoO mode. Two runs of the same program do not take the same decisions, which makes
+ * a slow run hard to investigate. In record mode, the SU logs every decision to a compact
+ * binary file. In replay mode, the SU forces the decisions of the file:
+ *
+ * - The dispatches happen in the recorded order, and each one goes to the recorded CU. A
+ *   ready instruction that is not the next one of the schedule waits, and so does the next
+ *   one while its CU is busy.
+ * - The renaming of the operand of an instruction uses the recorded hidden register. If
+ *   that register is still in use, waiting could block the rename that frees it, so the
+ *   normal renaming is used and the rename is counted as a miss.
+ *
+ * Only the decisions are forced, not the timing, so the SU iteration of each dispatch is
+ * logged to compare the two runs. When the replay cannot continue (the program, the
+ * register configuration or the inputs changed, or no instruction progresses for
+ * SCHED_REPLAY_STALL_ITERATIONS iterations of the SU) the replay diverges: the rest of the
+ * run uses the dispatch policy and the normal renaming, and the report tells at which
+ * decision it happened.
+ *
+ * The instructions are identified by their position in the order of fetch, which is the
+ * same in every run of a program (the SU fetches in program order). Their PC is also logged
+ * with the dispatches to detect a different program.
+ *
+ * File: "SCMSCHED", version, CUs, ILP mode and a reserved word (uint32_t each), followed by
+ * records of a tag and LEB128 values. The positions are zigzag deltas from the previous
+ * record of the same tag:
+ * - 'D' SU iterations since the previous dispatch, position, PC, CU
+ * - 'R' position, operand, number of the hidden register
+ * - 'E' SU iterations of the run (last record)
+ *
+ * The log is only used by the SU thread. Nothing is logged when it is disabled (the pointer
+ * of the SU is null)
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "SCMUlate_tools.hpp"
+#include "system_config.hpp"
+
+namespace scm {
+
+  class schedule_log_module {
+    public:
+      enum schedule_mode_t {SCHED_OFF, SCHED_RECORD, SCHED_REPLAY};
+
+    private:
+      struct dispatch_t {
+        uint64_t iteration;
+        uint64_t seq;
+        uint32_t pc;
+        uint32_t cu;
+      };
+
+      schedule_mode_t mode;
+      uint32_t numCUs;
+      ILP_MODES ilp_mode;
+      std::string fileName;
+      uint64_t iteration;          /**< Current iteration of the SU */
+      uint64_t dispatches, renames; /**< Decisions recorded, or forced in the replay */
+      uint64_t renameMisses;       /**< Recorded renames that could not be forced */
+
+      // Record
+      FILE * file;
+      std::vector<unsigned char> buffer;
+      uint64_t last_iteration;     /**< Iteration of the previous dispatch */
+      uint64_t last_dispatch_seq, last_rename_seq;
+
+      // Replay
+      std::vector<dispatch_t> schedule;
+      size_t next;                 /**< Next dispatch of the schedule */
+      std::unordered_map<uint64_t, uint32_t> renameRegs; /**< Hidden registers by position and operand */
+      uint64_t recordedRenames, recordedIterations;
+      bool held;                   /**< A dispatch waited for the schedule in this iteration */
+      uint64_t stalled;            /**< Consecutive iterations without progress */
+      bool diverged;
+      std::string divergence;
+
+      void put(uint64_t value);
+      inline void putDelta(uint64_t value, uint64_t & last) {
+        int64_t delta = static_cast<int64_t>(value - last);
+        put((static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+        last = value;
+      }
+      void flush();
+      void diverge(std::string const & reason);
+      /** \brief bits of the operand number (1 to MAX_NUM_OPERANDS) in the key of a hidden register */
+      static constexpr uint32_t operandBits(uint32_t maxOp) { return maxOp == 0 ? 0 : 1 + operandBits(maxOp >> 1); }
+      static inline uint64_t renameKey(uint64_t seq, uint32_t op) { return (seq << operandBits(MAX_NUM_OPERANDS)) | op; }
+
+    public:
+      schedule_log_module(uint32_t numCUs, ILP_MODES ilp_mode);
+
+      /** \brief log the decisions of the run to a file. Call it before the machine runs */
+      bool setRecord(std::string const & file);
+      /** \brief force the decisions logged in a file. Fails if the file was recorded with other CUs or ILP mode */
+      bool setReplay(std::string const & file);
+      inline schedule_mode_t getMode() const { return this->mode; }
+      inline bool isRecording() const { return this->mode == SCHED_RECORD; }
+      /** \brief the decisions are still forced (the replay did not diverge) */
+      inline bool isReplaying() const { return this->mode == SCHED_REPLAY && !this->diverged; }
+      inline bool hasDiverged() const { return this->diverged; }
+      inline uint64_t getDispatches() const { return this->dispatches; }
+      inline uint64_t getRenames() const { return this->renames; }
+      inline uint64_t getRenameMisses() const { return this->renameMisses; }
+
+      /** \brief a new iteration of the SU starts. progress is false if no instruction executed or retired in the previous one */
+      void nextIteration(bool progress);
+
+      /** \brief record mode: the instruction was dispatched to the CU */
+      inline void recordDispatch(uint64_t seq, uint32_t pc, uint32_t cu) {
+        this->buffer.push_back('D');
+        put(this->iteration - this->last_iteration);
+        putDelta(seq, this->last_dispatch_seq);
+        put(pc);
+        put(cu);
+        this->last_iteration = this->iteration;
+        this->dispatches++;
+        if (this->buffer.size() >= SCHED_LOG_BUFFER_SIZE)
+          flush();
+      }
+      /** \brief record mode: the operand op of the instruction was renamed to the hidden register */
+      inline void recordRename(uint64_t seq, uint32_t op, uint32_t reg) {
+        this->buffer.push_back('R');
+        putDelta(seq, this->last_rename_seq);
+        put(op);
+        put(reg);
+        this->renames++;
+        if (this->buffer.size() >= SCHED_LOG_BUFFER_SIZE)
+          flush();
+      }
+
+      /** \brief replay mode: CU of the instruction, or -1 if it is not the next dispatch of the schedule */
+      int replayDispatch(uint64_t seq, uint32_t pc);
+      /** \brief replay mode: the instruction returned by replayDispatch was inserted in its CU */
+      void dispatched();
+      /** \brief replay mode: hidden register of the operand op of the instruction, or -1 if it was not recorded */
+      int64_t replayRename(uint64_t seq, uint32_t op);
+      /** \brief replay mode: the operand was renamed. forced is false if the register returned by replayRename was in use */
+      void renamed(uint64_t seq, uint32_t op, bool forced);
+
+      /** \brief write the end of the log. Called when the machine stops */
+      void finish();
+      /** \brief print the decisions logged or forced. Called when the machine is done */
+      void report();
+
+      ~schedule_log_module();
+  };
+
+}
+
+#endif
@@ -7,8 +7,21 @@
 #include <iostream>
 #include <fstream>
 #include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <array>
+#include <cstdint>
 #include "SCMUlate_tools.hpp"
+#include "system_config.hpp"
 #include "omp.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 #ifdef TIMERS_COUNTERS
 #define TIMERS_COUNTERS_GUARD(code) code
@@ -16,13 +29,17 @@
 #define TIMERS_COUNTERS_GUARD(code) /* code */
 #endif
 
-#ifdef PAPI_COUNT
-#include "papi.h"
-
-
-#define PAPI_EVENTS PAPI_TOT_CYC, PAPI_DP_OPS, PAPI_DP_OPS
-//#define PAPI_EVENTS PAPI_L3_TCM, PAPI_LST_INS, PAPI_L3_TCA
-//#define PAPI_EVENTS PAPI_TOT_CYC, PAPI_RES_STL
+// Hardware counters around the execution of each codelet. PAPI, or perf_event_open in Linux
+#if defined(PAPI_COUNT)
+#include "papi_counters.hpp"
+#define HW_COUNTERS 1
+#define HW_EVENTS PAPI_EVENTS
+namespace scm { typedef papi_counters_t hw_counters_t; }
+#elif defined(PERF_COUNT)
+#include "perf_counters.hpp"
+#define HW_COUNTERS 1
+#define HW_EVENTS PERF_EVENTS
+namespace scm { typedef perf_counters_t hw_counters_t; }
 #endif
 
 namespace scm {
@@ -57,200 +74,373 @@ namespace scm {
     CUMEM_IDLE
   };
 
-#ifdef PAPI_COUNT
-  class papi_counters_t {
-    private:
-      int EventSet;
-      int numEvents;
-      long long *values;
-    public:
-      papi_counters_t(std::vector<int> &events, std::vector<std::string> &eventNames) : EventSet(PAPI_NULL), numEvents(0), values(nullptr) {
-        // Create an event set and add the different events. 
-        // Start meassuring 
-        int retVal; 
-        retVal = PAPI_create_eventset(&EventSet);
-        if (retVal != PAPI_OK) {
-          SCMULATE_ERROR(0, "PAPI Error starting the EventSet");
-          return;
-        }
-        auto it_event = events.begin();
-        auto it_name = eventNames.begin();
-        for (; it_event != events.end(); it_event++, it_name++) {
-          retVal = PAPI_add_event(EventSet, *it_event);
-          SCMULATE_INFOMSG(4,"PAPI, Adding event to event %s to Evenset %d", it_name->c_str(), EventSet);
-          if (retVal != PAPI_OK) {
-            SCMULATE_ERROR(0, "PAPI, error adding the Event %s to Evenset %d", it_name->c_str(), EventSet);
-            continue;
-          }
-          numEvents++;
-        }
-        // Allocate space for the values
-        values = new long long [numEvents];
-      }
+  /** \brief name of an event of a counter type (e.g. CUMEM_EXECUTION_COD) */
+  const char * eventName(counter_type type, int event);
 
-      void startCounting () {
-        if (EventSet != PAPI_NULL) {
-          PAPI_reset(EventSet);
-          PAPI_start(EventSet);
-        }
-      }
 
-      std::vector <long long> getCurrentValues() {
-        if (EventSet != PAPI_NULL) {
-          PAPI_read(EventSet, values);
-          return getValues();
-        }
-        return std::vector<long long>(); 
-      }
+  /** \brief What the timers record. Selected at runtime with timers_counters::setTraceMode
+   *
+   * The SU decides if each instruction is traced when it fetches it (traceInstruction), and the
+   * SU and the CUs only record the events of the traced instructions. The event that follows
+   * a traced event is also recorded, so the slice of the traced instruction has the right duration.
+   * The start and end of the timers are always recorded
+   */
+  enum trace_mode_t {
+    TRACE_FULL,        /**< All the events */
+    TRACE_SAMPLED,     /**< One of every N instructions, optionally only the ones in a range of PCs */
+    TRACE_WINDOW_PC,   /**< The instructions from the fetch of one PC to the fetch of another PC */
+    TRACE_WINDOW_TIME, /**< The instructions fetched between two times of the run */
+    TRACE_AGGREGATE    /**< No events. Count and time of the events of each instruction type (e.g. each codelet) */
+  };
 
-      std::vector <long long> getValues () {
-        std::vector<long long> retValues;
-        for (int i = 0; i < numEvents; i++)
-          retValues.push_back(values[i]);
-        return retValues;
-      }
+  /** \brief Event types per counter type kept in the aggregates. All the event enums are smaller */
+  #define TRACE_MAX_EVENT_TYPES 8
 
-      void stopCounting() {
-        if (EventSet != PAPI_NULL) {
-          PAPI_stop(EventSet, values);
-          // int status;
-          // PAPI_state(EventSet, &status);
-          // if (status == PAPI_OVERFLOWING) {
-          //   printf("OVERFLOWWWW\n");
-          // }
-          PAPI_reset(EventSet);
+  /** \brief ID of a timer. Given by timers_counters::addTimer */
+  typedef uint32_t timer_id_t;
 
-        }
-      }
+  /** \brief Instruction of an event that is not related to an instruction */
+  #define NO_INSTRUCTION 0xFFFFFFFFu
+  /** \brief Bit of the instruction ID that marks an interned description instead of a PC */
+  #define DESCRIPTION_ID_BIT 0x80000000u
 
-      ~papi_counters_t() {
-        // Delete the event set and stop counters
-        if (EventSet != PAPI_NULL) {
-          PAPI_destroy_eventset(&EventSet);
-          delete []values;
-        }
+  /** \brief Clock of the trace events
+   *
+   * The time stamp counter of the processor when it is available, otherwise the steady clock in
+   * nanoseconds. The ticks are converted to seconds when the trace is dumped, using the steady clock
+   * as reference. The TSC is assumed to be invariant (constant rate and synchronized between cores)
+   */
+  class trace_clock {
+    public:
+      static inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
       }
   };
-#endif 
 
-  class timer_event {
+  /** \brief Binary record of an event
+   *
+   * Fixed size, so the records can be preallocated and copied without allocations. The description
+   * of the event is not stored in the record, only the ID of the instruction, which is resolved
+   * to its text when the trace is dumped
+   */
+  struct trace_record_t {
+    uint64_t timestamp; /**< trace_clock ticks */
+    timer_id_t timer_id;
+    uint16_t event_id;
+    uint16_t num_hw;    /**< Hardware counters in hw */
+    uint32_t inst_id;   /**< ID of the instruction (instructionID), NO_INSTRUCTION, or an interned description (DESCRIPTION_ID_BIT) */
+#ifdef HW_COUNTERS
+    long long hw[TRACE_MAX_HW_COUNTERS];
+#endif
+  };
+
+  /** \brief Single producer single consumer ring of trace records
+   *
+   * The producer is the thread that owns the timer (the SU, a CU or the machine). Writing an
+   * event is a store to the preallocated slot and an atomic increment of the head, without locks.
+   * The size must be a power of 2
+   */
+  class trace_ring {
     private:
-      int eventID;
-      std::string description;
-      std::chrono::time_point<std::chrono::high_resolution_clock> counter;
-      #ifdef PAPI_COUNT
-        std::vector<long long> PAPICounters;
-      #endif
+      std::vector<trace_record_t> records;
+      uint64_t mask;
+      std::atomic<uint64_t> head; /**< Next record written by the producer */
+      std::atomic<uint64_t> tail; /**< Next record read by the consumer */
     public:
-      timer_event(int id, std::string desc = std::string()) : eventID(id), description(desc), counter(std::chrono::high_resolution_clock::now()) { }
-      timer_event(const timer_event& other) {
-        this->eventID = other.eventID;
-        this->description = other.description;
-        this->counter = other.counter;
-        #ifdef PAPI_COUNT
-          this->PAPICounters = other.PAPICounters;
-        #endif
+      trace_ring(uint64_t size) : records(size), mask(size - 1), head(0), tail(0) { }
+
+      /** \brief slot of the next record, or nullptr if the ring is full. Producer only */
+      inline trace_record_t * reserve() {
+        uint64_t cur_head = head.load(std::memory_order_relaxed);
+        if (cur_head - tail.load(std::memory_order_acquire) > mask)
+          return nullptr;
+        return &records[cur_head & mask];
       }
-      inline int getID() { return this->eventID; }
-      inline std::string getDescription() { return this->description; }
-      inline std::chrono::time_point<std::chrono::high_resolution_clock> getValue() { return this->counter; }
-      #ifdef PAPI_COUNT
-        inline void addPAPIcounters(std::vector<long long> counts) { PAPICounters = counts; }
-        inline std::vector<long long>& getPAPIcounters() { return PAPICounters; }
-      #endif
-      inline bool operator==(const timer_event& other){ return (eventID == other.eventID && counter == other.counter); }
-      bool operator != (const timer_event& other) { return eventID != other.eventID || counter != other.counter;  }
+      /** \brief publish the record given by reserve(). Producer only */
+      inline void commit() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+      /** \brief move all the published records to out. Consumer only */
+      void drain(std::vector<trace_record_t> & out) {
+        uint64_t cur_tail = tail.load(std::memory_order_relaxed);
+        uint64_t cur_head = head.load(std::memory_order_acquire);
+        for (; cur_tail != cur_head; cur_tail++)
+          out.push_back(records[cur_tail & mask]);
+        tail.store(cur_tail, std::memory_order_release);
+      }
+      inline uint64_t size() const { return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed); }
   };
 
+  /** \brief Binary trace file written while the machine runs (see setTraceOutput)
+   *
+   * Little endian. A header, the trace_record_t of all the timers as they are flushed (the records
+   * of each timer are in order, but the timers are interleaved), and a footer with the text needed
+   * to read them. The footer is written when the timers are dumped. Strings are a uint32_t length
+   * and their characters.
+   *
+   *   header: "SCMTRACE", uint32_t version, record size, offset of hw in the record, TRACE_MAX_HW_COUNTERS (0 without HW_COUNTERS)
+   *   footer: double seconds per tick, uint64_t initial ticks,
+   *           uint32_t timers, and for each timer (by ID) uint32_t counter_type and its name,
+   *           uint32_t instructions, and for each one uint32_t ID, uint32_t PC and its text,
+   *           uint32_t descriptions, and each description (by ID),
+   *           uint32_t hardware counters, and the name of each one,
+   *           uint32_t stat groups, and for each group its name, uint32_t stats, and each key and value
+   *   trailer: uint64_t offset of the footer, "SCMTEND" and a 0
+   *
+   * tools/trace2chrome.py converts it to the trace event format of Chrome and Perfetto
+   */
+  #define TRACE_FILE_MAGIC "SCMTRACE"
+  #define TRACE_FILE_END_MAGIC "SCMTEND"
+  #define TRACE_FILE_VERSION 2
+
   class timers_counters {
     private:
-#ifdef PAPI_COUNT
-      std::vector<int> PAPI_events;
-      std::vector<std::string> PAPI_events_str;
-      std::map <std::string, papi_counters_t*> PAPIcountersManager;
-      void init_papi_events() {}
-      template <typename ...Args>
-      void init_papi_events(int cur_val, Args... args) {
-        PAPI_events.push_back(cur_val);
-        char event_name[PAPI_MAX_STR_LEN];
-        int retVal = PAPI_event_code_to_name(cur_val, event_name);
-        if (retVal != PAPI_OK)
-          SCMULATE_ERROR(0, "PAPI error on finding event name");
-        SCMULATE_INFOMSG(4, "PAPI, Registering counter %s", event_name);
-        std::string event_name_str(event_name);
-        PAPI_events_str.push_back(event_name_str);
-        init_papi_events(args...);
-      }
-      const PAPI_hw_info_t *hw_info = NULL;
-      
-      std::map <std::string, papi_counters_t> papi_counters;
-      bool disablePapi;
+      struct aggregate_t {
+        uint64_t count;
+        uint64_t ticks;
+      };
+#ifdef HW_COUNTERS
+      /** \brief Sum of the hardware counters of the executions of an instruction */
+      struct hw_aggregate_t {
+        uint64_t count;
+        long long values[TRACE_MAX_HW_COUNTERS];
+      };
+#endif
+
+      /** \brief A timer and the records of its events */
+      struct timer_t {
+        std::string name;
+        counter_type type;
+        trace_ring ring;
+        std::vector<trace_record_t> spilled; /**< Records moved out of the ring when it was full */
+        uint64_t events;
+        uint64_t filtered;  /**< Events not recorded because of the trace mode */
+        bool closePending;  /**< The last event recorded belongs to a traced instruction */
+        // Aggregate mode: the last event, and the count and ticks per instruction ID and event type
+        uint64_t openTicks;
+        uint32_t openInst;
+        int openEvent;
+        bool openTraced;
+        std::vector<std::array<aggregate_t, TRACE_MAX_EVENT_TYPES> > aggregates;
+#ifdef HW_COUNTERS
+        std::vector<hw_aggregate_t> hwAggregates; /**< Indexed by instruction ID */
+#endif
+        timer_t(std::string n, counter_type t) : name(n), type(t), ring(TRACE_RING_SIZE), events(0), filtered(0), closePending(false),
+          openTicks(0), openInst(NO_INSTRUCTION), openEvent(0), openTraced(false) { }
+      };
+
+#ifdef HW_COUNTERS
+      std::vector<hw_counters_t::event_t> hwEvents;
+      std::vector<std::string> hwEventNames;
+      std::vector<hw_counters_t*> hwCountersManager; /**< Indexed by timer ID */
+      bool disableHW;
+      bool multiplexHW;
+      bool rawHWCounters; /**< The values are also kept in the trace records, not only in the aggregates */
+      void dumpHWCounters();
 
 #endif
       std::chrono::time_point<std::chrono::high_resolution_clock> globalInitialTimer;
-      std::map <std::string, std::vector<timer_event>> counters;
-      std::map <std::string, counter_type> counterType;
+      std::chrono::time_point<std::chrono::steady_clock> steadyInitialTimer;
+      uint64_t initialTicks;
+      std::vector<timer_t *> timers;             /**< Indexed by timer ID */
+      std::map <std::string, timer_id_t> timerIDs; /**< Also gives the order of the dump */
+      /** \brief Text of an instruction of the trace */
+      struct instruction_text_t {
+        uint32_t pc;
+        std::string text;
+      };
+      std::vector<instruction_text_t> instructions; /**< Indexed by instruction ID. Written by the SU only */
+      uint32_t programBase;                       /**< ID of the PC 0 of the current program */
+      std::vector<std::string> descriptions;      /**< Interned descriptions of the events added by name */
+      std::mutex descriptionsLock;
+      // Summary values of the modules (e.g. dispatch policy stats). Dumped under the STATS key
+      std::map <std::string, std::map<std::string, std::string>> stats;
       std::string dumpFilename;
-      static unsigned long omp_get_thread_num_wrapper(void) {
-        return (unsigned long)omp_get_thread_num();
-      }
+
+      // Trace mode. Set before the run. The state of the windows and the samples is only used by the SU
+      trace_mode_t traceMode;
+      uint64_t samplePeriod;
+      uint64_t sampleCount;
+      uint32_t pcLow, pcHigh;
+      double timeLow, timeHigh;
+      bool windowOpen;
+      /** \brief decide if the event of a timer is recorded, and update the aggregates. Not used in TRACE_FULL */
+      bool filterEvent(timer_t & timer, int event, uint32_t inst_id, bool traced);
+      bool filterInstruction(uint32_t pc);
+      void dumpAggregates(double secondsPerTick);
+      /** \brief name used to aggregate an instruction ID (the codelet name or the mnemonic) */
+      std::string instructionType(uint32_t inst_id);
+
+      // Binary trace streamed by a flusher thread. Only the flusher drains the rings while it runs
+      std::FILE * traceFile;
+      std::thread flusher;
+      std::atomic<bool> streaming;
+      bool stopFlusher;                      /**< Protected by flushLock */
+      std::mutex flushLock;
+      std::condition_variable flushCond;
+      std::vector<trace_record_t> flushBuffer;
+      uint64_t flushedRecords;
+      void flusherBehavior();
+      void joinFlusher();
+      /** \brief move the records of all the rings to the trace file. Flusher only */
+      void flushRings();
+      void writeTraceFooter(double secondsPerTick);
+
+      void dumpStats(std::ostream & out, std::string & indent);
+      void dumpTimers(std::ostream & out, double secondsPerTick);
+      std::string resolveDescription(uint32_t inst_id);
+      double measureOverhead();
+      /** \brief the ring of the timer is full
+       *
+       * Its records are moved out by the producer, or, when the trace is streamed, the producer
+       * wakes up the flusher and waits for it to make room
+       */
+      void spill(timer_t & timer);
 
     public:
-      timers_counters () : dumpFilename("") {
-        globalInitialTimer = std::chrono::high_resolution_clock::now();
-        #ifdef PAPI_COUNT
-          disablePapi = true;
-          init_papi_events(PAPI_EVENTS);
-          if( PAPI_library_init( PAPI_VER_CURRENT ) == PAPI_VER_CURRENT ) {
-            disablePapi = false;
-            SCMULATE_INFOMSG(3, "Your PAPI has been initialized!");
-          } else {
-             SCMULATE_ERROR(0, "PAPI! I could not load.");
-          }
-          hw_info = PAPI_get_hardware_info();
-          SCMULATE_ERROR_IF(0, hw_info == NULL, "PAPI Could not get your HW info!");
-          int i=0;
-          for (auto it = PAPI_events.begin(); it != PAPI_events.end(); it++, i++) {
-            if (PAPI_query_event(*it) != PAPI_OK)
-              SCMULATE_ERROR(0, "PAPI! Error with missing event i = %s", PAPI_events_str[i].c_str());
-          }
-          int retval = PAPI_thread_init( omp_get_thread_num_wrapper);
-          if (retval != PAPI_OK) {
-            SCMULATE_ERROR(0, "PAPI! Problems with your threads")
-            SCMULATE_ERROR_IF(0, retval != PAPI_ECMP , "PAPI! Trouble with the threads")
-          }
+      timers_counters () : programBase(0), dumpFilename(""), traceMode(TRACE_FULL), samplePeriod(1), sampleCount(0), pcLow(0), pcHigh(UINT32_MAX),
+                           timeLow(0), timeHigh(0), windowOpen(false), traceFile(nullptr), streaming(false), stopFlusher(false), flushedRecords(0) {
+        resetTimer();
+        #ifdef HW_COUNTERS
+          multiplexHW = false;
+          rawHWCounters = false;
+          disableHW = !hw_counters_t::initLibrary();
+          const char * envEvents = std::getenv("SCM_HW_EVENTS");
+          if (envEvents == nullptr || !setHWCounters(envEvents))
+            setHWCounters(HW_EVENTS);
+          const char * envMultiplex = std::getenv("SCM_HW_MULTIPLEX");
+          if (envMultiplex != nullptr && std::strcmp(envMultiplex, "0") != 0)
+            setHWMultiplex(true);
+          const char * envRaw = std::getenv("SCM_HW_RAW");
+          rawHWCounters = envRaw != nullptr && std::strcmp(envRaw, "0") != 0;
         #endif
       }
 
-      #ifdef PAPI_COUNT
-        void initPAPIcounter(std::string counterName) {
-          this->PAPIcountersManager[counterName] = new papi_counters_t(this->PAPI_events, this->PAPI_events_str);
+      #ifdef HW_COUNTERS
+        /** \brief select the hardware counters from a list of event names separated by commas
+         *
+         * The names of the backend (PAPI_TOT_CYC with PAPI, cycles with perf_event). Returns false,
+         * and keeps the previous counters, if an event does not exist in this machine. When there
+         * are more events than hardware counters, the counters are multiplexed. Call it before the run
+         */
+        bool setHWCounters(std::string events);
+        /** \brief multiplex the hardware counters. Call it before the run */
+        void setHWMultiplex(bool multiplex);
+        /** \brief also keep the values of the counters in each trace record (they are always aggregated per instruction type) */
+        inline void setRawHWCounters(bool raw) { rawHWCounters = raw; }
+        /** \brief create the counters of a timer. Called by the thread that owns the timer */
+        void initHWCounters(timer_id_t timer) {
+          if (!this->disableHW)
+            this->hwCountersManager[timer] = new hw_counters_t(this->hwEvents, this->hwEventNames, this->multiplexHW);
         }
-        void startPAPIcounters(std::string counterName) {
-          this->PAPIcountersManager[counterName]->startCounting();
-        }
-        void stopAndRegisterPAPIcounters(std::string counterName, timer_event &event) {
-          this->PAPIcountersManager[counterName]->stopCounting();
-          event.addPAPIcounters(this->PAPIcountersManager[counterName]->getValues());
+        inline void startHWCounters(timer_id_t timer) {
+          if (this->hwCountersManager[timer] != nullptr)
+            this->hwCountersManager[timer]->startCounting();
         }
+        /** \brief stop the hardware counters of the timer, and add an event
+         *
+         * The values are added to the aggregates of the instruction that was counted (counted_inst,
+         * its PC), and to the record of the event when raw counters are selected
+         */
+        void stopAndRegisterHWCounters(timer_id_t timer, int event, uint32_t inst_id = NO_INSTRUCTION, uint32_t counted_inst = NO_INSTRUCTION);
       #endif
 
       void resetTimer() { 
         globalInitialTimer = std::chrono::high_resolution_clock::now(); 
+        steadyInitialTimer = std::chrono::steady_clock::now();
+        initialTicks = trace_clock::now();
       }
-      void addTimer(std::string, counter_type type);
+      /** \brief create a timer. Timers are created before the threads that use them start */
+      timer_id_t addTimer(std::string, counter_type type);
+      /** \brief ID of a timer created with addTimer */
+      inline timer_id_t getTimerID(std::string const & name) { return timerIDs.at(name); }
       double getTimestamp();
-      timer_event& addEvent(std::string, int, std::string = std::string());
+
+      /** \brief select what is recorded
+       *
+       * full, sample:N (one of every N instructions), sample:N:A-B (only the PCs A to B),
+       * window:A-B (from the fetch of PC A to the fetch of PC B), time:T1-T2 (seconds since the
+       * start of the run) or aggregate. Returns false if the mode is not valid. Set it before the run
+       */
+      bool setTraceMode(std::string mode);
+      inline trace_mode_t getTraceMode() const { return traceMode; }
+
+      /** \brief decide if the instruction that the SU fetches at pc is traced. Only called by the SU */
+      inline bool traceInstruction(uint32_t pc) { return this->traceMode == TRACE_FULL || filterInstruction(pc); }
+
+      /** \brief add an event to a timer
+       *
+       * Only the thread that owns the timer can add events to it. inst_id is the instructionID of
+       * the instruction of the event, whose text is given to internInstruction. traced is the
+       * decision of traceInstruction for the instruction of the event. The events that are not
+       * of an instruction (e.g. idle) are only recorded to close the slice of a traced instruction
+       */
+      inline void addEvent(timer_id_t timer, int event, uint32_t inst_id = NO_INSTRUCTION, bool traced = false) {
+        timer_t & cur_timer = *timers[timer];
+        if (this->traceMode != TRACE_FULL && !filterEvent(cur_timer, event, inst_id, traced))
+          return;
+        trace_record_t * rec = cur_timer.ring.reserve();
+        if (rec == nullptr) {
+          spill(cur_timer);
+          rec = cur_timer.ring.reserve();
+        }
+        rec->timestamp = trace_clock::now();
+        rec->timer_id = timer;
+        rec->event_id = event;
+        rec->num_hw = 0;
+        rec->inst_id = inst_id;
+        cur_timer.ring.commit();
+        cur_timer.events++;
+      }
+      /** \brief add an event with a description. Slower, the timer is found by name and the description is interned */
+      void addEvent(std::string, int, std::string = std::string());
+
+      /** \brief ID of the instruction at pc of the current program in the events
+       *
+       * Each program loaded in the machine takes its own range of IDs (see newProgram), so the
+       * events of a program keep its text when other programs run later. For the first program
+       * the ID is the PC. Only changed between runs, so the CUs can read it
+       */
+      inline uint32_t instructionID(uint32_t pc) const { return programBase + pc; }
+      /** \brief text of the instruction at pc, used in the descriptions of its events. Only called by the SU */
+      inline bool hasInstruction(uint32_t pc) {
+        uint32_t inst_id = instructionID(pc);
+        return inst_id < instructions.size() && instructions[inst_id].text.size() != 0;
+      }
+      void internInstruction(uint32_t pc, std::string const & text);
+      /** \brief the IDs of the next program start after the ones of the current program. Called when it is loaded */
+      inline void newProgram() { programBase = instructions.size(); }
+
+      inline void addStat(std::string group, std::string key, std::string value) { stats[group][key] = value; }
       void dumpTimers();
       inline void setFilename(std::string fn) { dumpFilename = fn; }
+      /** \brief stream the records to a binary trace file while the machine runs, instead of dumping JSON
+       *
+       * A flusher thread empties the rings every TRACE_FLUSH_INTERVAL_MS, so the memory used by the
+       * trace does not grow with the run. Must be called after all the timers are created and before
+       * the threads that add events start. dumpTimers() writes the footer and closes the file.
+       * Returns false if the file cannot be created
+       */
+      bool setTraceOutput(std::string fileName);
+      inline bool isStreaming() const { return streaming.load(std::memory_order_relaxed); }
       ~timers_counters() {
-        #ifdef PAPI_COUNT
-          PAPI_unregister_thread();
-          for(std::pair<std::string,papi_counters_t*> manager :  PAPIcountersManager) {
-            delete manager.second;
+        #ifdef HW_COUNTERS
+          hw_counters_t::finishThread();
+          for(hw_counters_t* manager :  hwCountersManager) {
+            delete manager;
           }
         #endif
+        // The trace was not dumped. The file is left without footer
+        if (isStreaming()) {
+          joinFlusher();
+          std::fclose(traceFile);
+        }
+        for (timer_t * timer : timers)
+          delete timer;
       }
   };
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,92 @@
+#ifndef __TRACE_CACHE__
+#define __TRACE_CACHE__
+
+/** \brief Trace cache of the SU
+ *
+ * Every time the SU fetches an instruction, the decoded instruction of the instruction memory
+ * is copied into the instruction buffer. The copy is needed because the ILP controller renames
+ * its operands and changes its codelet parameters. Copying allocates the instruction, its strings,
+ * the directions of its operands, and a new codelet from the codelet factory.
+ *
+ * The trace cache keeps the copies of the hot basic blocks when they leave the instruction buffer.
+ * A block is hot after the SU has entered it TRACE_CACHE_HOT_THRESHOLD times (e.g. the body of a
+ * loop). The next iterations take the copies from the cache without going through the instruction
+ * memory, and only the state that the ILP controller changes is restored
+ * (see decoded_instruction_t::restore).
+ *
+ * Each trace is a basic block (see basic_blocks.hpp), identified by the PC where it starts. The
+ * branch at the end of the block selects the next trace. The renaming and the subscriptions are
+ * not part of the trace, since they depend on the instructions that are in flight.
+ */
+
+#include "SCMUlate_tools.hpp"
+#include "system_config.hpp"
+#include "instructions.hpp"
+#include "instruction_mem.hpp"
+#include "timers_counters.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace scm {
+
+  class trace_cache {
+    private:
+      struct trace_t {
+        uint64_t entries; /**< Times the SU fetched the first instruction of the block */
+        uint64_t hits;    /**< Instructions of the block taken from the cache */
+        uint64_t misses;  /**< Instructions of the block copied from the instruction memory */
+      };
+
+      inst_mem_module * inst_mem_m;
+      std::vector<trace_t> traces; /**< One per basic block */
+      std::vector<std::vector<decoded_instruction_t *> > free_copies; /**< Copies ready to be used again, per PC */
+      uint32_t hot_threshold;
+      uint64_t hits, misses;
+
+      TIMERS_COUNTERS_GUARD(
+        std::chrono::duration<double> hit_time;
+        std::chrono::duration<double> miss_time;
+      );
+
+      inline bool isHot(trace_t const & trace) const { return this->hot_threshold != 0 && trace.entries >= this->hot_threshold; }
+
+    public:
+      trace_cache() = delete;
+      trace_cache(inst_mem_module * const inst_mem);
+
+      /** \brief get a copy of the instruction at pc to insert it in the instruction buffer
+       *
+       * The copy comes from the cache when the block is hot and a copy is available, otherwise
+       * it is copied from the instruction memory. Returns nullptr if pc is outside the program
+       */
+      decoded_instruction_t * acquire(uint32_t pc);
+
+      /** \brief give back a copy that left the instruction buffer
+       *
+       * The copy is kept if its block is hot, otherwise it is deleted
+       */
+      void release(decoded_instruction_t * inst);
+
+      /** \brief drop the traces and the statistics, and cache the blocks of another program
+       *
+       * No copy of the previous program can be in the instruction buffer
+       */
+      void setProgram(inst_mem_module * const inst_mem);
+
+      inline uint64_t getHits() const { return this->hits; }
+      inline uint64_t getMisses() const { return this->misses; }
+      inline double getHitRate() const { return this->hits + this->misses == 0 ? 0 : static_cast<double>(this->hits) / (this->hits + this->misses); }
+      uint32_t getHotTraces() const;
+
+      /** \brief SU time saved by the hits, in seconds
+       *
+       * Estimated from the average time of a hit and of a miss. Only measured with TIMERS_COUNTERS
+       */
+      double getTimeSaved() const;
+
+      void dump();
+      ~trace_cache();
+  };
+}
+
+#endif
@@ -3,6 +3,6 @@
 
 #include "codelet.hpp"
 
-DEFINE_CODELET(print, 2, scm::OP_IO::OP1_RD);
+DEFINE_LIGHT_CODELET(print, 2, scm::OP_IO::OP1_RD);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef __COD_SYNTH__
+#define __COD_SYNTH__
+
+#include "codelet.hpp"
+
+/* Synthetic codelets for the programs of tools/scmgen.py
+ *
+ * They take a controlled time, so the overhead of the SU and the scaling of the machine
+ * can be measured without the libraries of the apps. Operand 2 is the minimum duration in
+ * nanoseconds. The inputs are optional (up to the last operand): the first 8 bytes of the
+ * output are one plus the sum of the first 8 bytes of each input, so the dependencies of the
+ * program are real, and the results do not depend on the timing or on the ILP mode.
+ *
+ * COD synth_spin out, ns, in1, ..., in6;
+ *   Spins on the CU for ns nanoseconds.
+ *
+ * COD synth_stream out, ns, src, dst, bytes, in1, in2, in3;
+ *   Copies bytes from the SCM memory address in the 64B register src to the one in dst,
+ *   and waits until ns nanoseconds have passed. The bandwidth is 2*bytes/ns at most.
+ *   The memory ranges are declared, so the streams are memory hazards of each other.
+ */
+
+DEFINE_CODELET(synth_spin, 8, scm::OP_IO::OP1_WR | scm::OP_IO::OP3_RD | scm::OP_IO::OP4_RD | scm::OP_IO::OP5_RD |
+                              scm::OP_IO::OP6_RD | scm::OP_IO::OP7_RD | scm::OP_IO::OP8_RD);
+
+DEFINE_MEMORY_CODELET(synth_stream, 8, scm::OP_IO::OP1_WR | scm::OP_IO::OP3_RD | scm::OP_IO::OP4_RD |
+                                       scm::OP_IO::OP6_RD | scm::OP_IO::OP7_RD | scm::OP_IO::OP8_RD,
+                      scm::OP_ADDRESS::OP3_IS_ADDRESS | scm::OP_ADDRESS::OP4_IS_ADDRESS);
+
+#endif
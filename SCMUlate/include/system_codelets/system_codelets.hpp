@@ -2,5 +2,6 @@
 #define __SYS_CODELETS__
 
 #include "cod_print.hpp"
+#include "cod_synth.hpp"
 
 #endif
\ No newline at end of file
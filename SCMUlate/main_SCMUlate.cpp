@@ -2,11 +2,35 @@
 #include <stdio.h>
 #include "scm_machine.hpp"
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <string>
 
 static struct {
   bool fileInput = false;
   char * fileName;
+  scm::mem_placement_policy placement = scm::PLACE_DEFAULT;
+  int placementNode = 0;
+  scm::mem_page_mode pageMode = scm::PAGES_THP;
+  char * manifestName = nullptr;
+  char * regConfigName = nullptr;
+  scm::DISPATCH_POLICIES dispatchPolicy = scm::ROUND_ROBIN;
+  scm::ILP_MODES ilpMode = scm::SEQUENTIAL;
+  uint32_t inlineThreshold = SU_INLINE_MEM_THRESHOLD;
+  char * traceName = nullptr;
+  char * traceMode = nullptr;
+  char * hwCounters = nullptr;
+  bool hwMultiplex = false;
+  bool hwRaw = false;
+  char * metricsOutput = nullptr;
+  uint32_t metricsInterval = LIVE_METRICS_INTERVAL_MS;
+  bool roofline = false;
+  char * rooflineOutput = nullptr;
+  char * rooflinePeaks = nullptr;
+  char * scheduleRecord = nullptr;
+  char * scheduleReplay = nullptr;
+  char * jobsName = nullptr;
+  bool resetJobs = false;
 } program_options;
 
  // 4 GB
@@ -19,34 +43,190 @@ int SCMUlate();
 
 int main (int argc, char * argv[]) {
   parseProgramOptions(argc, argv);
-  unsigned char * memory = new unsigned char[SIZEOFMEM];
+  scm::memory_manager_module memManager(SIZEOFMEM, program_options.placement, program_options.pageMode, program_options.placementNode);
+  if (program_options.manifestName != nullptr && !memManager.loadManifest(program_options.manifestName)) {
+    std::cout << "Could not map the datasets in " << program_options.manifestName << std::endl;
+    return 1;
+  }
+
+  // Service mode: the programs come from a job queue (a file, a FIFO, or - for stdin)
+  std::ifstream jobsFile;
+  std::istream * jobs = nullptr;
+  std::string firstJob;
+  if (program_options.jobsName != nullptr) {
+    if (strcmp(program_options.jobsName, "-") == 0) {
+      jobs = &std::cin;
+    } else {
+      jobsFile.open(program_options.jobsName);
+      if (!jobsFile.is_open()) {
+        std::cout << "Could not open the job queue " << program_options.jobsName << std::endl;
+        return 1;
+      }
+      jobs = &jobsFile;
+    }
+    // Without -i, the first job of the queue is the program the machine starts with
+    while (!program_options.fileInput && std::getline(*jobs, firstJob)) {
+      if (firstJob.empty() || firstJob[0] == '#')
+        continue;
+      program_options.fileInput = true;
+      program_options.fileName = &firstJob[0];
+    }
+    if (!program_options.fileInput) {
+      std::cout << "The job queue " << program_options.jobsName << " is empty" << std::endl;
+      return 1;
+    }
+  }
 
   // SCM MACHINE
   scm::scm_machine * myMachine;
   if (program_options.fileInput) {
     SCMULATE_INFOMSG(0, "Reading program file %s", program_options.fileName);
-    myMachine = new scm::scm_machine(program_options.fileName, memory);
+    myMachine = new scm::scm_machine(program_options.fileName, &memManager, program_options.ilpMode, program_options.regConfigName);
   } else {
     SCMULATE_INFOMSG(0, "Reading from stdin");
     char emptyStr[10] = "";
-    myMachine = new scm::scm_machine(emptyStr, memory);
+    myMachine = new scm::scm_machine(emptyStr, &memManager, program_options.ilpMode, program_options.regConfigName);
   }
 
-  myMachine->run();
+  myMachine->setDispatchPolicy(program_options.dispatchPolicy);
+  myMachine->setInlineThreshold(program_options.inlineThreshold);
+  if (program_options.traceName != nullptr || program_options.traceMode != nullptr) {
+#ifdef TIMERS_COUNTERS
+    if (program_options.traceMode != nullptr && !myMachine->setTraceMode(program_options.traceMode))
+      std::cout << "Unknown trace mode " << program_options.traceMode << ". Using full" << std::endl;
+    if (program_options.traceName != nullptr && !myMachine->setTraceOutput(program_options.traceName))
+      std::cout << "Could not create the trace file " << program_options.traceName << std::endl;
+#else
+    std::cout << "The trace needs a build with TIMERS_COUNTERS. Ignoring -trace and -tm" << std::endl;
+#endif
+  }
+  if (program_options.hwCounters != nullptr || program_options.hwMultiplex || program_options.hwRaw) {
+#if defined(TIMERS_COUNTERS) && defined(HW_COUNTERS)
+    scm::timers_counters * timers = myMachine->getTimersCounters();
+    if (program_options.hwCounters != nullptr && !timers->setHWCounters(program_options.hwCounters))
+      std::cout << "Invalid hardware counters " << program_options.hwCounters << ". Using the defaults" << std::endl;
+    if (program_options.hwMultiplex)
+      timers->setHWMultiplex(true);
+    timers->setRawHWCounters(program_options.hwRaw);
+#else
+    std::cout << "The hardware counters need a build with TIMERS_COUNTERS and PAPI or PERF_EVENTS. Ignoring -hw, -hwmux and -hwraw" << std::endl;
+#endif
+  }
+  if (program_options.metricsOutput != nullptr && !myMachine->setMetricsOutput(program_options.metricsOutput, program_options.metricsInterval))
+    std::cout << "Could not open the live metrics output " << program_options.metricsOutput << std::endl;
+  if (program_options.roofline || program_options.rooflineOutput != nullptr) {
+    myMachine->setRoofline(program_options.rooflineOutput != nullptr ? program_options.rooflineOutput : "");
+    double gflops, gbs;
+    if (program_options.rooflinePeaks != nullptr) {
+      if (scm::roofline_module::parsePeaks(program_options.rooflinePeaks, gflops, gbs))
+        myMachine->setRooflinePeaks(gflops, gbs);
+      else
+        std::cout << "Invalid peaks " << program_options.rooflinePeaks << ". Use -rpeak GFLOPS,GBs. Measuring them" << std::endl;
+    }
+  }
+  if (program_options.scheduleRecord != nullptr && program_options.scheduleReplay != nullptr)
+    std::cout << "-record and -replay cannot be used together. Ignoring -record" << std::endl;
+  if (program_options.scheduleReplay != nullptr) {
+    if (!myMachine->setScheduleReplay(program_options.scheduleReplay))
+      std::cout << "Could not replay the schedule " << program_options.scheduleReplay << ". Using the dispatch policy" << std::endl;
+  } else if (program_options.scheduleRecord != nullptr && !myMachine->setScheduleRecord(program_options.scheduleRecord)) {
+    std::cout << "Could not create the schedule log " << program_options.scheduleRecord << std::endl;
+  }
+  if (jobs != nullptr)
+    myMachine->serve(*jobs, program_options.resetJobs);
+  else
+    myMachine->run();
   TIMERS_COUNTERS_GUARD(
     myMachine->setTimersOutput("trace.json");
   );
   delete myMachine;
-  delete[] memory;
   return 0;
 }
 
 void parseProgramOptions(int argc, char* argv[]) {
+  // Options without value
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-stream") == 0) {
+      // Execute the program while it is being loaded. Programs from stdin or pipes are always streamed
+      scm::inst_mem_module::setStreaming(true);
+    } else if (strcmp(argv[i], "-hwmux") == 0) {
+      // Multiplex the hardware counters
+      program_options.hwMultiplex = true;
+    } else if (strcmp(argv[i], "-hwraw") == 0) {
+      // Keep the hardware counters of each event in the trace, not only the aggregates
+      program_options.hwRaw = true;
+    } else if (strcmp(argv[i], "-roofline") == 0) {
+      // Roofline report of the codelets when the machine finishes
+      program_options.roofline = true;
+    } else if (strcmp(argv[i], "-reset") == 0) {
+      // Service mode: clear the registers before each job
+      program_options.resetJobs = true;
+    }
+  }
   // there are other arguments
   for (int i = 1; i + 1 < argc; i++) {
     if (strcmp(argv[i], "-i") == 0) {
       program_options.fileInput = true;
       program_options.fileName = argv[++i];
+    } else if (strcmp(argv[i], "-m") == 0) {
+      // Manifest of files mapped into the SCM memory
+      program_options.manifestName = argv[++i];
+    } else if (strcmp(argv[i], "-r") == 0) {
+      // Register file configuration
+      program_options.regConfigName = argv[++i];
+    } else if (strcmp(argv[i], "-dp") == 0) {
+      // Dispatch policy: rr, ll, affinity
+      if (!scm::dispatch_controller::parsePolicy(argv[++i], program_options.dispatchPolicy))
+        std::cout << "Unknown dispatch policy " << argv[i] << ". Using rr" << std::endl;
+    } else if (strcmp(argv[i], "-ilp") == 0) {
+      // ILP mode of the SU: seq, superscalar, ooo
+      if (!scm::ilp_controller::parseMode(argv[++i], program_options.ilpMode))
+        std::cout << "Unknown ILP mode " << argv[i] << ". Using seq" << std::endl;
+    } else if (strcmp(argv[i], "-inl") == 0) {
+      // Largest register (in bytes) of the loads and stores executed by the SU
+      program_options.inlineThreshold = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-D") == 0) {
+      // Symbol of the program preprocessor: NAME=VALUE. Overrides .set NAME in the program
+      if (!scm::program_preprocessor::predefine(argv[++i]))
+        std::cout << "Invalid definition " << argv[i] << ". Use -D NAME=VALUE" << std::endl;
+    } else if (strcmp(argv[i], "-mp") == 0) {
+      // Memory placement policy: default, interleave, firsttouch, bind:<node>
+      if (!scm::memory_manager_module::parsePlacement(argv[++i], program_options.placement, program_options.placementNode))
+        std::cout << "Unknown memory placement " << argv[i] << ". Using default" << std::endl;
+    } else if (strcmp(argv[i], "-hp") == 0) {
+      // Page mode: default, thp, hugetlb
+      if (!scm::memory_manager_module::parsePageMode(argv[++i], program_options.pageMode))
+        std::cout << "Unknown page mode " << argv[i] << ". Using thp" << std::endl;
+    } else if (strcmp(argv[i], "-trace") == 0) {
+      // Binary trace streamed during the run (convert it with tools/trace2chrome.py)
+      program_options.traceName = argv[++i];
+    } else if (strcmp(argv[i], "-tm") == 0) {
+      // Trace mode: full, sample:N[:A-B], window:A-B, time:T1-T2, aggregate
+      program_options.traceMode = argv[++i];
+    } else if (strcmp(argv[i], "-hw") == 0) {
+      // Hardware counters: event names separated by commas (the default is SCM_HW_EVENTS, or PAPI_EVENTS / PERF_EVENTS)
+      program_options.hwCounters = argv[++i];
+    } else if (strcmp(argv[i], "-metrics") == 0) {
+      // Live metrics written during the run: a file, or unix:<path> (watch them with tools/scm_top.py)
+      program_options.metricsOutput = argv[++i];
+    } else if (strcmp(argv[i], "-mi") == 0) {
+      // Milliseconds between two samples of the live metrics
+      program_options.metricsInterval = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-rout") == 0) {
+      // Roofline report also written as JSON to this file (implies -roofline)
+      program_options.rooflineOutput = argv[++i];
+    } else if (strcmp(argv[i], "-rpeak") == 0) {
+      // Peaks of one CU for the roofline report: GFLOPS,GBs. They are measured otherwise
+      program_options.rooflinePeaks = argv[++i];
+    } else if (strcmp(argv[i], "-record") == 0) {
+      // Log the scheduling decisions (CU of each dispatch, renamed registers) to this file
+      program_options.scheduleRecord = argv[++i];
+    } else if (strcmp(argv[i], "-replay") == 0) {
+      // Force the scheduling decisions logged with -record by a previous run
+      program_options.scheduleReplay = argv[++i];
+    } else if (strcmp(argv[i], "-serve") == 0) {
+      // Service mode: run the programs listed in this file (one per line, - for stdin) on the same machine
+      program_options.jobsName = argv[++i];
     }
   }
 }
@@ -1,10 +1,12 @@
 #include "codelet.hpp"
 #include "instructions.hpp"
 #include "executor.hpp"
+#include <cstddef>
 
 namespace scm {
 
-std::map<std::string, creatorFnc> *codeletFactory::registeredCodelets;
+std::map<std::string, uint32_t> *codeletFactory::registeredCodelets;
+std::vector<codelet_type_t> *codeletFactory::registeredTypes;
 static int codeletFactoryInit;
 
 l2_memory_t 
@@ -16,28 +18,82 @@ l2_memory_t
    return this->getExecutor()->get_mem_interface()->getAddress(addr);
 }
 
+int32_t
+  codeletFactory::getCodeletID(std::string const & name) {
+    if (registeredCodelets == nullptr)
+      return -1;
+    auto found = registeredCodelets->find(name);
+    return found == registeredCodelets->end() ? -1 : static_cast<int32_t>(found->second);
+}
+
 codelet* 
   codeletFactory::createCodelet(std::string name, codelet_params usedParams) {
-    codelet * result;
     // Look for the codelet in the map
-    auto found = registeredCodelets->find(name);
-    if ( found == registeredCodelets->end()) {
+    int32_t id = getCodeletID(name);
+    if (id == -1) {
       // If not found, we display error, and then return null.
       SCMULATE_ERROR(0, "Trying to create a codelet that has not been implemented");
       return nullptr;
-    } else {
-      // If found we call the creator function and then 
-      SCMULATE_INFOMSG(5, "Creating Codelet %s", name.c_str());
-      creatorFnc creator = found->second;
-      result = creator(usedParams); // It is a function pointer
-      return result;
     }
+    SCMULATE_INFOMSG(5, "Creating Codelet %s", name.c_str());
+    return createCodelet(static_cast<uint32_t>(id), usedParams);
+};
+
+codelet* 
+  codeletFactory::createCodelet(uint32_t id, codelet_params usedParams) {
+    codelet * result = (*registeredTypes)[id].creator(usedParams); // It is a function pointer
+    result->codelet_id = id;
+    return result;
 };
 
+void
+  codeletFactory::growPool(codelet_type_t & type) {
+    // The memory of the pools is never returned to the system
+    size_t slot = (type.size + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+    unsigned char * chunk = static_cast<unsigned char *>(::operator new(slot * CODELET_POOL_CHUNK));
+    for (uint32_t i = 0; i < CODELET_POOL_CHUNK; i++)
+      type.free_slots.push_back(chunk + i * slot);
+}
+
+codelet* 
+  codeletFactory::cloneCodelet(codelet const * prototype) {
+    codelet_type_t & type = (*registeredTypes)[prototype->codelet_id];
+    if (type.free_slots.empty())
+      growPool(type);
+    void * memory = type.free_slots.back();
+    type.free_slots.pop_back();
+    codelet * result = prototype->clone_into(memory);
+    result->pooled = true;
+    return result;
+}
+
+void
+  codeletFactory::destroyCodelet(codelet * cod) {
+    if (cod == nullptr)
+      return;
+    if (!cod->pooled) {
+      delete cod;
+      return;
+    }
+    uint32_t id = cod->codelet_id;
+    cod->~codelet();
+    (*registeredTypes)[id].free_slots.push_back(cod);
+}
+
 void 
-  codeletFactory::registerCreator(std::string name, creatorFnc creator ) {
-    if (codeletFactoryInit++ == 0) registeredCodelets = new std::map<std::string, creatorFnc>();
+  codeletFactory::registerCreator(std::string name, creatorFnc creator, size_t size) {
+    if (codeletFactoryInit++ == 0) {
+      registeredCodelets = new std::map<std::string, uint32_t>();
+      registeredTypes = new std::vector<codelet_type_t>();
+    }
     SCMULATE_INFOMSG(3, "Registering codelet %s", name.c_str());
-    (*registeredCodelets)[name] = creator;
+    auto found = registeredCodelets->find(name);
+    if (found != registeredCodelets->end()) {
+      (*registeredTypes)[found->second].creator = creator;
+      (*registeredTypes)[found->second].size = size;
+      return;
+    }
+    (*registeredCodelets)[name] = registeredTypes->size();
+    registeredTypes->push_back(codelet_type_t{name, creator, size, std::vector<void *>()});
   }
-}
\ No newline at end of file
+}
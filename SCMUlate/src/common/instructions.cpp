@@ -1,8 +1,6 @@
 #include "instructions.hpp"
 #include "instruction_mem.hpp"
 
-// TODO: update all the functions to use getOpStr and getOp instead of the static op num
-//       to allow expansion in the future with multiple number of operands
 namespace scm {
     bool 
     decoded_instruction_t::decodeOperands(inst_mem_module * const inst_memory) {
@@ -51,9 +49,9 @@ namespace scm {
           }
 
           cod_exec = scm::codeletFactory::createCodelet(this->getInstruction(), newArgs);
-          cod_exec->setMemoryRange(&this->memRanges);
           if (cod_exec == nullptr) 
             return false;
+          cod_exec->setMemoryRange(&this->memRanges);
           for (uint32_t op_num = 1; op_num <= MAX_NUM_OPERANDS; op_num++) {
             operand_t & op = getOp(op_num);
             op.read = OP_IO::getOpRDIO(op_num) & cod_exec->getOpIO();
@@ -179,19 +177,190 @@ namespace scm {
     decoded_instruction_t::updateCodeletParams() {
       // For codelets only
       if (type == EXECUTE_INST) {
-        // TODO: To change the number oof arguments, wee should change this number
         codelet_params& newArgs = cod_exec->getParams();
-        if (op1.type == operand_t::REGISTER) {
-          newArgs.getParamAs(1) = op1.value.reg.reg_ptr; 
+        for (int i = 0; i < MAX_NUM_OPERANDS; i++) {
+          if (ops[i].type == operand_t::REGISTER) {
+            newArgs.getParamAs(i+1) = ops[i].value.reg.reg_ptr; 
+          }
+        }
+      }
+    }
+
+    typedef std::unordered_map<std::string, std::pair<const inst_def_t *, instType>> instruction_table_t;
+
+    /** \brief Table from the name of the instruction to its definition and type
+     *
+     * Built from the instruction definitions the first time it is used. The initialization
+     * of the static is thread safe, so programs can be loaded by several threads
+     */
+    static const instruction_table_t &
+    instructionTable() {
+      static const instruction_table_t table = [] {
+        instruction_table_t newTable;
+        for (size_t i = 0; i < NUM_OF_INST(controlInsts); i++)
+          newTable[controlInsts[i].inst_name] = std::make_pair(&controlInsts[i], CONTROL_INST);
+        for (size_t i = 0; i < NUM_OF_INST(basicArithInsts); i++)
+          newTable[basicArithInsts[i].inst_name] = std::make_pair(&basicArithInsts[i], BASIC_ARITH_INST);
+        for (size_t i = 0; i < NUM_OF_INST(memInsts); i++)
+          newTable[memInsts[i].inst_name] = std::make_pair(&memInsts[i], MEMORY_INST);
+        return newTable;
+      }();
+      return table;
+    }
+
+    /** \brief Read the operands of an instruction up to the ';'
+     *
+     * tok is the first token after the instruction name. Returns the number of operands
+     * or -1 if the list is not valid
+     */
+    static int
+    parseOperandList(inst_lexer & lexer, inst_token_t tok, inst_token_t * ops, std::string & error) {
+      int numOps = 0;
+      if (tok.type == inst_token_t::SEMICOLON)
+        return 0;
+      while (true) {
+        if (tok.operandKind() == OP_KIND::NONE) {
+          error = tok.type == inst_token_t::END ? "missing ';'" : "invalid operand '" + tok.str() + "'";
+          return -1;
+        }
+        if (numOps == MAX_NUM_OPERANDS) {
+          error = "more than " + std::to_string(MAX_NUM_OPERANDS) + " operands";
+          return -1;
         }
-        
-        if (op2.type == operand_t::REGISTER) {
-          newArgs.getParamAs(2) = op2.value.reg.reg_ptr; 
+        ops[numOps++] = tok;
+        tok = lexer.next();
+        if (tok.type == inst_token_t::SEMICOLON)
+          return numOps;
+        if (tok.type != inst_token_t::COMMA) {
+          error = tok.type == inst_token_t::END ? "missing ';'" : "expected ',' or ';' before '" + tok.str() + "'";
+          return -1;
         }
+        tok = lexer.next();
+      }
+    }
+
+    instructions::line_kind
+    instructions::parseLine(std::string const & line, decoded_instruction_t ** decInst, std::string & label, std::string & error) {
+      inst_lexer lexer(line);
+      inst_token_t first = lexer.next();
+      *decInst = nullptr;
+      if (first.type == inst_token_t::END)
+        return EMPTY_LINE;
 
-        if (op3.type == operand_t::REGISTER) {
-          newArgs.getParamAs(3) = op3.value.reg.reg_ptr; 
+      inst_token_t second = lexer.next();
+      if (first.type != inst_token_t::WORD) {
+        error = "expected an instruction or a label";
+      } else if (second.type == inst_token_t::COLON && first.operandKind() != OP_KIND::NONE) {
+        // Everything after the label is ignored
+        label = first.str();
+        if (lexer.next().type != inst_token_t::END)
+          SCMULATE_WARNING(0, "Text after label '%s' is ignored", label.c_str());
+        return LABEL_LINE;
+      } else if (first.is("COMMIT") && second.type == inst_token_t::SEMICOLON) {
+        *decInst = new decoded_instruction_t(COMMIT, COMMIT_INST.opcode, "COMMIT;");
+        return INSTRUCTION_LINE;
+      } else {
+        inst_token_t ops[MAX_NUM_OPERANDS];
+        if (first.is("COD")) {
+          if (second.type != inst_token_t::WORD) {
+            error = "expected the name of the codelet";
+          } else {
+            int numOps = parseOperandList(lexer, lexer.next(), ops, error);
+            if (numOps != -1) {
+              *decInst = new decoded_instruction_t(EXECUTE_INST, CODELET_INST.opcode, second.str());
+              for (int i = 0; i < numOps; i++)
+                (*decInst)->getOpStr(i+1) = ops[i].str();
+              return INSTRUCTION_LINE;
+            }
+          }
+        } else {
+          auto found = instructionTable().find(first.str());
+          if (found == instructionTable().end()) {
+            error = "unknown instruction '" + first.str() + "'";
+          } else {
+            const inst_def_t * def = found->second.first;
+            int numOps = parseOperandList(lexer, second, ops, error);
+            if (numOps != -1 && numOps != def->num_op)
+              error = def->inst_name + " expects " + std::to_string(def->num_op) + " operands";
+            for (int i = 0; i < numOps && error.empty(); i++)
+              if ((ops[i].operandKind() & def->op_kinds[i]) == 0)
+                error = "operand " + std::to_string(i+1) + " of " + def->inst_name + " cannot be '" + ops[i].str() + "'";
+            if (error.empty()) {
+              *decInst = new decoded_instruction_t(found->second.second, def->opcode, def->inst_name);
+              for (int i = 0; i < numOps; i++)
+                (*decInst)->getOpStr(i+1) = ops[i].str();
+              (*decInst)->setOpIO(def->op_in_out);
+              return INSTRUCTION_LINE;
+            }
+          }
         }
       }
+      *decInst = new decoded_instruction_t(UNKNOWN, 0xFF);
+      return INVALID_LINE;
+    }
+
+    decoded_instruction_t *
+    instructions::findInstType(std::string const & instruction) {
+      decoded_instruction_t * dec = nullptr;
+      std::string label, error;
+      parseLine(instruction, &dec, label, error);
+      if (!dec) dec = new decoded_instruction_t(UNKNOWN, 0xFF);
+      return dec;
+    }
+
+    bool
+    instructions::isComment(std::string const & inst) {
+      inst_lexer lexer(inst);
+      return lexer.next().type == inst_token_t::END;
+    }
+
+    bool
+    instructions::isLabelInst(std::string const & inst) {
+      decoded_instruction_t * dec = nullptr;
+      std::string label, error;
+      line_kind kind = parseLine(inst, &dec, label, error);
+      delete dec;
+      return kind == LABEL_LINE;
+    }
+
+    std::string
+    instructions::getLabel(std::string const & inst) {
+      decoded_instruction_t * dec = nullptr;
+      std::string label, error;
+      parseLine(inst, &dec, label, error);
+      delete dec;
+      return label;
+    }
+
+    /** \brief kind of an operand that must be a single token */
+    static std::uint_fast8_t
+    singleOperandKind(std::string const & op) {
+      inst_lexer lexer(op);
+      inst_token_t tok = lexer.next();
+      if (lexer.next().type != inst_token_t::END)
+        return OP_KIND::NONE;
+      return tok.operandKind();
+    }
+
+    bool
+    instructions::isRegister(std::string const & op) {
+      return singleOperandKind(op) == OP_KIND::REG;
+    }
+
+    bool
+    instructions::isLabel(std::string const & op) {
+      return singleOperandKind(op) == OP_KIND::LBL;
+    }
+
+    decoded_reg_t
+    instructions::decodeRegister(std::string const & op) {
+      // R<size>_<number>
+      decoded_reg_t res(op, std::string(""), 0, 0, nullptr);
+      size_t pos = op.find('_');
+      if (op.size() > 2 && op[0] == 'R' && pos != std::string::npos && pos > 1 && pos + 1 < op.size()) {
+        res.reg_size = op.substr(1, pos - 1);
+        res.reg_number = std::strtoul(op.c_str() + pos + 1, nullptr, 10);
+      }
+      return res;
     }
 }
\ No newline at end of file
@@ -0,0 +1,441 @@
+#include "program_preprocessor.hpp"
+#include "SCMUlate_tools.hpp"
+#include <cstdlib>
+#include <functional>
+
+// Limits to stop programs that expand forever
+#define PREPROCESSOR_MAX_DEPTH 64
+#define PREPROCESSOR_MAX_LINES (1ul << 24)
+// Bodies without instructions (e.g. only .set) do not add lines, so the counts and the
+// expansions (repetitions and macro invocations) are limited too
+#define PREPROCESSOR_MAX_REPEAT (1l << 24)
+#define PREPROCESSOR_MAX_EXPANSIONS (1ul << 26)
+
+namespace scm {
+
+  static inline bool isNameStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+  }
+
+  static inline bool isNameChar(char c) {
+    return isNameStart(c) || (c >= '0' && c <= '9');
+  }
+
+  static inline std::string trim(std::string const & str) {
+    size_t begin = str.find_first_not_of(" \t\r");
+    if (begin == std::string::npos)
+      return std::string();
+    size_t end = str.find_last_not_of(" \t\r");
+    return str.substr(begin, end - begin + 1);
+  }
+
+  /** \brief the text before the comment */
+  static inline std::string code(std::string const & text) {
+    size_t comment = text.find("//");
+    return comment == std::string::npos ? text : text.substr(0, comment);
+  }
+
+  /** \brief the directive of the line (e.g. ".rept") and its arguments. Empty if it is not a directive */
+  static inline std::string directive(std::string const & text, std::string * args = nullptr) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos || text[first] != '.')
+      return std::string();
+    std::string line = trim(code(text));
+    size_t end = 1;
+    while (end < line.size() && isNameChar(line[end]))
+      end++;
+    if (args != nullptr)
+      *args = trim(line.substr(end));
+    return line.substr(0, end);
+  }
+
+  /** \brief split a list of comma separated arguments */
+  static inline std::vector<std::string> splitArgs(std::string const & args) {
+    std::vector<std::string> result;
+    if (trim(args).empty())
+      return result;
+    size_t begin = 0;
+    while (true) {
+      size_t comma = args.find(',', begin);
+      result.push_back(trim(args.substr(begin, comma == std::string::npos ? std::string::npos : comma - begin)));
+      if (comma == std::string::npos)
+        break;
+      begin = comma + 1;
+    }
+    return result;
+  }
+
+  static inline bool isName(std::string const & str) {
+    if (str.empty() || !isNameStart(str[0]))
+      return false;
+    for (auto c : str)
+      if (!isNameChar(c))
+        return false;
+    return true;
+  }
+
+  /** \brief integer expressions. Recursive descent over + - * / % and parentheses */
+  class expression_parser {
+    private:
+      std::string const & expr;
+      size_t pos;
+      std::function<bool(std::string const &, int64_t &)> lookup;
+
+      void skipSpaces() {
+        while (pos < expr.size() && (expr[pos] == ' ' || expr[pos] == '\t'))
+          pos++;
+      }
+
+      bool primary(int64_t & value) {
+        skipSpaces();
+        if (pos >= expr.size()) {
+          error = "unexpected end of expression";
+          return false;
+        }
+        char c = expr[pos];
+        if (c == '(') {
+          pos++;
+          if (!sum(value))
+            return false;
+          skipSpaces();
+          if (pos >= expr.size() || expr[pos] != ')') {
+            error = "missing ')'";
+            return false;
+          }
+          pos++;
+          return true;
+        }
+        if (c == '-' || c == '+') {
+          pos++;
+          if (!primary(value))
+            return false;
+          value = c == '-' ? -value : value;
+          return true;
+        }
+        if (c >= '0' && c <= '9') {
+          value = 0;
+          while (pos < expr.size() && expr[pos] >= '0' && expr[pos] <= '9')
+            value = value * 10 + (expr[pos++] - '0');
+          return true;
+        }
+        if (isNameStart(c)) {
+          size_t begin = pos;
+          while (pos < expr.size() && isNameChar(expr[pos]))
+            pos++;
+          std::string name = expr.substr(begin, pos - begin);
+          if (!lookup(name, value)) {
+            error = "'" + name + "' is not defined";
+            return false;
+          }
+          return true;
+        }
+        error = std::string("unexpected '") + c + "'";
+        return false;
+      }
+
+      bool product(int64_t & value) {
+        if (!primary(value))
+          return false;
+        while (true) {
+          skipSpaces();
+          if (pos >= expr.size() || (expr[pos] != '*' && expr[pos] != '/' && expr[pos] != '%'))
+            return true;
+          char op = expr[pos++];
+          int64_t rhs;
+          if (!primary(rhs))
+            return false;
+          if (op != '*' && rhs == 0) {
+            error = "division by zero";
+            return false;
+          }
+          value = op == '*' ? value * rhs : op == '/' ? value / rhs : value % rhs;
+        }
+      }
+
+      bool sum(int64_t & value) {
+        if (!product(value))
+          return false;
+        while (true) {
+          skipSpaces();
+          if (pos >= expr.size() || (expr[pos] != '+' && expr[pos] != '-'))
+            return true;
+          char op = expr[pos++];
+          int64_t rhs;
+          if (!product(rhs))
+            return false;
+          value = op == '+' ? value + rhs : value - rhs;
+        }
+      }
+
+    public:
+      std::string error;
+
+      expression_parser(std::string const & expression, std::function<bool(std::string const &, int64_t &)> lookupFnc) :
+        expr(expression), pos(0), lookup(lookupFnc) { }
+
+      bool parse(int64_t & value) {
+        if (!sum(value))
+          return false;
+        skipSpaces();
+        if (pos != expr.size()) {
+          error = "unexpected '" + expr.substr(pos) + "'";
+          return false;
+        }
+        return true;
+      }
+  };
+
+  std::map<std::string, int64_t> &
+  program_preprocessor::predefined() {
+    static std::map<std::string, int64_t> symbols;
+    return symbols;
+  }
+
+  void
+  program_preprocessor::predefine(std::string const & name, int64_t value) {
+    predefined()[name] = value;
+  }
+
+  bool
+  program_preprocessor::predefine(std::string const & definition) {
+    size_t equal = definition.find('=');
+    if (equal == std::string::npos || !isName(definition.substr(0, equal)))
+      return false;
+    char * end;
+    std::string value = definition.substr(equal + 1);
+    int64_t number = std::strtoll(value.c_str(), &end, 0);
+    if (value.empty() || *end != '\0')
+      return false;
+    predefine(definition.substr(0, equal), number);
+    return true;
+  }
+
+  program_preprocessor::program_preprocessor() : expansions(0) { }
+
+  bool
+  program_preprocessor::setError(uint32_t line, std::string const & msg) {
+    if (error.empty())
+      error = std::to_string(line) + ": " + msg;
+    return false;
+  }
+
+  bool
+  program_preprocessor::evaluate(std::string const & expr, scope_t const & scope, uint32_t line, int64_t & value) {
+    expression_parser parser(expr, [&] (std::string const & name, int64_t & result) {
+      auto arg = scope.find(name);
+      if (arg != scope.end()) {
+        char * end;
+        result = std::strtoll(arg->second.c_str(), &end, 0);
+        return !arg->second.empty() && *end == '\0';
+      }
+      auto symbol = symbols.find(name);
+      if (symbol == symbols.end())
+        return false;
+      result = symbol->second;
+      return true;
+    });
+    if (!parser.parse(value))
+      return setError(line, "invalid expression '" + expr + "': " + parser.error);
+    return true;
+  }
+
+  bool
+  program_preprocessor::substitute(std::string const & text, scope_t const & scope, uint64_t expansion, uint32_t line, std::string & result) {
+    result.clear();
+    size_t comment = text.find("//");
+    size_t end = comment == std::string::npos ? text.size() : comment;
+    size_t pos = 0;
+    while (pos < end) {
+      size_t slash = text.find('\\', pos);
+      if (slash == std::string::npos || slash >= end) {
+        result.append(text, pos, end - pos);
+        break;
+      }
+      result.append(text, pos, slash - pos);
+      pos = slash + 1;
+      if (pos < end && text[pos] == '@') {
+        result += std::to_string(expansion);
+        pos++;
+      } else if (pos < end && text[pos] == '{') {
+        size_t close = text.find('}', pos);
+        if (close == std::string::npos || close >= end)
+          return setError(line, "missing '}'");
+        int64_t value;
+        if (!evaluate(text.substr(pos + 1, close - pos - 1), scope, line, value))
+          return false;
+        result += std::to_string(value);
+        pos = close + 1;
+      } else if (pos < end && isNameStart(text[pos])) {
+        size_t begin = pos;
+        while (pos < end && isNameChar(text[pos]))
+          pos++;
+        std::string name = text.substr(begin, pos - begin);
+        auto arg = scope.find(name);
+        auto symbol = symbols.find(name);
+        if (arg != scope.end())
+          result += arg->second;
+        else if (symbol != symbols.end())
+          result += std::to_string(symbol->second);
+        else
+          return setError(line, "'\\" + name + "' is not defined");
+      } else {
+        return setError(line, "invalid use of '\\'");
+      }
+    }
+    if (end != text.size())
+      result.append(text, end, std::string::npos);
+    return true;
+  }
+
+  bool
+  program_preprocessor::findEnd(std::vector<source_line_t> const & lines, size_t begin, size_t end, size_t & found) {
+    std::string open = directive(lines[begin].text);
+    bool macro = open == ".macro";
+    int depth = 0;
+    for (size_t i = begin; i < end; i++) {
+      std::string dir = directive(lines[i].text);
+      if (macro ? dir == ".macro" : (dir == ".rept" || dir == ".unroll"))
+        depth++;
+      else if (dir == (macro ? ".endm" : ".endr") && --depth == 0) {
+        found = i;
+        return true;
+      }
+    }
+    return setError(lines[begin].line, open + " without " + (macro ? ".endm" : ".endr"));
+  }
+
+  bool
+  program_preprocessor::process(std::vector<source_line_t> const & lines, size_t begin, size_t end, scope_t const & scope, uint64_t expansion, uint32_t depth, std::vector<source_line_t> & out) {
+    if (depth > PREPROCESSOR_MAX_DEPTH)
+      return setError(lines[begin].line, "too many nested expansions");
+    if (expansions > PREPROCESSOR_MAX_EXPANSIONS)
+      return setError(lines[begin].line, "too many expansions");
+    for (size_t i = begin; i < end; i++) {
+      uint32_t line = lines[i].line;
+      std::string args;
+      std::string dir = directive(lines[i].text, &args);
+
+      if (dir.empty()) {
+        std::string text;
+        if (!substitute(lines[i].text, scope, expansion, line, text))
+          return false;
+        // Macro invocation
+        std::string first = macros.empty() ? std::string() : trim(code(text));
+        size_t nameEnd = 0;
+        while (nameEnd < first.size() && isNameChar(first[nameEnd]))
+          nameEnd++;
+        auto macro = macros.find(first.substr(0, nameEnd));
+        if (nameEnd == 0 || macro == macros.end()) {
+          if (out.size() >= PREPROCESSOR_MAX_LINES)
+            return setError(line, "the program is too large");
+          out.push_back({text, line});
+          continue;
+        }
+        std::string argList = first.substr(nameEnd);
+        if (!argList.empty() && argList.back() == ';')
+          argList.pop_back();
+        std::vector<std::string> values = splitArgs(argList);
+        if (values.size() != macro->second.params.size())
+          return setError(line, "macro " + macro->first + " expects " + std::to_string(macro->second.params.size()) + " arguments");
+        scope_t macroScope(scope);
+        for (size_t p = 0; p < values.size(); p++)
+          macroScope[macro->second.params[p]] = values[p];
+        // Copy the body, the macro could be redefined while it is expanded
+        std::vector<source_line_t> body(macro->second.body);
+        if (!process(body, 0, body.size(), macroScope, ++expansions, depth + 1, out))
+          return false;
+
+      } else if (dir == ".set") {
+        std::string symArgs;
+        if (!substitute(args, scope, expansion, line, symArgs))
+          return false;
+        size_t nameEnd = 0;
+        while (nameEnd < symArgs.size() && isNameChar(symArgs[nameEnd]))
+          nameEnd++;
+        std::string name = symArgs.substr(0, nameEnd);
+        std::string expr = trim(symArgs.substr(nameEnd));
+        if (!expr.empty() && expr[0] == ',')
+          expr = trim(expr.substr(1));
+        if (!isName(name) || expr.empty())
+          return setError(line, ".set expects a name and a value");
+        int64_t value;
+        if (!evaluate(expr, scope, line, value))
+          return false;
+        if (predefined().count(name) != 0) {
+          SCMULATE_INFOMSG(3, "Line %u: .set %s ignored. It is defined in the command line", line, name.c_str());
+        } else {
+          symbols[name] = value;
+        }
+
+      } else if (dir == ".rept" || dir == ".unroll") {
+        size_t last;
+        if (!findEnd(lines, i, end, last))
+          return false;
+        std::string var;
+        std::string countExpr = args;
+        if (dir == ".unroll") {
+          size_t comma = args.find(',');
+          var = trim(args.substr(0, comma));
+          countExpr = comma == std::string::npos ? std::string() : args.substr(comma + 1);
+          if (!isName(var))
+            return setError(line, ".unroll expects a variable name and a count");
+        }
+        std::string count;
+        int64_t times;
+        if (!substitute(countExpr, scope, expansion, line, count) || !evaluate(count, scope, line, times))
+          return false;
+        if (times < 0)
+          return setError(line, dir + " count cannot be negative");
+        if (times > PREPROCESSOR_MAX_REPEAT)
+          return setError(line, dir + " count is larger than " + std::to_string(PREPROCESSOR_MAX_REPEAT));
+        scope_t loopScope(scope);
+        for (int64_t copy = 0; copy < times; copy++) {
+          if (!var.empty())
+            loopScope[var] = std::to_string(copy);
+          if (!process(lines, i + 1, last, loopScope, ++expansions, depth + 1, out))
+            return false;
+        }
+        i = last;
+
+      } else if (dir == ".macro") {
+        size_t last;
+        if (!findEnd(lines, i, end, last))
+          return false;
+        size_t nameEnd = 0;
+        while (nameEnd < args.size() && isNameChar(args[nameEnd]))
+          nameEnd++;
+        std::string name = args.substr(0, nameEnd);
+        if (!isName(name))
+          return setError(line, ".macro expects a name");
+        macro_t & macro = macros[name];
+        macro.params = splitArgs(args.substr(nameEnd));
+        for (auto it = macro.params.begin(); it != macro.params.end(); ++it)
+          if (!isName(*it))
+            return setError(line, "invalid parameter '" + *it + "' of macro " + name);
+        macro.body.assign(lines.begin() + i + 1, lines.begin() + last);
+        i = last;
+
+      } else if (dir == ".endr" || dir == ".endm") {
+        return setError(line, dir + " without a matching directive");
+      } else {
+        return setError(line, "unknown directive " + dir);
+      }
+    }
+    return true;
+  }
+
+  bool
+  program_preprocessor::expand(std::istream & input, std::vector<source_line_t> & out) {
+    std::vector<source_line_t> source;
+    macros.clear();
+    symbols = predefined();
+    expansions = 0;
+    error.clear();
+
+    std::string text;
+    uint32_t line = 0;
+    while (std::getline(input, text))
+      source.push_back({text, ++line});
+    return process(source, 0, source.size(), scope_t(), 0, 0, out);
+  }
+}
@@ -1,17 +1,27 @@
 #include "scm_machine.hpp"
 #include <iostream>
 
-scm::scm_machine::scm_machine(char * in_filename, l2_memory_t const memory, ILP_MODES ilp_mode):
+scm::scm_machine::scm_machine(char * in_filename, memory_manager_module * const mem_manager, ILP_MODES ilp_mode, const char * reg_config):
   alive(false), 
   init_correct(true), 
   filename(in_filename),
-  reg_file_m(),
-  inst_mem_m(filename, &reg_file_m), 
+  mem_manager_m(mem_manager),
+  reg_file_m(mem_manager, reg_config),
+  inst_mem_m(new inst_mem_module(in_filename, &reg_file_m)), 
   control_store_m(NUM_CUS),
-  fetch_decode_m(&inst_mem_m, &control_store_m, &alive, ilp_mode) {
+  fetch_decode_m(inst_mem_m.get(), &control_store_m, &alive, ilp_mode, mem_manager->getL2Memory()),
+  metrics_m(NUM_CUS),
+  roofline_m(NUM_CUS),
+  sched_log_m(NUM_CUS, ilp_mode) {
     SCMULATE_INFOMSG(0, "Initializing SCM machine")
     // Configuration parameters
   
+    if (!mem_manager_m->isValid()) {
+      SCMULATE_ERROR(0, "The memory manager does not have a valid L2 memory");
+      init_correct = false;
+      return;
+    }
+
     // We check the register configuration is valid
     if(!reg_file_m.checkRegisterConfig()) {
       SCMULATE_ERROR(0, "Error when checking the register");
@@ -19,7 +29,7 @@ scm::scm_machine::scm_machine(char * in_filename, l2_memory_t const memory, ILP_
       return;
     }
     
-    if(!inst_mem_m.isValid()) {
+    if(!inst_mem_m->isValid()) {
       SCMULATE_ERROR(0, "Error when loading file");
       init_correct = false;
       return;
@@ -35,7 +45,7 @@ scm::scm_machine::scm_machine(char * in_filename, l2_memory_t const memory, ILP_
     int * cur_exec = exec_units_threads;
     for (int i = 0; i < NUM_CUS; i++, cur_exec++) {
       SCMULATE_INFOMSG(4, "Creating executor (CUMEM) %d out of %d for thread %d", i, NUM_CUS, *cur_exec);
-      cu_executor_module* newExec = new cu_executor_module(*cur_exec, &control_store_m, i, &alive, memory);
+      cu_executor_module* newExec = new cu_executor_module(*cur_exec, &control_store_m, i, &alive, mem_manager_m->getL2Memory());
       TIMERS_COUNTERS_GUARD(
         newExec->setTimerCnt(&this->time_cnt_m);
       )
@@ -46,6 +56,155 @@ scm::scm_machine::scm_machine(char * in_filename, l2_memory_t const memory, ILP_
     ITT_RESUME;
 }
 
+bool
+scm::scm_machine::setMetricsOutput(std::string output, uint32_t interval) {
+  if (!this->metrics_m.setOutput(output, interval))
+    return false;
+  this->fetch_decode_m.setLiveMetrics(&this->metrics_m);
+  for (auto it = executors_m.begin(); it < executors_m.end(); ++it)
+    (*it)->setLiveMetrics(&this->metrics_m);
+  return true;
+}
+
+void
+scm::scm_machine::setRoofline(std::string jsonOutput) {
+  this->roofline_m.enable(jsonOutput);
+  for (auto it = executors_m.begin(); it < executors_m.end(); ++it)
+    (*it)->setRoofline(&this->roofline_m);
+}
+
+bool
+scm::scm_machine::setScheduleRecord(std::string file) {
+  if (!this->sched_log_m.setRecord(file))
+    return false;
+  this->fetch_decode_m.setScheduleLog(&this->sched_log_m);
+  return true;
+}
+
+bool
+scm::scm_machine::setScheduleReplay(std::string file) {
+  if (!this->sched_log_m.setReplay(file))
+    return false;
+  this->fetch_decode_m.setScheduleLog(&this->sched_log_m);
+  return true;
+}
+
+void
+scm::scm_machine::threadBehavior() {
+  switch (omp_get_thread_num()) {
+    case SU_THREAD:
+      fetch_decode_m.behavior();
+      break;
+    case CU_THREADS:
+      // Find my executor
+      for (auto it = executors_m.begin(); it < executors_m.end(); ++it) {
+        if ((*it)->get_executor_id() == omp_get_thread_num()) {
+          (*it)->behavior();
+          break; // exit for loop
+        }
+      }
+      break;
+    default:
+      {
+        // Initialization barrier
+        #pragma omp barrier 
+        SCMULATE_WARNING(0, "Thread created with no purpose. What's my purpose? You pass the butter");
+      }
+  }
+}
+
+bool
+scm::scm_machine::loadProgram(char * in_filename) {
+  if (!this->init_correct) return false;
+  inst_mem_module * new_inst_mem = new inst_mem_module(in_filename, &reg_file_m);
+  if (!new_inst_mem->isValid()) {
+    SCMULATE_ERROR(0, "Error when loading file %s", in_filename);
+    delete new_inst_mem;
+    return false;
+  }
+  if (!this->fetch_decode_m.loadProgram(new_inst_mem)) {
+    // The CUs may still have instructions of the previous program. The machine cannot be reused
+    delete new_inst_mem;
+    this->init_correct = false;
+    return false;
+  }
+  this->inst_mem_m.reset(new_inst_mem);
+  this->filename = in_filename;
+  return true;
+}
+
+void
+scm::scm_machine::resetRegisters() {
+  this->reg_file_m.clear();
+  this->fetch_decode_m.clearRegisters();
+}
+
+scm::run_status
+scm::scm_machine::serve(std::istream & jobs, bool reset) {
+  if (!this->init_correct) return SCM_RUN_FAILURE;
+  TIMERS_COUNTERS_GUARD(
+    this->time_cnt_m.resetTimer();
+    this->time_cnt_m.addEvent("SCM_MACHINE",SYS_START);
+  );
+  bool next_job = true;
+  uint64_t served = 0, failed = 0;
+  std::string job;
+  std::chrono::time_point<std::chrono::high_resolution_clock> service_timer = std::chrono::high_resolution_clock::now();
+  std::chrono::time_point<std::chrono::high_resolution_clock> job_timer;
+  this->metrics_m.start();
+#pragma omp parallel shared(alive, next_job) num_threads(NUM_CUS+1)
+  {
+    #pragma omp master 
+    {
+      SCMULATE_INFOMSG(1, "Serving with %d threads ", omp_get_num_threads());
+    }
+    while (true) {
+      if (omp_get_thread_num() == SU_THREAD) {
+        // The loaded program is the first job. The next ones come from the queue
+        while (served != 0 && this->init_correct && std::getline(jobs, job)) {
+          if (job.empty() || job[0] == '#')
+            continue;
+          if (this->loadProgram(&job[0])) {
+            // A job that cannot be loaded does not change the state of the machine
+            if (reset)
+              this->resetRegisters();
+            break;
+          }
+          if (this->init_correct)
+            std::cout << "Job " << served + failed << " " << job << ": could not be loaded" << std::endl;
+          else
+            std::cout << "Job " << served + failed << " " << job << ": the previous program did not finish. Stopping the service" << std::endl;
+          failed++;
+        }
+        next_job = this->init_correct && (served == 0 || jobs);
+        this->alive = next_job;
+        job_timer = std::chrono::high_resolution_clock::now();
+      }
+      // The CUs are parked here while the SU waits for the next job
+      #pragma omp barrier 
+      if (!next_job)
+        break;
+      threadBehavior();
+      #pragma omp barrier 
+      if (omp_get_thread_num() == SU_THREAD) {
+        std::chrono::duration<double> diff = std::chrono::high_resolution_clock::now() - job_timer;
+        std::cout << "Job " << served + failed << " " << this->filename << ": Exec Time = " << diff.count() << std::endl;
+        served++;
+      }
+    }
+  }
+  this->metrics_m.stop();
+  this->sched_log_m.finish();
+  std::chrono::duration<double> diff = std::chrono::high_resolution_clock::now() - service_timer;
+  std::cout << "Served " << served << " jobs (" << failed << " failed to load). Exec Time = " << diff.count() << std::endl;
+  TIMERS_COUNTERS_GUARD(
+    this->time_cnt_m.addEvent("SCM_MACHINE",SYS_END);
+  );
+  // A program that did not finish leaves the machine in an unusable state
+  if (!this->init_correct) return SCM_RUN_FAILURE;
+  return SCM_RUN_SUCCESS;
+}
+
 scm::run_status
 scm::scm_machine::run() {
   if (!this->init_correct) return SCM_RUN_FAILURE;
@@ -55,6 +214,7 @@ scm::scm_machine::run() {
   );
   this->alive = true;
   int run_result = 0;
+  this->metrics_m.start();
   std::chrono::time_point<std::chrono::high_resolution_clock> timer = std::chrono::high_resolution_clock::now();
 #pragma omp parallel reduction(+: run_result) shared(alive) num_threads(NUM_CUS+1)
   {
@@ -62,29 +222,12 @@ scm::scm_machine::run() {
     {
       SCMULATE_INFOMSG(1, "Running with %d threads ", omp_get_num_threads());
     }
-    switch (omp_get_thread_num()) {
-      case SU_THREAD:
-        fetch_decode_m.behavior();
-        break;
-      case CU_THREADS:
-        // Find my executor
-        for (auto it = executors_m.begin(); it < executors_m.end(); ++it) {
-          if ((*it)->get_executor_id() == omp_get_thread_num()) {
-            (*it)->behavior();
-            break; // exit for loop
-          }
-        }
-        break;
-      default:
-        {
-          // Initialization barrier
-          #pragma omp barrier 
-          SCMULATE_WARNING(0, "Thread created with no purpose. What's my purpose? You pass the butter");
-        }
-    }
+    threadBehavior();
     #pragma omp barrier 
 
   }
+  this->metrics_m.stop();
+  this->sched_log_m.finish();
   std::chrono::time_point<std::chrono::high_resolution_clock> timer2 = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> diff = timer2 - timer;
   std::cout << "Exec Time = " << diff.count() << std::endl;
@@ -101,6 +244,8 @@ scm::scm_machine::~scm_machine() {
   ITT_PAUSE;
   for (auto it = executors_m.begin(); it < executors_m.end(); ++it) 
     delete (*it);
+  this->roofline_m.report();
+  this->sched_log_m.report();
   TIMERS_COUNTERS_GUARD(
     this->time_cnt_m.dumpTimers();
   );
@@ -0,0 +1,74 @@
+#include "basic_blocks.hpp"
+
+int64_t
+scm::program_blocks::controlTarget(decoded_instruction_t * inst, uint32_t pc) {
+  if (inst->getType() != CONTROL_INST)
+    return -1;
+  // JMPLBL and JMPPC have the destination in the first operand, the branches in the third one
+  operand_t & dest = (inst->getOpcode() == JMPLBL_INST.opcode || inst->getOpcode() == JMPPC_INST.opcode) ? inst->getOp1() : inst->getOp3();
+  if (dest.type == operand_t::LABEL)
+    return static_cast<int64_t>(static_cast<int>(dest.value.immediate));
+  if (dest.type == operand_t::IMMEDIATE_VAL)
+    return static_cast<int64_t>(pc) + static_cast<int>(dest.value.immediate);
+  return -1;
+}
+
+void
+scm::program_blocks::findBlocks(std::vector<decoded_instruction_t *> & program) {
+  uint32_t numInsts = program.size();
+  std::vector<bool> leader(numInsts + 1, false);
+  leader[0] = true;
+  for (uint32_t pc = 0; pc < numInsts; pc++) {
+    instType type = program[pc]->getType();
+    if (type == CONTROL_INST || type == COMMIT) {
+      leader[pc + 1] = true;
+      int64_t target = controlTarget(program[pc], pc);
+      if (target >= 0 && target < numInsts)
+        leader[target] = true;
+    }
+  }
+
+  block_of_pc.resize(numInsts);
+  for (uint32_t pc = 0; pc < numInsts; pc++) {
+    if (leader[pc]) {
+      blocks.push_back(basic_block_t());
+      blocks.back().first_pc = pc;
+    }
+    blocks.back().last_pc = pc;
+    block_of_pc[pc] = blocks.size() - 1;
+  }
+
+  // Edges of the control flow graph
+  for (uint32_t num = 0; num < blocks.size(); num++) {
+    basic_block_t & block = blocks[num];
+    decoded_instruction_t * last = program[block.last_pc];
+    bool fallthrough = last->getType() != COMMIT && last->getType() != UNKNOWN &&
+                       last->getOpcode() != JMPLBL_INST.opcode && last->getOpcode() != JMPPC_INST.opcode;
+    if (fallthrough && block.last_pc + 1 < numInsts)
+      block.successors.push_back(num + 1);
+    int64_t target = controlTarget(last, block.last_pc);
+    if (target >= 0 && target < numInsts && (!fallthrough || block_of_pc[target] != num + 1))
+      block.successors.push_back(block_of_pc[target]);
+  }
+}
+
+void
+scm::program_blocks::analyze(std::vector<decoded_instruction_t *> & program) {
+  blocks.clear();
+  block_of_pc.clear();
+  if (program.empty())
+    return;
+  findBlocks(program);
+  SCMULATE_INFOMSG(3, "Program has %lu instructions in %lu basic blocks", program.size(), blocks.size());
+}
+
+void
+scm::program_blocks::dump() {
+  for (uint32_t num = 0; num < blocks.size(); num++) {
+    basic_block_t & block = blocks[num];
+    std::cout << "BB" << num << " [" << block.first_pc << ", " << block.last_pc << "] successors =";
+    for (auto it = block.successors.begin(); it != block.successors.end(); ++it)
+      std::cout << " BB" << *it;
+    std::cout << std::endl;
+  }
+}
@@ -0,0 +1,159 @@
+#include "dispatch_policy.hpp"
+#include <algorithm>
+
+int
+scm::round_robin_policy::dispatch(instruction_state_pair * inst) {
+  uint32_t numCUs = this->ctrl_st_m->numExecutors();
+  uint32_t attempts = 0;
+  // We try scheduling on all the sched units
+  while (attempts++ < numCUs) {
+    if (this->ctrl_st_m->get_executor(curSched)->try_insert(inst))
+      return curSched;
+    curSched++;
+    curSched %= numCUs;
+  }
+  return -1;
+}
+
+int
+scm::least_loaded_policy::dispatch(instruction_state_pair * inst) {
+  for (uint32_t i = 0; i < cu_order.size(); i++)
+    cu_order[i] = i;
+  std::sort(cu_order.begin(), cu_order.end(), [this] (uint32_t a, uint32_t b) {
+    return in_flight[a] < in_flight[b] || (in_flight[a] == in_flight[b] && assigned[a] < assigned[b]);
+  });
+  int cu = tryInOrder(inst);
+  if (cu != -1) {
+    in_flight[cu]++;
+    assigned[cu]++;
+  }
+  return cu;
+}
+
+bool
+scm::least_loaded_policy::dispatchTo(instruction_state_pair * inst, uint32_t cu) {
+  if (!dispatch_policy::dispatchTo(inst, cu))
+    return false;
+  in_flight[cu]++;
+  assigned[cu]++;
+  return true;
+}
+
+int
+scm::register_affinity_policy::dispatch(instruction_state_pair * inst) {
+  uint32_t numCUs = this->ctrl_st_m->numExecutors();
+  std::fill(score.begin(), score.end(), 0);
+  decoded_instruction_t * decInst = inst->first;
+  for (uint32_t op_num = 1; op_num <= MAX_NUM_OPERANDS; op_num++) {
+    operand_t & op = decInst->getOp(op_num);
+    if (op.type != operand_t::REGISTER || !op.read)
+      continue;
+    auto owner = last_writer->find(op.value.reg.reg_ptr);
+    if (owner != last_writer->end())
+      score[owner->second] += op.value.reg.reg_size_bytes;
+  }
+  // Round robin order, stable sorted by score. Without inputs this is round robin
+  for (uint32_t i = 0; i < numCUs; i++)
+    cu_order[i] = (curSched + i) % numCUs;
+  std::stable_sort(cu_order.begin(), cu_order.end(), [this] (uint32_t a, uint32_t b) {
+    return score[a] > score[b];
+  });
+  int cu = tryInOrder(inst);
+  if (cu != -1)
+    curSched = (cu + 1) % numCUs;
+  return cu;
+}
+
+scm::dispatch_controller::dispatch_controller(control_store_module * const control_store_m, DISPATCH_POLICIES policy_type) :
+  ctrl_st_m(control_store_m),
+  policy(nullptr),
+  sched_log(nullptr),
+  dispatched(0),
+  migrations(0),
+  migrated_bytes(0) {
+  setPolicy(policy_type);
+}
+
+void
+scm::dispatch_controller::setPolicy(DISPATCH_POLICIES policy_type) {
+  delete policy;
+  switch (policy_type) {
+    case LEAST_LOADED:
+      policy = new least_loaded_policy(ctrl_st_m, &last_writer);
+      break;
+    case REG_AFFINITY:
+      policy = new register_affinity_policy(ctrl_st_m, &last_writer);
+      break;
+    case ROUND_ROBIN:
+    default:
+      policy = new round_robin_policy(ctrl_st_m, &last_writer);
+      break;
+  }
+  SCMULATE_INFOMSG(3, "Using dispatch policy %s", policy->getName());
+}
+
+bool
+scm::dispatch_controller::attemptDispatch(instruction_state_pair * inst) {
+  int cu;
+  if (sched_log != nullptr && sched_log->isReplaying()) {
+    // Only the next instruction of the schedule is dispatched, and only to its CU
+    cu = sched_log->replayDispatch(inst->first->getFetchSeq(), inst->first->getPC());
+    if (cu != -1 && !policy->dispatchTo(inst, cu))
+      return false;
+    if (cu != -1)
+      sched_log->dispatched();
+    else if (!sched_log->isReplaying())
+      cu = policy->dispatch(inst);
+  } else {
+    cu = policy->dispatch(inst);
+  }
+  if (cu == -1) {
+    SCMULATE_INFOMSG(5, "Could not find a free unit");
+    return false;
+  }
+  SCMULATE_INFOMSG(5, "Scheduling to CUMEM %d", cu);
+  if (sched_log != nullptr && sched_log->isRecording())
+    sched_log->recordDispatch(inst->first->getFetchSeq(), inst->first->getPC(), cu);
+  dispatched++;
+  executing_cu[inst] = cu;
+
+  // Register bookkeeping. Reads of registers written by other CUs are migrations
+  decoded_instruction_t * decInst = inst->first;
+  for (uint32_t op_num = 1; op_num <= MAX_NUM_OPERANDS; op_num++) {
+    operand_t & op = decInst->getOp(op_num);
+    if (op.type != operand_t::REGISTER)
+      continue;
+    if (op.read) {
+      auto owner = last_writer.find(op.value.reg.reg_ptr);
+      if (owner != last_writer.end() && owner->second != static_cast<uint32_t>(cu)) {
+        migrations++;
+        migrated_bytes += op.value.reg.reg_size_bytes;
+      }
+    }
+    if (op.write)
+      last_writer[op.value.reg.reg_ptr] = cu;
+  }
+  return true;
+}
+
+void
+scm::dispatch_controller::instructionFinished(instruction_state_pair * inst) {
+  auto it = executing_cu.find(inst);
+  if (it == executing_cu.end())
+    return;
+  policy->instructionFinished(it->second);
+  executing_cu.erase(it);
+}
+
+bool
+scm::dispatch_controller::parsePolicy(std::string name, DISPATCH_POLICIES & policy_type) {
+  if (name == "rr")
+    policy_type = ROUND_ROBIN;
+  else if (name == "ll")
+    policy_type = LEAST_LOADED;
+  else if (name == "affinity")
+    policy_type = REG_AFFINITY;
+  else
+    return false;
+  return true;
+}
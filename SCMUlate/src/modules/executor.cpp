@@ -2,7 +2,10 @@
 
 scm::cu_executor_module::cu_executor_module(int CU_ID, control_store_module * const control_store_m, unsigned int execSlotNumber, bool * aliveSig, l2_memory_t upperMem):
   cu_executor_id(CU_ID),
-  aliveSignal(aliveSig) {
+  aliveSignal(aliveSig),
+  cu_slot(execSlotNumber),
+  metrics_m(nullptr),
+  roofline_m(nullptr) {
     this->myExecutor = control_store_m->get_executor(execSlotNumber);
     this->mem_interface_t = new mem_interface_module(upperMem, this);
 }
@@ -10,10 +13,10 @@ scm::cu_executor_module::cu_executor_module(int CU_ID, control_store_module * co
 int
 scm::cu_executor_module::behavior() {
   TIMERS_COUNTERS_GUARD(
-    #ifdef PAPI_COUNT
-    this->timer_cnt_m->initPAPIcounter(this->cu_timer_name);
+    #ifdef HW_COUNTERS
+    this->timer_cnt_m->initHWCounters(this->cu_timer_id);
     #endif
-    this->timer_cnt_m->addEvent(this->cu_timer_name, CUMEM_START);
+    this->timer_cnt_m->addEvent(this->cu_timer_id, CUMEM_START);
   );
   SCMULATE_INFOMSG(1, "Starting CUMEM %d behavior", cu_executor_id);
   // Initialization barrier
@@ -24,21 +27,24 @@ scm::cu_executor_module::behavior() {
       SCMULATE_ERROR_IF(0,myExecutor->getHead() == nullptr,"Executor head is NULL even though it was marked as not empty!");
       SCMULATE_INFOMSG(5, "  CUMEM[%d]: Executing instruction %s", cu_executor_id, myExecutor->getHead()->first->getFullInstruction().data());
       scm::decoded_instruction_t * curInstruction = myExecutor->getHead()->first;
+      if (this->metrics_m != nullptr)
+        this->metrics_m->cuBegin(this->cu_slot);
+      uint64_t start = this->roofline_m != nullptr ? roofline_module::now() : 0;
       if (curInstruction->getType() == scm::instType::MEMORY_INST || curInstruction->getExecCodelet()->isMemoryCodelet()) {
         TIMERS_COUNTERS_GUARD(
-          #ifdef PAPI_COUNT
-          this->timer_cnt_m->startPAPIcounters(this->cu_timer_name);
+          #ifdef HW_COUNTERS
+          this->timer_cnt_m->startHWCounters(this->cu_timer_id);
           #endif
-          this->timer_cnt_m->addEvent(this->cu_timer_name, CUMEM_EXECUTION_MEM, curInstruction->getFullInstruction());
+          this->timer_cnt_m->addEvent(this->cu_timer_id, CUMEM_EXECUTION_MEM, this->timer_cnt_m->instructionID(curInstruction->getPC()), curInstruction->isTraced());
         );
         this->mem_interface_t->assignInstSlot(curInstruction);
         this->mem_interface_t->behavior();
       } else if (curInstruction->getType() == scm::instType::EXECUTE_INST) {
         TIMERS_COUNTERS_GUARD(
-          #ifdef PAPI_COUNT
-          this->timer_cnt_m->startPAPIcounters(this->cu_timer_name);
+          #ifdef HW_COUNTERS
+          this->timer_cnt_m->startHWCounters(this->cu_timer_id);
           #endif
-          this->timer_cnt_m->addEvent(this->cu_timer_name, CUMEM_EXECUTION_COD, curInstruction->getFullInstruction());
+          this->timer_cnt_m->addEvent(this->cu_timer_id, CUMEM_EXECUTION_COD, this->timer_cnt_m->instructionID(curInstruction->getPC()), curInstruction->isTraced());
         );
         codeletExecutor();
       } else {
@@ -46,19 +52,22 @@ scm::cu_executor_module::behavior() {
       }
       
       TIMERS_COUNTERS_GUARD(
-        #ifdef PAPI_COUNT
-          timer_event& anEvent = this->timer_cnt_m->addEvent(this->cu_timer_name, CUMEM_IDLE);
-          this->timer_cnt_m->stopAndRegisterPAPIcounters(this->cu_timer_name, anEvent);
+        #ifdef HW_COUNTERS
+          this->timer_cnt_m->stopAndRegisterHWCounters(this->cu_timer_id, CUMEM_IDLE, NO_INSTRUCTION, this->timer_cnt_m->instructionID(curInstruction->getPC()));
         #else 
-          this->timer_cnt_m->addEvent(this->cu_timer_name, CUMEM_IDLE);
+          this->timer_cnt_m->addEvent(this->cu_timer_id, CUMEM_IDLE);
         #endif
       );
+      if (this->roofline_m != nullptr)
+        this->roofline_m->account(this->cu_slot, curInstruction, roofline_module::now() - start);
+      if (this->metrics_m != nullptr)
+        this->metrics_m->cuEnd(this->cu_slot);
       myExecutor->consume();
     }
   }
   SCMULATE_INFOMSG(1, "Shutting down executor CUMEM %d", cu_executor_id);
   TIMERS_COUNTERS_GUARD(
-    this->timer_cnt_m->addEvent(this->cu_timer_name, CUMEM_END);
+    this->timer_cnt_m->addEvent(this->cu_timer_id, CUMEM_END);
   );
   return 0;
 }
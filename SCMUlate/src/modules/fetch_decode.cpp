@@ -5,14 +5,30 @@
 scm::fetch_decode_module::fetch_decode_module(inst_mem_module *const inst_mem, 
                                               control_store_module *const control_store_m, 
                                               bool *const aliveSig, 
-                                              ILP_MODES ilp_mode) : 
+                                              ILP_MODES ilp_mode,
+                                              l2_memory_t const memory) : 
                                               inst_mem_m(inst_mem),
                                               ctrl_st_m(control_store_m),
                                               aliveSignal(aliveSig),
                                               PC(0),
                                               su_number(0), 
-                                              instructionLevelParallelism(ilp_mode), 
-                                              stallingInstruction(nullptr)
+                                              instructionLevelParallelism(ilp_mode, inst_mem->getRegisterFileModule()), 
+                                              dispatcher(control_store_m),
+                                              su_mem_interface(memory, nullptr),
+                                              inline_mem_threshold(SU_INLINE_MEM_THRESHOLD),
+                                              inlined_ldimm(0),
+                                              inlined_mem(0),
+                                              inlined_codelets(0),
+                                              block_fetch(ilp_mode != ILP_MODES::SEQUENTIAL),
+                                              block_fetches(0),
+                                              traces(inst_mem),
+                                              inst_buff_m(&traces),
+                                              stallingInstruction(nullptr),
+                                              metrics_m(nullptr),
+                                              sched_log(nullptr),
+                                              fetched_instructions(0),
+                                              retired_instructions(0),
+                                              moved_bytes(0)
                                               //debugger(DEBUGER_MODE)
                                               
 {
@@ -26,28 +42,45 @@ int scm::fetch_decode_module::behavior()
   uint64_t stall = 0, waiting = 0, ready = 0, execution_done = 0, executing = 0, decomision = 0;
   bool commited = false; 
   TIMERS_COUNTERS_GUARD(
-      this->time_cnt_m->addEvent(this->su_timer_name, SU_START););
+      this->time_cnt_m->addEvent(this->su_timer_id, SU_START););
   SCMULATE_INFOMSG(1, "Initializing the SU");
 // Initialization barrier
 #pragma omp barrier
   while (*(this->aliveSignal)) {
     // FETCHING PC
     int fetch_reps = 0;
+    int fetch_window = INSTRUCTION_FETCH_WINDOW;
     scm::decoded_instruction_t *new_inst = nullptr;
     if (!commited) {
+      // Out of order modes fetch up to the end of the basic block. There are no jumps in between
+      const basic_block_t * block = this->inst_mem_m->getBlocks().blockAt(this->PC);
+      if (this->block_fetch && this->stallingInstruction == nullptr && block != nullptr && static_cast<int>(block->last_pc) - this->PC + 1 > fetch_window) {
+        fetch_window = block->last_pc - this->PC + 1;
+        this->block_fetches++;
+      }
       do {
         if (this->stallingInstruction == nullptr) {
           SCMULATE_INFOMSG(5, "FETCHING PC = %d", this->PC);
-          new_inst = this->inst_mem_m->fetch(this->PC);
+          if (!this->inst_buff_m.can_add_instruction()) {
+            // The buffer is full. Nothing else can be fetched in this iteration
+            break;
+          }
+          // Hot blocks come from the trace cache, the rest is copied from the instruction memory
+          new_inst = this->traces.acquire(this->PC);
           if (!new_inst) {
             *(this->aliveSignal) = false;
             SCMULATE_ERROR(0, "Returned instruction is NULL for PC = %d. This should not happen", PC);
             continue;
           }
           // Insert new instruction
-          if (this->inst_buff_m.add_instruction(*new_inst)) {
+          if (this->inst_buff_m.add_instruction(new_inst)) {
+            new_inst->setFetchSeq(this->fetched_instructions++);
             TIMERS_COUNTERS_GUARD(
-              this->time_cnt_m->addEvent(this->su_timer_name, FETCH_DECODE_INSTRUCTION, std::string("PC = ") + std::to_string(PC) + std::string(" ") + new_inst->getFullInstruction()););
+              // The text of the instruction is kept once per PC of each program, and resolved when the trace is dumped
+              if (!this->time_cnt_m->hasInstruction(PC))
+                this->time_cnt_m->internInstruction(PC, new_inst->getFullInstruction());
+              new_inst->setTraced(this->time_cnt_m->traceInstruction(PC));
+              this->time_cnt_m->addEvent(this->su_timer_id, FETCH_DECODE_INSTRUCTION, this->time_cnt_m->instructionID(PC), new_inst->isTraced()););
             SCMULATE_INFOMSG(5, "Executing PC = %d", this->PC);
             ITT_TASK_BEGIN(fetch_decode_module_behavior, checkMarkInstructionToSched);
             instructionLevelParallelism.checkMarkInstructionToSched(this->inst_buff_m.get_latest());
@@ -60,9 +93,10 @@ int scm::fetch_decode_module::behavior()
             // Mark instruction for scheduling
             commited = new_inst->getOpcode() == COMMIT_INST.opcode;
             SCMULATE_INFOMSG(5, "incrementing PC");
-            this->PC++;
+            // The idle time after the fetch belongs to the fetched instruction
             TIMERS_COUNTERS_GUARD(
-              this->time_cnt_m->addEvent(this->su_timer_name, SU_IDLE, std::string("PC = ") + std::to_string(PC)) );
+              this->time_cnt_m->addEvent(this->su_timer_id, SU_IDLE, this->time_cnt_m->instructionID(PC)) );
+            this->PC++;
           }
         } else {
           new_inst = this->stallingInstruction->first;
@@ -71,7 +105,7 @@ int scm::fetch_decode_module::behavior()
             this->stallingInstruction = nullptr;
           }
         }
-      } while (stallingInstruction == nullptr && !commited && ++fetch_reps < INSTRUCTION_FETCH_WINDOW && new_inst->getType() != instType::CONTROL_INST && new_inst->getType() != instType::COMMIT );
+      } while (stallingInstruction == nullptr && !commited && ++fetch_reps < fetch_window && new_inst->getType() != instType::CONTROL_INST && new_inst->getType() != instType::COMMIT );
     }
     // bool mark_event = (this->inst_buff_m.getBufferSize() > 0 );
     // if (mark_event) {
@@ -138,12 +172,14 @@ int scm::fetch_decode_module::behavior()
               //   this->time_cnt_m->addEvent(this->su_timer_name, SU_IDLE););
               break;
             case EXECUTE_INST:
-              SCMULATE_INFOMSG(4, "Scheduling an EXECUTE_INST %s", current_pair->first->getFullInstruction().c_str());
-              if (!attemptAssignExecuteInstruction(current_pair))
-                current_pair->second = instruction_state::READY;
-              break;
             case MEMORY_INST:
-              SCMULATE_INFOMSG(4, "Scheduling a MEMORY_INST %s", current_pair->first->getFullInstruction().c_str());
+              if (isInlineInstruction(current_pair->first)) {
+                SCMULATE_INFOMSG(4, "Executing in the SU %s", current_pair->first->getFullInstruction().c_str());
+                executeInlineInstruction(current_pair->first);
+                current_pair->second = instruction_state::EXECUTION_DONE;
+                break;
+              }
+              SCMULATE_INFOMSG(4, "Scheduling %s %s", current_pair->first->getType() == MEMORY_INST ? "a MEMORY_INST" : "an EXECUTE_INST", current_pair->first->getFullInstruction().c_str());
               if (!attemptAssignExecuteInstruction(current_pair))
                 current_pair->second = instruction_state::READY;
               break;
@@ -158,19 +194,27 @@ int scm::fetch_decode_module::behavior()
         case instruction_state::EXECUTION_DONE:
           execution_done ++;
           TIMERS_COUNTERS_GUARD(
-            this->time_cnt_m->addEvent(this->su_timer_name, DISPATCH_INSTRUCTION, current_pair->first->getFullInstruction()););
+            this->time_cnt_m->addEvent(this->su_timer_id, DISPATCH_INSTRUCTION, this->time_cnt_m->instructionID(current_pair->first->getPC()), current_pair->first->isTraced()););
           // check if stalling instruction
           if (this->stallingInstruction != nullptr && this->stallingInstruction == current_pair) {
             SCMULATE_INFOMSG(5, "Unstalling on %s", stallingInstruction->first->getFullInstruction().c_str());
             this->stallingInstruction = nullptr;
           }
+          if (this->metrics_m != nullptr && current_pair->first->isMemoryInstruction()) {
+            memranges_pair * ranges = current_pair->first->getMemoryRange();
+            for (auto range = ranges->reads.begin(); range != ranges->reads.end(); ++range)
+              this->moved_bytes += range->size;
+            for (auto range = ranges->writes.begin(); range != ranges->writes.end(); ++range)
+              this->moved_bytes += range->size;
+          }
           ITT_TASK_BEGIN(fetch_decode_module_behavior, instructionFinished);
           instructionLevelParallelism.instructionFinished(current_pair);
           ITT_TASK_END(instructionFinished);
+          this->dispatcher.instructionFinished(current_pair);
           SCMULATE_INFOMSG(5, "Marking instruction %s for decomission", current_pair->first->getFullInstruction().c_str());
           current_pair->second = instruction_state::DECOMMISSION;
           TIMERS_COUNTERS_GUARD(
-            this->time_cnt_m->addEvent(this->su_timer_name, SU_IDLE, current_pair->first->getFullInstruction()););
+            this->time_cnt_m->addEvent(this->su_timer_id, SU_IDLE, this->time_cnt_m->instructionID(current_pair->first->getPC())););
           break;
         case instruction_state::EXECUTING:
           executing++;
@@ -188,6 +232,12 @@ int scm::fetch_decode_module::behavior()
     SCMULATE_INFOMSG(6, "%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\n", stall, waiting, ready, execution_done, executing, decomision, this->inst_buff_m.getBufferSize());
     // Clear out instructions that are decomissioned
     this->inst_buff_m.clean_out_queue();
+    if (this->sched_log != nullptr)
+      this->sched_log->nextIteration(execution_done != 0 || executing != 0);
+    if (this->metrics_m != nullptr) {
+      this->retired_instructions += execution_done;
+      this->metrics_m->publishSU(this->PC, this->retired_instructions, this->inst_buff_m.getBufferSize(), instructionLevelParallelism.getNumberOfRanges(), instructionLevelParallelism.getRenamedInUse(), this->moved_bytes);
+    }
 
     // if (mark_event) {  
     //   TIMERS_COUNTERS_GUARD(
@@ -195,11 +245,62 @@ int scm::fetch_decode_module::behavior()
     // }
   }
   SCMULATE_INFOMSG(1, "Shutting down fetch decode unit");
+  SCMULATE_INFOMSG(1, "Dispatch policy %s: %lu instructions dispatched, %lu register migrations (%lu bytes)", this->dispatcher.getPolicyName(), this->dispatcher.getDispatched(), this->dispatcher.getMigrations(), this->dispatcher.getMigratedBytes());
+  SCMULATE_INFOMSG(1, "Executed in the SU (dispatches saved): %lu LDIMM, %lu loads/stores, %lu codelets", this->inlined_ldimm, this->inlined_mem, this->inlined_codelets);
+  SCMULATE_INFOMSG(1, "%u basic blocks. The SU fetched %lu times more than %d instructions at once", this->inst_mem_m->getBlocks().numBlocks(), this->block_fetches, INSTRUCTION_FETCH_WINDOW);
+  SCMULATE_INFOMSG(1, "Trace cache: %u hot traces, %lu hits, %lu misses (hit rate %.2f%%)", this->traces.getHotTraces(), this->traces.getHits(), this->traces.getMisses(), this->traces.getHitRate() * 100);
   TIMERS_COUNTERS_GUARD(
-      this->time_cnt_m->addEvent(this->su_timer_name, SU_END););
+      this->time_cnt_m->addEvent(this->su_timer_id, SU_END);
+      this->time_cnt_m->addStat("DISPATCH", "policy", this->dispatcher.getPolicyName());
+      this->time_cnt_m->addStat("DISPATCH", "dispatched", std::to_string(this->dispatcher.getDispatched()));
+      this->time_cnt_m->addStat("DISPATCH", "migrations", std::to_string(this->dispatcher.getMigrations()));
+      this->time_cnt_m->addStat("DISPATCH", "migrated_bytes", std::to_string(this->dispatcher.getMigratedBytes()));
+      if (this->sched_log != nullptr) {
+        this->time_cnt_m->addStat("SCHEDULE", "mode", this->sched_log->isRecording() ? "record" : "replay");
+        this->time_cnt_m->addStat("SCHEDULE", "dispatches", std::to_string(this->sched_log->getDispatches()));
+        this->time_cnt_m->addStat("SCHEDULE", "renames", std::to_string(this->sched_log->getRenames()));
+        this->time_cnt_m->addStat("SCHEDULE", "rename_misses", std::to_string(this->sched_log->getRenameMisses()));
+        this->time_cnt_m->addStat("SCHEDULE", "diverged", this->sched_log->hasDiverged() ? "true" : "false");
+      }
+      this->time_cnt_m->addStat("SU_INLINE", "threshold_bytes", std::to_string(this->inline_mem_threshold));
+      this->time_cnt_m->addStat("SU_INLINE", "ldimm", std::to_string(this->inlined_ldimm));
+      this->time_cnt_m->addStat("SU_INLINE", "memory", std::to_string(this->inlined_mem));
+      this->time_cnt_m->addStat("SU_INLINE", "codelets", std::to_string(this->inlined_codelets));
+      this->time_cnt_m->addStat("BLOCKS", "basic_blocks", std::to_string(this->inst_mem_m->getBlocks().numBlocks()));
+      this->time_cnt_m->addStat("BLOCKS", "block_fetches", std::to_string(this->block_fetches));
+      this->time_cnt_m->addStat("TRACE_CACHE", "hot_traces", std::to_string(this->traces.getHotTraces()));
+      this->time_cnt_m->addStat("TRACE_CACHE", "hits", std::to_string(this->traces.getHits()));
+      this->time_cnt_m->addStat("TRACE_CACHE", "misses", std::to_string(this->traces.getMisses()));
+      this->time_cnt_m->addStat("TRACE_CACHE", "hit_rate", std::to_string(this->traces.getHitRate()));
+      this->time_cnt_m->addStat("TRACE_CACHE", "su_time_saved_s", std::to_string(this->traces.getTimeSaved())););
   return 0;
 }
 
+bool scm::fetch_decode_module::loadProgram(inst_mem_module * const inst_mem)
+{
+  if (this->inst_buff_m.getBufferSize() != 0) {
+    SCMULATE_ERROR(0, "The previous program did not finish. %lu instructions are in the buffer", this->inst_buff_m.getBufferSize());
+    return false;
+  }
+  this->inst_mem_m = inst_mem;
+  this->traces.setProgram(inst_mem);
+  this->instructionLevelParallelism.newProgram();
+  TIMERS_COUNTERS_GUARD(
+    this->time_cnt_m->newProgram(););
+  this->stallingInstruction = nullptr;
+  this->PC = 0;
+  return true;
+}
+
+int scm::fetch_decode_module::getLabelTarget(scm::decoded_instruction_t *inst, int op_num)
+{
+  int target = inst->getOp(op_num).value.immediate;
+  // Labels of streamed programs may be used before they are loaded
+  if (target == -1)
+    target = this->inst_mem_m->resolveLabel(inst->getOpStr(op_num));
+  return target;
+}
+
 void scm::fetch_decode_module::executeControlInstruction(scm::decoded_instruction_t *inst)
 {
 
@@ -207,7 +308,7 @@ void scm::fetch_decode_module::executeControlInstruction(scm::decoded_instructio
   ///// CONTROL LOGIC FOR THE JMPLBL INSTRUCTION
   /////////////////////////////////////////////////////
   if (inst->getOpcode() == JMPLBL_INST.opcode) {
-    int newPC = inst->getOp(1).value.immediate;
+    int newPC = getLabelTarget(inst, 1);
     SCMULATE_ERROR_IF(0, newPC == -1, "Incorrect label translation");
     PC = newPC;
     return;
@@ -242,7 +343,7 @@ void scm::fetch_decode_module::executeControlInstruction(scm::decoded_instructio
     if (bitComparison) {
       int target;
       if (inst->getOp(3).type == operand_t::LABEL) {
-        target = inst->getOp(3).value.immediate;
+        target = getLabelTarget(inst, 3);
       } else {
         int offset = inst->getOp(3).value.immediate;
         target = offset + PC - 1;
@@ -273,7 +374,7 @@ void scm::fetch_decode_module::executeControlInstruction(scm::decoded_instructio
     if (reg1_gt_reg2) {
       int target;
       if (inst->getOp(3).type == operand_t::LABEL) {
-        target = inst->getOp(3).value.immediate;
+        target = getLabelTarget(inst, 3);
       } else {
         int offset = inst->getOp(3).value.immediate;
         target = offset + PC - 1;
@@ -308,7 +409,7 @@ void scm::fetch_decode_module::executeControlInstruction(scm::decoded_instructio
     if (reg1_get_reg2) {
       int target;
       if (inst->getOp(3).type == operand_t::LABEL) {
-        target = inst->getOp(3).value.immediate;
+        target = getLabelTarget(inst, 3);
       } else {
         int offset = inst->getOp(3).value.immediate;
         target = offset + PC - 1;
@@ -339,7 +440,7 @@ void scm::fetch_decode_module::executeControlInstruction(scm::decoded_instructio
     if (reg1_lt_reg2) {
       int target;
       if (inst->getOp(3).type == operand_t::LABEL) {
-        target = inst->getOp(3).value.immediate;
+        target = getLabelTarget(inst, 3);
       } else {
         int offset = inst->getOp(3).value.immediate;
         target = offset + PC - 1;
@@ -374,7 +475,7 @@ void scm::fetch_decode_module::executeControlInstruction(scm::decoded_instructio
     if (reg1_let_reg2) {
       int target;
       if (inst->getOp(3).type == operand_t::LABEL) {
-        target = inst->getOp(3).value.immediate;
+        target = getLabelTarget(inst, 3);
       } else {
         int offset = inst->getOp(3).value.immediate;
         target = offset + PC - 1;
@@ -602,23 +703,36 @@ void scm::fetch_decode_module::executeArithmeticInstructions(scm::decoded_instru
   }
 }
 
-bool scm::fetch_decode_module::attemptAssignExecuteInstruction(scm::instruction_state_pair *inst)
+bool scm::fetch_decode_module::isInlineInstruction(scm::decoded_instruction_t *inst)
 {
-  // TODO: Jose this is the point where you can select scheduing policies
-  static uint32_t curSched = 0;
-  bool sched = false;
-  uint32_t attempts = 0;
-  // We try scheduling on all the sched units
-  while (!sched && attempts++ < this->ctrl_st_m->numExecutors()) {
-    if (this->ctrl_st_m->get_executor(curSched)->try_insert(inst)) {
-      sched = true;
-    } else {
-      curSched++;
-      curSched %= this->ctrl_st_m->numExecutors();
-    }
+  if (inst->getType() == EXECUTE_INST)
+    return inst->getExecCodelet()->isLightweight();
+  if (inst->getType() != MEMORY_INST)
+    return false;
+  if (inst->getOpcode() == LDIMM_INST.opcode)
+    return true;
+  // Only the register size matters. The address calculation is the same for all the loads and stores
+  return inst->getOp1().value.reg.reg_size_bytes <= this->inline_mem_threshold;
+}
+
+void scm::fetch_decode_module::executeInlineInstruction(scm::decoded_instruction_t *inst)
+{
+  if (inst->getType() == EXECUTE_INST) {
+    scm::codelet * curCodelet = inst->getExecCodelet();
+    curCodelet->setExecutor(nullptr);
+    curCodelet->implementation();
+    this->inlined_codelets++;
+    return;
   }
-  SCMULATE_INFOMSG_IF(5, sched, "Scheduling to CUMEM %d", curSched);
-  SCMULATE_INFOMSG_IF(5, !sched, "Could not find a free unit");
+  if (inst->getOpcode() == LDIMM_INST.opcode)
+    this->inlined_ldimm++;
+  else
+    this->inlined_mem++;
+  this->su_mem_interface.assignInstSlot(inst);
+  this->su_mem_interface.behavior();
+}
 
-  return sched;
-}
\ No newline at end of file
+bool scm::fetch_decode_module::attemptAssignExecuteInstruction(scm::instruction_state_pair *inst)
+{
+  return this->dispatcher.attemptDispatch(inst);
+}
@@ -107,7 +107,7 @@ namespace scm {
 
                 if(it_used != used.end()) {
                   // Register is in use. Let's rename it
-                  decoded_reg_t newReg = getRenamedRegister(current_operand->value.reg);
+                  decoded_reg_t newReg = getRenamedRegister(current_operand->value.reg, inst, i);
                   // Check if renaming was successful.
                   if (newReg == current_operand->value.reg) {
                     SCMULATE_INFOMSG(5, "STRUCTURAL HAZZARD on operand %d. No new register was found for renaming. Leaving other operands for later SU iteration.", i);
@@ -215,7 +215,7 @@ namespace scm {
 
                 if (rename) {
                   //let's rename
-                  new_renamed_reg = getRenamedRegister(original_op_reg);
+                  new_renamed_reg = getRenamedRegister(original_op_reg, inst, i);
                   // Check if renaming was successful.
                   if (new_renamed_reg == original_op_reg) {
                     SCMULATE_INFOMSG(5, "STRUCTURAL HAZZARD on operand %d. No new register was found for renaming. Leaving other operands for later SU iteration.", i);
@@ -333,22 +333,39 @@ namespace scm {
       }
 
       decoded_reg_t 
-      ilp_OoO::getRenamedRegister(decoded_reg_t & otherReg) {
+      ilp_OoO::getRenamedRegister(decoded_reg_t & otherReg, decoded_instruction_t * inst, int op_num) {
         static uint32_t curRegNum = 0;
         decoded_reg_t newReg = otherReg;
         uint32_t numReg4size = hidden_register_file->getNumRegForSize(newReg.reg_size_bytes);
-        curRegNum = (curRegNum+1) % numReg4size;
-        newReg.reg_number = curRegNum;
-        uint32_t attempts = 0;
+        int64_t forced = this->sched_log != nullptr && this->sched_log->isReplaying() ? this->sched_log->replayRename(inst->getFetchSeq(), op_num) : -1;
 
-        // Iterate over the hidden register is found that is not being used
-        do {
+        if (forced >= 0) {
+          // Replay. getNextRegister returns the register after reg_number
+          newReg.reg_number = (forced + numReg4size - 1) % numReg4size;
           newReg.reg_ptr = hidden_register_file->getNextRegister(newReg.reg_size_bytes, newReg.reg_number);
-          attempts++;
-        } while ((this->used.find(newReg.reg_ptr) != this->used.end() || this->renamedInUse.find(newReg.reg_ptr) != this->renamedInUse.end()) && attempts != numReg4size);
-        if (attempts == numReg4size) {
-          SCMULATE_INFOMSG(4, "When trying to rename, we could not find another register that was free out of %d", numReg4size);
-          return otherReg;
+          // Waiting for the register could block the rename that frees it. It is taken as a miss instead
+          bool isFree = this->used.find(newReg.reg_ptr) == this->used.end() && this->renamedInUse.find(newReg.reg_ptr) == this->renamedInUse.end();
+          SCMULATE_INFOMSG_IF(4, !isFree, "When replaying the renaming, the hidden register %ld was not free", forced);
+          this->sched_log->renamed(inst->getFetchSeq(), op_num, isFree);
+          if (!isFree)
+            forced = -1;
+        }
+        if (forced < 0) {
+          curRegNum = (curRegNum+1) % numReg4size;
+          newReg.reg_number = curRegNum;
+          uint32_t attempts = 0;
+
+          // Iterate over the hidden register is found that is not being used
+          do {
+            newReg.reg_ptr = hidden_register_file->getNextRegister(newReg.reg_size_bytes, newReg.reg_number);
+            attempts++;
+          } while ((this->used.find(newReg.reg_ptr) != this->used.end() || this->renamedInUse.find(newReg.reg_ptr) != this->renamedInUse.end()) && attempts != numReg4size);
+          if (attempts == numReg4size) {
+            SCMULATE_INFOMSG(4, "When trying to rename, we could not find another register that was free out of %d", numReg4size);
+            return otherReg;
+          }
+          if (this->sched_log != nullptr && this->sched_log->isRecording())
+            this->sched_log->recordRename(inst->getFetchSeq(), op_num, newReg.reg_number);
         }
         newReg.reg_name = std::string("R_ren_") + newReg.reg_size + std::string("_") + std::to_string(newReg.reg_number);
         SCMULATE_INFOMSG(4, "Register %s mapped to %s with renaming", otherReg.reg_name.c_str(), newReg.reg_name.c_str());
@@ -517,4 +534,17 @@ namespace scm {
 
       }
 
+      bool
+      ilp_controller::parseMode(std::string const & name, ILP_MODES & mode) {
+        if (name == "seq")
+          mode = SEQUENTIAL;
+        else if (name == "superscalar")
+          mode = SUPERSCALAR;
+        else if (name == "ooo")
+          mode = OOO;
+        else
+          return false;
+        return true;
+      }
+
 }
\ No newline at end of file
@@ -1,5 +1,10 @@
 #include "instruction_mem.hpp"
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 using namespace std;
 
@@ -10,25 +15,45 @@ scm::inst_mem_module::loader(char* filename) {
     string line;
     file_stream.open(filename);
     unsigned int curInst = 0;
+    // Only used by the messages, which are compiled out in non verbose builds
+    [[maybe_unused]] unsigned int lineNumber = 0;
 
     // If file is valid
     if (file_stream.is_open()) {
+      // Expand the directives (.rept, .unroll, .macro, .set) first
+      program_preprocessor preprocessor;
+      std::vector<source_line_t> program;
+      if (!preprocessor.expand(file_stream, program)) {
+        SCMULATE_ERROR(0, "%s:%s", filename, preprocessor.getError().c_str());
+        return false;
+      }
       // Read line by line and get the values 
-      while (std::getline(file_stream, line))
-        // if line has text. Lines with no text should not be 
-        // counted for offsets. Label lines are not counted for offsets
-        if (line.length() != 0 ) {
-          // When it is a label we store this value, it is not stored in memory
-          if (instructions::isLabelInst(line)) {
-            std::string label = instructions::getLabel(line);
+      for (auto it = program.begin(); it != program.end(); ++it) {
+        line = it->text;
+        lineNumber = it->line;
+        // Lines with no text and label lines are not counted for offsets
+        decoded_instruction_t * newInst = nullptr;
+        std::string label, error;
+        switch (instructions::parseLine(line, &newInst, label, error)) {
+          case instructions::LABEL_LINE:
+            // When it is a label we store this value, it is not stored in memory
             SCMULATE_INFOMSG(4, "Found label: '%s'", label.c_str());
             labels[label] = curInst; 
-          } else if (!instructions::isComment(line)) {
-            this->memory.push_back(scm::instructions::findInstType(line));
+            break;
+          case instructions::INVALID_LINE:
+            SCMULATE_WARNING(0, "%s:%u: %s in '%s'", filename, lineNumber, error.c_str(), line.c_str());
+            // The UNKNOWN instruction is stored. The SU stops the machine if it reaches it
+            [[fallthrough]];
+          case instructions::INSTRUCTION_LINE:
             // Any other instruction we store it in memory
+            this->memory.push_back(newInst);
             curInst++;
-          }
+            break;
+          case instructions::EMPTY_LINE:
+          default:
+            break;
         }
+      }
       file_stream.close();
       for (const auto& inst : this->memory) { 
         if (!inst->decodeOperands(this)) {
@@ -49,17 +74,199 @@ scm::inst_mem_module::loader(char* filename) {
 }
 
 scm::inst_mem_module::inst_mem_module(char * filename, reg_file_module * const reg_file_m):
-  reg_file_m(reg_file_m) {
+  reg_file_m(reg_file_m),
+  streaming(false),
+  stream_fd(-1),
+  loaded(0),
+  evicted(0),
+  stream_done(false),
+  stream_stop(false) {
   SCMULATE_INFOMSG(3, "CREATING INSTRUCTION MEMORY");
   this->is_valid = true;
-  // Open the file, if specified, otherwise read from stdio
-  string line = "";
-  if (strlen(filename) != 0) {
+  // Programs from stdin and pipes are streamed. Otherwise open the file
+  if (isStreamedProgram(filename)) {
+    this->streaming = true;
+    this->is_valid = this->streamOpen(filename);
+    return;
+  }
+  if (program_image::isImage(filename))
+    this->is_valid = this->imageLoader(filename);
+  else
     this->is_valid = this->loader(filename);
+  if (this->is_valid)
+    this->blocks.analyze(this->memory);
+}
+
+bool &
+scm::inst_mem_module::forceStreaming() {
+  static bool force = false;
+  return force;
+}
+
+bool
+scm::inst_mem_module::isStreamedProgram(const char * filename) {
+  if (strlen(filename) == 0 || strcmp(filename, "-") == 0)
+    return true;
+  struct stat file_stat;
+  if (stat(filename, &file_stat) == 0 && (S_ISFIFO(file_stat.st_mode) || S_ISCHR(file_stat.st_mode)))
+    return true;
+  return forceStreaming() && !program_image::isImage(filename);
+}
+
+bool
+scm::inst_mem_module::streamOpen(const char * filename) {
+  if (strlen(filename) == 0 || strcmp(filename, "-") == 0) {
+    SCMULATE_INFOMSG(2, "STREAMING THE PROGRAM FROM STDIN");
+    this->stream_fd = STDIN_FILENO;
   } else {
-    while ((cin >> line) && line != std::string("-"))
-      this->memory.push_back(scm::instructions::findInstType(line));
+    SCMULATE_INFOMSG(2, "STREAMING FILE %s", filename);
+    this->stream_fd = open(filename, O_RDONLY);
+    if (this->stream_fd < 0) {
+      SCMULATE_ERROR(0, "PROGRAM DOES NOT EXIST %s", filename);
+      return false;
+    }
   }
+  this->memory.assign(STREAM_WINDOW_SIZE, nullptr);
+  this->stream_loader = std::thread(&inst_mem_module::streamLoader, this);
+  return true;
+}
+
+void
+scm::inst_mem_module::streamLoader() {
+  std::vector<char> buffer(1 << 16);
+  std::string pending;
+  uint32_t lineNumber = 0;
+  bool ended = false;
+  while (!ended && !this->stream_stop.load()) {
+    // Wait for data with a timeout, so the loader stops when the machine is destroyed
+    struct pollfd input = {this->stream_fd, POLLIN, 0};
+    int ready = poll(&input, 1, 100);
+    if (ready == 0 || (ready < 0 && errno == EINTR))
+      continue;
+    ssize_t bytes = ready < 0 ? -1 : read(this->stream_fd, buffer.data(), buffer.size());
+    if (bytes < 0) {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+      SCMULATE_ERROR(0, "Error reading the program: %s", strerror(errno));
+      break;
+    }
+    if (bytes == 0) {
+      // End of the program. The last line may not have a new line
+      if (!pending.empty())
+        streamLine(pending, ++lineNumber);
+      break;
+    }
+    ssize_t begin = 0;
+    for (ssize_t i = 0; i < bytes && !ended; i++) {
+      if (buffer[i] == '\n') {
+        pending.append(&buffer[begin], i - begin);
+        ended = !streamLine(pending, ++lineNumber);
+        pending.clear();
+        begin = i + 1;
+      }
+    }
+    if (!ended)
+      pending.append(&buffer[begin], bytes - begin);
+  }
+  SCMULATE_INFOMSG(2, "Finished streaming the program. %lu instructions", this->loaded.load());
+  {
+    std::lock_guard<std::mutex> lock(this->stream_lock);
+    this->stream_done = true;
+  }
+  this->stream_cv.notify_all();
+}
+
+bool
+scm::inst_mem_module::streamLine(std::string const & line, [[maybe_unused]] uint32_t lineNumber) {
+  // A line with only '-' ends a program typed in stdin
+  if (line == "-")
+    return false;
+  decoded_instruction_t * newInst = nullptr;
+  std::string label, error;
+  switch (instructions::parseLine(line, &newInst, label, error)) {
+    case instructions::LABEL_LINE:
+      SCMULATE_INFOMSG(4, "Found label: '%s'", label.c_str());
+      {
+        std::lock_guard<std::mutex> lock(this->stream_lock);
+        this->labels[label] = this->loaded.load();
+      }
+      // Jumps may be waiting for this label
+      this->stream_cv.notify_all();
+      return true;
+    case instructions::INVALID_LINE:
+      SCMULATE_WARNING(0, "%u: %s in '%s'", lineNumber, error.c_str(), line.c_str());
+      // The UNKNOWN instruction is stored. The SU stops the machine if it reaches it
+      [[fallthrough]];
+    case instructions::INSTRUCTION_LINE:
+      break;
+    case instructions::EMPTY_LINE:
+    default:
+      return true;
+  }
+  // Labels that are not defined yet are left as -1, and resolved when the instruction executes
+  if (!newInst->decodeOperands(this)) {
+    SCMULATE_ERROR(0, "PROBLEM DECODING OPERANDS in line %u '%s'", lineNumber, line.c_str());
+    delete newInst;
+    return false;
+  }
+  // Wait for the SU to free a slot of the window
+  uint64_t pc = this->loaded.load();
+  if (pc - this->evicted.load() >= STREAM_WINDOW_SIZE) {
+    std::unique_lock<std::mutex> lock(this->stream_lock);
+    this->stream_cv.wait(lock, [&] { return pc - this->evicted.load() < STREAM_WINDOW_SIZE || this->stream_stop.load(); });
+    if (this->stream_stop.load()) {
+      delete newInst;
+      return false;
+    }
+  }
+  this->memory[pc & (STREAM_WINDOW_SIZE - 1)] = newInst;
+  {
+    std::lock_guard<std::mutex> lock(this->stream_lock);
+    this->loaded = pc + 1;
+  }
+  this->stream_cv.notify_all();
+  return true;
+}
+
+scm::decoded_instruction_t*
+scm::inst_mem_module::streamFetch(uint64_t pc) {
+  if (pc < this->evicted.load()) {
+    SCMULATE_ERROR(0, "PC = %lu was evicted. Jumps back cannot be longer than %d instructions in streamed programs", pc, STREAM_HISTORY_SIZE);
+    return nullptr;
+  }
+  if (pc >= this->loaded.load()) {
+    std::unique_lock<std::mutex> lock(this->stream_lock);
+    this->stream_cv.wait(lock, [&] { return pc < this->loaded.load() || this->stream_done.load(); });
+    if (pc >= this->loaded.load())
+      return nullptr;
+  }
+  // Evict the instructions that are far behind the PC. In batches, to wake up the loader less often
+  if (pc > STREAM_HISTORY_SIZE && pc - STREAM_HISTORY_SIZE - this->evicted.load() >= STREAM_WINDOW_SIZE / 8) {
+    uint64_t floor = pc - STREAM_HISTORY_SIZE;
+    for (uint64_t old = this->evicted.load(); old < floor; old++) {
+      delete this->memory[old & (STREAM_WINDOW_SIZE - 1)];
+      this->memory[old & (STREAM_WINDOW_SIZE - 1)] = nullptr;
+    }
+    {
+      std::lock_guard<std::mutex> lock(this->stream_lock);
+      this->evicted = floor;
+    }
+    this->stream_cv.notify_all();
+  }
+  return this->memory[pc & (STREAM_WINDOW_SIZE - 1)];
+}
+
+int
+scm::inst_mem_module::resolveLabel(std::string const & label) {
+  if (!this->streaming)
+    return getMemoryLabel(label);
+  std::unique_lock<std::mutex> lock(this->stream_lock);
+  auto it = this->labels.find(label);
+  while (it == this->labels.end() && !this->stream_done.load()) {
+    this->stream_cv.wait(lock);
+    it = this->labels.find(label);
+  }
+  return it != this->labels.end() ? it->second : -1;
 }
 
 void
@@ -71,6 +278,16 @@ scm::inst_mem_module::dumpMemory() {
 }
 
 scm::inst_mem_module::~inst_mem_module() {
+  if (this->stream_loader.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(this->stream_lock);
+      this->stream_stop = true;
+    }
+    this->stream_cv.notify_all();
+    this->stream_loader.join();
+  }
+  if (this->stream_fd > STDIN_FILENO)
+    close(this->stream_fd);
   for (auto it : this->memory) {
     delete it;
   }
@@ -0,0 +1,169 @@
+#include "live_metrics.hpp"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+scm::live_metrics_module::live_metrics_module(uint32_t numCUs) :
+  cus(numCUs), interval_ms(LIVE_METRICS_INTERVAL_MS), outputFile(nullptr), listenSocket(-1), enabled(false),
+  stopSampler(false), start_ns(0), last_ns(0), last_retired(0), last_bytes(0), last_busy(numCUs, 0) { }
+
+bool
+scm::live_metrics_module::setOutput(std::string const & output, uint32_t interval) {
+  if (this->enabled || output.empty())
+    return false;
+  this->interval_ms = interval > 0 ? interval : LIVE_METRICS_INTERVAL_MS;
+  if (output.compare(0, 5, "unix:") == 0) {
+    std::string path = output.substr(5);
+    sockaddr_un addr;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+      SCMULATE_ERROR(0, "Invalid socket path %s", path.c_str());
+      return false;
+    }
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+      return false;
+    // A socket left by a previous run is replaced
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+      SCMULATE_ERROR(0, "Could not listen on %s (errno %d)", path.c_str(), errno);
+      close(fd);
+      return false;
+    }
+    // The sampler never waits for the clients
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    this->listenSocket = fd;
+    this->outputName = path;
+  } else {
+    this->outputFile = std::fopen(output.c_str(), "w");
+    if (this->outputFile == nullptr)
+      return false;
+    this->outputName = output;
+  }
+  this->enabled = true;
+  return true;
+}
+
+void
+scm::live_metrics_module::start() {
+  if (!this->enabled)
+    return;
+  this->start_ns = this->last_ns = now();
+  this->last_retired = this->last_bytes = 0;
+  for (uint32_t i = 0; i < this->cus.size(); i++)
+    this->last_busy[i] = this->cus[i].busy.load(std::memory_order_relaxed);
+  std::ostringstream header;
+  header << "{\"metrics\": 1, \"cus\": " << this->cus.size() << ", \"window_size\": " << INSTRUCTIONS_BUFFER_SIZE
+         << ", \"interval_ms\": " << this->interval_ms << "}\n";
+  acceptClients();
+  write(header.str());
+  this->stopSampler = false;
+  this->sampler = std::thread(&live_metrics_module::samplerBehavior, this);
+}
+
+void
+scm::live_metrics_module::stop() {
+  if (!this->enabled || !this->sampler.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(this->samplerLock);
+    this->stopSampler = true;
+  }
+  this->samplerCond.notify_one();
+  this->sampler.join();
+  sample(true);
+}
+
+void
+scm::live_metrics_module::samplerBehavior() {
+  std::unique_lock<std::mutex> lock(this->samplerLock);
+  while (!this->stopSampler) {
+    if (this->samplerCond.wait_for(lock, std::chrono::milliseconds(this->interval_ms)) == std::cv_status::no_timeout)
+      continue;
+    lock.unlock();
+    acceptClients();
+    sample(false);
+    lock.lock();
+  }
+}
+
+void
+scm::live_metrics_module::sample(bool done) {
+  uint64_t t = now();
+  double elapsed = (t - this->last_ns) * 1e-9;
+  uint64_t retired = this->su.retired.load(std::memory_order_relaxed);
+  uint64_t bytes = this->su.bytes.load(std::memory_order_relaxed);
+
+  std::ostringstream line;
+  line << std::fixed << std::setprecision(3);
+  line << "{\"t\": " << (t - this->start_ns) * 1e-9
+       << ", \"pc\": " << this->su.pc.load(std::memory_order_relaxed)
+       << ", \"retired\": " << retired
+       << ", \"ips\": " << (elapsed > 0 ? (retired - this->last_retired) / elapsed : 0)
+       << ", \"window\": " << this->su.window.load(std::memory_order_relaxed)
+       << ", \"ranges\": " << this->su.ranges.load(std::memory_order_relaxed)
+       << ", \"renamed\": " << this->su.renamed.load(std::memory_order_relaxed)
+       << ", \"bytes\": " << bytes
+       << ", \"bps\": " << (elapsed > 0 ? (bytes - this->last_bytes) / elapsed : 0)
+       << ", \"cu_busy\": [";
+  for (uint32_t i = 0; i < this->cus.size(); i++) {
+    // The instruction in progress counts up to now. The CU may finish it between the two loads,
+    // so the fraction is clamped
+    uint64_t since = this->cus[i].busy_since.load(std::memory_order_relaxed);
+    uint64_t busy = this->cus[i].busy.load(std::memory_order_relaxed) + (since != 0 && since < t ? t - since : 0);
+    double fraction = elapsed > 0 && busy > this->last_busy[i] ? (busy - this->last_busy[i]) * 1e-9 / elapsed : 0;
+    line << (i == 0 ? "" : ", ") << std::setprecision(2) << (fraction > 1 ? 1.0 : fraction);
+    this->last_busy[i] = busy;
+  }
+  line << "]" << (done ? ", \"done\": true" : "") << "}\n";
+  write(line.str());
+
+  this->last_ns = t;
+  this->last_retired = retired;
+  this->last_bytes = bytes;
+}
+
+void
+scm::live_metrics_module::write(std::string const & line) {
+  if (this->outputFile != nullptr) {
+    std::fwrite(line.data(), 1, line.size(), this->outputFile);
+    std::fflush(this->outputFile);
+  }
+  // Clients that do not keep up are disconnected
+  for (auto it = this->clients.begin(); it != this->clients.end(); ) {
+    if (send(*it, line.data(), line.size(), MSG_NOSIGNAL | MSG_DONTWAIT) != static_cast<ssize_t>(line.size())) {
+      close(*it);
+      it = this->clients.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void
+scm::live_metrics_module::acceptClients() {
+  if (this->listenSocket < 0)
+    return;
+  int client;
+  while ((client = accept(this->listenSocket, nullptr, nullptr)) >= 0)
+    this->clients.push_back(client);
+}
+
+scm::live_metrics_module::~live_metrics_module() {
+  stop();
+  if (this->outputFile != nullptr)
+    std::fclose(this->outputFile);
+  for (int client : this->clients)
+    close(client);
+  if (this->listenSocket >= 0) {
+    close(this->listenSocket);
+    unlink(this->outputName.c_str());
+  }
+}
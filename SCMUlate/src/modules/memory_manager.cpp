@@ -0,0 +1,409 @@
+#include "memory_manager.hpp"
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// We do not depend on numaif.h (libnuma), these are the values
+// of the kernel ABI for the mbind system call
+#define SCM_MPOL_DEFAULT 0
+#define SCM_MPOL_BIND 2
+#define SCM_MPOL_INTERLEAVE 3
+#define SCM_MAX_NUMA_NODES 64
+
+namespace {
+  // Count the NUMA nodes in the system through sysfs.
+  // If it is not available we assume a single node
+  int countNumaNodes() {
+    int nodes = 0;
+    DIR * nodeDir = opendir("/sys/devices/system/node");
+    if (nodeDir == nullptr)
+      return 1;
+    struct dirent * entry;
+    while ((entry = readdir(nodeDir)) != nullptr) {
+      if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+        nodes++;
+    }
+    closedir(nodeDir);
+    return nodes == 0 ? 1 : nodes;
+  }
+}
+
+scm::memory_manager_module::memory_manager_module(uint64_t l2_size, mem_placement_policy policy, mem_page_mode page_mode, int node):
+  placement(policy),
+  pages(page_mode),
+  bind_node(node),
+  tile_size(MEM_FIRST_TOUCH_TILE),
+  num_nodes(countNumaNodes()) {
+  SCMULATE_INFOMSG(3, "Initializing memory manager with %lu bytes, policy %d, pages %d, %d NUMA nodes", l2_size, placement, pages, num_nodes);
+  l2_region.base = nullptr;
+  if (placement == PLACE_BIND_NODE && (bind_node < 0 || bind_node >= num_nodes)) {
+    SCMULATE_WARNING(0, "NUMA node %d does not exist. Using the default placement policy", bind_node);
+    placement = PLACE_DEFAULT;
+  }
+  if (!mapRegion(l2_size, l2_region)) {
+    SCMULATE_ERROR(0, "Could not reserve the L2 memory of %lu bytes", l2_size);
+    return;
+  }
+  applyPlacement(l2_region.base, l2_region.size, placement);
+}
+
+bool
+scm::memory_manager_module::mapRegion(uint64_t size, mem_region_t & region) {
+  region.base = nullptr;
+  region.size = size;
+  region.mapping = MAP_FAILED;
+  region.hugetlb = false;
+
+  // Sizes are rounded to huge pages, this makes it possible to align the region and
+  // use huge pages for all of it
+  uint64_t rounded_size = ((size + MEM_HUGE_PAGE_SIZE - 1) / MEM_HUGE_PAGE_SIZE) * MEM_HUGE_PAGE_SIZE;
+
+  if (pages == PAGES_HUGETLB) {
+    // No MAP_NORESERVE here, we want mmap to fail if the hugetlb pool cannot hold the region
+    region.mapping_size = rounded_size;
+    region.mapping = mmap(nullptr, region.mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (region.mapping != MAP_FAILED) {
+      region.base = reinterpret_cast<l2_memory_t>(region.mapping);
+      region.hugetlb = true;
+      return true;
+    }
+    SCMULATE_WARNING(0, "Could not obtain %lu bytes of explicit huge pages (errno = %d). Using transparent huge pages", rounded_size, errno);
+  }
+
+  // One extra huge page to align the start of the region
+  region.mapping_size = rounded_size + MEM_HUGE_PAGE_SIZE;
+  region.mapping = mmap(nullptr, region.mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (region.mapping == MAP_FAILED) {
+    SCMULATE_ERROR(0, "mmap of %lu bytes failed (errno = %d)", region.mapping_size, errno);
+    return false;
+  }
+  uint64_t aligned = (reinterpret_cast<uint64_t>(region.mapping) + MEM_HUGE_PAGE_SIZE - 1) & ~(MEM_HUGE_PAGE_SIZE - 1);
+  region.base = reinterpret_cast<l2_memory_t>(aligned);
+
+  if (pages != PAGES_DEFAULT) {
+    if (madvise(region.base, rounded_size, MADV_HUGEPAGE) != 0)
+      SCMULATE_WARNING(0, "madvise(MADV_HUGEPAGE) failed (errno = %d). Using regular pages", errno);
+  }
+  return true;
+}
+
+bool
+scm::memory_manager_module::applyPlacement(l2_memory_t base, uint64_t size, mem_placement_policy policy) {
+  unsigned long nodemask[SCM_MAX_NUMA_NODES/(8*sizeof(unsigned long))] = {0};
+  int mode = SCM_MPOL_DEFAULT;
+  switch (policy) {
+    case PLACE_DEFAULT:
+    case PLACE_FIRST_TOUCH:
+      // The kernel default is already local allocation on first touch
+      return true;
+    case PLACE_INTERLEAVE:
+      if (num_nodes < 2)
+        return true;
+      mode = SCM_MPOL_INTERLEAVE;
+      for (int i = 0; i < num_nodes && i < SCM_MAX_NUMA_NODES; i++)
+        nodemask[i/(8*sizeof(unsigned long))] |= 1ul << (i%(8*sizeof(unsigned long)));
+      break;
+    case PLACE_BIND_NODE:
+      mode = SCM_MPOL_BIND;
+      nodemask[bind_node/(8*sizeof(unsigned long))] |= 1ul << (bind_node%(8*sizeof(unsigned long)));
+      break;
+  }
+  uint64_t page_size = sysconf(_SC_PAGESIZE);
+  uint64_t aligned_size = ((size + page_size - 1) / page_size) * page_size;
+  long res = syscall(SYS_mbind, base, aligned_size, mode, nodemask, SCM_MAX_NUMA_NODES + 1, 0);
+  if (res != 0) {
+    SCMULATE_WARNING(0, "mbind failed with errno = %d. Using the default placement", errno);
+    return false;
+  }
+  return true;
+}
+
+l2_memory_t
+scm::memory_manager_module::allocateRegion(uint64_t size) {
+  mem_region_t newRegion;
+  if (!mapRegion(size, newRegion))
+    return nullptr;
+  applyPlacement(newRegion.base, newRegion.size, placement == PLACE_FIRST_TOUCH ? PLACE_DEFAULT : placement);
+  regions.push_back(newRegion);
+  return newRegion.base;
+}
+
+void
+scm::memory_manager_module::releaseRegion(l2_memory_t base) {
+  for (auto it = regions.begin(); it != regions.end(); ++it) {
+    if (it->base == base) {
+      munmap(it->mapping, it->mapping_size);
+      regions.erase(it);
+      return;
+    }
+  }
+  SCMULATE_WARNING(0, "Attempting to release a region that does not belong to the memory manager");
+}
+
+void
+scm::memory_manager_module::firstTouch(uint64_t offset, uint64_t size) {
+  if (placement != PLACE_FIRST_TOUCH)
+    return;
+  if (offset + size > l2_region.size) {
+    SCMULATE_ERROR(0, "First touch range [%lu, %lu) is outside of the L2 memory", offset, offset + size);
+    return;
+  }
+  SCMULATE_INFOMSG(3, "First touch of %lu bytes using tiles of %lu bytes", size, tile_size);
+  uint64_t page_size = sysconf(_SC_PAGESIZE);
+  uint64_t num_tiles = (size + tile_size - 1) / tile_size;
+  l2_memory_t start = l2_region.base + offset;
+  // Same thread distribution than in scm_machine::run()
+  int exec_units_threads[] = {CUS};
+#pragma omp parallel num_threads(NUM_CUS+1)
+  {
+    int cu = -1;
+    for (int i = 0; i < NUM_CUS; i++)
+      if (exec_units_threads[i] == omp_get_thread_num())
+        cu = i;
+    if (cu != -1) {
+      for (uint64_t tile = cu; tile < num_tiles; tile += NUM_CUS) {
+        uint64_t tile_end = (tile + 1) * tile_size < size ? (tile + 1) * tile_size : size;
+        for (uint64_t pos = tile * tile_size; pos < tile_end; pos += page_size)
+          start[pos] = 0;
+      }
+    }
+  }
+}
+
+uint64_t
+scm::memory_manager_module::getFilePageSize() {
+  // Also when the hugetlb pool was empty, so the valid regions do not depend on the system state
+  return pages == PAGES_HUGETLB ? MEM_HUGE_PAGE_SIZE : sysconf(_SC_PAGESIZE);
+}
+
+bool
+scm::memory_manager_module::mapFile(std::string name, std::string path, uint64_t offset, uint64_t size, mem_file_mode mode) {
+  uint64_t page_size = getFilePageSize();
+  if (offset % page_size != 0) {
+    SCMULATE_ERROR(0, "File region %s offset %lu is not aligned to pages of %lu bytes", name.c_str(), offset, page_size);
+    return false;
+  }
+  if (getFileRegion(name) != nullptr) {
+    SCMULATE_ERROR(0, "File region %s already exists", name.c_str());
+    return false;
+  }
+
+  int fd = open(path.c_str(), mode == FILE_WRITE_BACK ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+  if (fd < 0) {
+    SCMULATE_ERROR(0, "Could not open %s for region %s (errno = %d)", path.c_str(), name.c_str(), errno);
+    return false;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    SCMULATE_ERROR(0, "Could not stat %s for region %s (errno = %d)", path.c_str(), name.c_str(), errno);
+    close(fd);
+    return false;
+  }
+  uint64_t file_size = file_stat.st_size;
+  if (size == 0)
+    size = file_size;
+  if (size == 0) {
+    SCMULATE_ERROR(0, "Region %s has size 0", name.c_str());
+    close(fd);
+    return false;
+  }
+  // Accessing the pages of the mapping past the end of the file raises SIGBUS
+  if (mode != FILE_WRITE_BACK && size > file_size) {
+    SCMULATE_ERROR(0, "Region %s has %lu bytes but %s only has %lu", name.c_str(), size, path.c_str(), file_size);
+    close(fd);
+    return false;
+  }
+  // The mapping cannot end in the middle of an explicit huge page
+  if (pages == PAGES_HUGETLB && size % page_size != 0) {
+    SCMULATE_ERROR(0, "Region %s has %lu bytes, which is not a multiple of the huge page size (%lu bytes)", name.c_str(), size, page_size);
+    close(fd);
+    return false;
+  }
+  if (size > l2_region.size || offset > l2_region.size - size) {
+    SCMULATE_ERROR(0, "Region %s [%lu, %lu) is outside of the L2 memory", name.c_str(), offset, offset + size);
+    close(fd);
+    return false;
+  }
+  // The mappings take whole pages, so the regions cannot share a page
+  uint64_t mapped_end = ((offset + size + page_size - 1) / page_size) * page_size;
+  for (auto it = file_regions.begin(); it != file_regions.end(); ++it) {
+    uint64_t other_end = ((it->offset + it->size + page_size - 1) / page_size) * page_size;
+    if (offset < other_end && it->offset < mapped_end) {
+      SCMULATE_ERROR(0, "Region %s [%lu, %lu) overlaps region %s [%lu, %lu)", name.c_str(), offset, offset + size, it->name.c_str(), it->offset, it->offset + it->size);
+      close(fd);
+      return false;
+    }
+  }
+  // Output files take the size of the region
+  if (mode == FILE_WRITE_BACK && static_cast<uint64_t>(file_stat.st_size) != size && ftruncate(fd, size) != 0) {
+    SCMULATE_ERROR(0, "Could not resize %s to %lu bytes (errno = %d)", path.c_str(), size, errno);
+    close(fd);
+    return false;
+  }
+
+  int prot = mode == FILE_READ_ONLY ? PROT_READ : PROT_READ | PROT_WRITE;
+  int flags = (mode == FILE_COPY_ON_WRITE ? MAP_PRIVATE : MAP_SHARED) | MAP_FIXED;
+  void * mapping = mmap(l2_region.base + offset, size, prot, flags, fd, 0);
+  // The mapping keeps its own reference to the file
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    SCMULATE_ERROR(0, "mmap of %s into region %s failed (errno = %d)", path.c_str(), name.c_str(), errno);
+    // A failed MAP_FIXED may have unmapped the range already. Anonymous memory is put back
+    // so there is no hole in the L2 memory
+    int restore_flags = l2_region.hugetlb ? MAP_HUGETLB : MAP_NORESERVE;
+    mapping = mmap(l2_region.base + offset, mapped_end - offset, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | restore_flags, -1, 0);
+    if (mapping == MAP_FAILED) {
+      SCMULATE_ERROR(0, "Could not restore the L2 memory [%lu, %lu) (errno = %d)", offset, mapped_end, errno);
+    } else {
+      if (pages != PAGES_DEFAULT && !l2_region.hugetlb)
+        madvise(mapping, mapped_end - offset, MADV_HUGEPAGE);
+      applyPlacement(l2_region.base + offset, mapped_end - offset, placement);
+    }
+    return false;
+  }
+  SCMULATE_INFOMSG(3, "Mapped %s into region %s [%lu, %lu)", path.c_str(), name.c_str(), offset, offset + size);
+  file_regions.push_back({name, path, offset, size, mode});
+  return true;
+}
+
+// Offsets and sizes of the manifest, in decimal or 0x hexadecimal
+static bool parseManifestNumber(std::string const & text, uint64_t & value) {
+  char * end = nullptr;
+  errno = 0;
+  if (text.empty() || text[0] == '-')
+    return false;
+  value = std::strtoull(text.c_str(), &end, 0);
+  return errno == 0 && *end == '\0';
+}
+
+bool
+scm::memory_manager_module::loadManifest(std::string manifestFile) {
+  std::ifstream manifest(manifestFile);
+  if (!manifest.is_open()) {
+    SCMULATE_ERROR(0, "Could not open manifest %s", manifestFile.c_str());
+    return false;
+  }
+  std::string line;
+  int lineNumber = 0;
+  bool success = true;
+  while (std::getline(manifest, line)) {
+    lineNumber++;
+    std::istringstream fields(line);
+    std::string name, offset, size, mode, path;
+    if (!(fields >> name) || name[0] == '#')
+      continue;
+    if (!(fields >> offset >> size >> mode >> path)) {
+      SCMULATE_ERROR(0, "Malformed manifest line %d: %s", lineNumber, line.c_str());
+      success = false;
+      continue;
+    }
+    mem_file_mode fileMode;
+    if (mode == "ro")
+      fileMode = FILE_READ_ONLY;
+    else if (mode == "cow")
+      fileMode = FILE_COPY_ON_WRITE;
+    else if (mode == "rw")
+      fileMode = FILE_WRITE_BACK;
+    else {
+      SCMULATE_ERROR(0, "Unknown mode %s in manifest line %d", mode.c_str(), lineNumber);
+      success = false;
+      continue;
+    }
+    // base 0 accepts both decimal and 0x values
+    uint64_t offsetValue, sizeValue;
+    if (!parseManifestNumber(offset, offsetValue) || !parseManifestNumber(size, sizeValue)) {
+      SCMULATE_ERROR(0, "Invalid offset %s or size %s in manifest line %d", offset.c_str(), size.c_str(), lineNumber);
+      success = false;
+      continue;
+    }
+    if (!mapFile(name, path, offsetValue, sizeValue, fileMode)) {
+      SCMULATE_ERROR(0, "Could not map region %s of manifest line %d", name.c_str(), lineNumber);
+      success = false;
+    }
+  }
+  return success;
+}
+
+void
+scm::memory_manager_module::dumpManifest(std::ostream & out) {
+  const char * modeNames[] = {"ro", "cow", "rw"};
+  out << "# name offset size mode path" << std::endl;
+  for (auto it = file_regions.begin(); it != file_regions.end(); ++it)
+    out << it->name << " 0x" << std::hex << it->offset << " 0x" << it->size << std::dec << " " << modeNames[it->mode] << " " << it->path << std::endl;
+}
+
+const scm::file_region_t *
+scm::memory_manager_module::getFileRegion(std::string name) {
+  for (auto it = file_regions.begin(); it != file_regions.end(); ++it)
+    if (it->name == name)
+      return &(*it);
+  return nullptr;
+}
+
+bool
+scm::memory_manager_module::syncFiles() {
+  bool success = true;
+  for (auto it = file_regions.begin(); it != file_regions.end(); ++it) {
+    if (it->mode != FILE_WRITE_BACK)
+      continue;
+    if (msync(l2_region.base + it->offset, it->size, MS_SYNC) != 0) {
+      SCMULATE_ERROR(0, "msync of region %s failed (errno = %d)", it->name.c_str(), errno);
+      success = false;
+    }
+  }
+  return success;
+}
+
+bool
+scm::memory_manager_module::parsePlacement(std::string name, mem_placement_policy & policy, int & node) {
+  if (name == "default") {
+    policy = PLACE_DEFAULT;
+  } else if (name == "interleave") {
+    policy = PLACE_INTERLEAVE;
+  } else if (name == "firsttouch") {
+    policy = PLACE_FIRST_TOUCH;
+  } else if (name.compare(0, 5, "bind:") == 0 && name.size() > 5) {
+    const char * value = name.c_str() + 5;
+    char * end = nullptr;
+    errno = 0;
+    long bindNode = std::strtol(value, &end, 10);
+    if (errno != 0 || *end != '\0' || bindNode < 0 || bindNode > INT32_MAX) {
+      SCMULATE_ERROR(0, "Invalid NUMA node '%s' in the placement %s", value, name.c_str());
+      return false;
+    }
+    policy = PLACE_BIND_NODE;
+    node = bindNode;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool
+scm::memory_manager_module::parsePageMode(std::string name, mem_page_mode & mode) {
+  if (name == "default")
+    mode = PAGES_DEFAULT;
+  else if (name == "thp")
+    mode = PAGES_THP;
+  else if (name == "hugetlb")
+    mode = PAGES_HUGETLB;
+  else
+    return false;
+  return true;
+}
+
+scm::memory_manager_module::~memory_manager_module() {
+  syncFiles();
+  for (auto it = regions.begin(); it != regions.end(); ++it)
+    munmap(it->mapping, it->mapping_size);
+  if (l2_region.base != nullptr)
+    munmap(l2_region.mapping, l2_region.mapping_size);
+}
@@ -0,0 +1,206 @@
+#ifdef PERF_COUNT
+#include "perf_counters.hpp"
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace {
+  struct named_event_t {
+    const char * name;
+    uint32_t type;
+    uint64_t config;
+  };
+
+  #define CACHE_EVENT(cache, op, result) ((cache) | (PERF_COUNT_HW_CACHE_OP_ ## op << 8) | (PERF_COUNT_HW_CACHE_RESULT_ ## result << 16))
+
+  // Same names than perf list
+  const named_event_t namedEvents[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch-instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"bus-cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BUS_CYCLES},
+    {"stalled-cycles-frontend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+    {"stalled-cycles-backend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+    {"ref-cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES},
+    {"L1-dcache-loads", PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, READ, ACCESS)},
+    {"L1-dcache-load-misses", PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, READ, MISS)},
+    {"LLC-loads", PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_LL, READ, ACCESS)},
+    {"LLC-load-misses", PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_LL, READ, MISS)},
+    {"LLC-stores", PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_LL, WRITE, ACCESS)},
+    {"LLC-store-misses", PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_LL, WRITE, MISS)},
+    {"dTLB-load-misses", PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, READ, MISS)},
+    {"task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES}
+  };
+
+  void initAttr(perf_event_attr & attr, uint32_t type, uint64_t config) {
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  }
+
+  // Counts the calling thread in any CPU
+  int perfEventOpen(perf_event_attr & attr, int group_fd) {
+    return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+  }
+}
+
+bool
+scm::perf_counters_t::initLibrary() {
+  perf_event_attr attr;
+  initAttr(attr, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+  int fd = perfEventOpen(attr, -1);
+  if (fd < 0) {
+    SCMULATE_ERROR(0, "perf_event_open is not allowed (errno %d). Check /proc/sys/kernel/perf_event_paranoid", errno);
+    return false;
+  }
+  close(fd);
+  return true;
+}
+
+bool
+scm::perf_counters_t::findEvent(std::string const & name, event_t & event) {
+  for (const named_event_t & named : namedEvents) {
+    if (name == named.name) {
+      event.type = named.type;
+      event.config = named.config;
+      return true;
+    }
+  }
+  // Raw event of the processor, as in perf: r followed by the hexadecimal event and umask
+  if (name.size() > 1 && name[0] == 'r') {
+    char * end;
+    uint64_t config = std::strtoull(name.c_str() + 1, &end, 16);
+    if (*end == '\0') {
+      event.type = PERF_TYPE_RAW;
+      event.config = config;
+      return true;
+    }
+  }
+  return false;
+}
+
+scm::perf_counters_t::perf_counters_t(std::vector<event_t> &events, std::vector<std::string> &eventNames, bool multiplex) :
+  numEvents(events.size()), events(events), eventNames(eventNames), useRdpmc(false), scaled(multiplex), unscheduled(false), startValues(), values() {
+  openCounters(multiplex);
+}
+
+void
+scm::perf_counters_t::openCounters(bool multiplex) {
+  int leader = -1;
+  long pageSize = sysconf(_SC_PAGESIZE);
+  this->scaled = multiplex;
+  for (int i = 0; i < numEvents; i++) {
+    perf_event_attr attr;
+    initAttr(attr, this->events[i].type, this->events[i].config);
+    // A group is scheduled at once. Multiplexed events are scheduled one by one
+    int fd = perfEventOpen(attr, multiplex ? -1 : leader);
+    if (fd < 0) {
+      SCMULATE_ERROR(0, "perf_event_open could not open %s (errno %d). It is not counted", this->eventNames[i].c_str(), errno);
+      continue;
+    }
+    if (leader == -1 && !multiplex)
+      leader = fd;
+    void * page = mmap(nullptr, pageSize, PROT_READ, MAP_SHARED, fd, 0);
+    this->counters.push_back(counter_t{fd, page == MAP_FAILED ? nullptr : static_cast<perf_event_mmap_page *>(page)});
+    this->counterIndex.push_back(i);
+  }
+  this->useRdpmc = false;
+#if defined(__x86_64__) || defined(__i386__)
+  // Multiplexed counters are scaled with the times given by read()
+  this->useRdpmc = !multiplex && !this->counters.empty();
+  for (counter_t & counter : this->counters)
+    if (counter.page == nullptr || !counter.page->cap_user_rdpmc)
+      this->useRdpmc = false;
+#endif
+  SCMULATE_INFOMSG(3, "perf_event: %lu of %d counters opened (%s)", this->counters.size(), numEvents, this->useRdpmc ? "rdpmc" : "read");
+}
+
+void
+scm::perf_counters_t::closeCounters() {
+  long pageSize = sysconf(_SC_PAGESIZE);
+  for (counter_t & counter : this->counters) {
+    if (counter.page != nullptr)
+      munmap(counter.page, pageSize);
+    close(counter.fd);
+  }
+  this->counters.clear();
+  this->counterIndex.clear();
+}
+
+long long
+scm::perf_counters_t::readCounter(counter_t & counter) {
+#if defined(__x86_64__) || defined(__i386__)
+  if (this->useRdpmc) {
+    // Protocol of perf_event_mmap_page. The kernel changes lock when the event is rescheduled
+    perf_event_mmap_page * page = counter.page;
+    uint32_t seq, index;
+    long long count;
+    do {
+      seq = page->lock;
+      asm volatile("" ::: "memory");
+      index = page->index;
+      count = page->offset;
+      if (page->cap_user_rdpmc && index != 0) {
+        uint16_t width = page->pmc_width;
+        int64_t pmc = __rdpmc(index - 1);
+        pmc <<= 64 - width;
+        pmc >>= 64 - width;
+        count += pmc;
+      }
+      asm volatile("" ::: "memory");
+    } while (page->lock != seq);
+    // Events that are not in a hardware counter (e.g. software events) are read with read()
+    if (index != 0)
+      return count;
+  }
+#endif
+  uint64_t data[3]; // value, time enabled, time running
+  if (read(counter.fd, data, sizeof(data)) != sizeof(data))
+    return 0;
+  // Enabled but never running: the group does not fit in the counters of the PMU
+  if (data[1] != 0 && data[2] == 0)
+    this->unscheduled = true;
+  if (this->scaled && data[2] != 0 && data[2] < data[1])
+    return static_cast<long long>(data[0] * (static_cast<double>(data[1]) / data[2]));
+  return data[0];
+}
+
+void
+scm::perf_counters_t::startCounting() {
+  for (size_t i = 0; i < this->counters.size(); i++)
+    this->startValues[this->counterIndex[i]] = readCounter(this->counters[i]);
+}
+
+void
+scm::perf_counters_t::stopCounting() {
+  for (size_t i = 0; i < this->counters.size(); i++)
+    this->values[this->counterIndex[i]] = readCounter(this->counters[i]) - this->startValues[this->counterIndex[i]];
+  if (this->unscheduled && !this->scaled) {
+    // The values of this interval are lost. The next ones are multiplexed
+    SCMULATE_WARNING(0, "The %d hardware counters do not fit in the PMU at once. Multiplexing them", numEvents);
+    closeCounters();
+    openCounters(true);
+  }
+  this->unscheduled = false;
+}
+
+scm::perf_counters_t::~perf_counters_t() {
+  closeCounters();
+}
+#endif
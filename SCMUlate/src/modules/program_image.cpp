@@ -0,0 +1,358 @@
+#include "program_image.hpp"
+#include "instruction_mem.hpp"
+#include "instructions.hpp"
+#include "program_preprocessor.hpp"
+#include <fstream>
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// FNV-1a
+static inline uint64_t
+hashBytes(uint64_t hash, const void * data, size_t size) {
+  const unsigned char * bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+static inline uint64_t
+hashInstDef(uint64_t hash, const scm::inst_def_t & def, scm::instType type) {
+  uint32_t fields[4] = {def.opcode, static_cast<uint32_t>(def.num_op), static_cast<uint32_t>(def.op_in_out), static_cast<uint32_t>(type)};
+  hash = hashBytes(hash, def.inst_name.c_str(), def.inst_name.size() + 1);
+  hash = hashBytes(hash, fields, sizeof(fields));
+  for (int i = 0; i < MAX_NUM_OPERANDS; i++) {
+    uint8_t kind = def.op_kinds[i];
+    hash = hashBytes(hash, &kind, 1);
+  }
+  return hash;
+}
+
+uint64_t
+scm::program_image::isaChecksum() {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  hash = hashInstDef(hash, COMMIT_INST, COMMIT);
+  hash = hashInstDef(hash, LABEL_INST, UNKNOWN);
+  hash = hashInstDef(hash, CODELET_INST, EXECUTE_INST);
+  for (size_t i = 0; i < NUM_OF_INST(controlInsts); i++)
+    hash = hashInstDef(hash, controlInsts[i], CONTROL_INST);
+  for (size_t i = 0; i < NUM_OF_INST(basicArithInsts); i++)
+    hash = hashInstDef(hash, basicArithInsts[i], BASIC_ARITH_INST);
+  for (size_t i = 0; i < NUM_OF_INST(memInsts); i++)
+    hash = hashInstDef(hash, memInsts[i], MEMORY_INST);
+  return hash;
+}
+
+uint64_t
+scm::program_image::stringsChecksum(const char * const * strings, uint32_t count) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (uint32_t i = 0; i < count; i++)
+    hash = hashBytes(hash, strings[i], std::strlen(strings[i]) + 1);
+  return hash;
+}
+
+bool
+scm::program_image::isImage(const char * filename) {
+  char magic[PROGRAM_IMAGE_MAGIC_SIZE];
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.read(magic, PROGRAM_IMAGE_MAGIC_SIZE))
+    return false;
+  return std::memcmp(magic, PROGRAM_IMAGE_MAGIC, PROGRAM_IMAGE_MAGIC_SIZE) == 0;
+}
+
+namespace {
+  /** \brief strings of the image. Repeated strings are stored once */
+  class image_strings {
+    private:
+      std::string blob;
+      std::unordered_map<std::string, uint32_t> ids;
+    public:
+      image_strings() : blob(1, '\0') { ids[""] = 0; }
+      uint32_t get(std::string const & str) {
+        auto found = ids.find(str);
+        if (found != ids.end())
+          return found->second;
+        uint32_t id = blob.size();
+        blob.append(str.c_str(), str.size() + 1);
+        ids[str] = id;
+        return id;
+      }
+      const std::string & data() { return blob; }
+  };
+}
+
+bool
+scm::program_image::assemble(const char * programFile, const char * imageFile, std::string & error) {
+  std::ifstream input(programFile);
+  error.clear();
+  if (!input.is_open()) {
+    error = std::string("could not open ") + programFile;
+    return false;
+  }
+
+  program_preprocessor preprocessor;
+  std::vector<source_line_t> source;
+  if (!preprocessor.expand(input, source)) {
+    error = std::string(programFile) + ":" + preprocessor.getError();
+    return false;
+  }
+
+  // Parse the whole program first, labels may be used before they are defined
+  std::vector<decoded_instruction_t *> program;
+  std::vector<std::pair<std::string, uint32_t>> labels;
+  std::unordered_map<std::string, uint32_t> labelPCs;
+  for (auto it = source.begin(); it != source.end() && error.empty(); ++it) {
+    std::string const & line = it->text;
+    unsigned int lineNumber = it->line;
+    decoded_instruction_t * newInst = nullptr;
+    std::string label, lineError;
+    switch (instructions::parseLine(line, &newInst, label, lineError)) {
+      case instructions::LABEL_LINE:
+        labels.push_back(std::make_pair(label, program.size()));
+        labelPCs[label] = program.size();
+        break;
+      case instructions::INVALID_LINE:
+        error = std::string(programFile) + ":" + std::to_string(lineNumber) + ": " + lineError + " in '" + line + "'";
+        delete newInst;
+        break;
+      case instructions::INSTRUCTION_LINE:
+        program.push_back(newInst);
+        break;
+      case instructions::EMPTY_LINE:
+      default:
+        break;
+    }
+  }
+
+  image_strings strings;
+  std::vector<image_instruction_t> insts(program.size());
+  std::vector<image_label_t> imgLabels;
+  std::vector<uint32_t> codelets;
+  std::unordered_map<std::string, bool> usedCodelets;
+
+  for (uint32_t pc = 0; pc < program.size() && error.empty(); pc++) {
+    decoded_instruction_t * inst = program[pc];
+    image_instruction_t & rec = insts[pc];
+    std::memset(&rec, 0, sizeof(image_instruction_t));
+    rec.type = inst->getType();
+    rec.opcode = inst->getOpcode();
+    rec.op_in_out = inst->getOpIO();
+    rec.name_id = strings.get(inst->getInstruction());
+    if (inst->getType() == EXECUTE_INST && !usedCodelets[inst->getInstruction()]) {
+      usedCodelets[inst->getInstruction()] = true;
+      codelets.push_back(rec.name_id);
+    }
+    for (uint32_t op_num = 1; op_num <= MAX_NUM_OPERANDS && error.empty(); op_num++) {
+      std::string & opStr = inst->getOpStr(op_num);
+      image_operand_t & op = rec.ops[op_num - 1];
+      if (opStr.size() == 0)
+        continue;
+      rec.num_ops = op_num;
+      op.str_id = strings.get(opStr);
+      // Same classification than decoded_instruction_t::decodeOperands
+      if (instructions::isRegister(opStr)) {
+        decoded_reg_t reg = instructions::decodeRegister(opStr);
+        if (reg_file_module::getRegisterSizeInBytes(reg.reg_size) == 0) {
+          error = "register " + opStr + " of instruction " + std::to_string(pc) + " does not have a valid size";
+          continue;
+        }
+        op.type = operand_t::REGISTER;
+        op.size_id = strings.get(reg.reg_size);
+        op.value = reg.reg_number;
+      } else if (instructions::isLabel(opStr)) {
+        auto found = labelPCs.find(opStr);
+        if (found == labelPCs.end()) {
+          error = "label " + opStr + " used by instruction " + std::to_string(pc) + " is not defined";
+          continue;
+        }
+        op.type = operand_t::LABEL;
+        op.value = found->second;
+      } else {
+        op.type = operand_t::IMMEDIATE_VAL;
+        op.value = std::stoull(opStr);
+      }
+    }
+  }
+  for (auto it = program.begin(); it != program.end(); ++it)
+    delete *it;
+  if (!error.empty())
+    return false;
+
+  for (auto it = labels.begin(); it != labels.end(); ++it)
+    imgLabels.push_back({strings.get(it->first), it->second});
+
+  std::vector<const char *> codeletNames;
+  for (auto it = codelets.begin(); it != codelets.end(); ++it)
+    codeletNames.push_back(strings.data().c_str() + *it);
+
+  image_header_t header;
+  std::memset(&header, 0, sizeof(image_header_t));
+  std::memcpy(header.magic, PROGRAM_IMAGE_MAGIC, PROGRAM_IMAGE_MAGIC_SIZE);
+  header.version = PROGRAM_IMAGE_VERSION;
+  header.max_operands = MAX_NUM_OPERANDS;
+  header.isa_checksum = isaChecksum();
+  header.codelet_checksum = stringsChecksum(codeletNames.data(), codeletNames.size());
+  header.num_instructions = insts.size();
+  header.num_labels = imgLabels.size();
+  header.num_codelets = codelets.size();
+  header.strings_size = strings.data().size();
+  header.instructions_offset = sizeof(image_header_t);
+  header.labels_offset = header.instructions_offset + insts.size() * sizeof(image_instruction_t);
+  header.codelets_offset = header.labels_offset + imgLabels.size() * sizeof(image_label_t);
+  header.strings_offset = header.codelets_offset + codelets.size() * sizeof(uint32_t);
+
+  std::ofstream output(imageFile, std::ios::binary | std::ios::trunc);
+  if (!output.is_open()) {
+    error = std::string("could not create ") + imageFile;
+    return false;
+  }
+  output.write(reinterpret_cast<const char *>(&header), sizeof(image_header_t));
+  output.write(reinterpret_cast<const char *>(insts.data()), insts.size() * sizeof(image_instruction_t));
+  output.write(reinterpret_cast<const char *>(imgLabels.data()), imgLabels.size() * sizeof(image_label_t));
+  output.write(reinterpret_cast<const char *>(codelets.data()), codelets.size() * sizeof(uint32_t));
+  output.write(strings.data().data(), strings.data().size());
+  if (!output) {
+    error = std::string("could not write ") + imageFile;
+    return false;
+  }
+  return true;
+}
+
+/** \brief check that an array of the image is inside the file */
+static inline bool
+inImage(uint64_t offset, uint64_t count, size_t elemSize, size_t fileSize) {
+  return offset <= fileSize && count <= (fileSize - offset) / elemSize;
+}
+
+bool
+scm::inst_mem_module::imageLoader(const char * filename) {
+  SCMULATE_INFOMSG(2, "LOADING PROGRAM IMAGE %s", filename);
+  int fd = open(filename, O_RDONLY);
+  if (fd == -1) {
+    SCMULATE_ERROR(0, "PROGRAM DOES NOT EXIST %s", filename);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(image_header_t)) {
+    SCMULATE_ERROR(0, "PROGRAM IMAGE %s IS TRUNCATED", filename);
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  void * map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    SCMULATE_ERROR(0, "COULD NOT MAP PROGRAM IMAGE %s", filename);
+    return false;
+  }
+  const char * base = static_cast<const char *>(map);
+  const image_header_t * header = reinterpret_cast<const image_header_t *>(base);
+
+  bool valid = true;
+  if (std::memcmp(header->magic, PROGRAM_IMAGE_MAGIC, PROGRAM_IMAGE_MAGIC_SIZE) != 0 || header->version != PROGRAM_IMAGE_VERSION) {
+    SCMULATE_ERROR(0, "%s IS NOT A PROGRAM IMAGE OF VERSION %d", filename, PROGRAM_IMAGE_VERSION);
+    valid = false;
+  } else if (header->max_operands != MAX_NUM_OPERANDS || header->isa_checksum != program_image::isaChecksum()) {
+    SCMULATE_ERROR(0, "PROGRAM IMAGE %s WAS ASSEMBLED FOR A DIFFERENT INSTRUCTION SET. ASSEMBLE IT AGAIN", filename);
+    valid = false;
+  } else if (!inImage(header->instructions_offset, header->num_instructions, sizeof(image_instruction_t), size) ||
+             !inImage(header->labels_offset, header->num_labels, sizeof(image_label_t), size) ||
+             !inImage(header->codelets_offset, header->num_codelets, sizeof(uint32_t), size) ||
+             !inImage(header->strings_offset, header->strings_size, 1, size) ||
+             header->strings_size == 0 || base[header->strings_offset + header->strings_size - 1] != '\0') {
+    SCMULATE_ERROR(0, "PROGRAM IMAGE %s IS CORRUPTED", filename);
+    valid = false;
+  }
+
+  const char * strings = base + header->strings_offset;
+  auto str = [&] (uint32_t id) -> const char * {
+    if (id >= header->strings_size) {
+      valid = false;
+      return "";
+    }
+    return strings + id;
+  };
+
+  // The codelets must be registered in this simulator
+  if (valid) {
+    const uint32_t * codelets = reinterpret_cast<const uint32_t *>(base + header->codelets_offset);
+    std::vector<const char *> codeletNames;
+    for (uint32_t i = 0; i < header->num_codelets; i++)
+      codeletNames.push_back(str(codelets[i]));
+    if (!valid || program_image::stringsChecksum(codeletNames.data(), codeletNames.size()) != header->codelet_checksum) {
+      SCMULATE_ERROR(0, "PROGRAM IMAGE %s HAS A CORRUPTED CODELET TABLE", filename);
+      valid = false;
+    }
+    for (auto it = codeletNames.begin(); it != codeletNames.end() && valid; ++it) {
+      if (codeletFactory::registeredCodelets == nullptr || codeletFactory::registeredCodelets->count(*it) == 0) {
+        SCMULATE_ERROR(0, "PROGRAM IMAGE %s USES CODELET %s THAT IS NOT REGISTERED", filename, *it);
+        valid = false;
+      }
+    }
+  }
+
+  if (valid) {
+    const image_label_t * imgLabels = reinterpret_cast<const image_label_t *>(base + header->labels_offset);
+    for (uint32_t i = 0; i < header->num_labels && valid; i++) {
+      // A jump outside of the program would make the SU fetch out of bounds
+      if (imgLabels[i].pc >= header->num_instructions) {
+        SCMULATE_ERROR(0, "LABEL %s AT PC %u IS OUTSIDE OF THE PROGRAM", str(imgLabels[i].name_id), imgLabels[i].pc);
+        valid = false;
+        break;
+      }
+      labels[str(imgLabels[i].name_id)] = imgLabels[i].pc;
+    }
+
+    const image_instruction_t * insts = reinterpret_cast<const image_instruction_t *>(base + header->instructions_offset);
+    memory.reserve(header->num_instructions);
+    for (uint32_t pc = 0; pc < header->num_instructions && valid; pc++) {
+      const image_instruction_t & rec = insts[pc];
+      if (rec.type > MEMORY_INST) {
+        valid = false;
+        break;
+      }
+      decoded_instruction_t * inst = new decoded_instruction_t(static_cast<instType>(rec.type), rec.opcode, str(rec.name_id));
+      inst->setOpIO(rec.op_in_out);
+      memory.push_back(inst);
+      for (uint32_t op_num = 1; op_num <= rec.num_ops && op_num <= MAX_NUM_OPERANDS; op_num++) {
+        const image_operand_t & imgOp = rec.ops[op_num - 1];
+        operand_t & op = inst->getOp(op_num);
+        std::string & opStr = inst->getOpStr(op_num);
+        opStr = str(imgOp.str_id);
+        if (imgOp.type == operand_t::REGISTER) {
+          std::string size = str(imgOp.size_id);
+          op.type = operand_t::REGISTER;
+          op.value.reg = decoded_reg_t(opStr, size, reg_file_m->getRegisterSizeInBytes(size), imgOp.value, nullptr);
+          op.value.reg.reg_ptr = reg_file_m->getRegisterByName(size, imgOp.value);
+          if (op.value.reg.reg_ptr == nullptr) {
+            SCMULATE_ERROR(0, "REGISTER %s OF INSTRUCTION %u DOES NOT EXIST IN THIS REGISTER FILE", opStr.c_str(), pc);
+            valid = false;
+          }
+        } else if (imgOp.type == operand_t::LABEL && imgOp.value >= header->num_instructions) {
+          SCMULATE_ERROR(0, "LABEL %s OF INSTRUCTION %u IS OUTSIDE OF THE PROGRAM", opStr.c_str(), pc);
+          valid = false;
+        } else if (imgOp.type == operand_t::LABEL || imgOp.type == operand_t::IMMEDIATE_VAL) {
+          op.type = imgOp.type == operand_t::LABEL ? operand_t::LABEL : operand_t::IMMEDIATE_VAL;
+          op.value.immediate = imgOp.value;
+        }
+        op.read = OP_IO::getOpRDIO(op_num) & rec.op_in_out;
+        op.write = OP_IO::getOpWRIO(op_num) & rec.op_in_out;
+      }
+      // Only the codelet objects and the operand directions are left
+      if (valid && !inst->decodeOperands(this)) {
+        SCMULATE_ERROR(0, "PROBLEM DECODING OPERANDS OF INSTRUCTION %u IN %s", pc, filename);
+        valid = false;
+      }
+    }
+    if (!valid)
+      SCMULATE_ERROR(0, "PROGRAM IMAGE %s IS CORRUPTED", filename);
+  }
+  munmap(map, size);
+  return valid;
+}
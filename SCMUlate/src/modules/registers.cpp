@@ -1,56 +1,161 @@
 #include "register.hpp"
 #include <sstream>
+#include <fstream>
 #include <iomanip>
 
-scm::reg_file_module::reg_file_module() {
+scm::reg_file_module::reg_file_module(memory_manager_module * const mem_manager, const char * configFile):
+  reg_file(nullptr),
+  reg_file_size(0),
+  budget(REG_FILE_SIZE_KB*1000l),
+  mem_manager(mem_manager),
+  valid_config(true) {
   SCMULATE_INFOMSG(3, "Initializing Register file");
-  reg_file = new register_file_t();
-  // Initialize the memory that represents the register
-  // file to zero
-  for (int i = 0; i < REG_FILE_SIZE_KB*1000 ; ++ i) {
-    reg_file->space[i] = 0;
+  if (configFile != nullptr) {
+    std::ifstream config(configFile);
+    if (!config.is_open()) {
+      SCMULATE_ERROR(0, "Could not open register configuration %s", configFile);
+      valid_config = false;
+    } else {
+      valid_config = parseRegisterConfig(config, reg_classes, budget);
+    }
+  } else {
+    std::istringstream config(DEFAULT_REGISTER_CONFIG);
+    valid_config = parseRegisterConfig(config, reg_classes, budget);
   }
+  this->buildRegisterFile();
   this->describeRegisterFile();
   this->checkRegisterConfig();
 }
 
-void 
+scm::reg_file_module::reg_file_module(memory_manager_module * const mem_manager, const std::vector<reg_class_t> & classes):
+  reg_file(nullptr),
+  reg_file_size(0),
+  budget(REG_FILE_SIZE_KB*1000l),
+  mem_manager(mem_manager),
+  reg_classes(classes),
+  valid_config(true) {
+  SCMULATE_INFOMSG(3, "Initializing Register file from existing classes");
+  this->buildRegisterFile();
+}
+
+bool
+scm::reg_file_module::parseRegisterConfig(std::istream & config, std::vector<reg_class_t> & classes, uint64_t & budget) {
+  std::string line;
+  int lineNumber = 0;
+  bool success = true;
+  while (std::getline(config, line)) {
+    lineNumber++;
+    std::istringstream fields(line);
+    std::string size;
+    uint64_t count;
+    if (!(fields >> size) || size[0] == '#')
+      continue;
+    if (!(fields >> count)) {
+      SCMULATE_ERROR(0, "Malformed register configuration line %d: %s", lineNumber, line.c_str());
+      success = false;
+      continue;
+    }
+    if (size == "budget_kb") {
+      budget = count*1000l;
+      continue;
+    }
+    reg_class_t newClass;
+    newClass.name = size;
+    newClass.size_bytes = getRegisterSizeInBytes(size);
+    newClass.num_regs = count;
+    if (newClass.size_bytes == 0 || newClass.size_bytes/CACHE_LINE_SIZE >= MAX_REG_LINES) {
+      SCMULATE_ERROR(0, "Register size %s in line %d is not valid", size.c_str(), lineNumber);
+      success = false;
+      continue;
+    }
+    bool repeated = false;
+    for (auto it = classes.begin(); it != classes.end(); ++it)
+      repeated |= it->size_bytes == newClass.size_bytes;
+    if (repeated) {
+      SCMULATE_ERROR(0, "Register class %s is defined more than once", size.c_str());
+      success = false;
+      continue;
+    }
+    if (count != 0)
+      classes.push_back(newClass);
+  }
+  if (classes.empty()) {
+    SCMULATE_ERROR(0, "The register configuration does not have any register");
+    success = false;
+  }
+  return success;
+}
+
+void
+scm::reg_file_module::buildRegisterFile() {
+  // Layout of each class
+  uint64_t max_lines = 0;
+  reg_file_size = 0;
+  for (auto it = reg_classes.begin(); it != reg_classes.end(); ++it) {
+    it->stride = ((it->size_bytes + REG_ALIGNMENT - 1) / REG_ALIGNMENT) * REG_ALIGNMENT;
+    it->offset = ((reg_file_size + REG_CLASS_ALIGNMENT - 1) / REG_CLASS_ALIGNMENT) * REG_CLASS_ALIGNMENT;
+    reg_file_size = it->offset + it->stride * it->num_regs;
+    if (sizeToLines(it->size_bytes) > max_lines)
+      max_lines = sizeToLines(it->size_bytes);
+  }
+  reg_file_size = ((reg_file_size + REG_CLASS_ALIGNMENT - 1) / REG_CLASS_ALIGNMENT) * REG_CLASS_ALIGNMENT;
+
+  class_table.assign(max_lines + 1, -1);
+  class_names.clear();
+  for (uint32_t i = 0; i < reg_classes.size(); i++) {
+    uint32_t lines = sizeToLines(reg_classes[i].size_bytes);
+    class_table[lines] = i;
+    class_names[lines == 0 ? std::string("64B") : std::to_string(lines) + "L"] = i;
+  }
+
+  // The memory that represents the register file must be zero. Pages coming from the
+  // memory manager are already zero, and value initialization zeroes the heap version.
+  if (mem_manager != nullptr) {
+    reg_file = mem_manager->allocateRegion(reg_file_size);
+    if (reg_file == nullptr) {
+      SCMULATE_WARNING(0, "Memory manager could not allocate the register file. Using the heap");
+      this->mem_manager = nullptr;
+    }
+  }
+  if (this->mem_manager == nullptr)
+    reg_file = new unsigned char[reg_file_size]();
+}
+
+void
 scm::reg_file_module::describeRegisterFile() {
   SCMULATE_INFOMSG(0, "REGISTER FILE DEFINITION");
-  SCMULATE_INFOMSG(0, " SIZE = %ld", CALCULATE_REG_SIZE);
-  SCMULATE_INFOMSG(1, " %ld registers of 64BITS, each of %d bytes. Total size = %ld  -- %f percent ", NUM_REG_64BITS, 64/8, NUM_REG_64BITS*64/8, (NUM_REG_64BITS*64/8)*100.0f/CALCULATE_REG_SIZE);
-  SCMULATE_INFOMSG(1, " %ld registers of 1LINE each of %ld bytes. Total size = %ld  -- %f percent", NUM_REG_1LINE, CACHE_LINE_SIZE, NUM_REG_1LINE*CACHE_LINE_SIZE, NUM_REG_1LINE*CACHE_LINE_SIZE*100.0f/CALCULATE_REG_SIZE);
-  SCMULATE_INFOMSG(1, " %ld registers of 8LINE each of %ld bytes. Total size = %ld  -- %f percent", NUM_REG_8LINE, CACHE_LINE_SIZE*8, NUM_REG_8LINE*8*CACHE_LINE_SIZE, NUM_REG_8LINE*8*CACHE_LINE_SIZE*100.0f/CALCULATE_REG_SIZE);
-  SCMULATE_INFOMSG(1, " %ld registers of 16LINE each of %ld bytes. Total size = %ld  -- %f percent", NUM_REG_16LINE, CACHE_LINE_SIZE*16, NUM_REG_16LINE*16*CACHE_LINE_SIZE, NUM_REG_16LINE*16*CACHE_LINE_SIZE*100.0f/CALCULATE_REG_SIZE);
-  SCMULATE_INFOMSG(1, " %ld registers of 256LINE each of %ld bytes. Total size = %ld  -- %f percent", NUM_REG_256LINE, CACHE_LINE_SIZE*256, NUM_REG_256LINE*256*CACHE_LINE_SIZE, NUM_REG_256LINE*256*CACHE_LINE_SIZE*100.0f/CALCULATE_REG_SIZE);
-  SCMULATE_INFOMSG(1, " %ld registers of 512LINE each of %ld bytes. Total size = %ld  -- %f percent", NUM_REG_512LINE, CACHE_LINE_SIZE*512, NUM_REG_512LINE*512*CACHE_LINE_SIZE, NUM_REG_512LINE*512*CACHE_LINE_SIZE*100.0f/CALCULATE_REG_SIZE);
-  SCMULATE_INFOMSG(1, " %ld registers of 1024LINE each of %ld bytes. Total size = %ld  -- %f percent", NUM_REG_1024LINE, CACHE_LINE_SIZE*1024, NUM_REG_1024LINE*1024*CACHE_LINE_SIZE, NUM_REG_1024LINE*1024*CACHE_LINE_SIZE*100.0f/CALCULATE_REG_SIZE);
-  SCMULATE_INFOMSG(1, " %ld registers of 2048LINE each of %ld bytes. Total size = %ld  -- %f percent", NUM_REG_2048LINE, CACHE_LINE_SIZE*2048, NUM_REG_2048LINE*2048*CACHE_LINE_SIZE, NUM_REG_2048LINE*2048*CACHE_LINE_SIZE*100.0f/CALCULATE_REG_SIZE);
-
+  SCMULATE_INFOMSG(0, " SIZE = %ld", reg_file_size);
+  for (auto it = reg_classes.begin(); it != reg_classes.end(); ++it) {
+    SCMULATE_INFOMSG(1, " %u registers of %s each of %u bytes. Total size = %lu  -- %f percent ", it->num_regs, it->name.c_str(), it->size_bytes, it->stride*it->num_regs, (it->stride*it->num_regs)*100.0f/reg_file_size);
+  }
 }
 
 
 bool
 scm::reg_file_module::checkRegisterConfig() {
-  if (CALCULATE_REG_SIZE > REG_FILE_SIZE_KB*1000) {
-    // This is an error, because it could cause seg fault
-    SCMULATE_ERROR(0, "DEFINED REGISTER IS LARGER THAN DEFINED REG_FILE_SIZE_KB");
-    SCMULATE_ERROR(0, "REG_FILE_SIZE_KB = %ld", REG_FILE_SIZE_KB*1000l);
-    SCMULATE_ERROR(0, "CALCULATE_REG_SIZE = %ld", CALCULATE_REG_SIZE);
-    SCMULATE_ERROR(0, "EXCESS = %ld", CALCULATE_REG_SIZE - REG_FILE_SIZE_KB*1000l);
+  if (!valid_config) {
+    SCMULATE_ERROR(0, "THE REGISTER CONFIGURATION IS NOT VALID");
     return 0;
-  } else if (CALCULATE_REG_SIZE < REG_FILE_SIZE_KB*1000) {
+  }
+  if (reg_file_size > budget) {
+    // The register file is allocated to fit the configuration. This only means
+    // that the register file will not fit in the cache
+    SCMULATE_WARNING(0, "DEFINED REGISTER IS LARGER THAN THE REGISTER FILE BUDGET");
+    SCMULATE_WARNING(0, "BUDGET = %ld", budget);
+    SCMULATE_WARNING(0, "CALCULATE_REG_SIZE = %ld", reg_file_size);
+    SCMULATE_WARNING(0, "EXCESS = %ld", reg_file_size - budget);
+  } else if (reg_file_size < budget) {
     // This is just a warning, you are not using the whole register file
-    SCMULATE_WARNING(0, "DEFINED REGISTER IS SMALLER THAN DEFINED REG_FILE_SIZE_KB");
-    SCMULATE_WARNING(0, "REG_FILE_SIZE_KB = %ld", REG_FILE_SIZE_KB*1000l);
-    SCMULATE_WARNING(0, "CALCULATE_REG_SIZE = %ld", CALCULATE_REG_SIZE);
-    SCMULATE_WARNING(0, "REMAINING = %ld", (REG_FILE_SIZE_KB*1000l) - CALCULATE_REG_SIZE);
+    SCMULATE_WARNING(0, "DEFINED REGISTER IS SMALLER THAN THE REGISTER FILE BUDGET");
+    SCMULATE_WARNING(0, "BUDGET = %ld", budget);
+    SCMULATE_WARNING(0, "CALCULATE_REG_SIZE = %ld", reg_file_size);
+    SCMULATE_WARNING(0, "REMAINING = %ld", budget - reg_file_size);
   }
 
   return 1;
 }
 
-void 
+void
 scm::reg_file_module::dumpRegister(std::string size, int num) {
   int len_in_bytes = getRegisterSizeInBytes(size);
   std::cout << "reg_" << size <<"_"<< num <<" = 0x" ;
@@ -61,7 +166,8 @@ scm::reg_file_module::dumpRegister(std::string size, int num) {
 }
 
 scm::reg_file_module::~reg_file_module() {
-  delete reg_file;
+  if (mem_manager != nullptr)
+    mem_manager->releaseRegion(reg_file);
+  else
+    delete [] reg_file;
 }
-
-
@@ -0,0 +1,239 @@
+#include "roofline.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+  volatile double sink;
+
+  // Bytes per ns (GB/s) of c = a + s * b over arrays larger than the caches
+  double measureBandwidth() {
+    const size_t n = ROOFLINE_STREAM_ELEMENTS;
+    std::vector<double> a(n, 1.0), b(n, 2.0), c(n, 0.0);
+    double best = 0;
+    for (int rep = 0; rep < ROOFLINE_PEAK_REPS; rep++) {
+      uint64_t start = scm::roofline_module::now();
+      for (size_t i = 0; i < n; i++)
+        c[i] = a[i] + 3.0 * b[i];
+      uint64_t ns = scm::roofline_module::now() - start;
+      if (ns > 0)
+        best = std::max(best, 3.0 * n * sizeof(double) / ns);
+    }
+    sink = c[n / 2];
+    return best;
+  }
+
+  // Flops per ns (GFLOP/s) of independent multiply-adds that fit in the registers.
+  // The clones use the vector units of the processor that runs the machine
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(__INTEL_COMPILER)
+  __attribute__((target_clones("arch=skylake-avx512", "arch=haswell", "default")))
+#endif
+  double measureFlops() {
+    const int chains = 64;
+    const uint64_t iterations = ROOFLINE_FLOP_ITERATIONS;
+    double acc[chains];
+    for (int k = 0; k < chains; k++)
+      acc[k] = k;
+    double best = 0;
+    for (int rep = 0; rep < ROOFLINE_PEAK_REPS; rep++) {
+      uint64_t start = scm::roofline_module::now();
+      for (uint64_t it = 0; it < iterations; it++)
+        for (int k = 0; k < chains; k++)
+          acc[k] = acc[k] * 0.999999 + 0.000001;
+      uint64_t ns = scm::roofline_module::now() - start;
+      if (ns > 0)
+        best = std::max(best, 2.0 * chains * iterations / ns);
+    }
+    double sum = 0;
+    for (int k = 0; k < chains; k++)
+      sum += acc[k];
+    sink = sum;
+    return best;
+  }
+}
+
+void
+scm::roofline_module::codelet_account_t::add(codelet_account_t const & other) {
+  this->calls += other.calls;
+  this->ns += other.ns;
+  this->bytes_read += other.bytes_read;
+  this->bytes_written += other.bytes_written;
+  this->flops += other.flops;
+}
+
+scm::roofline_module::roofline_module(uint32_t numCUs) :
+  cus(numCUs), enabled(false), peakGFlops(0), peakGBs(0), peaksMeasured(false) { }
+
+void
+scm::roofline_module::enable(std::string output) {
+  this->enabled = true;
+  this->outputName = output;
+  // The codelets are registered before main
+  for (cu_accounts_t & cu : this->cus)
+    cu.codelets.resize(codeletFactory::registeredTypes == nullptr ? 0 : codeletFactory::registeredTypes->size());
+}
+
+void
+scm::roofline_module::setPeaks(double gflops, double gbs) {
+  this->peakGFlops = gflops;
+  this->peakGBs = gbs;
+  this->peaksMeasured = false;
+}
+
+bool
+scm::roofline_module::parsePeaks(std::string const & peaks, double & gflops, double & gbs) {
+  size_t comma = peaks.find(',');
+  if (comma == std::string::npos)
+    return false;
+  char * end;
+  gflops = std::strtod(peaks.c_str(), &end);
+  if (end != peaks.c_str() + comma || gflops <= 0)
+    return false;
+  gbs = std::strtod(peaks.c_str() + comma + 1, &end);
+  return *end == '\0' && gbs > 0;
+}
+
+void
+scm::roofline_module::account(uint32_t cu, decoded_instruction_t * inst, uint64_t ns) {
+  cu_accounts_t & accounts = this->cus[cu];
+  codelet_account_t * account;
+  codelet * cod = inst->getType() == instType::EXECUTE_INST ? inst->getExecCodelet() : nullptr;
+  if (cod != nullptr) {
+    if (cod->getCodeletID() >= accounts.codelets.size())
+      accounts.codelets.resize(cod->getCodeletID() + 1);
+    account = &accounts.codelets[cod->getCodeletID()];
+    account->flops += cod->getFlops();
+  } else {
+    auto found = accounts.memInsts.find(inst->getOpcode());
+    if (found == accounts.memInsts.end()) {
+      accounts.memInstNames[inst->getOpcode()] = inst->getInstruction();
+      found = accounts.memInsts.emplace(inst->getOpcode(), codelet_account_t()).first;
+    }
+    account = &found->second;
+  }
+  account->calls++;
+  account->ns += ns;
+
+  if (inst->isMemoryInstruction()) {
+    memranges_pair * ranges = inst->getMemoryRange();
+    for (auto range = ranges->reads.begin(); range != ranges->reads.end(); ++range)
+      account->bytes_read += range->size;
+    for (auto range = ranges->writes.begin(); range != ranges->writes.end(); ++range)
+      account->bytes_written += range->size;
+  } else {
+    // The codelet works on its registers
+    for (int op_num = 1; op_num <= MAX_NUM_OPERANDS; op_num++) {
+      operand_t & op = inst->getOp(op_num);
+      if (op.type != operand_t::REGISTER)
+        continue;
+      if (inst->getOpIO() & OP_IO::getOpRDIO(op_num))
+        account->bytes_read += op.value.reg.reg_size_bytes;
+      if (inst->getOpIO() & OP_IO::getOpWRIO(op_num))
+        account->bytes_written += op.value.reg.reg_size_bytes;
+    }
+  }
+}
+
+std::vector<std::pair<std::string, scm::roofline_module::codelet_account_t> >
+scm::roofline_module::totals() {
+  std::map<std::string, codelet_account_t> byName;
+  for (cu_accounts_t & cu : this->cus) {
+    for (uint32_t id = 0; id < cu.codelets.size(); id++)
+      if (cu.codelets[id].calls != 0)
+        byName[(*codeletFactory::registeredTypes)[id].name].add(cu.codelets[id]);
+    for (auto & memInst : cu.memInsts)
+      byName[cu.memInstNames[memInst.first]].add(memInst.second);
+  }
+  return std::vector<std::pair<std::string, codelet_account_t> >(byName.begin(), byName.end());
+}
+
+void
+scm::roofline_module::measurePeaks() {
+  if (this->peakGFlops > 0 && this->peakGBs > 0)
+    return;
+  this->peakGBs = measureBandwidth();
+  this->peakGFlops = measureFlops();
+  this->peaksMeasured = true;
+}
+
+void
+scm::roofline_module::report() {
+  if (!this->enabled)
+    return;
+  std::vector<std::pair<std::string, codelet_account_t> > codelets = totals();
+  if (codelets.empty())
+    return;
+  measurePeaks();
+  double ridge = this->peakGFlops / this->peakGBs;
+
+  std::ofstream json;
+  if (!this->outputName.empty()) {
+    json.open(this->outputName);
+    if (!json.is_open())
+      SCMULATE_ERROR(0, "Could not open the roofline output %s", this->outputName.c_str());
+  }
+  json << std::setprecision(6);
+  json << "{\"peaks\": {\"gflops\": " << this->peakGFlops << ", \"gbs\": " << this->peakGBs << ", \"ridge\": " << ridge
+       << ", \"measured\": " << (this->peaksMeasured ? "true" : "false") << "},\n \"codelets\": [";
+
+  std::cout << "ROOFLINE of one CU: " << std::fixed << std::setprecision(2) << this->peakGFlops << " GFLOP/s, " << this->peakGBs << " GB/s"
+            << (this->peaksMeasured ? " (measured)" : "") << ", ridge at " << ridge << " flop/B" << std::endl;
+  std::cout << std::left << std::setw(24) << "Codelet" << std::right << std::setw(10) << "calls" << std::setw(12) << "time (s)"
+            << std::setw(14) << "read (B)" << std::setw(14) << "written (B)" << std::setw(14) << "flops" << std::setw(10) << "flop/B"
+            << std::setw(10) << "GB/s" << std::setw(10) << "GFLOP/s" << std::setw(8) << "% roof" << "  bound" << std::endl;
+  bool first = true;
+  for (auto & codelet : codelets) {
+    codelet_account_t & total = codelet.second;
+    uint64_t bytes = total.bytes_read + total.bytes_written;
+    double gbs = total.ns > 0 ? static_cast<double>(bytes) / total.ns : 0;
+    double gflops = total.ns > 0 ? static_cast<double>(total.flops) / total.ns : 0;
+    double intensity = bytes > 0 ? static_cast<double>(total.flops) / bytes : 0;
+    // Without flops only the bandwidth can be compared
+    double attainable = std::min(this->peakGFlops, intensity * this->peakGBs);
+    double roof = total.flops > 0 ? (attainable > 0 ? gflops / attainable : 0) : gbs / this->peakGBs;
+    const char * bound = total.flops == 0 || intensity < ridge ? "memory" : "compute";
+
+    std::cout << std::left << std::setw(24) << codelet.first << std::right << std::setw(10) << total.calls
+              << std::setw(12) << std::setprecision(6) << total.ns * 1e-9 << std::setw(14) << total.bytes_read << std::setw(14) << total.bytes_written
+              << std::setw(14) << total.flops << std::setprecision(2) << std::setw(10) << intensity << std::setw(10) << gbs
+              << std::setw(10) << gflops << std::setw(8) << roof * 100 << "  " << bound << std::endl;
+    json << (first ? "\n" : ",\n") << "  {\"name\": \"" << codelet.first << "\", \"calls\": " << total.calls << ", \"seconds\": " << total.ns * 1e-9
+         << ", \"bytes_read\": " << total.bytes_read << ", \"bytes_written\": " << total.bytes_written << ", \"flops\": " << total.flops
+         << ", \"intensity\": " << intensity << ", \"gbs\": " << gbs << ", \"gflops\": " << gflops << ", \"roof\": " << roof
+         << ", \"bound\": \"" << bound << "\"}";
+    first = false;
+  }
+
+  // Busy time and work of each CU
+  json << "],\n \"cus\": [";
+  for (uint32_t cu = 0; cu < this->cus.size(); cu++) {
+    codelet_account_t total;
+    json << (cu == 0 ? "\n" : ",\n") << "  {\"cu\": " << cu << ", \"codelets\": {";
+    bool firstCodelet = true;
+    for (uint32_t id = 0; id < this->cus[cu].codelets.size(); id++) {
+      codelet_account_t & account = this->cus[cu].codelets[id];
+      if (account.calls == 0)
+        continue;
+      total.add(account);
+      json << (firstCodelet ? "" : ", ") << "\"" << (*codeletFactory::registeredTypes)[id].name << "\": {\"calls\": " << account.calls
+           << ", \"seconds\": " << account.ns * 1e-9 << ", \"bytes\": " << account.bytes_read + account.bytes_written << ", \"flops\": " << account.flops << "}";
+      firstCodelet = false;
+    }
+    for (auto & memInst : this->cus[cu].memInsts) {
+      total.add(memInst.second);
+      json << (firstCodelet ? "" : ", ") << "\"" << this->cus[cu].memInstNames[memInst.first] << "\": {\"calls\": " << memInst.second.calls
+           << ", \"seconds\": " << memInst.second.ns * 1e-9 << ", \"bytes\": " << memInst.second.bytes_read + memInst.second.bytes_written << ", \"flops\": 0}";
+      firstCodelet = false;
+    }
+    json << "}, \"calls\": " << total.calls << ", \"seconds\": " << total.ns * 1e-9 << ", \"bytes\": " << total.bytes_read + total.bytes_written
+         << ", \"flops\": " << total.flops << "}";
+    if (total.calls != 0)
+      std::cout << "CU " << cu << ": " << total.calls << " instructions, " << std::fixed << std::setprecision(6) << total.ns * 1e-9 << " s, "
+                << std::setprecision(2) << static_cast<double>(total.bytes_read + total.bytes_written) / total.ns << " GB/s, "
+                << static_cast<double>(total.flops) / total.ns << " GFLOP/s" << std::endl;
+  }
+  json << "]}\n";
+  std::cout.unsetf(std::ios_base::floatfield);
+}
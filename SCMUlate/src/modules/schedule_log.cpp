@@ -0,0 +1,205 @@
+#include "schedule_log.hpp"
+#include <cstring>
+#include <iostream>
+
+namespace {
+  const char schedMagic[8] = {'S', 'C', 'M', 'S', 'C', 'H', 'E', 'D'};
+  const uint32_t schedVersion = 1;
+
+  bool get(std::vector<unsigned char> const & data, size_t & pos, uint64_t & value) {
+    value = 0;
+    for (int shift = 0; pos < data.size() && shift < 64; shift += 7) {
+      unsigned char byte = data[pos++];
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0)
+        return true;
+    }
+    return false;
+  }
+
+  bool getDelta(std::vector<unsigned char> const & data, size_t & pos, uint64_t & last) {
+    uint64_t zigzag;
+    if (!get(data, pos, zigzag))
+      return false;
+    last += (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+    return true;
+  }
+}
+
+scm::schedule_log_module::schedule_log_module(uint32_t numCUs, ILP_MODES ilp_mode) :
+  mode(SCHED_OFF), numCUs(numCUs), ilp_mode(ilp_mode), iteration(0), dispatches(0), renames(0), renameMisses(0),
+  file(nullptr), last_iteration(0), last_dispatch_seq(0), last_rename_seq(0), next(0), recordedRenames(0), recordedIterations(0),
+  held(false), stalled(0), diverged(false) { }
+
+void
+scm::schedule_log_module::put(uint64_t value) {
+  while (value >= 0x80) {
+    this->buffer.push_back(static_cast<unsigned char>(value | 0x80));
+    value >>= 7;
+  }
+  this->buffer.push_back(static_cast<unsigned char>(value));
+}
+
+void
+scm::schedule_log_module::flush() {
+  if (this->file != nullptr && !this->buffer.empty())
+    fwrite(this->buffer.data(), 1, this->buffer.size(), this->file);
+  this->buffer.clear();
+}
+
+bool
+scm::schedule_log_module::setRecord(std::string const & fileName) {
+  this->file = fopen(fileName.c_str(), "wb");
+  if (this->file == nullptr)
+    return false;
+  uint32_t header[4] = {schedVersion, this->numCUs, static_cast<uint32_t>(this->ilp_mode), 0};
+  fwrite(schedMagic, 1, sizeof(schedMagic), this->file);
+  fwrite(header, sizeof(uint32_t), 4, this->file);
+  this->buffer.reserve(SCHED_LOG_BUFFER_SIZE + 64);
+  this->fileName = fileName;
+  this->mode = SCHED_RECORD;
+  return true;
+}
+
+bool
+scm::schedule_log_module::setReplay(std::string const & fileName) {
+  FILE * in = fopen(fileName.c_str(), "rb");
+  if (in == nullptr)
+    return false;
+  char magic[8];
+  uint32_t header[4];
+  std::vector<unsigned char> data;
+  bool valid = fread(magic, 1, sizeof(magic), in) == sizeof(magic) && memcmp(magic, schedMagic, sizeof(magic)) == 0 &&
+               fread(header, sizeof(uint32_t), 4, in) == 4 && header[0] == schedVersion;
+  if (valid) {
+    unsigned char chunk[65536];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), in)) > 0)
+      data.insert(data.end(), chunk, chunk + read);
+  }
+  fclose(in);
+  if (!valid) {
+    SCMULATE_WARNING(0, "%s is not a schedule log", fileName.c_str());
+    return false;
+  }
+  if (header[1] != this->numCUs || header[2] != static_cast<uint32_t>(this->ilp_mode)) {
+    SCMULATE_WARNING(0, "%s was recorded with %u CUs and ILP mode %u. This machine has %u CUs and ILP mode %u",
+                     fileName.c_str(), header[1], header[2], this->numCUs, static_cast<uint32_t>(this->ilp_mode));
+    return false;
+  }
+
+  size_t pos = 0;
+  uint64_t iter = 0, dispatchSeq = 0, renameSeq = 0, a, b, c;
+  bool ended = false;
+  while (pos < data.size() && !ended) {
+    unsigned char tag = data[pos++];
+    if (tag == 'D' && get(data, pos, a) && getDelta(data, pos, dispatchSeq) && get(data, pos, b) && get(data, pos, c) && c < this->numCUs) {
+      iter += a;
+      this->schedule.push_back(dispatch_t{iter, dispatchSeq, static_cast<uint32_t>(b), static_cast<uint32_t>(c)});
+    } else if (tag == 'R' && getDelta(data, pos, renameSeq) && get(data, pos, b) && get(data, pos, c) && b <= MAX_NUM_OPERANDS) {
+      this->renameRegs[renameKey(renameSeq, b)] = c;
+      this->recordedRenames++;
+    } else if (tag == 'E' && get(data, pos, a)) {
+      this->recordedIterations = a;
+      ended = true;
+    } else {
+      break;
+    }
+  }
+  // A run that crashed still has the decisions before the crash
+  SCMULATE_WARNING_IF(0, !ended, "%s is truncated. Replaying the first %lu dispatches", fileName.c_str(), this->schedule.size());
+  this->fileName = fileName;
+  this->mode = SCHED_REPLAY;
+  return true;
+}
+
+void
+scm::schedule_log_module::nextIteration(bool progress) {
+  this->iteration++;
+  if (!isReplaying())
+    return;
+  this->stalled = this->held && !progress ? this->stalled + 1 : 0;
+  this->held = false;
+  if (this->stalled == SCHED_REPLAY_STALL_ITERATIONS)
+    diverge("no instruction progressed for " + std::to_string(SCHED_REPLAY_STALL_ITERATIONS) + " SU iterations while waiting for PC " +
+            std::to_string(this->schedule[this->next].pc) + " (instruction " + std::to_string(this->schedule[this->next].seq) + ")");
+}
+
+void
+scm::schedule_log_module::diverge(std::string const & reason) {
+  this->diverged = true;
+  this->divergence = "dispatch " + std::to_string(this->next) + ": " + reason;
+  SCMULATE_WARNING(0, "The replay diverged at %s. Using the dispatch policy", this->divergence.c_str());
+}
+
+int
+scm::schedule_log_module::replayDispatch(uint64_t seq, uint32_t pc) {
+  if (this->next == this->schedule.size()) {
+    diverge("the schedule has no more dispatches");
+    return -1;
+  }
+  dispatch_t & decision = this->schedule[this->next];
+  if (decision.seq != seq) {
+    this->held = true;
+    return -1;
+  }
+  if (decision.pc != pc) {
+    diverge("instruction " + std::to_string(seq) + " is at PC " + std::to_string(pc) + " instead of " + std::to_string(decision.pc));
+    return -1;
+  }
+  return decision.cu;
+}
+
+void
+scm::schedule_log_module::dispatched() {
+  this->next++;
+  this->dispatches++;
+}
+
+int64_t
+scm::schedule_log_module::replayRename(uint64_t seq, uint32_t op) {
+  auto reg = this->renameRegs.find(renameKey(seq, op));
+  return reg == this->renameRegs.end() ? -1 : reg->second;
+}
+
+void
+scm::schedule_log_module::renamed(uint64_t seq, uint32_t op, bool forced) {
+  auto reg = this->renameRegs.find(renameKey(seq, op));
+  if (reg == this->renameRegs.end())
+    return;
+  this->renameRegs.erase(reg);
+  if (forced)
+    this->renames++;
+  else
+    this->renameMisses++;
+}
+
+void
+scm::schedule_log_module::finish() {
+  if (this->mode != SCHED_RECORD || this->file == nullptr)
+    return;
+  this->buffer.push_back('E');
+  put(this->iteration);
+  flush();
+  fclose(this->file);
+  this->file = nullptr;
+}
+
+void
+scm::schedule_log_module::report() {
+  if (this->mode == SCHED_RECORD) {
+    std::cout << "SCHEDULE recorded " << this->dispatches << " dispatches and " << this->renames << " renames in "
+              << this->iteration << " SU iterations to " << this->fileName << std::endl;
+  } else if (this->mode == SCHED_REPLAY) {
+    std::cout << "SCHEDULE replayed " << this->dispatches << " of " << this->schedule.size() << " dispatches and "
+              << this->renames << " of " << this->recordedRenames << " renames (" << this->renameMisses << " registers in use) from " << this->fileName << " in "
+              << this->iteration << " SU iterations (" << this->recordedIterations << " recorded)";
+    if (this->diverged)
+      std::cout << ". Diverged at " << this->divergence;
+    std::cout << std::endl;
+  }
+}
+
+scm::schedule_log_module::~schedule_log_module() {
+  finish();
+}
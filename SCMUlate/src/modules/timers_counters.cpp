@@ -1,27 +1,556 @@
 #include "timers_counters.hpp"
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <algorithm>
 
 namespace scm
 {
 
-void timers_counters::addTimer(std::string counterName, counter_type type)
+namespace {
+  // Helpers of the binary trace file. The machines are little endian
+  inline void writeU32(std::FILE * file, uint32_t value) { std::fwrite(&value, sizeof(value), 1, file); }
+  inline void writeU64(std::FILE * file, uint64_t value) { std::fwrite(&value, sizeof(value), 1, file); }
+  inline void writeString(std::FILE * file, std::string const & str) {
+    writeU32(file, str.size());
+    std::fwrite(str.data(), 1, str.size(), file);
+  }
+}
+
+const char * eventName(counter_type type, int event) {
+  static const char * SYS_names[] = {"SYS_START", "SYS_END"};
+  static const char * SU_names[] = {"SU_START", "SU_END", "FETCH_DECODE_INSTRUCTION", "DISPATCH_INSTRUCTION",
+                                    "EXECUTE_CONTROL_INSTRUCTION", "EXECUTE_ARITH_INSTRUCTION", "SU_IDLE"};
+  static const char * CUMEM_names[] = {"CUMEM_START", "CUMEM_END", "CUMEM_EXECUTION_COD", "CUMEM_EXECUTION_MEM", "CUMEM_IDLE"};
+  switch (type) {
+    case SYS_TIMER:
+      return event <= SYS_END ? SYS_names[event] : "SYS_EVENT";
+    case SU_TIMER:
+      return event <= SU_IDLE ? SU_names[event] : "SU_EVENT";
+    case CUMEM_TIMER:
+      return event <= CUMEM_IDLE ? CUMEM_names[event] : "CUMEM_EVENT";
+    default:
+      return "EVENT";
+  }
+}
+
+timer_id_t timers_counters::addTimer(std::string counterName, counter_type type)
 {
-  this->counters[counterName] = std::vector<timer_event>();
-  this->counters[counterName].reserve(1e6);
-  this->counterType[counterName] = type;
+  auto found = this->timerIDs.find(counterName);
+  if (found != this->timerIDs.end())
+    return found->second;
+  timer_id_t id = this->timers.size();
+  this->timers.push_back(new timer_t(counterName, type));
+  this->timerIDs[counterName] = id;
+  #ifdef HW_COUNTERS
+    this->hwCountersManager.push_back(nullptr);
+  #endif
+  return id;
 }
 
 double timers_counters::getTimestamp() {
   std::chrono::duration<double> diff = std::chrono::high_resolution_clock::now() - this->globalInitialTimer;
   return diff.count();
 }
-timer_event& timers_counters::addEvent(std::string counterName, int newEvent, std::string desc)
+
+void timers_counters::addEvent(std::string counterName, int newEvent, std::string desc)
+{
+  uint32_t inst_id = NO_INSTRUCTION;
+  if (desc.size() != 0) {
+    std::lock_guard<std::mutex> lock(this->descriptionsLock);
+    inst_id = this->descriptions.size() | DESCRIPTION_ID_BIT;
+    this->descriptions.push_back(desc);
+  }
+  addEvent(this->timerIDs.at(counterName), newEvent, inst_id);
+}
+
+bool timers_counters::setTraceMode(std::string mode)
+{
+  unsigned long period = 1, low = 0, high = UINT32_MAX;
+  double t1 = 0, t2 = 0;
+  char extra;
+  const char * str = mode.c_str();
+  if (mode == "full") {
+    this->traceMode = TRACE_FULL;
+  } else if (mode == "aggregate") {
+    this->traceMode = TRACE_AGGREGATE;
+  } else if (std::sscanf(str, "sample:%lu:%lu-%lu%c", &period, &low, &high, &extra) == 3 || std::sscanf(str, "sample:%lu%c", &period, &extra) == 1) {
+    if (period == 0 || low > high)
+      return false;
+    this->traceMode = TRACE_SAMPLED;
+  } else if (std::sscanf(str, "window:%lu-%lu%c", &low, &high, &extra) == 2) {
+    this->traceMode = TRACE_WINDOW_PC;
+  } else if (std::sscanf(str, "time:%lf-%lf%c", &t1, &t2, &extra) == 2 && t1 < t2) {
+    this->traceMode = TRACE_WINDOW_TIME;
+  } else {
+    return false;
+  }
+  this->samplePeriod = period;
+  this->sampleCount = 0;
+  this->pcLow = low;
+  this->pcHigh = high;
+  this->timeLow = t1;
+  this->timeHigh = t2;
+  this->windowOpen = false;
+  addStat("TRACE", "mode", mode);
+  return true;
+}
+
+bool timers_counters::filterInstruction(uint32_t pc)
+{
+  switch (this->traceMode) {
+    case TRACE_SAMPLED:
+      return pc >= this->pcLow && pc <= this->pcHigh && (this->sampleCount++ % this->samplePeriod) == 0;
+    case TRACE_WINDOW_PC: {
+      // The window is opened again every time the SU fetches pcLow (e.g. in each iteration of a loop)
+      if (pc == this->pcLow)
+        this->windowOpen = true;
+      bool traced = this->windowOpen;
+      if (pc == this->pcHigh)
+        this->windowOpen = false;
+      return traced;
+    }
+    case TRACE_WINDOW_TIME: {
+      std::chrono::duration<double> now = std::chrono::steady_clock::now() - this->steadyInitialTimer;
+      return now.count() >= this->timeLow && now.count() < this->timeHigh;
+    }
+    default:
+      return true;
+  }
+}
+
+bool timers_counters::filterEvent(timer_t & timer, int event, uint32_t inst_id, bool traced)
+{
+  // Start and end have the same value for all the counter types
+  bool startEnd = event == SYS_START || event == SYS_END;
+  if (this->traceMode == TRACE_AGGREGATE) {
+    // The previous event of the timer lasted until now
+    uint64_t now = trace_clock::now();
+    if (timer.openTraced) {
+      if (timer.openInst >= timer.aggregates.size())
+        timer.aggregates.resize(timer.openInst + 1, std::array<aggregate_t, TRACE_MAX_EVENT_TYPES>());
+      aggregate_t & agg = timer.aggregates[timer.openInst][timer.openEvent];
+      agg.count++;
+      agg.ticks += now - timer.openTicks;
+    }
+    timer.openTicks = now;
+    timer.openInst = inst_id;
+    timer.openEvent = event;
+    timer.openTraced = traced && inst_id != NO_INSTRUCTION && !(inst_id & DESCRIPTION_ID_BIT) && event < TRACE_MAX_EVENT_TYPES;
+    if (!startEnd)
+      timer.filtered++;
+    return startEnd;
+  }
+  bool record = traced || timer.closePending || startEnd;
+  timer.closePending = traced;
+  if (!record)
+    timer.filtered++;
+  return record;
+}
+
+std::string timers_counters::instructionType(uint32_t inst_id)
+{
+  // The first word of the instruction is the codelet name, or the mnemonic
+  if (inst_id >= this->instructions.size())
+    return "PC_" + std::to_string(inst_id);
+  std::string inst = this->instructions[inst_id].text;
+  inst = inst.substr(0, inst.find_first_of(" ;,"));
+  if (inst.size() == 0)
+    inst = "PC_" + std::to_string(this->instructions[inst_id].pc);
+  return inst;
+}
+
+void timers_counters::dumpAggregates(double secondsPerTick)
+{
+  std::map<std::string, aggregate_t> totals;
+  for (timer_t * timer : this->timers) {
+    for (uint32_t inst_id = 0; inst_id < timer->aggregates.size(); inst_id++) {
+      std::string inst = instructionType(inst_id);
+      for (int event = 0; event < TRACE_MAX_EVENT_TYPES; event++) {
+        aggregate_t & agg = timer->aggregates[inst_id][event];
+        if (agg.count == 0)
+          continue;
+        aggregate_t & total = totals[std::string(eventName(timer->type, event)) + " " + inst];
+        total.count += agg.count;
+        total.ticks += agg.ticks;
+      }
+    }
+  }
+  for (auto & total : totals) {
+    double seconds = total.second.ticks * secondsPerTick;
+    addStat("AGGREGATE", total.first, "count = " + std::to_string(total.second.count) + ", time = " + std::to_string(seconds) +
+            " s, avg = " + std::to_string(seconds * 1e9 / total.second.count) + " ns");
+  }
+}
+
+void timers_counters::internInstruction(uint32_t pc, std::string const & text)
+{
+  uint32_t inst_id = instructionID(pc);
+  if (inst_id >= this->instructions.size()) {
+    uint32_t first = this->instructions.size();
+    this->instructions.resize(inst_id + 1);
+    // The IDs before programBase belong to the previous programs
+    for (uint32_t id = first; id <= inst_id; id++)
+      this->instructions[id].pc = id - this->programBase;
+  }
+  this->instructions[inst_id].text = text;
+}
+
+void timers_counters::spill(timer_t & timer)
+{
+  if (isStreaming()) {
+    // The flusher is the consumer of the ring
+    while (timer.ring.reserve() == nullptr) {
+      this->flushCond.notify_one();
+      std::this_thread::yield();
+    }
+    return;
+  }
+  // Nobody else drains the ring while the machine runs, so the producer can do it
+  timer.ring.drain(timer.spilled);
+}
+
+bool timers_counters::setTraceOutput(std::string fileName)
+{
+  if (isStreaming())
+    return false;
+  this->traceFile = std::fopen(fileName.c_str(), "wb");
+  if (this->traceFile == nullptr) {
+    SCMULATE_ERROR(0, "Could not create the trace file %s", fileName.c_str());
+    return false;
+  }
+  std::fwrite(TRACE_FILE_MAGIC, 1, std::strlen(TRACE_FILE_MAGIC), this->traceFile);
+  writeU32(this->traceFile, TRACE_FILE_VERSION);
+  writeU32(this->traceFile, sizeof(trace_record_t));
+  #ifdef HW_COUNTERS
+    writeU32(this->traceFile, offsetof(trace_record_t, hw));
+    writeU32(this->traceFile, TRACE_MAX_HW_COUNTERS);
+  #else
+    writeU32(this->traceFile, sizeof(trace_record_t));
+    writeU32(this->traceFile, 0);
+  #endif
+
+  // Records spilled before the stream started go first
+  for (timer_t * timer : this->timers) {
+    std::fwrite(timer->spilled.data(), sizeof(trace_record_t), timer->spilled.size(), this->traceFile);
+    this->flushedRecords += timer->spilled.size();
+    std::vector<trace_record_t>().swap(timer->spilled);
+  }
+  this->flushBuffer.reserve(TRACE_RING_SIZE);
+  this->stopFlusher = false;
+  this->streaming = true;
+  this->flusher = std::thread(&timers_counters::flusherBehavior, this);
+  return true;
+}
+
+void timers_counters::flusherBehavior()
+{
+  std::unique_lock<std::mutex> lock(this->flushLock);
+  while (!this->stopFlusher) {
+    this->flushCond.wait_for(lock, std::chrono::milliseconds(TRACE_FLUSH_INTERVAL_MS));
+    lock.unlock();
+    flushRings();
+    lock.lock();
+  }
+}
+
+void timers_counters::joinFlusher()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->flushLock);
+    this->stopFlusher = true;
+  }
+  this->flushCond.notify_one();
+  this->flusher.join();
+}
+
+void timers_counters::flushRings()
+{
+  for (timer_t * timer : this->timers) {
+    if (timer->ring.size() == 0)
+      continue;
+    this->flushBuffer.clear();
+    timer->ring.drain(this->flushBuffer);
+    std::fwrite(this->flushBuffer.data(), sizeof(trace_record_t), this->flushBuffer.size(), this->traceFile);
+    this->flushedRecords += this->flushBuffer.size();
+  }
+}
+
+void timers_counters::writeTraceFooter(double secondsPerTick)
+{
+  std::FILE * file = this->traceFile;
+  uint64_t footerOffset = std::ftell(file);
+  std::fwrite(&secondsPerTick, sizeof(secondsPerTick), 1, file);
+  writeU64(file, this->initialTicks);
+
+  writeU32(file, this->timers.size());
+  for (timer_t * timer : this->timers) {
+    writeU32(file, timer->type);
+    writeString(file, timer->name);
+  }
+
+  uint32_t numInstructions = 0;
+  for (instruction_text_t const & inst : this->instructions)
+    if (inst.text.size() != 0)
+      numInstructions++;
+  writeU32(file, numInstructions);
+  for (uint32_t inst_id = 0; inst_id < this->instructions.size(); inst_id++) {
+    if (this->instructions[inst_id].text.size() == 0)
+      continue;
+    writeU32(file, inst_id);
+    writeU32(file, this->instructions[inst_id].pc);
+    writeString(file, this->instructions[inst_id].text);
+  }
+
+  writeU32(file, this->descriptions.size());
+  for (std::string const & desc : this->descriptions)
+    writeString(file, desc);
+
+  #ifdef HW_COUNTERS
+    writeU32(file, this->hwEventNames.size());
+    for (std::string const & name : this->hwEventNames)
+      writeString(file, name);
+  #else
+    writeU32(file, 0);
+  #endif
+
+  writeU32(file, this->stats.size());
+  for (auto & group : this->stats) {
+    writeString(file, group.first);
+    writeU32(file, group.second.size());
+    for (auto & value : group.second) {
+      writeString(file, value.first);
+      writeString(file, value.second);
+    }
+  }
+
+  writeU64(file, footerOffset);
+  std::fwrite(TRACE_FILE_END_MAGIC, 1, std::strlen(TRACE_FILE_END_MAGIC) + 1, file);
+}
+
+#ifdef HW_COUNTERS
+bool timers_counters::setHWCounters(std::string events)
+{
+  std::vector<hw_counters_t::event_t> codes;
+  std::vector<std::string> names;
+  size_t start = 0;
+  while (start <= events.size()) {
+    size_t end = events.find(',', start);
+    if (end == std::string::npos)
+      end = events.size();
+    std::string name = events.substr(start, end - start);
+    start = end + 1;
+    if (name.size() == 0)
+      continue;
+    hw_counters_t::event_t code;
+    if (!hw_counters_t::findEvent(name, code)) {
+      SCMULATE_ERROR(0, "Hardware counter %s is not available", name.c_str());
+      return false;
+    }
+    SCMULATE_INFOMSG(4, "Registering hardware counter %s", name.c_str());
+    codes.push_back(code);
+    names.push_back(name);
+  }
+  if (codes.size() == 0 || codes.size() > TRACE_MAX_HW_COUNTERS) {
+    SCMULATE_ERROR(0, "Select between 1 and %d hardware counters", TRACE_MAX_HW_COUNTERS);
+    return false;
+  }
+  this->hwEvents = codes;
+  this->hwEventNames = names;
+  int numCounters = hw_counters_t::numHWCounters();
+  if (numCounters > 0 && static_cast<int>(codes.size()) > numCounters)
+    setHWMultiplex(true);
+  return true;
+}
+
+void timers_counters::setHWMultiplex(bool multiplex)
+{
+  if (multiplex && !this->multiplexHW && !this->disableHW && !hw_counters_t::initMultiplex()) {
+    SCMULATE_ERROR(0, "Could not initialize the multiplexing of the hardware counters");
+    return;
+  }
+  this->multiplexHW = multiplex;
+}
+
+void timers_counters::stopAndRegisterHWCounters(timer_id_t timer, int event, uint32_t inst_id, uint32_t counted_inst)
+{
+  hw_counters_t * counters = this->hwCountersManager[timer];
+  if (counters == nullptr) {
+    addEvent(timer, event, inst_id);
+    return;
+  }
+  counters->stopCounting();
+  long long const * values = counters->getValues();
+  int numValues = counters->getNumValues();
+  timer_t & cur_timer = *timers[timer];
+  if (counted_inst != NO_INSTRUCTION) {
+    if (counted_inst >= cur_timer.hwAggregates.size())
+      cur_timer.hwAggregates.resize(counted_inst + 1, hw_aggregate_t());
+    hw_aggregate_t & agg = cur_timer.hwAggregates[counted_inst];
+    agg.count++;
+    for (int i = 0; i < numValues; i++)
+      agg.values[i] += values[i];
+  }
+  if (!this->rawHWCounters) {
+    addEvent(timer, event, inst_id);
+    return;
+  }
+  if (this->traceMode != TRACE_FULL && !filterEvent(cur_timer, event, inst_id, false))
+    return;
+  trace_record_t * rec = cur_timer.ring.reserve();
+  if (rec == nullptr) {
+    spill(cur_timer);
+    rec = cur_timer.ring.reserve();
+  }
+  rec->timestamp = trace_clock::now();
+  rec->timer_id = timer;
+  rec->event_id = event;
+  rec->inst_id = inst_id;
+  rec->num_hw = numValues;
+  for (int i = 0; i < numValues; i++)
+    rec->hw[i] = values[i];
+  cur_timer.ring.commit();
+  cur_timer.events++;
+}
+
+void timers_counters::dumpHWCounters()
+{
+  std::map<std::string, hw_aggregate_t> totals;
+  for (timer_t * timer : this->timers) {
+    for (uint32_t inst_id = 0; inst_id < timer->hwAggregates.size(); inst_id++) {
+      hw_aggregate_t & agg = timer->hwAggregates[inst_id];
+      if (agg.count == 0)
+        continue;
+      hw_aggregate_t & total = totals.emplace(instructionType(inst_id), hw_aggregate_t()).first->second;
+      total.count += agg.count;
+      for (size_t i = 0; i < this->hwEventNames.size(); i++)
+        total.values[i] += agg.values[i];
+    }
+  }
+  if (totals.empty())
+    return;
+
+  // Summary table, also kept in the HW_COUNTERS stats
+  std::cout << std::left << std::setw(32) << "Instruction" << std::right << std::setw(12) << "count";
+  for (std::string const & name : this->hwEventNames)
+    std::cout << std::setw(std::max<size_t>(16, name.size() + 2)) << name;
+  std::cout << std::endl;
+  for (auto & total : totals) {
+    std::cout << std::left << std::setw(32) << total.first << std::right << std::setw(12) << total.second.count;
+    std::string value = "count = " + std::to_string(total.second.count);
+    for (size_t i = 0; i < this->hwEventNames.size(); i++) {
+      std::cout << std::setw(std::max<size_t>(16, this->hwEventNames[i].size() + 2)) << total.second.values[i];
+      value += ", " + this->hwEventNames[i] + " = " + std::to_string(total.second.values[i]);
+    }
+    std::cout << std::endl;
+    addStat("HW_COUNTERS", total.first, value);
+  }
+}
+#endif
+
+std::string timers_counters::resolveDescription(uint32_t inst_id)
+{
+  if (inst_id == NO_INSTRUCTION)
+    return std::string();
+  if (inst_id & DESCRIPTION_ID_BIT)
+    return this->descriptions[inst_id & ~DESCRIPTION_ID_BIT];
+  if (inst_id < this->instructions.size() && this->instructions[inst_id].text.size() != 0)
+    return this->instructions[inst_id].text + " (PC = " + std::to_string(this->instructions[inst_id].pc) + ")";
+  return std::string("PC = ") + std::to_string(inst_id);
+}
+
+double timers_counters::measureOverhead()
+{
+  // Same work than addEvent, in a timer that is not dumped
+  const int numEvents = 100000;
+  timer_t scratch("overhead", SYS_TIMER);
+  std::vector<trace_record_t> drained;
+  drained.reserve(TRACE_RING_SIZE);
+  std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+  for (int i = 0; i < numEvents; i++) {
+    trace_record_t * rec = scratch.ring.reserve();
+    if (rec == nullptr) {
+      drained.clear();
+      scratch.ring.drain(drained);
+      rec = scratch.ring.reserve();
+    }
+    rec->timestamp = trace_clock::now();
+    rec->timer_id = 0;
+    rec->event_id = i & 0xFF;
+    rec->num_hw = 0;
+    rec->inst_id = i;
+    scratch.ring.commit();
+    scratch.events++;
+  }
+  std::chrono::duration<double> diff = std::chrono::steady_clock::now() - start;
+  return diff.count() * 1e9 / numEvents;
+}
+
+void timers_counters::dumpStats(std::ostream & out, std::string & indent)
 {
-  timer_event event(newEvent, desc);
-  this->counters.at(counterName).push_back(event);
-  return this->counters.at(counterName).back();
+  out << indent << "\"STATS\": {\n";
+  size_t numGroups = stats.size();
+  for (auto & group : stats) {
+    numGroups--;
+    out << indent << "  \"" << group.first << "\": {\n";
+    size_t numValues = group.second.size();
+    for (auto & value : group.second) {
+      numValues--;
+      out << indent << "    \"" << value.first << "\": \"" << value.second << "\"" << (numValues != 0 ? ",\n" : "\n");
+    }
+    out << indent << (numGroups != 0 ? "  },\n" : "  }\n");
+  }
+  out << indent << "}\n";
 }
 
 void timers_counters::dumpTimers()
+{
+  // Ticks of the trace clock to seconds, measured over the whole run
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - this->steadyInitialTimer;
+  uint64_t elapsedTicks = trace_clock::now() - this->initialTicks;
+  double secondsPerTick = elapsedTicks != 0 ? elapsed.count() / elapsedTicks : 0;
+
+  if (isStreaming()) {
+    joinFlusher();
+    flushRings();
+    this->streaming = false;
+  }
+
+  uint64_t totalEvents = 0, totalSpilled = 0, totalFiltered = 0;
+  for (timer_t * timer : this->timers) {
+    totalEvents += timer->events;
+    totalSpilled += timer->spilled.size();
+    totalFiltered += timer->filtered;
+  }
+  if (this->traceMode == TRACE_AGGREGATE)
+    dumpAggregates(secondsPerTick);
+  #ifdef HW_COUNTERS
+    dumpHWCounters();
+  #endif
+  addStat("TRACE", "events", std::to_string(totalEvents));
+  if (this->traceMode != TRACE_FULL)
+    addStat("TRACE", "filtered_events", std::to_string(totalFiltered));
+  addStat("TRACE", "spilled_events", std::to_string(totalSpilled));
+  addStat("TRACE", "overhead_ns_per_event", std::to_string(measureOverhead()));
+  addStat("TRACE", "clock_ghz", std::to_string(secondsPerTick != 0 ? 1e-9 / secondsPerTick : 0));
+
+  if (this->traceFile != nullptr) {
+    addStat("TRACE", "streamed_events", std::to_string(this->flushedRecords));
+    writeTraceFooter(secondsPerTick);
+    std::fclose(this->traceFile);
+    this->traceFile = nullptr;
+    return;
+  }
+
+  if (this->dumpFilename.length() == 0) {
+    dumpTimers(std::cout, secondsPerTick);
+  } else {
+    auto logFile = std::ofstream(this->dumpFilename);
+    dumpTimers(logFile, secondsPerTick);
+  }
+}
+
+void timers_counters::dumpTimers(std::ostream & out, double secondsPerTick)
 {
   // Needed for indentation
   std::string indent = "";
@@ -32,131 +561,65 @@ void timers_counters::dumpTimers()
   auto indent_pop = [&]() {
     indent.erase(indent.length() - indent_increment.length(), indent_increment.length());
   };
-  if (this->dumpFilename.length() == 0) {
-    std::cout << "{\n";
+  out << "{\n";
+  indent_push();
+  int numElements = timerIDs.size() + (stats.empty() ? 0 : 1);
+  // for each timer
+  for (std::pair<const std::string, timer_id_t> & element : timerIDs)
+  {
+    numElements--;
+    timer_t & timer = *this->timers[element.second];
+    timer.ring.drain(timer.spilled);
+    out << indent << "\"" << element.first << "\": {\n";
     indent_push();
-    int numElements = counters.size();
-    // for each timer 
-    for (std::pair<std::string, std::vector<timer_event>> element : counters)
-    {
-      numElements--;
-      std::cout << indent << "\"" << element.first << "\": {\n";
-      indent_push();
 
-      std::cout << indent << "\"counter type\": \"" << std::to_string(this->counterType[element.first]) << "\",\n";
-      std::cout << indent << "\"events\": [\n";
-      indent_push();
-      // For each event in the timer.
-      for (timer_event& event : element.second)
-      {
-        std::cout << indent << "{\n";
-        indent_push();
-        std::cout << indent << "\"type\": \"" << std::to_string(event.getID()) << "\",\n";
-        // Get the event timer value 
-        std::chrono::duration<double> diff = event.getValue() - this->globalInitialTimer;
-        std::cout << indent << "\"value\": " << std::to_string(diff.count()) << ",\n";
-        #ifdef PAPI_COUNT
-          std::vector <long long> PAPIvals = event.getPAPIcounters();
-          if (PAPIvals.size() > 0) {
-            std::cout << indent << "\"description\": \"" << event.getDescription() << "\",\n";
-            std::cout << indent << "\"hw_counters\": {\n";
-            indent_push();
-            size_t papi_name_count = 0;
-            for (auto vals_it = PAPIvals.begin(); vals_it != PAPIvals.end(); vals_it++, papi_name_count++) {
-              if (papi_name_count != PAPIvals.size()-1) {
-                std::cout << indent << "\""<< this->PAPI_events_str[papi_name_count]<<"\": "<< static_cast<unsigned long long>(*vals_it) << ", \n";
-              } else {
-                std::cout << indent << "\""<< this->PAPI_events_str[papi_name_count]<<"\": "<< static_cast<unsigned long long>(*vals_it) << " \n";
-              }
-            }
-            indent_pop();
-            std::cout << indent << "}\n";
-          } else {
-            std::cout << indent << "\"description\": \"" << event.getDescription() << "\"\n";
-          }
-        #else 
-          std::cout << indent << "\"description\": \"" << event.getDescription() << "\"\n";
-        #endif
-        indent_pop();
-        if (event != element.second.back())
-          std::cout << indent << "},\n";
-        else
-          std::cout << indent << "}\n";
-      }
-      indent_pop();
-      std::cout << indent << "]\n";
-      indent_pop();
-      if (numElements != 0)
-        std::cout << indent << "},\n";
-      else
-        std::cout << indent << "}\n";
-    }
-    indent_pop();
-    std::cout << indent << "}\n";
-  } else {
-    auto logFile = std::ofstream(this->dumpFilename);
-    logFile << "{\n";
+    out << indent << "\"counter type\": \"" << std::to_string(timer.type) << "\",\n";
+    out << indent << "\"events\": [\n";
     indent_push();
-    int numElements = counters.size();
-    // for each timer 
-    for (std::pair<std::string, std::vector<timer_event>> element : counters)
+    // For each event in the timer.
+    for (size_t i = 0; i < timer.spilled.size(); i++)
     {
-      numElements--;
-      logFile << indent << "\"" << element.first << "\": {\n";
+      trace_record_t & event = timer.spilled[i];
+      out << indent << "{\n";
       indent_push();
-
-      logFile << indent << "\"counter type\": \"" << std::to_string(this->counterType[element.first]) << "\",\n";
-      logFile << indent << "\"events\": [\n";
-      indent_push();
-      // For each event in the timer.
-      for (timer_event event : element.second)
-      {
-        logFile << indent << "{\n";
-        indent_push();
-        logFile << indent << "\"type\": \"" << std::to_string(event.getID()) << "\",\n";
-        // Get the event timer value 
-        std::chrono::duration<double> diff = event.getValue() - this->globalInitialTimer;
-
-        logFile << indent << "\"value\": " << std::to_string(diff.count()) << ",\n";
-        #ifdef PAPI_COUNT
-          std::vector <long long> PAPIvals = event.getPAPIcounters();
-          if (PAPIvals.size() > 0) {
-            logFile << indent << "\"description\": \"" << event.getDescription() << "\",\n";
-            logFile << indent << "\"hw_counters\": {\n";
-            indent_push();
-            size_t papi_name_count = 0;
-            for (auto vals_it = PAPIvals.begin(); vals_it != PAPIvals.end(); vals_it++, papi_name_count++) {
-              if (papi_name_count != PAPIvals.size()-1) {
-                logFile << indent << "\""<< this->PAPI_events_str[papi_name_count]<<"\": "<< static_cast<unsigned long long>(*vals_it) << ", \n";
-              } else {
-                logFile << indent << "\""<< this->PAPI_events_str[papi_name_count]<<"\": "<< static_cast<unsigned long long>(*vals_it) << " \n";
-              }
-            }
-            indent_pop();
-            logFile << indent << "}\n";
-          } else {
-            logFile << indent << "\"description\": \"" << event.getDescription() << "\"\n";
+      out << indent << "\"type\": \"" << std::to_string(event.event_id) << "\",\n";
+      // Get the event timer value
+      double value = (static_cast<int64_t>(event.timestamp - this->initialTicks)) * secondsPerTick;
+      out << indent << "\"value\": " << std::to_string(value) << ",\n";
+      #ifdef HW_COUNTERS
+        if (event.num_hw > 0) {
+          out << indent << "\"description\": \"" << resolveDescription(event.inst_id) << "\",\n";
+          out << indent << "\"hw_counters\": {\n";
+          indent_push();
+          for (uint16_t hw_num = 0; hw_num < event.num_hw; hw_num++) {
+            out << indent << "\""<< this->hwEventNames[hw_num]<<"\": "<< static_cast<unsigned long long>(event.hw[hw_num]) << (hw_num != event.num_hw-1 ? ", \n" : " \n");
           }
-        #else 
-          logFile << indent << "\"description\": \"" << event.getDescription() << "\"\n";
-        #endif
-        indent_pop();
-        if (event != element.second.back())
-          logFile << indent << "},\n";
-        else
-          logFile << indent << "}\n";
-      }
+          indent_pop();
+          out << indent << "}\n";
+        } else {
+          out << indent << "\"description\": \"" << resolveDescription(event.inst_id) << "\"\n";
+        }
+      #else
+        out << indent << "\"description\": \"" << resolveDescription(event.inst_id) << "\"\n";
+      #endif
       indent_pop();
-      logFile << indent << "]\n";
-      indent_pop();
-      if (numElements != 0)
-        logFile << indent << "},\n";
+      if (i != timer.spilled.size() - 1)
+        out << indent << "},\n";
       else
-        logFile << indent << "}\n";
+        out << indent << "}\n";
     }
     indent_pop();
-    logFile << indent << "}\n";
+    out << indent << "]\n";
+    indent_pop();
+    if (numElements != 0)
+      out << indent << "},\n";
+    else
+      out << indent << "}\n";
   }
+  if (!stats.empty())
+    dumpStats(out, indent);
+  indent_pop();
+  out << indent << "}\n";
 }
 
-} // namespace scm
\ No newline at end of file
+} // namespace scm
@@ -0,0 +1,118 @@
+#include "trace_cache.hpp"
+
+scm::trace_cache::trace_cache(inst_mem_module * const inst_mem) :
+  inst_mem_m(inst_mem),
+  traces(inst_mem->getBlocks().numBlocks(), trace_t{0, 0, 0}),
+  free_copies(inst_mem->isStreaming() ? 0 : inst_mem->getMemSize()),
+  hot_threshold(TRACE_CACHE_HOT_THRESHOLD),
+  hits(0),
+  misses(0) {
+  TIMERS_COUNTERS_GUARD(
+    hit_time = std::chrono::duration<double>::zero();
+    miss_time = std::chrono::duration<double>::zero();
+  );
+}
+
+scm::decoded_instruction_t *
+scm::trace_cache::acquire(uint32_t pc) {
+  TIMERS_COUNTERS_GUARD(
+    auto start = std::chrono::high_resolution_clock::now();
+  );
+  decoded_instruction_t * original = this->inst_mem_m->fetch(pc);
+  if (original == nullptr)
+    return nullptr;
+  decoded_instruction_t * copy;
+  // Streamed programs are not split in blocks. There are no traces
+  if (pc >= this->free_copies.size()) {
+    copy = new decoded_instruction_t(*original);
+    copy->setPC(pc);
+    return copy;
+  }
+  const program_blocks & blocks = this->inst_mem_m->getBlocks();
+  trace_t & trace = this->traces[blocks.blockNumAt(pc)];
+  if (blocks.blockAt(pc)->first_pc == pc)
+    trace.entries++;
+
+  std::vector<decoded_instruction_t *> & copies = this->free_copies[pc];
+  if (!copies.empty()) {
+    copy = copies.back();
+    copies.pop_back();
+    copy->restore(*original);
+    trace.hits++;
+    this->hits++;
+    TIMERS_COUNTERS_GUARD(
+      this->hit_time += std::chrono::high_resolution_clock::now() - start;
+    );
+  } else {
+    copy = new decoded_instruction_t(*original);
+    copy->setPC(pc);
+    trace.misses++;
+    this->misses++;
+    TIMERS_COUNTERS_GUARD(
+      this->miss_time += std::chrono::high_resolution_clock::now() - start;
+    );
+  }
+  return copy;
+}
+
+void
+scm::trace_cache::release(decoded_instruction_t * inst) {
+  uint32_t pc = inst->getPC();
+  if (pc < this->free_copies.size() && isHot(this->traces[this->inst_mem_m->getBlocks().blockNumAt(pc)]) && this->free_copies[pc].size() < TRACE_CACHE_MAX_COPIES)
+    this->free_copies[pc].push_back(inst);
+  else
+    delete inst;
+}
+
+void
+scm::trace_cache::setProgram(inst_mem_module * const inst_mem) {
+  for (auto it = this->free_copies.begin(); it != this->free_copies.end(); ++it)
+    for (auto copy = it->begin(); copy != it->end(); ++copy)
+      delete *copy;
+  this->inst_mem_m = inst_mem;
+  this->traces.assign(inst_mem->getBlocks().numBlocks(), trace_t{0, 0, 0});
+  this->free_copies.clear();
+  this->free_copies.resize(inst_mem->isStreaming() ? 0 : inst_mem->getMemSize());
+  this->hits = this->misses = 0;
+  TIMERS_COUNTERS_GUARD(
+    hit_time = std::chrono::duration<double>::zero();
+    miss_time = std::chrono::duration<double>::zero();
+  );
+}
+
+uint32_t
+scm::trace_cache::getHotTraces() const {
+  uint32_t hot = 0;
+  for (auto it = this->traces.begin(); it != this->traces.end(); ++it)
+    if (isHot(*it))
+      hot++;
+  return hot;
+}
+
+double
+scm::trace_cache::getTimeSaved() const {
+  double saved = 0;
+  TIMERS_COUNTERS_GUARD(
+    if (this->hits != 0 && this->misses != 0)
+      saved = this->hits * (this->miss_time.count() / this->misses - this->hit_time.count() / this->hits);
+  );
+  return saved;
+}
+
+void
+scm::trace_cache::dump() {
+  const program_blocks & blocks = this->inst_mem_m->getBlocks();
+  for (uint32_t num = 0; num < this->traces.size(); num++) {
+    trace_t & trace = this->traces[num];
+    if (!isHot(trace))
+      continue;
+    std::cout << "Trace PC " << blocks.getBlock(num).first_pc << " (BB" << num << ") entries = " << trace.entries
+              << " hits = " << trace.hits << " misses = " << trace.misses << std::endl;
+  }
+}
+
+scm::trace_cache::~trace_cache() {
+  for (auto it = this->free_copies.begin(); it != this->free_copies.end(); ++it)
+    for (auto copy = it->begin(); copy != it->end(); ++copy)
+      delete *copy;
+}
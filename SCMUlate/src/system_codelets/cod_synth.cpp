@@ -0,0 +1,82 @@
+#include "cod_synth.hpp"
+#include <chrono>
+#include <cstring>
+
+namespace {
+  // Registers hold the values with the most significant byte first (see LDIMM)
+  uint64_t readRegister64(const unsigned char * reg) {
+#ifdef ARITH64
+    return *reinterpret_cast<const uint64_t *>(reg);
+#else
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+      value = (value << 8) | reg[i];
+    return value;
+#endif
+  }
+
+  void writeRegister64(unsigned char * reg, uint64_t value) {
+#ifdef ARITH64
+    *reinterpret_cast<uint64_t *>(reg) = value;
+#else
+    for (int i = 7; i >= 0; i--, value >>= 8)
+      reg[i] = value & 255;
+#endif
+  }
+
+  // Sum of the inputs from operand first to the last one
+  uint64_t sumInputs(scm::codelet_params & params, int first) {
+    uint64_t value = 0;
+    for (int op = first; op <= MAX_NUM_OPERANDS; op++) {
+      unsigned char * reg = params.getParamValueAs<unsigned char *>(op);
+      if (reg != nullptr)
+        value += readRegister64(reg);
+    }
+    return value;
+  }
+
+  // Immediate operand. Read through the pointer of the parameter to avoid the type punning of getParamValueAs
+  uint64_t immediate(scm::codelet_params & params, int op) {
+    return reinterpret_cast<uint64_t>(params.getParamValueAs<unsigned char *>(op));
+  }
+
+  // The work done while waiting is discarded, so the outputs do not depend on the timing
+  void waitUntil(std::chrono::steady_clock::time_point end) {
+    volatile uint64_t work = 1;
+    while (std::chrono::steady_clock::now() < end)
+      work = work * 6364136223846793005ull + 1442695040888963407ull;
+  }
+}
+
+IMPLEMENT_CODELET(synth_spin,
+  auto start = std::chrono::steady_clock::now();
+  uint64_t ns = immediate(this->getParams(), 2);
+  uint64_t value = sumInputs(this->getParams(), 3) + 1;
+  waitUntil(start + std::chrono::nanoseconds(ns));
+  writeRegister64(this->getParams().getParamValueAs<unsigned char *>(1), value);
+);
+
+MEMRANGE_CODELET(synth_stream,
+  uint64_t src = readRegister64(this->getParams().getParamValueAs<unsigned char *>(3));
+  uint64_t dst = readRegister64(this->getParams().getParamValueAs<unsigned char *>(4));
+  uint64_t bytes = immediate(this->getParams(), 5);
+  if (bytes != 0) {
+    this->addReadMemRange(src, bytes);
+    this->addWriteMemRange(dst, bytes);
+  }
+);
+
+IMPLEMENT_CODELET(synth_stream,
+  auto start = std::chrono::steady_clock::now();
+  uint64_t ns = immediate(this->getParams(), 2);
+  uint64_t bytes = immediate(this->getParams(), 5);
+  uint64_t value = sumInputs(this->getParams(), 6) + 1;
+  if (bytes != 0) {
+    unsigned char * src = getAddress(readRegister64(this->getParams().getParamValueAs<unsigned char *>(3)));
+    unsigned char * dst = getAddress(readRegister64(this->getParams().getParamValueAs<unsigned char *>(4)));
+    std::memmove(dst, src, bytes);
+    value += dst[0] + dst[bytes - 1];
+  }
+  waitUntil(start + std::chrono::nanoseconds(ns));
+  writeRegister64(this->getParams().getParamValueAs<unsigned char *>(1), value);
+);
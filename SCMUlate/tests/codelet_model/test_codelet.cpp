@@ -30,6 +30,18 @@ int main() {
     
     scm::codelet * myCodelet = scm::codeletFactory::createCodelet("hello_world", myParams);
     myCodelet->implementation();
+
+    // Clones are placed in the pool of the type, and the memory is used again
+    scm::codelet * myClone = scm::codeletFactory::cloneCodelet(myCodelet);
+    if (myClone->getCodeletID() != myCodelet->getCodeletID() || reinterpret_cast<uint64_t>(myClone->getParams().getParamValueAs<unsigned char *>(2)) != 2)
+      return 1;
+    myClone->implementation();
+    scm::codelet * oldClone = myClone;
+    scm::codeletFactory::destroyCodelet(myClone);
+    myClone = scm::codeletFactory::cloneCodelet(myCodelet);
+    if (myClone != oldClone)
+      return 1;
+    scm::codeletFactory::destroyCodelet(myClone);
     
     delete [] myChar;
     delete myCodelet;
@@ -1,10 +1,173 @@
 #include "instruction_mem.hpp"
+#include <fstream>
+#include <cstdio>
 
 int main () {
-  //scm::inst_mem_module mem_from_file("test_mem_file.txt");
-  //mem_from_file.dumpMemory();
-  //scm::inst_mem_module mem_from_stdin("");
-  //mem_from_stdin.dumpMemory();
+  scm::reg_file_module reg_file_m;
+
+  std::ofstream program("test_program.scm");
+  program << "// Comment line" << std::endl
+          << "LDIMM R64B_1, -5;" << std::endl
+          << "\tLDOFF\tR1L_2, R64B_1, 64; // Tabs and comment" << std::endl
+          << "loop:" << std::endl
+          << "" << std::endl
+          << "ADD R64B_1, R64B_1, 1;" << std::endl
+          << "BGT R64B_1, R64B_3, loop;" << std::endl
+          << "LDIMM R64B_1 5;" << std::endl
+          << "COMMIT;" << std::endl;
+  program.close();
+
+  char fileName[] = "test_program.scm";
+  scm::inst_mem_module mem_from_file(fileName, &reg_file_m);
+  if (!mem_from_file.isValid() || mem_from_file.getMemSize() != 6)
+    return 1;
+  if (mem_from_file.getMemoryLabel("loop") != 2)
+    return 1;
+  if (mem_from_file.fetch(0)->getOpcode() != scm::LDIMM_INST.opcode || mem_from_file.fetch(0)->getOp2().type != scm::operand_t::IMMEDIATE_VAL)
+    return 1;
+  if (mem_from_file.fetch(1)->getOp2().value.reg.reg_ptr != reg_file_m.getRegisterByName("64B", 1))
+    return 1;
+  if (mem_from_file.fetch(3)->getType() != scm::CONTROL_INST || mem_from_file.fetch(3)->getOp3().type != scm::operand_t::LABEL)
+    return 1;
+  // Missing comma. It is kept as an unknown instruction
+  if (mem_from_file.fetch(4)->getType() != scm::UNKNOWN || mem_from_file.fetch(5)->getType() != scm::COMMIT)
+    return 1;
+  mem_from_file.dumpMemory();
+  std::remove(fileName);
+
+  // Program image. It must decode to the same instructions than the text
+  std::ofstream valid_program("test_program.scm");
+  valid_program << "LDIMM R64B_1, 5;" << std::endl
+                << "loop:" << std::endl
+                << "LDOFF R1L_2, R64B_1, 64;" << std::endl
+                << "SUB R64B_1, R64B_1, 1;" << std::endl
+                << "BGT R64B_1, R64B_3, loop;" << std::endl
+                << "JMPLBL end;" << std::endl
+                << "end:" << std::endl
+                << "COMMIT;" << std::endl;
+  valid_program.close();
+  std::string error;
+  if (!scm::program_image::assemble(fileName, "test_program.scmb", error))
+    return 1;
+  char imageName[] = "test_program.scmb";
+  if (!scm::program_image::isImage(imageName) || scm::program_image::isImage(fileName))
+    return 1;
+  scm::inst_mem_module mem_from_text(fileName, &reg_file_m);
+  scm::inst_mem_module mem_from_image(imageName, &reg_file_m);
+  if (!mem_from_image.isValid() || mem_from_image.getMemSize() != mem_from_text.getMemSize())
+    return 1;
+  if (mem_from_image.getMemoryLabel("loop") != 1 || mem_from_image.getMemoryLabel("end") != 5)
+    return 1;
+  for (uint32_t pc = 0; pc < mem_from_text.getMemSize(); pc++) {
+    scm::decoded_instruction_t * text = mem_from_text.fetch(pc);
+    scm::decoded_instruction_t * image = mem_from_image.fetch(pc);
+    if (text->getFullInstruction() != image->getFullInstruction() || text->getType() != image->getType() || 
+        text->getOpcode() != image->getOpcode() || text->getOpIO() != image->getOpIO())
+      return 1;
+    for (int op = 1; op <= MAX_NUM_OPERANDS; op++) {
+      if (text->getOp(op).type != image->getOp(op).type || text->getOp(op).read != image->getOp(op).read || text->getOp(op).write != image->getOp(op).write)
+        return 1;
+      if (text->getOp(op).type == scm::operand_t::REGISTER && text->getOp(op).value.reg.reg_ptr != image->getOp(op).value.reg.reg_ptr)
+        return 1;
+      if (text->getOp(op).type == scm::operand_t::IMMEDIATE_VAL && text->getOp(op).value.immediate != image->getOp(op).value.immediate)
+        return 1;
+    }
+  }
+
+  // Basic blocks: [0], [1, 3] (loop), [4], [5]
+  const scm::program_blocks & blocks = mem_from_text.getBlocks();
+  if (blocks.numBlocks() != 4 || blocks.blockAt(2) != &blocks.getBlock(1) || blocks.getBlock(1).last_pc != 3)
+    return 1;
+  const scm::basic_block_t & loop = blocks.getBlock(1);
+  if (loop.successors.size() != 2 || loop.successors[0] != 2 || loop.successors[1] != 1)
+    return 1;
+
+  // Undefined labels and codelets that are not registered
+  valid_program.open("test_program.scm");
+  valid_program << "JMPLBL nowhere;" << std::endl << "COMMIT;" << std::endl;
+  valid_program.close();
+  if (scm::program_image::assemble(fileName, imageName, error))
+    return 1;
+  valid_program.open("test_program.scm");
+  valid_program << "COD not_a_codelet R64B_1;" << std::endl << "COMMIT;" << std::endl;
+  valid_program.close();
+  if (!scm::program_image::assemble(fileName, imageName, error))
+    return 1;
+  scm::inst_mem_module mem_unknown_codelet(imageName, &reg_file_m);
+  if (mem_unknown_codelet.isValid())
+    return 1;
+  std::remove(imageName);
+
+  // Directives are expanded by the loader
+  std::ofstream directives("test_program.scm");
+  directives << ".set COPIES 3" << std::endl
+             << ".macro inc reg, amount" << std::endl
+             << "  ADD \\reg, \\reg, \\amount;" << std::endl
+             << ".endm" << std::endl
+             << ".unroll i, COPIES" << std::endl
+             << "copy_\\@:" << std::endl
+             << "  inc R64B_\\{i+1}, \\{i*8};" << std::endl
+             << ".endr" << std::endl
+             << ".rept 2" << std::endl
+             << "  JMPLBL copy_3;" << std::endl
+             << ".endr" << std::endl
+             << "COMMIT;" << std::endl;
+  directives.close();
+  scm::inst_mem_module mem_directives(fileName, &reg_file_m);
+  if (!mem_directives.isValid() || mem_directives.getMemSize() != 6 || mem_directives.getMemoryLabel("copy_3") != 1)
+    return 1;
+  if (mem_directives.fetch(2)->getFullInstruction() != "ADD R64B_3, R64B_3, 16")
+    return 1;
+
+  // Codelets have up to MAX_NUM_OPERANDS operands
+  scm::decoded_instruction_t * wide = nullptr;
+  std::string label;
+  if (scm::instructions::parseLine("COD gemm R64B_1, R64B_2, R64B_3, R64B_4, 5, 6, 7, R64B_8;", &wide, label, error) != scm::instructions::INSTRUCTION_LINE)
+    return 1;
+  if (wide->getNumOps() != 8 || wide->getOpStr(8) != "R64B_8" || wide->getFullInstruction() != "gemm R64B_1, R64B_2, R64B_3, R64B_4, 5, 6, 7, R64B_8")
+    return 1;
+  delete wide;
+  if (scm::instructions::parseLine("COD gemm R64B_1, 2, 3, 4, 5, 6, 7, 8, 9;", &wide, label, error) != scm::instructions::INVALID_LINE)
+    return 1;
+  delete wide;
+
+  // Streamed programs. Forward labels are resolved when they are used
+  std::ofstream streamed("test_program.scm");
+  streamed << "JMPLBL end;" << std::endl
+           << "LDIMM R64B_1, 5;" << std::endl
+           << "end:" << std::endl
+           << "COMMIT;";
+  streamed.close();
+  scm::inst_mem_module::setStreaming(true);
+  {
+    scm::inst_mem_module mem_streamed(fileName, &reg_file_m);
+    if (!mem_streamed.isValid() || !mem_streamed.isStreaming())
+      return 1;
+    if (mem_streamed.fetch(0)->getOp1().type != scm::operand_t::LABEL || static_cast<int>(mem_streamed.fetch(0)->getOp1().value.immediate) != -1)
+      return 1;
+    if (mem_streamed.resolveLabel("end") != 2 || mem_streamed.fetch(2)->getType() != scm::COMMIT || mem_streamed.fetch(3) != nullptr)
+      return 1;
+    if (mem_streamed.resolveLabel("nowhere") != -1 || mem_streamed.getMemSize() != 3)
+      return 1;
+  }
+
+  // Straight line programs only keep a window of instructions in memory
+  const uint32_t numInsts = 2 * STREAM_WINDOW_SIZE;
+  streamed.open("test_program.scm");
+  for (uint32_t i = 0; i < numInsts; i++)
+    streamed << "ADD R64B_1, R64B_1, " << i << ";" << std::endl;
+  streamed << "COMMIT;" << std::endl;
+  streamed.close();
+  {
+    scm::inst_mem_module mem_streamed(fileName, &reg_file_m);
+    for (uint32_t pc = 0; pc <= numInsts; pc++)
+      if (mem_streamed.fetch(pc) == nullptr)
+        return 1;
+    if (mem_streamed.fetch(numInsts)->getType() != scm::COMMIT || mem_streamed.fetch(0) != nullptr || mem_streamed.getMemSize() != numInsts + 1)
+      return 1;
+  }
+  scm::inst_mem_module::setStreaming(false);
+  std::remove(fileName);
 
   return 0;
 }
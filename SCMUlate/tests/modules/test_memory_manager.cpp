@@ -0,0 +1,81 @@
+#include "memory_manager.hpp"
+#include "register.hpp"
+#include <fstream>
+
+#define TEST_L2_SIZE (64l*1024l*1024l)
+
+int main () {
+  scm::memory_manager_module mem_manager(TEST_L2_SIZE, scm::PLACE_FIRST_TOUCH, scm::PAGES_THP);
+  if (!mem_manager.isValid())
+    return 1;
+
+  mem_manager.firstTouch(0, TEST_L2_SIZE/2);
+  l2_memory_t memory = mem_manager.getL2Memory();
+  for (long i = 0; i < TEST_L2_SIZE; i += 4096)
+    if (memory[i] != 0)
+      return 1;
+  memory[TEST_L2_SIZE - 1] = 18;
+
+  scm::reg_file_module reg_file_m(&mem_manager);
+  for (int i = 0; i < 8; i++)
+    if (reg_file_m.getRegisterByName("64B", 1)[i] != 0)
+      return 1;
+  for (int i = 0; i < 8; i++) reg_file_m.getRegisterByName("64B", 1)[i] = 18;
+  reg_file_m.dumpRegister("64B", 1);
+
+  // File backed regions
+  std::ofstream input("test_mem_input.bin", std::ios::binary);
+  for (int i = 0; i < 8192; i++) input.put(static_cast<char>(i));
+  input.close();
+  std::ofstream manifest("test_mem_manifest.txt");
+  manifest << "# name offset size mode path" << std::endl
+           << "input 0x100000 0 ro test_mem_input.bin" << std::endl
+           << "copy 0x200000 4096 cow test_mem_input.bin" << std::endl
+           << "output 0x300000 8192 rw test_mem_output.bin" << std::endl;
+  manifest.close();
+  if (!mem_manager.loadManifest("test_mem_manifest.txt"))
+    return 1;
+  mem_manager.dumpManifest(std::cout);
+
+  const scm::file_region_t * inputRegion = mem_manager.getFileRegion("input");
+  const scm::file_region_t * copyRegion = mem_manager.getFileRegion("copy");
+  const scm::file_region_t * outputRegion = mem_manager.getFileRegion("output");
+  if (inputRegion == nullptr || copyRegion == nullptr || outputRegion == nullptr || inputRegion->size != 8192)
+    return 1;
+  for (int i = 0; i < 8192; i++) {
+    if (memory[inputRegion->offset + i] != static_cast<unsigned char>(i))
+      return 1;
+    memory[outputRegion->offset + i] = memory[inputRegion->offset + i] + 1;
+  }
+  memory[copyRegion->offset] = 18;
+  if (!mem_manager.syncFiles())
+    return 1;
+
+  std::ifstream output("test_mem_output.bin", std::ios::binary);
+  for (int i = 0; i < 8192; i++)
+    if (static_cast<unsigned char>(output.get()) != static_cast<unsigned char>(i + 1))
+      return 1;
+  // Copy on write must not modify the file
+  if (memory[inputRegion->offset] != 0)
+    return 1;
+
+  // With explicit huge pages the file regions take whole huge pages, even if the
+  // hugetlb pool is empty and the L2 memory fell back to transparent huge pages
+  scm::memory_manager_module huge_manager(TEST_L2_SIZE, scm::PLACE_DEFAULT, scm::PAGES_HUGETLB);
+  if (!huge_manager.isValid() || huge_manager.getFilePageSize() != MEM_HUGE_PAGE_SIZE)
+    return 1;
+  std::ofstream hugeInput("test_mem_huge.bin", std::ios::binary);
+  for (long i = 0; i < MEM_HUGE_PAGE_SIZE; i++) hugeInput.put(static_cast<char>(i));
+  hugeInput.close();
+  if (huge_manager.mapFile("small_offset", "test_mem_huge.bin", 0x1000, MEM_HUGE_PAGE_SIZE, scm::FILE_READ_ONLY) ||
+      huge_manager.mapFile("small_size", "test_mem_huge.bin", MEM_HUGE_PAGE_SIZE, 4096, scm::FILE_READ_ONLY) ||
+      huge_manager.mapFile("small_output", "test_mem_huge_output.bin", MEM_HUGE_PAGE_SIZE, 8192, scm::FILE_WRITE_BACK))
+    return 1;
+  if (!huge_manager.mapFile("huge", "test_mem_huge.bin", MEM_HUGE_PAGE_SIZE, 0, scm::FILE_READ_ONLY))
+    return 1;
+  for (long i = 0; i < MEM_HUGE_PAGE_SIZE; i += 4096)
+    if (huge_manager.getL2Memory()[MEM_HUGE_PAGE_SIZE + i] != static_cast<unsigned char>(i))
+      return 1;
+
+  return 0;
+}
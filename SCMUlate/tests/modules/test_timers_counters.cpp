@@ -1,5 +1,7 @@
 #include "timers_counters.hpp"
 #include <math.h>
+#include <cstring>
+#include <cstdio>
 
 #define WASTE_TIME(aVar) for(int i = 0; i < 10000000; i++) pow(aVar,0.5)
 
@@ -20,6 +22,99 @@ int main () {
   WASTE_TIME(aVar);
   timers.addEvent("test2", scm::SYS_START, "test2");
 
+  // Events added by ID. Descriptions are resolved from the instruction ID when the timers are dumped
+  scm::timer_id_t test3 = timers.addTimer("test3", scm::SU_TIMER);
+  if (test3 != timers.getTimerID("test3") || timers.addTimer("test1", scm::SYS_TIMER) != timers.getTimerID("test1"))
+    return 1;
+  timers.internInstruction(7, "ADD R64B_1, R64B_1, 1");
+  if (!timers.hasInstruction(7) || timers.hasInstruction(6))
+    return 1;
+  timers.addEvent(test3, scm::FETCH_DECODE_INSTRUCTION, timers.instructionID(7));
+  timers.addEvent(test3, scm::SU_IDLE);
+  // Another program takes new IDs, the text of the previous one is kept for its events
+  timers.newProgram();
+  if (timers.hasInstruction(7) || timers.instructionID(7) == 7)
+    return 1;
+  timers.internInstruction(7, "SUB R64B_1, R64B_1, 1");
+  if (!timers.hasInstruction(7))
+    return 1;
+  timers.addEvent(test3, scm::FETCH_DECODE_INSTRUCTION, timers.instructionID(7));
+  timers.addEvent(test3, scm::SU_IDLE);
+
+  // More events than the ring holds
+  scm::timer_id_t test4 = timers.addTimer("test4", scm::SYS_TIMER);
+  for (int i = 0; i < TRACE_RING_SIZE + 10; i++)
+    timers.addEvent(test4, scm::SYS_START);
+
   timers.dumpTimers();
+
+  // Binary trace streamed by the flusher. The ring is refilled several times
+  {
+    scm::timers_counters streamed;
+    scm::timer_id_t test5 = streamed.addTimer("test5", scm::SU_TIMER);
+    if (!streamed.setTraceOutput("test_trace.bin") || !streamed.isStreaming())
+      return 1;
+    const uint64_t numEvents = 3 * TRACE_RING_SIZE + 10;
+    for (uint64_t i = 0; i < numEvents; i++)
+      streamed.addEvent(test5, scm::FETCH_DECODE_INSTRUCTION, i);
+    streamed.dumpTimers();
+    if (streamed.isStreaming())
+      return 1;
+
+    std::FILE * file = std::fopen("test_trace.bin", "rb");
+    if (file == nullptr)
+      return 1;
+    char magic[8];
+    uint32_t header[4];
+    if (std::fread(magic, 1, 8, file) != 8 || std::memcmp(magic, TRACE_FILE_MAGIC, 8) != 0)
+      return 1;
+    if (std::fread(header, sizeof(uint32_t), 4, file) != 4 || header[0] != TRACE_FILE_VERSION || header[1] != sizeof(scm::trace_record_t))
+      return 1;
+    // The records are in order, and the footer is after them
+    scm::trace_record_t rec;
+    for (uint64_t i = 0; i < numEvents; i++)
+      if (std::fread(&rec, sizeof(rec), 1, file) != 1 || rec.inst_id != i || rec.timer_id != test5)
+        return 1;
+    uint64_t footerOffset;
+    char endMagic[8];
+    std::fseek(file, -16, SEEK_END);
+    if (std::fread(&footerOffset, sizeof(footerOffset), 1, file) != 1 || std::fread(endMagic, 1, 8, file) != 8)
+      return 1;
+    std::fclose(file);
+    if (footerOffset != 24 + numEvents * sizeof(scm::trace_record_t) || std::strcmp(endMagic, TRACE_FILE_END_MAGIC) != 0)
+      return 1;
+  }
+
+  // Trace modes
+  {
+    scm::timers_counters modes;
+    if (modes.setTraceMode("sample:0") || modes.setTraceMode("window:3") || modes.setTraceMode("time:2-1") || modes.setTraceMode("sampled"))
+      return 1;
+    if (!modes.setTraceMode("window:2-4"))
+      return 1;
+    bool window[] = {false, false, true, true, true, false, false};
+    for (uint32_t pc = 0; pc < 7; pc++)
+      if (modes.traceInstruction(pc) != window[pc])
+        return 1;
+    if (!modes.setTraceMode("sample:1:5-6") || modes.traceInstruction(4) || !modes.traceInstruction(5) || modes.traceInstruction(7))
+      return 1;
+
+    // One of every two instructions. The idle event after a traced instruction closes its slice
+    scm::timer_id_t test6 = modes.addTimer("test6", scm::SU_TIMER);
+    if (!modes.setTraceMode("sample:2") || !modes.setTraceOutput("test_trace_sampled.bin"))
+      return 1;
+    for (uint32_t pc = 0; pc < 10; pc++) {
+      modes.addEvent(test6, scm::FETCH_DECODE_INSTRUCTION, pc, modes.traceInstruction(pc));
+      modes.addEvent(test6, scm::SU_IDLE);
+    }
+    modes.dumpTimers();
+    std::FILE * file = std::fopen("test_trace_sampled.bin", "rb");
+    uint64_t footerOffset;
+    if (file == nullptr || std::fseek(file, -16, SEEK_END) != 0 || std::fread(&footerOffset, sizeof(footerOffset), 1, file) != 1)
+      return 1;
+    std::fclose(file);
+    if (footerOffset != 24 + 10 * sizeof(scm::trace_record_t))
+      return 1;
+  }
   return 0;
 }
@@ -0,0 +1,52 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "program_image.hpp"
+#include "program_preprocessor.hpp"
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// SCM assembler. Converts a program in text into a program image that the
+// instruction memory maps without parsing it.
+//
+// Usage: scm-as <program.scm> [-o <image>] [-D NAME=VALUE ...]
+// The default image name is the program name with the extension .scmb
+
+int main (int argc, char * argv[]) {
+  char * programName = nullptr;
+  std::string imageName;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+      imageName = argv[++i];
+    else if (strcmp(argv[i], "-D") == 0 && i + 1 < argc) {
+      if (!scm::program_preprocessor::predefine(argv[++i])) {
+        std::cout << "Invalid definition " << argv[i] << ". Use -D NAME=VALUE" << std::endl;
+        return 1;
+      }
+    }
+    else if (programName == nullptr && argv[i][0] != '-')
+      programName = argv[i];
+    else {
+      programName = nullptr;
+      break;
+    }
+  }
+  if (programName == nullptr) {
+    std::cout << "Usage: " << argv[0] << " <program.scm> [-o <image>] [-D NAME=VALUE ...]" << std::endl;
+    return 1;
+  }
+  if (imageName.empty()) {
+    imageName = programName;
+    size_t ext = imageName.rfind(".scm");
+    if (ext != std::string::npos && ext + 4 == imageName.size())
+      imageName.erase(ext);
+    imageName += ".scmb";
+  }
+
+  std::string error;
+  if (!scm::program_image::assemble(programName, imageName.c_str(), error)) {
+    std::cout << "scm-as: " << error << std::endl;
+    return 1;
+  }
+  return 0;
+}
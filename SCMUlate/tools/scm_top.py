@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+
+''' Shows the live metrics of a running SCMUlate machine (SCMUlate -metrics <output>).
+
+The input is the file written by the machine, which is followed as with tail -f,
+or unix:<path> to connect to the socket of the machine. Each sample is printed as
+a row. A run is marked STALLED when no instruction retired for --stall samples,
+and STARVED when the CUs are mostly idle while the instruction window is full
+(the instructions in the window wait for each other, so the SU cannot keep the
+CUs busy). See live_metrics.hpp for the format.
+'''
+
+import argparse
+import json
+import socket
+import sys
+import time
+
+def follow_file(fileName, fromStart):
+    with open(fileName, "r") as f:
+        if not fromStart:
+            f.seek(0, 2)
+        partial = ""
+        while True:
+            line = f.readline()
+            if not line:
+                time.sleep(0.2)
+                continue
+            partial += line
+            if partial.endswith("\n"):
+                yield partial
+                partial = ""
+
+def follow_socket(path):
+    conn = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    conn.connect(path)
+    partial = b""
+    while True:
+        data = conn.recv(4096)
+        if not data:
+            return
+        partial += data
+        while b"\n" in partial:
+            line, partial = partial.split(b"\n", 1)
+            yield line.decode("utf-8", "replace")
+
+def human(value):
+    for unit in ["", "K", "M", "G"]:
+        if abs(value) < 1000:
+            return "%.1f%s" % (value, unit)
+        value /= 1000.0
+    return "%.1fT" % value
+
+def main():
+    parser = argparse.ArgumentParser(description='Shows the live metrics of a running SCMUlate machine')
+    parser.add_argument('input', help='Metrics file, or unix:<path> for the socket of the machine')
+    parser.add_argument('--all', dest='fromStart', action='store_true', help='Show the samples already in the file')
+    parser.add_argument('--stall', dest='stall', type=int, default=3, help='Samples without retired instructions to report a stall (default 3)')
+    parser.add_argument('--starved', dest='starved', type=float, default=0.1, help='Average CU busy fraction under which a run with a full window is starved (default 0.1)')
+    args = parser.parse_args()
+
+    try:
+        if args.input.startswith("unix:"):
+            lines = follow_socket(args.input[5:])
+        else:
+            lines = follow_file(args.input, args.fromStart)
+        header = "%9s %8s %10s %10s %6s %6s %7s %10s %6s  %s" % ("t(s)", "PC", "retired", "inst/s", "window", "ranges", "renamed", "bytes/s", "CUs", "status")
+        print(header)
+        idle = 0
+        windowSize = 128
+        for line in lines:
+            try:
+                sample = json.loads(line)
+            except ValueError:
+                continue
+            if "metrics" in sample:
+                windowSize = sample["window_size"]
+                print("# %d CUs, window of %d instructions, a sample every %d ms" % (sample["cus"], sample["window_size"], sample["interval_ms"]))
+                continue
+            busy = sample["cu_busy"]
+            avgBusy = sum(busy) / len(busy) if busy else 0
+            idle = idle + 1 if sample["ips"] == 0 else 0
+            status = []
+            if idle >= args.stall:
+                status.append("STALLED at PC %d" % sample["pc"])
+            elif sample["window"] >= windowSize and avgBusy < args.starved and busy:
+                status.append("STARVED")
+            if sample.get("done"):
+                status.append("done")
+            print("%9.3f %8d %10d %10s %6d %6d %7d %10s %5.0f%%  %s" % (sample["t"], sample["pc"], sample["retired"], human(sample["ips"]),
+                  sample["window"], sample["ranges"], sample["renamed"], human(sample["bps"]), avgBusy * 100, " ".join(status)), flush=True)
+            if sample.get("done"):
+                return
+    except (OSError, KeyError) as e:
+        print("Error reading the metrics:", e, file=sys.stderr)
+        exit(1)
+    except KeyboardInterrupt:
+        pass
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,1004 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "timers_counters.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// SCM trace analyzer. Summarizes a trace of SCMUlate without plotting it: the
+// utilization of each unit, a histogram of the idle gaps of the CUs, the latency
+// of the SU around each execution, the distribution of the durations of each
+// instruction type (codelet or mnemonic), and an estimate of the critical path.
+//
+// The input is the JSON dump of the timers (trace.json) or the binary trace
+// streamed with -trace. They are read once, in chunks, without building the
+// document in memory. Only the executions of the CUs and the fetch and retire
+// events of the SU are kept (about 60 bytes per executed instruction).
+//
+// Usage: scm-trace <trace> [-csv <prefix>] [-json <file>]
+// -csv writes <prefix>units.csv, <prefix>events.csv, <prefix>idle.csv,
+// <prefix>instructions.csv, <prefix>latency.csv and <prefix>critical_path.csv.
+// With -json - the JSON summary is written to stdout instead of the report.
+
+namespace {
+
+  const uint32_t NO_KEY = std::numeric_limits<uint32_t>::max();
+  const double NO_TIME = std::numeric_limits<double>::quiet_NaN();
+  // Idle gaps of the CUs. Bucket 0 is under 1 us, bucket i is [2^(i-1), 2^i) us. The last one is open
+  const int IDLE_BUCKETS = 24;
+
+  double bucketLow(int bucket) { return bucket == 0 ? 0 : std::ldexp(1.0, bucket - 1); }
+
+  const char * counterTypeName(int type) {
+    static const char * names[] = {"SYS_TIMER", "SU_TIMER", "MEM_TIMER", "CUMEM_TIMER"};
+    return type >= scm::SYS_TIMER && type <= scm::CUMEM_TIMER ? names[type] : "UNKNOWN";
+  }
+
+  // Same slices as traceplot.py: the IDLE, START and END events are not work
+  bool isMarker(int type, int event) {
+    std::string name = scm::eventName(static_cast<scm::counter_type>(type), event);
+    auto endsWith = [&](const char * suffix) {
+      size_t len = std::strlen(suffix);
+      return name.size() >= len && name.compare(name.size() - len, len, suffix) == 0;
+    };
+    return endsWith("IDLE") || endsWith("START") || endsWith("END");
+  }
+
+  void writeJSONString(std::ostream & out, std::string const & str) {
+    out << '"';
+    for (char c : str) {
+      if (c == '"' || c == '\\')
+        out << '\\' << c;
+      else if (static_cast<unsigned char>(c) < 0x20)
+        out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+      else
+        out << c;
+    }
+    out << '"';
+  }
+
+  /** \brief Pull reader of JSON. Enough for the dump of timers_counters::dumpTimers */
+  class json_reader {
+    private:
+      std::FILE * file;
+      std::vector<char> buffer;
+      size_t pos, len;
+      bool fill() {
+        this->len = std::fread(this->buffer.data(), 1, this->buffer.size(), this->file);
+        this->pos = 0;
+        return this->len > 0;
+      }
+    public:
+      json_reader(std::FILE * f) : file(f), buffer(1 << 20), pos(0), len(0) { }
+      int get() {
+        if (this->pos == this->len && !fill())
+          return EOF;
+        return static_cast<unsigned char>(this->buffer[this->pos++]);
+      }
+      /** \brief next character that is not a space, without consuming it */
+      int peek() {
+        while (true) {
+          if (this->pos == this->len && !fill())
+            return EOF;
+          char c = this->buffer[this->pos];
+          if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+            return static_cast<unsigned char>(c);
+          this->pos++;
+        }
+      }
+      bool expect(char c) {
+        if (peek() != c)
+          return false;
+        this->pos++;
+        return true;
+      }
+      bool string(std::string & out) {
+        out.clear();
+        if (!expect('"'))
+          return false;
+        for (int c = get(); c != '"'; c = get()) {
+          if (c == EOF)
+            return false;
+          if (c == '\\') {
+            c = get();
+            if (c == 'n')
+              c = '\n';
+            else if (c == 't')
+              c = '\t';
+            else if (c == 'u') {
+              for (int i = 0; i < 4; i++)
+                get();
+              c = '?';
+            } else if (c == EOF)
+              return false;
+          }
+          out.push_back(static_cast<char>(c));
+        }
+        return true;
+      }
+      bool number(double & out) {
+        char digits[64];
+        size_t n = 0;
+        for (int c = peek(); c != EOF && (std::isdigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'); c = peek()) {
+          if (n < sizeof(digits) - 1)
+            digits[n++] = static_cast<char>(c);
+          this->pos++;
+        }
+        digits[n] = '\0';
+        char * end;
+        out = std::strtod(digits, &end);
+        return n > 0 && *end == '\0';
+      }
+      /** \brief skip any value */
+      bool skip() {
+        int c = peek();
+        std::string str;
+        if (c == '"')
+          return string(str);
+        if (c == '{' || c == '[') {
+          char close = c == '{' ? '}' : ']';
+          this->pos++;
+          if (expect(close))
+            return true;
+          do {
+            if (close == '}' && (!string(str) || !expect(':')))
+              return false;
+            if (!skip())
+              return false;
+          } while (expect(','));
+          return expect(close);
+        }
+        // Numbers, true, false and null
+        size_t n = 0;
+        for (c = peek(); c != EOF && (std::isalnum(c) || c == '-' || c == '+' || c == '.'); c = peek(), n++)
+          this->pos++;
+        return n > 0;
+      }
+  };
+
+  struct distribution_t {
+    uint64_t count;
+    double total, min, p50, p90, p99, max;
+    distribution_t() : count(0), total(0), min(0), p50(0), p90(0), p99(0), max(0) { }
+  };
+
+  /** \brief count, total and percentiles (nearest rank) of the values. Sorts them */
+  distribution_t summarize(std::vector<double> & values) {
+    distribution_t dist;
+    if (values.empty())
+      return dist;
+    std::sort(values.begin(), values.end());
+    dist.count = values.size();
+    for (double value : values)
+      dist.total += value;
+    auto rank = [&](double p) { return values[std::min(values.size() - 1, static_cast<size_t>(std::ceil(p * values.size())) - 1)]; };
+    dist.min = values.front();
+    dist.p50 = rank(0.5);
+    dist.p90 = rank(0.9);
+    dist.p99 = rank(0.99);
+    dist.max = values.back();
+    return dist;
+  }
+
+  class trace_analyzer {
+    private:
+      /** \brief a timer of the trace (the machine, the SU or a CU) */
+      struct unit_t {
+        std::string name;
+        int type;
+        uint64_t events;
+        double first, last;
+        int prevEvent;
+        uint32_t prevKey;
+        double prevTime;
+        double time[TRACE_MAX_EVENT_TYPES];     /**< Time in the slices of each event */
+        uint64_t slices[TRACE_MAX_EVENT_TYPES];
+        uint64_t idle[IDLE_BUCKETS];
+        unit_t(std::string n, int t) : name(n), type(t), events(0), first(0), last(0), prevEvent(0), prevKey(NO_KEY), prevTime(0) {
+          std::fill(time, time + TRACE_MAX_EVENT_TYPES, 0.0);
+          std::fill(slices, slices + TRACE_MAX_EVENT_TYPES, 0);
+          std::fill(idle, idle + IDLE_BUCKETS, 0);
+        }
+      };
+      /** \brief execution of an instruction in a CU, and the SU events of the same instance */
+      struct execution_t {
+        double start, end;
+        double fetch, retire; /**< NO_TIME if they are not in the trace */
+        uint32_t key;
+        uint32_t unit;
+      };
+      /** \brief fetch or retire (DISPATCH_INSTRUCTION) of an instruction in the SU */
+      struct su_event_t {
+        uint32_t key;
+        double time;
+        bool operator<(su_event_t const & other) const { return key != other.key ? key < other.key : time < other.time; }
+      };
+
+      std::string traceName;
+      uint64_t totalEvents;
+      std::vector<unit_t> units;
+      std::vector<execution_t> executions;
+      std::vector<su_event_t> fetches, retires;
+      // Keys of the instructions. The description of the event in JSON, the instruction ID in the binary trace
+      std::vector<std::string> keyNames;
+      std::unordered_map<std::string, uint32_t> descriptionKeys;
+      std::unordered_map<uint32_t, uint32_t> instructionKeys;
+      std::map<std::string, std::map<std::string, std::string> > stats;
+
+      // Results
+      double runStart, runEnd;
+      std::vector<std::string> typeNames;
+      std::vector<uint32_t> keyTypes;
+      std::vector<distribution_t> durations, issues, retirements; /**< Indexed by type */
+      distribution_t allIssues, allRetirements;
+      double totalExecuting;
+      std::vector<uint32_t> path;   /**< Executions of the critical path, from the first one */
+      double pathExecuting;
+
+      uint32_t addUnit(std::string const & name, int type) {
+        this->units.emplace_back(name, type);
+        return this->units.size() - 1;
+      }
+      uint32_t descriptionKey(std::string const & desc);
+      uint32_t instructionKey(uint32_t inst_id, std::map<uint32_t, std::string> const & instructions, std::vector<std::string> const & descriptions);
+      void event(uint32_t unit, int event, double time, uint32_t key);
+      void slice(uint32_t unit, int event, uint32_t key, double start, double end);
+      bool readStats(json_reader & in);
+      void matchInstances();
+      void criticalPath();
+      static std::string instructionType(std::string const & name);
+
+    public:
+      trace_analyzer(std::string name) : traceName(name), totalEvents(0), runStart(0), runEnd(0), totalExecuting(0), pathExecuting(0) { }
+      bool readJSON(std::FILE * file, std::string & error);
+      bool readBinary(std::FILE * file, std::string & error);
+      void analyze();
+      void printReport(std::ostream & out);
+      bool writeCSV(std::string const & prefix);
+      void writeJSON(std::ostream & out);
+  };
+
+  uint32_t trace_analyzer::descriptionKey(std::string const & desc) {
+    if (desc.empty())
+      return NO_KEY;
+    auto found = this->descriptionKeys.find(desc);
+    if (found != this->descriptionKeys.end())
+      return found->second;
+    this->keyNames.push_back(desc);
+    this->descriptionKeys.emplace(desc, this->keyNames.size() - 1);
+    return this->keyNames.size() - 1;
+  }
+
+  uint32_t trace_analyzer::instructionKey(uint32_t inst_id, std::map<uint32_t, std::string> const & instructions, std::vector<std::string> const & descriptions) {
+    if (inst_id == NO_INSTRUCTION)
+      return NO_KEY;
+    auto found = this->instructionKeys.find(inst_id);
+    if (found != this->instructionKeys.end())
+      return found->second;
+    // Same text as timers_counters::resolveDescription
+    std::string name;
+    if (inst_id & DESCRIPTION_ID_BIT) {
+      uint32_t index = inst_id & ~DESCRIPTION_ID_BIT;
+      name = index < descriptions.size() ? descriptions[index] : std::string();
+    } else {
+      auto text = instructions.find(inst_id);
+      name = text != instructions.end() ? text->second : "PC = " + std::to_string(inst_id);
+    }
+    this->keyNames.push_back(name);
+    this->instructionKeys.emplace(inst_id, this->keyNames.size() - 1);
+    return this->keyNames.size() - 1;
+  }
+
+  void trace_analyzer::event(uint32_t unitID, int event, double time, uint32_t key) {
+    unit_t & unit = this->units[unitID];
+    this->totalEvents++;
+    if (unit.events++ == 0)
+      unit.first = time;
+    else
+      slice(unitID, unit.prevEvent, unit.prevKey, unit.prevTime, time);
+    unit.last = time;
+    unit.prevEvent = event;
+    unit.prevKey = key;
+    unit.prevTime = time;
+  }
+
+  void trace_analyzer::slice(uint32_t unitID, int event, uint32_t key, double start, double end) {
+    unit_t & unit = this->units[unitID];
+    double duration = end - start;
+    if (event >= 0 && event < TRACE_MAX_EVENT_TYPES) {
+      unit.time[event] += duration;
+      unit.slices[event]++;
+    }
+    if (unit.type == scm::SU_TIMER && key != NO_KEY) {
+      if (event == scm::FETCH_DECODE_INSTRUCTION)
+        this->fetches.push_back({key, start});
+      else if (event == scm::DISPATCH_INSTRUCTION)
+        this->retires.push_back({key, start});
+    } else if (unit.type == scm::CUMEM_TIMER) {
+      if (event == scm::CUMEM_IDLE) {
+        int bucket = 0;
+        for (double us = duration * 1e6; bucket < IDLE_BUCKETS - 1 && us >= bucketLow(bucket + 1); bucket++);
+        unit.idle[bucket]++;
+      } else if ((event == scm::CUMEM_EXECUTION_COD || event == scm::CUMEM_EXECUTION_MEM) && key != NO_KEY) {
+        this->executions.push_back({start, end, NO_TIME, NO_TIME, key, unitID});
+      }
+    }
+  }
+
+  bool trace_analyzer::readStats(json_reader & in) {
+    std::string group, key, value;
+    if (!in.expect('{'))
+      return false;
+    if (in.expect('}'))
+      return true;
+    do {
+      if (!in.string(group) || !in.expect(':') || !in.expect('{'))
+        return false;
+      if (in.expect('}'))
+        continue;
+      do {
+        if (!in.string(key) || !in.expect(':') || !in.string(value))
+          return false;
+        this->stats[group][key] = value;
+      } while (in.expect(','));
+      if (!in.expect('}'))
+        return false;
+    } while (in.expect(','));
+    return in.expect('}');
+  }
+
+  bool trace_analyzer::readJSON(std::FILE * file, std::string & error) {
+    json_reader in(file);
+    std::string name, key, typeName, desc;
+    error = "invalid JSON trace";
+    if (!in.expect('{'))
+      return false;
+    if (in.expect('}'))
+      return true;
+    do {
+      if (!in.string(name) || !in.expect(':'))
+        return false;
+      if (name == "STATS") {
+        if (!readStats(in))
+          return false;
+        continue;
+      }
+      uint32_t unit = addUnit(name, -1);
+      if (!in.expect('{'))
+        return false;
+      if (in.expect('}'))
+        continue;
+      do {
+        if (!in.string(key) || !in.expect(':'))
+          return false;
+        if (key == "counter type") {
+          if (!in.string(typeName))
+            return false;
+          this->units[unit].type = std::atoi(typeName.c_str());
+        } else if (key == "events") {
+          if (!in.expect('['))
+            return false;
+          if (in.expect(']'))
+            continue;
+          do {
+            int eventType = -1;
+            double value = 0;
+            desc.clear();
+            if (!in.expect('{'))
+              return false;
+            if (!in.expect('}')) {
+              do {
+                if (!in.string(key) || !in.expect(':'))
+                  return false;
+                if (key == "type") {
+                  if (!in.string(typeName))
+                    return false;
+                  eventType = std::atoi(typeName.c_str());
+                } else if (key == "value") {
+                  if (!in.number(value))
+                    return false;
+                } else if (key == "description") {
+                  if (!in.string(desc))
+                    return false;
+                } else if (!in.skip()) {
+                  return false;
+                }
+              } while (in.expect(','));
+              if (!in.expect('}'))
+                return false;
+            }
+            event(unit, eventType, value, descriptionKey(desc));
+          } while (in.expect(','));
+          if (!in.expect(']'))
+            return false;
+        } else if (!in.skip()) {
+          return false;
+        }
+      } while (in.expect(','));
+      if (!in.expect('}'))
+        return false;
+    } while (in.expect(','));
+    return in.expect('}');
+  }
+
+  bool trace_analyzer::readBinary(std::FILE * file, std::string & error) {
+    // See the format in timers_counters.hpp
+    char magic[8];
+    uint32_t header[4];
+    if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic) || std::fread(header, sizeof(uint32_t), 4, file) != 4 ||
+        std::memcmp(magic, TRACE_FILE_MAGIC, sizeof(magic)) != 0) {
+      error = "not an SCMUlate trace";
+      return false;
+    }
+    const long headerSize = sizeof(magic) + sizeof(header);
+    uint32_t version = header[0], recordSize = header[1];
+    if (version != TRACE_FILE_VERSION || recordSize < 20) {
+      error = "unsupported trace version " + std::to_string(version);
+      return false;
+    }
+
+    uint64_t footerOffset;
+    char endMagic[8];
+    std::fseek(file, 0, SEEK_END);
+    long fileSize = std::ftell(file);
+    if (fileSize < headerSize + static_cast<long>(sizeof(footerOffset) + sizeof(endMagic)) ||
+        std::fseek(file, fileSize - sizeof(footerOffset) - sizeof(endMagic), SEEK_SET) != 0 ||
+        std::fread(&footerOffset, sizeof(footerOffset), 1, file) != 1 || std::fread(endMagic, 1, sizeof(endMagic), file) != sizeof(endMagic) ||
+        std::memcmp(endMagic, TRACE_FILE_END_MAGIC, sizeof(endMagic)) != 0 ||
+        footerOffset < static_cast<uint64_t>(headerSize) || footerOffset > fileSize - sizeof(footerOffset) - sizeof(endMagic)) {
+      error = "the trace has no footer (the run did not finish)";
+      return false;
+    }
+
+    // Footer
+    std::vector<char> footer(fileSize - sizeof(footerOffset) - sizeof(endMagic) - footerOffset);
+    std::fseek(file, footerOffset, SEEK_SET);
+    if (std::fread(footer.data(), 1, footer.size(), file) != footer.size()) {
+      error = "could not read the footer";
+      return false;
+    }
+    size_t pos = 0;
+    bool valid = true;
+    auto read = [&](void * value, size_t size) {
+      if (pos + size > footer.size()) {
+        valid = false;
+        std::memset(value, 0, size);
+        return;
+      }
+      std::memcpy(value, footer.data() + pos, size);
+      pos += size;
+    };
+    auto readU32 = [&]() { uint32_t value; read(&value, sizeof(value)); return value; };
+    auto readString = [&]() {
+      uint32_t length = readU32();
+      if (!valid || pos + length > footer.size()) {
+        valid = false;
+        return std::string();
+      }
+      pos += length;
+      return std::string(footer.data() + pos - length, length);
+    };
+    double secondsPerTick;
+    uint64_t initialTicks;
+    read(&secondsPerTick, sizeof(secondsPerTick));
+    read(&initialTicks, sizeof(initialTicks));
+    for (uint32_t timer = 0, numTimers = readU32(); valid && timer < numTimers; timer++) {
+      int type = readU32();
+      addUnit(readString(), type);
+    }
+    // Descriptions of the instructions by ID. Each program of a service run has its own IDs
+    std::map<uint32_t, std::string> instructions;
+    for (uint32_t inst = 0, numInsts = readU32(); valid && inst < numInsts; inst++) {
+      uint32_t inst_id = readU32();
+      uint32_t pc = readU32();
+      instructions[inst_id] = readString() + " (PC = " + std::to_string(pc) + ")";
+    }
+    std::vector<std::string> descriptions;
+    for (uint32_t desc = 0, numDescs = readU32(); valid && desc < numDescs; desc++)
+      descriptions.push_back(readString());
+    for (uint32_t hw = 0, numHW = readU32(); valid && hw < numHW; hw++)
+      readString();
+    for (uint32_t group = 0, numGroups = readU32(); valid && group < numGroups; group++) {
+      std::string groupName = readString();
+      for (uint32_t stat = 0, numStats = readU32(); valid && stat < numStats; stat++) {
+        std::string key = readString();
+        this->stats[groupName][key] = readString();
+      }
+    }
+    if (!valid) {
+      error = "invalid footer";
+      return false;
+    }
+
+    // Records, in chunks. The timers are interleaved, but the records of each timer are in order
+    const size_t chunkRecords = 4096;
+    std::vector<char> chunk(chunkRecords * recordSize);
+    uint64_t remaining = (footerOffset - headerSize) / recordSize;
+    std::fseek(file, headerSize, SEEK_SET);
+    while (remaining > 0) {
+      size_t toRead = std::min<uint64_t>(remaining, chunkRecords);
+      if (std::fread(chunk.data(), recordSize, toRead, file) != toRead) {
+        error = "truncated trace";
+        return false;
+      }
+      remaining -= toRead;
+      for (size_t rec = 0; rec < toRead; rec++) {
+        const char * record = chunk.data() + rec * recordSize;
+        uint64_t timestamp;
+        uint32_t timer, inst_id;
+        uint16_t eventID;
+        std::memcpy(&timestamp, record + offsetof(scm::trace_record_t, timestamp), sizeof(timestamp));
+        std::memcpy(&timer, record + offsetof(scm::trace_record_t, timer_id), sizeof(timer));
+        std::memcpy(&eventID, record + offsetof(scm::trace_record_t, event_id), sizeof(eventID));
+        std::memcpy(&inst_id, record + offsetof(scm::trace_record_t, inst_id), sizeof(inst_id));
+        if (timer >= this->units.size())
+          continue;
+        double time = static_cast<int64_t>(timestamp - initialTicks) * secondsPerTick;
+        event(timer, eventID, time, instructionKey(inst_id, instructions, descriptions));
+      }
+    }
+    return true;
+  }
+
+  std::string trace_analyzer::instructionType(std::string const & name) {
+    // The first word of the instruction is the codelet name or the mnemonic (as in the aggregate trace mode)
+    if (name.compare(0, 5, "PC = ") == 0)
+      return "PC_" + name.substr(5);
+    std::string type = name.substr(0, name.find_first_of(" ;,"));
+    return type.empty() ? name : type;
+  }
+
+  void trace_analyzer::matchInstances() {
+    // The fetch and the retire of each instance of a PC are in order. The execution of an instance
+    // starts after its fetch and ends before its retire. Instances without execution (e.g. the ones
+    // executed in the SU) are skipped
+    std::sort(this->fetches.begin(), this->fetches.end());
+    std::sort(this->retires.begin(), this->retires.end());
+    std::sort(this->executions.begin(), this->executions.end(), [](execution_t const & a, execution_t const & b) {
+      return a.key != b.key ? a.key < b.key : a.start < b.start;
+    });
+    for (size_t first = 0; first < this->executions.size(); ) {
+      uint32_t key = this->executions[first].key;
+      size_t last = first;
+      while (last < this->executions.size() && this->executions[last].key == key)
+        last++;
+      auto fetch = std::lower_bound(this->fetches.begin(), this->fetches.end(), su_event_t{key, -HUGE_VAL});
+      auto fetchEnd = std::lower_bound(fetch, this->fetches.end(), su_event_t{key + 1, -HUGE_VAL});
+      auto retire = std::lower_bound(this->retires.begin(), this->retires.end(), su_event_t{key, -HUGE_VAL});
+      auto retireEnd = std::lower_bound(retire, this->retires.end(), su_event_t{key + 1, -HUGE_VAL});
+      for (size_t exec = first; exec < last; exec++) {
+        execution_t & e = this->executions[exec];
+        while (fetch != fetchEnd && retire != retireEnd && retire->time < e.end) {
+          ++fetch;
+          ++retire;
+        }
+        if (fetch == fetchEnd || retire == retireEnd || fetch->time > e.start)
+          continue;
+        e.fetch = fetch->time;
+        e.retire = retire->time;
+        ++fetch;
+        ++retire;
+      }
+      first = last;
+    }
+  }
+
+  void trace_analyzer::criticalPath() {
+    // The dependencies are not in the trace. An instruction most likely waited for the last
+    // instruction that the SU retired before it started (its operands, or the fetch when the SU
+    // was stalled). The path is followed back from the execution that ended last
+    this->path.clear();
+    this->pathExecuting = 0;
+    if (this->executions.empty())
+      return;
+    std::vector<uint32_t> byRetire(this->executions.size());
+    for (uint32_t exec = 0; exec < byRetire.size(); exec++)
+      byRetire[exec] = exec;
+    auto retireOf = [&](uint32_t exec) {
+      execution_t & e = this->executions[exec];
+      return std::isnan(e.retire) ? e.end : e.retire;
+    };
+    std::sort(byRetire.begin(), byRetire.end(), [&](uint32_t a, uint32_t b) { return retireOf(a) < retireOf(b); });
+
+    uint32_t cur = 0;
+    for (uint32_t exec = 1; exec < this->executions.size(); exec++)
+      if (this->executions[exec].end > this->executions[cur].end)
+        cur = exec;
+    while (this->path.size() < this->executions.size()) {
+      this->path.push_back(cur);
+      execution_t & e = this->executions[cur];
+      auto blocker = std::upper_bound(byRetire.begin(), byRetire.end(), e.start, [&](double time, uint32_t exec) { return time < retireOf(exec); });
+      while (blocker != byRetire.begin() && (*(blocker - 1) == cur || this->executions[*(blocker - 1)].start >= e.start))
+        --blocker;
+      if (blocker == byRetire.begin())
+        break;
+      cur = *(blocker - 1);
+    }
+    std::reverse(this->path.begin(), this->path.end());
+    for (uint32_t exec : this->path)
+      this->pathExecuting += this->executions[exec].end - this->executions[exec].start;
+  }
+
+  void trace_analyzer::analyze() {
+    // The run is the slice of the machine. Without it, the span of all the events
+    bool first = true;
+    for (unit_t & unit : this->units) {
+      if (unit.events == 0)
+        continue;
+      if (unit.type == scm::SYS_TIMER && unit.events >= 2) {
+        this->runStart = unit.first;
+        this->runEnd = unit.last;
+        first = false;
+        break;
+      }
+      this->runStart = first ? unit.first : std::min(this->runStart, unit.first);
+      this->runEnd = first ? unit.last : std::max(this->runEnd, unit.last);
+      first = false;
+    }
+
+    matchInstances();
+
+    // Instruction types
+    std::map<std::string, uint32_t> typeIDs;
+    this->keyTypes.resize(this->keyNames.size());
+    for (uint32_t key = 0; key < this->keyNames.size(); key++) {
+      auto inserted = typeIDs.emplace(instructionType(this->keyNames[key]), typeIDs.size());
+      this->keyTypes[key] = inserted.first->second;
+    }
+    this->typeNames.resize(typeIDs.size());
+    for (auto & type : typeIDs)
+      this->typeNames[type.second] = type.first;
+
+    std::vector<std::vector<double> > typeDurations(this->typeNames.size()), typeIssues(this->typeNames.size()), typeRetirements(this->typeNames.size());
+    std::vector<double> allIssueValues, allRetireValues;
+    for (execution_t & e : this->executions) {
+      uint32_t type = this->keyTypes[e.key];
+      typeDurations[type].push_back(e.end - e.start);
+      this->totalExecuting += e.end - e.start;
+      if (!std::isnan(e.fetch)) {
+        typeIssues[type].push_back(e.start - e.fetch);
+        allIssueValues.push_back(e.start - e.fetch);
+        typeRetirements[type].push_back(e.retire - e.end);
+        allRetireValues.push_back(e.retire - e.end);
+      }
+    }
+    for (uint32_t type = 0; type < this->typeNames.size(); type++) {
+      this->durations.push_back(summarize(typeDurations[type]));
+      this->issues.push_back(summarize(typeIssues[type]));
+      this->retirements.push_back(summarize(typeRetirements[type]));
+    }
+    this->allIssues = summarize(allIssueValues);
+    this->allRetirements = summarize(allRetireValues);
+
+    criticalPath();
+  }
+
+  void trace_analyzer::printReport(std::ostream & out) {
+    double run = this->runEnd - this->runStart;
+    out << std::fixed << std::setprecision(6);
+    out << "Trace " << this->traceName << ": " << this->totalEvents << " events in " << this->units.size() << " units, run of " << run << " s" << std::endl;
+
+    out << std::endl << std::left << std::setw(16) << "Unit" << std::right << std::setw(12) << "events" << std::setw(12) << "busy (s)"
+        << std::setw(8) << "util" << "  time per event" << std::endl;
+    for (unit_t & unit : this->units) {
+      double busy = 0;
+      for (int event = 0; event < TRACE_MAX_EVENT_TYPES; event++)
+        if (!isMarker(unit.type, event))
+          busy += unit.time[event];
+      out << std::left << std::setw(16) << unit.name << std::right << std::setw(12) << unit.events << std::setw(12) << busy
+          << std::setw(7) << std::setprecision(2) << (run > 0 ? busy / run * 100 : 0) << "% " << std::setprecision(6);
+      for (int event = 0; event < TRACE_MAX_EVENT_TYPES; event++)
+        if (unit.slices[event] != 0 && (unit.type != scm::SYS_TIMER || event != scm::SYS_END))
+          out << " " << scm::eventName(static_cast<scm::counter_type>(unit.type), event) << " " << std::setprecision(1)
+              << (run > 0 ? unit.time[event] / run * 100 : 0) << "%" << std::setprecision(6);
+      out << std::endl;
+    }
+
+    out << std::endl << "Idle gaps of the CUs (us)" << std::endl;
+    uint64_t gaps[IDLE_BUCKETS] = {0}, maxGaps = 0;
+    for (unit_t & unit : this->units)
+      for (int bucket = 0; bucket < IDLE_BUCKETS; bucket++)
+        gaps[bucket] += unit.idle[bucket];
+    int firstBucket = IDLE_BUCKETS, lastBucket = -1;
+    for (int bucket = 0; bucket < IDLE_BUCKETS; bucket++) {
+      maxGaps = std::max(maxGaps, gaps[bucket]);
+      if (gaps[bucket] != 0) {
+        firstBucket = std::min(firstBucket, bucket);
+        lastBucket = bucket;
+      }
+    }
+    for (int bucket = firstBucket; bucket <= lastBucket; bucket++) {
+      std::string range = "[" + std::to_string(static_cast<uint64_t>(bucketLow(bucket))) + ", " +
+                          (bucket == IDLE_BUCKETS - 1 ? std::string("inf") : std::to_string(static_cast<uint64_t>(bucketLow(bucket + 1)))) + ")";
+      out << std::setw(16) << range << std::setw(12) << gaps[bucket] << " " << std::string(maxGaps ? gaps[bucket] * 50 / maxGaps : 0, '#') << std::endl;
+    }
+
+    out << std::endl << std::left << std::setw(24) << "Instruction" << std::right << std::setw(10) << "count" << std::setw(12) << "total (s)"
+        << std::setw(12) << "mean (us)" << std::setw(12) << "p50 (us)" << std::setw(12) << "p90 (us)" << std::setw(12) << "p99 (us)"
+        << std::setw(12) << "max (us)" << std::setw(12) << "issue p50" << std::setw(12) << "retire p50" << std::endl;
+    out << std::setprecision(2);
+    for (uint32_t type = 0; type < this->typeNames.size(); type++) {
+      distribution_t & dist = this->durations[type];
+      if (dist.count == 0)
+        continue;
+      out << std::left << std::setw(24) << this->typeNames[type] << std::right << std::setw(10) << dist.count << std::setw(12) << std::setprecision(6) << dist.total
+          << std::setprecision(2) << std::setw(12) << dist.total / dist.count * 1e6 << std::setw(12) << dist.p50 * 1e6 << std::setw(12) << dist.p90 * 1e6
+          << std::setw(12) << dist.p99 * 1e6 << std::setw(12) << dist.max * 1e6
+          << std::setw(12) << (this->issues[type].count ? this->issues[type].p50 * 1e6 : 0)
+          << std::setw(12) << (this->retirements[type].count ? this->retirements[type].p50 * 1e6 : 0) << std::endl;
+    }
+    out << "Latency of the SU (from the fetch to the start in a CU, and from the end to the retire), in us:" << std::endl;
+    for (int kind = 0; kind < 2; kind++) {
+      distribution_t & dist = kind == 0 ? this->allIssues : this->allRetirements;
+      out << (kind == 0 ? "  issue:  " : "  retire: ") << dist.count << " instructions, mean " << (dist.count ? dist.total / dist.count * 1e6 : 0)
+          << ", p50 " << dist.p50 * 1e6 << ", p90 " << dist.p90 * 1e6 << ", p99 " << dist.p99 * 1e6 << ", max " << dist.max * 1e6 << std::endl;
+    }
+
+    if (!this->path.empty()) {
+      execution_t & firstExec = this->executions[this->path.front()];
+      execution_t & lastExec = this->executions[this->path.back()];
+      double start = std::isnan(firstExec.fetch) ? firstExec.start : firstExec.fetch;
+      double length = lastExec.end - this->runStart;
+      std::map<std::string, std::pair<uint64_t, double> > byType;
+      for (uint32_t exec : this->path) {
+        std::pair<uint64_t, double> & type = byType[this->typeNames[this->keyTypes[this->executions[exec].key]]];
+        type.first++;
+        type.second += this->executions[exec].end - this->executions[exec].start;
+      }
+      out << std::endl << std::setprecision(6) << "Critical path (estimated): " << this->path.size() << " instructions, " << length << " s" << std::endl
+          << "  before the first fetch: " << start - this->runStart << " s, executing: " << this->pathExecuting << " s, waiting for the SU: "
+          << length - (start - this->runStart) - this->pathExecuting << " s" << std::endl
+          << "  parallelism (execution time / executing in the path): " << std::setprecision(2) << (this->pathExecuting > 0 ? this->totalExecuting / this->pathExecuting : 0) << std::endl;
+      for (auto & type : byType)
+        out << "  " << std::left << std::setw(22) << type.first << std::right << std::setw(10) << type.second.first << std::setw(12) << std::setprecision(6) << type.second.second << " s" << std::endl;
+    }
+
+    if (!this->stats.empty()) {
+      out << std::endl;
+      for (auto & group : this->stats) {
+        out << group.first << std::endl;
+        for (auto & stat : group.second)
+          out << "  " << stat.first << ": " << stat.second << std::endl;
+      }
+    }
+    out.unsetf(std::ios_base::floatfield);
+  }
+
+  bool trace_analyzer::writeCSV(std::string const & prefix) {
+    std::ofstream units(prefix + "units.csv"), events(prefix + "events.csv"), idle(prefix + "idle.csv"),
+                  insts(prefix + "instructions.csv"), latency(prefix + "latency.csv"), critical(prefix + "critical_path.csv");
+    if (!units || !events || !idle || !insts || !latency || !critical)
+      return false;
+    double run = this->runEnd - this->runStart;
+    for (std::ofstream * out : {&units, &events, &idle, &insts, &latency, &critical})
+      *out << std::setprecision(9);
+
+    units << "unit,type,events,busy_s,utilization" << std::endl;
+    events << "unit,event,slices,seconds,fraction" << std::endl;
+    idle << "unit,low_us,high_us,gaps" << std::endl;
+    for (unit_t & unit : this->units) {
+      double busy = 0;
+      for (int event = 0; event < TRACE_MAX_EVENT_TYPES; event++) {
+        if (unit.slices[event] == 0)
+          continue;
+        if (!isMarker(unit.type, event))
+          busy += unit.time[event];
+        events << unit.name << "," << scm::eventName(static_cast<scm::counter_type>(unit.type), event) << "," << unit.slices[event] << ","
+               << unit.time[event] << "," << (run > 0 ? unit.time[event] / run : 0) << std::endl;
+      }
+      units << unit.name << "," << counterTypeName(unit.type) << "," << unit.events << "," << busy << "," << (run > 0 ? busy / run : 0) << std::endl;
+      for (int bucket = 0; bucket < IDLE_BUCKETS; bucket++)
+        if (unit.idle[bucket] != 0)
+          idle << unit.name << "," << bucketLow(bucket) << "," << (bucket == IDLE_BUCKETS - 1 ? std::string("inf") : std::to_string(static_cast<uint64_t>(bucketLow(bucket + 1))))
+               << "," << unit.idle[bucket] << std::endl;
+    }
+
+    insts << "instruction,count,total_s,mean_s,min_s,p50_s,p90_s,p99_s,max_s" << std::endl;
+    latency << "instruction,latency,count,mean_s,min_s,p50_s,p90_s,p99_s,max_s" << std::endl;
+    auto writeDistribution = [](std::ostream & out, distribution_t const & dist) {
+      out << dist.count << "," << (dist.count ? dist.total / dist.count : 0) << "," << dist.min << "," << dist.p50 << ","
+          << dist.p90 << "," << dist.p99 << "," << dist.max << std::endl;
+    };
+    latency << "ALL,issue,";
+    writeDistribution(latency, this->allIssues);
+    latency << "ALL,retire,";
+    writeDistribution(latency, this->allRetirements);
+    for (uint32_t type = 0; type < this->typeNames.size(); type++) {
+      if (this->durations[type].count == 0)
+        continue;
+      distribution_t & dist = this->durations[type];
+      insts << this->typeNames[type] << "," << dist.count << "," << dist.total << "," << dist.total / dist.count << "," << dist.min << ","
+            << dist.p50 << "," << dist.p90 << "," << dist.p99 << "," << dist.max << std::endl;
+      latency << this->typeNames[type] << ",issue,";
+      writeDistribution(latency, this->issues[type]);
+      latency << this->typeNames[type] << ",retire,";
+      writeDistribution(latency, this->retirements[type]);
+    }
+
+    critical << "step,unit,instruction,fetch_s,start_s,end_s,retire_s" << std::endl;
+    for (uint32_t step = 0; step < this->path.size(); step++) {
+      execution_t & e = this->executions[this->path[step]];
+      std::string name = this->keyNames[e.key];
+      std::replace(name.begin(), name.end(), ',', ' ');
+      critical << step << "," << this->units[e.unit].name << ",\"" << name << "\"," << e.fetch << "," << e.start << "," << e.end << "," << e.retire << std::endl;
+    }
+    return true;
+  }
+
+  void trace_analyzer::writeJSON(std::ostream & out) {
+    double run = this->runEnd - this->runStart;
+    auto writeDistribution = [&](distribution_t const & dist) {
+      out << "{\"count\": " << dist.count << ", \"total\": " << dist.total << ", \"mean\": " << (dist.count ? dist.total / dist.count : 0)
+          << ", \"min\": " << dist.min << ", \"p50\": " << dist.p50 << ", \"p90\": " << dist.p90 << ", \"p99\": " << dist.p99 << ", \"max\": " << dist.max << "}";
+    };
+    out << std::setprecision(9);
+    out << "{\"trace\": ";
+    writeJSONString(out, this->traceName);
+    out << ", \"events\": " << this->totalEvents << ",\n \"run\": {\"start\": " << this->runStart << ", \"end\": " << this->runEnd << ", \"seconds\": " << run << "},\n \"units\": [";
+    for (uint32_t unitID = 0; unitID < this->units.size(); unitID++) {
+      unit_t & unit = this->units[unitID];
+      double busy = 0;
+      out << (unitID == 0 ? "\n  " : ",\n  ") << "{\"name\": ";
+      writeJSONString(out, unit.name);
+      out << ", \"type\": \"" << counterTypeName(unit.type) << "\", \"events\": " << unit.events << ", \"slices\": {";
+      bool firstEvent = true;
+      for (int event = 0; event < TRACE_MAX_EVENT_TYPES; event++) {
+        if (unit.slices[event] == 0)
+          continue;
+        if (!isMarker(unit.type, event))
+          busy += unit.time[event];
+        out << (firstEvent ? "" : ", ") << "\"" << scm::eventName(static_cast<scm::counter_type>(unit.type), event) << "\": {\"count\": "
+            << unit.slices[event] << ", \"seconds\": " << unit.time[event] << "}";
+        firstEvent = false;
+      }
+      out << "}, \"busy\": " << busy << ", \"utilization\": " << (run > 0 ? busy / run : 0);
+      if (unit.type == scm::CUMEM_TIMER) {
+        out << ", \"idle_gaps_us\": [";
+        bool firstBucket = true;
+        for (int bucket = 0; bucket < IDLE_BUCKETS; bucket++) {
+          if (unit.idle[bucket] == 0)
+            continue;
+          out << (firstBucket ? "" : ", ") << "[" << bucketLow(bucket) << ", ";
+          if (bucket == IDLE_BUCKETS - 1)
+            out << "null";
+          else
+            out << bucketLow(bucket + 1);
+          out << ", " << unit.idle[bucket] << "]";
+          firstBucket = false;
+        }
+        out << "]";
+      }
+      out << "}";
+    }
+
+    out << "],\n \"instructions\": [";
+    bool firstType = true;
+    for (uint32_t type = 0; type < this->typeNames.size(); type++) {
+      if (this->durations[type].count == 0)
+        continue;
+      out << (firstType ? "\n  " : ",\n  ") << "{\"name\": ";
+      writeJSONString(out, this->typeNames[type]);
+      out << ", \"duration\": ";
+      writeDistribution(this->durations[type]);
+      out << ", \"issue\": ";
+      writeDistribution(this->issues[type]);
+      out << ", \"retire\": ";
+      writeDistribution(this->retirements[type]);
+      out << "}";
+      firstType = false;
+    }
+    out << "],\n \"latency\": {\"issue\": ";
+    writeDistribution(this->allIssues);
+    out << ", \"retire\": ";
+    writeDistribution(this->allRetirements);
+
+    out << "},\n \"critical_path\": {";
+    if (!this->path.empty()) {
+      execution_t & firstExec = this->executions[this->path.front()];
+      double start = (std::isnan(firstExec.fetch) ? firstExec.start : firstExec.fetch) - this->runStart;
+      double length = this->executions[this->path.back()].end - this->runStart;
+      out << "\"seconds\": " << length << ", \"before_first_fetch\": " << start << ", \"executing\": " << this->pathExecuting
+          << ", \"waiting\": " << length - start - this->pathExecuting << ", \"parallelism\": " << (this->pathExecuting > 0 ? this->totalExecuting / this->pathExecuting : 0)
+          << ", \"path\": [";
+      for (uint32_t step = 0; step < this->path.size(); step++) {
+        execution_t & e = this->executions[this->path[step]];
+        out << (step == 0 ? "\n   " : ",\n   ") << "{\"unit\": ";
+        writeJSONString(out, this->units[e.unit].name);
+        out << ", \"instruction\": ";
+        writeJSONString(out, this->keyNames[e.key]);
+        out << ", \"start\": " << e.start << ", \"end\": " << e.end;
+        if (!std::isnan(e.fetch))
+          out << ", \"fetch\": " << e.fetch << ", \"retire\": " << e.retire;
+        out << "}";
+      }
+      out << "]";
+    }
+    out << "},\n \"stats\": {";
+    bool firstGroup = true;
+    for (auto & group : this->stats) {
+      out << (firstGroup ? "" : ", ");
+      writeJSONString(out, group.first);
+      out << ": {";
+      bool firstStat = true;
+      for (auto & stat : group.second) {
+        out << (firstStat ? "" : ", ");
+        writeJSONString(out, stat.first);
+        out << ": ";
+        writeJSONString(out, stat.second);
+        firstStat = false;
+      }
+      out << "}";
+      firstGroup = false;
+    }
+    out << "}}\n";
+  }
+}
+
+int main (int argc, char * argv[]) {
+  char * traceName = nullptr;
+  std::string csvPrefix, jsonName;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-csv") == 0 && i + 1 < argc)
+      csvPrefix = argv[++i];
+    else if (strcmp(argv[i], "-json") == 0 && i + 1 < argc)
+      jsonName = argv[++i];
+    else if (traceName == nullptr && argv[i][0] != '-')
+      traceName = argv[i];
+    else {
+      traceName = nullptr;
+      break;
+    }
+  }
+  if (traceName == nullptr) {
+    std::cout << "Usage: " << argv[0] << " <trace.json|binary trace> [-csv <prefix>] [-json <file>|-]" << std::endl;
+    return 1;
+  }
+
+  std::FILE * file = std::fopen(traceName, "rb");
+  if (file == nullptr) {
+    std::cout << "scm-trace: could not open " << traceName << std::endl;
+    return 1;
+  }
+  trace_analyzer analyzer(traceName);
+  std::string error;
+  char magic[sizeof(TRACE_FILE_MAGIC) - 1] = {0};
+  bool binary = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) && std::memcmp(magic, TRACE_FILE_MAGIC, sizeof(magic)) == 0;
+  std::rewind(file);
+  bool valid = binary ? analyzer.readBinary(file, error) : analyzer.readJSON(file, error);
+  std::fclose(file);
+  if (!valid) {
+    std::cout << "scm-trace: " << traceName << ": " << error << std::endl;
+    return 1;
+  }
+  analyzer.analyze();
+
+  if (jsonName != "-")
+    analyzer.printReport(std::cout);
+  if (!jsonName.empty()) {
+    if (jsonName == "-") {
+      analyzer.writeJSON(std::cout);
+    } else {
+      std::ofstream json(jsonName);
+      if (!json) {
+        std::cout << "scm-trace: could not create " << jsonName << std::endl;
+        return 1;
+      }
+      analyzer.writeJSON(json);
+    }
+  }
+  if (!csvPrefix.empty() && !analyzer.writeCSV(csvPrefix)) {
+    std::cout << "scm-trace: could not create the CSV files " << csvPrefix << "*.csv" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,283 @@
+#!/usr/bin/env python3
+
+''' Generates synthetic SCM programs with the shape of a DAG.
+
+The program has depth levels of width nodes. Each node is a synthetic codelet (see
+cod_synth.hpp) that reads the outputs of up to fan-in nodes of the previous level, and
+the output of a node is read by up to fan-out nodes of the next level. The nodes spin
+for a duration taken from a distribution, or copy a range of the SCM memory (streams).
+A stream reads the range written by an earlier stream with the overlap probability, so
+there are memory hazards. With the branch density, a node is followed by a branch that
+depends on its output (the SU stalls until it is done, the path does not change).
+
+The registers of the outputs are taken from the register classes of the mix, and a
+register is reused once all the readers of its value are in the program, so the
+program has the dependencies of the DAG plus the false dependencies of the reuse.
+R64B_0 and R64B_1 are the counter of the loop (--repeat), and the next --addr-regs
+64B registers hold the addresses of the streams.
+
+The number of nodes, the work and the critical path of an iteration are written as
+comments at the start of the program and to stderr. The work divided by the critical
+path is the parallelism of the DAG: the speedup that the machine could get with
+enough CUs and no overhead.
+
+Example, the scaling of a wide DAG of 50us codelets:
+  scmgen.py --width 16 --depth 64 --fan-in 2 --duration exp:50us -o dag.scm
+  SCMUlate -ilp ooo -i dag.scm
+'''
+
+import argparse
+import random
+import re
+import sys
+
+# Same as DEFAULT_REGISTER_CONFIG (register_config.hpp)
+DEFAULT_REGISTERS = {"64B": 160, "1L": 140, "8L": 100, "16L": 100, "256L": 60, "512L": 60, "1024L": 60, "2048L": 40}
+TIME_UNITS = {"NS": 1, "US": 1000, "MS": 1000000, "S": 1000000000}
+SIZE_UNITS = {"B": 1, "K": 1 << 10, "KB": 1 << 10, "M": 1 << 20, "MB": 1 << 20, "G": 1 << 30, "GB": 1 << 30}
+MAX_SPIN_INPUTS = 6
+MAX_STREAM_INPUTS = 3
+LOOP_REGS = 2
+
+def parse_with_unit(text, units, default):
+    match = re.fullmatch(r"\s*([0-9.]+)\s*([a-zA-Z]*)\s*", text)
+    if not match or match.group(2).upper() not in units and match.group(2) != "":
+        raise argparse.ArgumentTypeError("invalid value " + text)
+    return int(float(match.group(1)) * units[match.group(2).upper()] if match.group(2) else float(match.group(1)) * default)
+
+def parse_time(text):
+    return parse_with_unit(text, TIME_UNITS, 1)
+
+def parse_size(text):
+    return parse_with_unit(text, SIZE_UNITS, 1)
+
+def register_bytes(size):
+    return 8 if size == "64B" else int(size[:-1]) * 64
+
+class Duration:
+    ''' Distribution of the durations in ns: const:T, uniform:MIN:MAX, exp:MEAN,
+    lognormal:MEDIAN:SIGMA, bimodal:SHORT:LONG:P_LONG. Times take ns, us, ms or s '''
+    def __init__(self, text):
+        parts = text.split(":")
+        self.kind = parts[0]
+        try:
+            if self.kind == "const" and len(parts) == 2:
+                self.args = [parse_time(parts[1])]
+            elif self.kind in ("uniform", "bimodal") and len(parts) >= 3:
+                self.args = [parse_time(parts[1]), parse_time(parts[2])] + [float(p) for p in parts[3:4]]
+                if self.kind == "bimodal" and len(self.args) != 3:
+                    raise ValueError
+            elif self.kind == "exp" and len(parts) == 2:
+                self.args = [parse_time(parts[1])]
+            elif self.kind == "lognormal" and len(parts) == 3:
+                self.args = [parse_time(parts[1]), float(parts[2])]
+            else:
+                raise ValueError
+        except ValueError:
+            raise argparse.ArgumentTypeError("invalid duration " + text)
+
+    def sample(self, rng):
+        if self.kind == "const":
+            value = self.args[0]
+        elif self.kind == "uniform":
+            value = rng.uniform(self.args[0], self.args[1])
+        elif self.kind == "exp":
+            value = rng.expovariate(1.0 / self.args[0]) if self.args[0] > 0 else 0
+        elif self.kind == "lognormal":
+            value = self.args[0] * rng.lognormvariate(0, self.args[1])
+        else:
+            value = self.args[1] if rng.random() < self.args[2] else self.args[0]
+        return max(0, int(value))
+
+def parse_mix(text):
+    mix = {}
+    for item in text.split(","):
+        size, _, weight = item.partition("=")
+        if not size.endswith("B") and not size.endswith("L"):
+            raise argparse.ArgumentTypeError("invalid register class " + size)
+        mix[size] = float(weight) if weight else 1.0
+    return mix
+
+def read_register_config(fileName):
+    registers = {}
+    with open(fileName) as f:
+        for line in f:
+            fields = line.split("#")[0].split()
+            if len(fields) == 2:
+                registers[fields[0]] = int(fields[1])
+    return registers
+
+class RegisterAllocator:
+    ''' Free registers of each class. A register is freed when the last reader of its value is emitted '''
+    def __init__(self, registers, reserved64B):
+        self.free = {}
+        for size, count in registers.items():
+            first = reserved64B if size == "64B" else 0
+            self.free[size] = list(range(first, count))
+        self.fallbacks = 0
+
+    def allocate(self, size):
+        if not self.free.get(size):
+            # Any class with free registers, the smallest first
+            candidates = [s for s in self.free if self.free[s]]
+            if not candidates:
+                return None
+            self.fallbacks += 1
+            size = min(candidates, key=register_bytes)
+        return size, self.free[size].pop(0)
+
+    def release(self, reg):
+        self.free[reg[0]].append(reg[1])
+
+def reg_name(reg):
+    return "R%s_%d" % reg
+
+def generate(args, out):
+    rng = random.Random(args.seed)
+    registers = read_register_config(args.regfile) if args.regfile else dict(DEFAULT_REGISTERS)
+    for size in args.regs:
+        if size not in registers:
+            sys.exit("The register file has no %s registers" % size)
+    if registers.get("64B", 0) < LOOP_REGS + args.addr_regs + 1:
+        sys.exit("The register file needs at least %d 64B registers" % (LOOP_REGS + args.addr_regs + 1))
+    allocator = RegisterAllocator(registers, LOOP_REGS + args.addr_regs)
+    sizes = list(args.regs.keys())
+    weights = list(args.regs.values())
+    streamBytes = args.stream_bytes
+    streamNs = int(streamBytes * 2 / args.stream_bw) if args.stream_bw > 0 else 0
+    memSlots = max(1, args.memory // streamBytes) if streamBytes > 0 else 1
+
+    body = []
+    numNodes = numEdges = numStreams = numOverlaps = numBranches = 0
+    work = 0
+    nextAddrReg = 0
+    nextSlot = 0
+    writtenRanges = []   # (offset, finish time) of the ranges written by the streams
+    previous = []        # nodes of the previous level
+    for level in range(args.depth):
+        current = []
+        for index in range(args.width):
+            isStream = rng.random() < args.streams and streamBytes > 0
+            maxInputs = MAX_STREAM_INPUTS if isStream else MAX_SPIN_INPUTS
+            inputs = []
+            if previous:
+                numInputs = rng.randint(1, min(args.fan_in, maxInputs, len(previous)))
+                # Prefer the nodes of the previous level that can be read by more nodes
+                candidates = [n for n in previous if n["readers"] < args.fan_out]
+                rng.shuffle(candidates)
+                inputs = candidates[:numInputs]
+                if len(inputs) < numInputs:
+                    others = [n for n in previous if n not in inputs]
+                    inputs += rng.sample(others, min(len(others), numInputs - len(inputs)))
+            ready = max([n["finish"] for n in inputs], default=0)
+
+            for node in inputs:
+                node["readers"] += 1
+            numEdges += len(inputs)
+            inputRegs = ", ".join(reg_name(n["reg"]) for n in inputs)
+
+            size = rng.choices(sizes, weights)[0]
+            reg = allocator.allocate(size)
+            if reg is None:
+                sys.exit("Out of registers at level %d. Use a larger register file or a smaller width" % level)
+
+            if isStream:
+                numStreams += 1
+                if writtenRanges and rng.random() < args.overlap:
+                    src, written = rng.choice(writtenRanges[-args.width:])
+                    ready = max(ready, written)
+                    numOverlaps += 1
+                else:
+                    src = (nextSlot % memSlots) * streamBytes
+                    nextSlot += 1
+                dst = (nextSlot % memSlots) * streamBytes
+                nextSlot += 1
+                srcReg = "R64B_%d" % (LOOP_REGS + nextAddrReg % args.addr_regs)
+                dstReg = "R64B_%d" % (LOOP_REGS + (nextAddrReg + 1) % args.addr_regs)
+                nextAddrReg += 2
+                duration = streamNs
+                body.append("LDIMM %s, %d;" % (srcReg, src))
+                body.append("LDIMM %s, %d;" % (dstReg, dst))
+                body.append("COD synth_stream %s, %d, %s, %s, %d%s;" % (reg_name(reg), duration, srcReg, dstReg, streamBytes,
+                                                                       ", " + inputRegs if inputRegs else ""))
+            else:
+                duration = args.duration.sample(rng)
+                body.append("COD synth_spin %s, %d%s;" % (reg_name(reg), duration, ", " + inputRegs if inputRegs else ""))
+            node = {"reg": reg, "readers": 0, "finish": ready + duration}
+            if isStream:
+                writtenRanges.append((dst, node["finish"]))
+            numNodes += 1
+            work += duration
+
+            if rng.random() < args.branches:
+                # Always taken, to the next instruction
+                body.append("BREQ %s, %s, 1;" % (reg_name(reg), reg_name(reg)))
+                numBranches += 1
+            current.append(node)
+
+        # The values of the previous level are not read anymore
+        for node in previous:
+            allocator.release(node["reg"])
+        previous = current
+    for node in previous:
+        allocator.release(node["reg"])
+
+    criticalPath = max([n["finish"] for n in previous], default=0)
+    stats = [
+        "%d nodes, %d edges, %d streams (%d overlapping), %d branches" % (numNodes, numEdges, numStreams, numOverlaps, numBranches),
+        "work %.3f ms, critical path %.3f ms, parallelism %.2f (per iteration)" % (work / 1e6, criticalPath / 1e6, work / criticalPath if criticalPath else 0),
+    ]
+    if allocator.fallbacks:
+        stats.append("%d outputs used another register class (not enough free registers)" % allocator.fallbacks)
+
+    out.write("// Generated by scmgen.py %s\n" % " ".join(sys.argv[1:]))
+    for line in stats:
+        out.write("// %s\n" % line)
+    if args.repeat > 1:
+        out.write("LDIMM R64B_0, 0; // Iteration\n")
+        out.write("LDIMM R64B_1, %d; // Iterations\n" % args.repeat)
+        out.write("scmgen_loop:\n")
+        out.write("  BREQ R64B_0, R64B_1, scmgen_done;\n")
+        for line in body:
+            out.write("  %s\n" % line)
+        out.write("  ADD R64B_0, R64B_0, 1;\n")
+        out.write("  JMPLBL scmgen_loop;\n")
+        out.write("scmgen_done:\n")
+    else:
+        for line in body:
+            out.write("%s\n" % line)
+    out.write("COMMIT;\n")
+    return stats
+
+def main():
+    parser = argparse.ArgumentParser(description='Generates synthetic SCM programs with the shape of a DAG')
+    parser.add_argument('-o', dest='output', help='Output program (default stdout)')
+    parser.add_argument('--width', type=int, default=8, help='Nodes of each level (default 8)')
+    parser.add_argument('--depth', type=int, default=16, help='Levels (default 16)')
+    parser.add_argument('--fan-in', dest='fan_in', type=int, default=2, help='Most inputs of a node, up to 6 (default 2)')
+    parser.add_argument('--fan-out', dest='fan_out', type=int, default=2, help='Most readers of a node that are preferred (default 2)')
+    parser.add_argument('--regs', type=parse_mix, default=parse_mix("64B"), help='Register classes of the outputs and their weights, e.g. 64B=3,1L=1,2048L=1 (default 64B)')
+    parser.add_argument('--regfile', help='Register configuration of the machine (SCMUlate -r). Default: the default register file')
+    parser.add_argument('--duration', type=Duration, default=Duration("const:10us"), help='Duration of the spins: const:T, uniform:MIN:MAX, exp:MEAN, lognormal:MEDIAN:SIGMA, bimodal:SHORT:LONG:P_LONG (default const:10us)')
+    parser.add_argument('--streams', type=float, default=0, help='Fraction of the nodes that are streams (default 0)')
+    parser.add_argument('--stream-bytes', dest='stream_bytes', type=parse_size, default=parse_size("64K"), help='Bytes copied by a stream (default 64K)')
+    parser.add_argument('--stream-bw', dest='stream_bw', type=float, default=0, help='Bandwidth of a stream in GB/s. The stream waits to not go faster. 0 is as fast as possible (default)')
+    parser.add_argument('--overlap', type=float, default=0, help='Probability that a stream reads a range written by a recent stream (default 0)')
+    parser.add_argument('--memory', type=parse_size, default=parse_size("256M"), help='Bytes of the SCM memory used by the streams (default 256M)')
+    parser.add_argument('--addr-regs', dest='addr_regs', type=int, default=16, help='64B registers for the addresses of the streams (default 16)')
+    parser.add_argument('--branches', type=float, default=0, help='Probability that a node is followed by a branch on its output (default 0)')
+    parser.add_argument('--repeat', type=int, default=1, help='Iterations of a loop around the DAG (default 1)')
+    parser.add_argument('--seed', type=int, default=1, help='Seed of the generator (default 1)')
+    args = parser.parse_args()
+    if args.width < 1 or args.depth < 1 or args.fan_in < 1 or args.fan_out < 1 or args.addr_regs < 2:
+        parser.error("width, depth, fan-in and fan-out must be at least 1, and addr-regs at least 2")
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    stats = generate(args, out)
+    if args.output:
+        out.close()
+    for line in stats:
+        print(line, file=sys.stderr)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+
+''' Converts the binary trace of SCMUlate (SCMUlate -trace <file>) to the trace
+event format of Chrome (chrome://tracing) and Perfetto (ui.perfetto.dev).
+
+Each timer (the machine, the SU and each CU) is a thread of the trace. As in
+traceplot.py, the time between an event and the next event of the same timer
+is a slice named after the first event. The records are read and written one
+at a time, so the memory used does not depend on the length of the trace.
+See timers_counters.hpp for the format of the file.
+'''
+
+import argparse
+import json
+import struct
+import sys
+
+HEADER = struct.Struct("<8sIIII")
+TRAILER = struct.Struct("<Q8s")
+# trace_record_t: timestamp, timer_id, event_id, num_hw, inst_id
+RECORD = struct.Struct("<QIHHI")
+NO_INSTRUCTION = 0xFFFFFFFF
+DESCRIPTION_ID_BIT = 0x80000000
+
+counter_types = ["SYS_TIMER", "SU_TIMER", "MEM_TIMER", "CUMEM_TIMER"]
+
+event_names = {
+    "SYS_TIMER": ["SYS_START", "SYS_END"],
+    "SU_TIMER": ["SU_START", "SU_END", "FETCH_DECODE_INSTRUCTION", "DISPATCH_INSTRUCTION",
+                 "EXECUTE_CONTROL_INSTRUCTION", "EXECUTE_ARITH_INSTRUCTION", "SU_IDLE"],
+    "CUMEM_TIMER": ["CUMEM_START", "CUMEM_END", "CUMEM_EXECUTION_COD", "CUMEM_EXECUTION_MEM",
+                    "CUMEM_IDLE"]
+}
+
+class reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def unpack(self, fmt):
+        values = struct.unpack_from(fmt, self.data, self.pos)
+        self.pos += struct.calcsize(fmt)
+        return values
+
+    def u32(self):
+        return self.unpack("<I")[0]
+
+    def string(self):
+        length = self.u32()
+        value = self.data[self.pos:self.pos + length].decode("utf-8", "replace")
+        self.pos += length
+        return value
+
+
+class trace_file:
+    ''' Header and footer of a binary trace. The records are read with records() '''
+    def __init__(self, fileName):
+        self.file = open(fileName, "rb")
+        magic, self.version, self.recordSize, self.hwOffset, self.maxHw = HEADER.unpack(self.file.read(HEADER.size))
+        if magic != b"SCMTRACE":
+            raise ValueError(fileName + " is not an SCMUlate binary trace")
+        if self.version != 2:
+            raise ValueError("Unsupported trace version " + str(self.version))
+        self.secondsPerTick = 0
+        self.initialTicks = None
+        self.timers = []
+        self.instructions = {}
+        self.descriptions = []
+        self.hwNames = []
+        self.stats = {}
+
+        # The footer is missing if the run did not finish. The records are still converted
+        self.file.seek(0, 2)
+        fileSize = self.file.tell()
+        self.recordsEnd = fileSize
+        if fileSize >= HEADER.size + TRAILER.size:
+            self.file.seek(fileSize - TRAILER.size)
+            footerOffset, endMagic = TRAILER.unpack(self.file.read(TRAILER.size))
+            if endMagic == b"SCMTEND\0" and HEADER.size <= footerOffset <= fileSize - TRAILER.size:
+                self.recordsEnd = footerOffset
+                self.file.seek(footerOffset)
+                self.readFooter(reader(self.file.read(fileSize - TRAILER.size - footerOffset)))
+        if self.recordsEnd == fileSize:
+            print("Warning: the trace has no footer. Times are in ticks and there are no names", file=sys.stderr)
+            self.recordsEnd -= (fileSize - HEADER.size) % self.recordSize
+
+    def readFooter(self, r):
+        self.secondsPerTick, self.initialTicks = r.unpack("<dQ")
+        for _ in range(r.u32()):
+            timerType = r.u32()
+            self.timers.append((r.string(), timerType))
+        # (PC, text) by instruction ID. Each program of a service run has its own IDs
+        for _ in range(r.u32()):
+            instId, pc = r.u32(), r.u32()
+            self.instructions[instId] = (pc, r.string())
+        self.descriptions = [r.string() for _ in range(r.u32())]
+        self.hwNames = [r.string() for _ in range(r.u32())]
+        for _ in range(r.u32()):
+            group = r.string()
+            self.stats[group] = {}
+            for _ in range(r.u32()):
+                key = r.string()
+                self.stats[group][key] = r.string()
+
+    def records(self):
+        ''' (timestamp, timer_id, event_id, inst_id, hw counters) of each record, in file order '''
+        self.file.seek(HEADER.size)
+        remaining = self.recordsEnd - HEADER.size
+        chunkRecords = 4096
+        while remaining > 0:
+            chunk = self.file.read(min(remaining, chunkRecords * self.recordSize))
+            if len(chunk) < self.recordSize:
+                return
+            remaining -= len(chunk)
+            for offset in range(0, len(chunk) - self.recordSize + 1, self.recordSize):
+                timestamp, timer, event, numHw, inst = RECORD.unpack_from(chunk, offset)
+                hw = struct.unpack_from("<%dq" % numHw, chunk, offset + self.hwOffset) if numHw > 0 else ()
+                yield timestamp, timer, event, inst, hw
+
+    def timerName(self, timer):
+        return self.timers[timer][0] if timer < len(self.timers) else "timer " + str(timer)
+
+    def timerType(self, timer):
+        if timer < len(self.timers) and self.timers[timer][1] < len(counter_types):
+            return counter_types[self.timers[timer][1]]
+        return None
+
+    def eventName(self, timer, event):
+        names = event_names.get(self.timerType(timer), [])
+        return names[event] if event < len(names) else "EVENT_" + str(event)
+
+    def description(self, inst):
+        if inst == NO_INSTRUCTION:
+            return ""
+        if inst & DESCRIPTION_ID_BIT:
+            index = inst & ~DESCRIPTION_ID_BIT
+            return self.descriptions[index] if index < len(self.descriptions) else ""
+        if inst in self.instructions:
+            pc, text = self.instructions[inst]
+            return text + " (PC = " + str(pc) + ")"
+        return "PC = " + str(inst)
+
+    def toMicroseconds(self, timestamp):
+        if self.initialTicks is None:
+            return float(timestamp)
+        return (timestamp - self.initialTicks) * self.secondsPerTick * 1e6
+
+
+def convert(trace, out, keepIdle):
+    first = True
+    def emit(event):
+        nonlocal first
+        out.write(("\n" if first else ",\n") + json.dumps(event))
+        first = False
+
+    out.write('{"displayTimeUnit": "ns", "traceEvents": [')
+    for timer in range(len(trace.timers)):
+        emit({"ph": "M", "pid": 0, "tid": timer, "name": "thread_name", "args": {"name": trace.timerName(timer)}})
+        emit({"ph": "M", "pid": 0, "tid": timer, "name": "thread_sort_index", "args": {"sort_index": timer}})
+
+    # Previous record of each timer. It becomes a slice when the next record of the timer is read
+    previous = {}
+    numRecords = 0
+    for record in trace.records():
+        numRecords += 1
+        timestamp, timer, event, inst, hw = record
+        if timer in previous:
+            prevTimestamp, prevEvent, prevInst, _ = previous[timer]
+            name = trace.eventName(timer, prevEvent)
+            # Same slices than traceplot.py, but the whole run of the machine is kept
+            isMarker = name.endswith("IDLE") or name.endswith("END") or name.endswith("START")
+            if not isMarker or keepIdle or trace.timerType(timer) == "SYS_TIMER":
+                slice = {"ph": "X", "pid": 0, "tid": timer, "name": name,
+                         "cat": trace.timerType(timer) or "",
+                         "ts": trace.toMicroseconds(prevTimestamp),
+                         "dur": trace.toMicroseconds(timestamp) - trace.toMicroseconds(prevTimestamp)}
+                args = {}
+                desc = trace.description(prevInst)
+                if desc:
+                    args["description"] = desc
+                # The hardware counters are registered by the event that closes the slice
+                for num, value in enumerate(hw):
+                    args[trace.hwNames[num] if num < len(trace.hwNames) else "hw" + str(num)] = value
+                if args:
+                    slice["args"] = args
+                emit(slice)
+        previous[timer] = (timestamp, event, inst, hw)
+
+    out.write('\n],\n"metadata": ' + json.dumps({"STATS": trace.stats}) + '}\n')
+    return numRecords
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Converts a binary trace of SCMUlate to Chrome/Perfetto trace event JSON')
+    parser.add_argument('input', help='Binary trace (SCMUlate -trace <file>)')
+    parser.add_argument('--output', '-o', dest='output', action='store', default='-', help='Output JSON file (default stdout)')
+    parser.add_argument('--idle', dest='keepIdle', action='store_true', help='Also add the IDLE, START and END slices')
+    args = parser.parse_args()
+
+    try:
+        trace = trace_file(args.input)
+    except (OSError, ValueError, struct.error) as e:
+        print("Error opening trace:", e, file=sys.stderr)
+        exit(1)
+    out = sys.stdout if args.output == '-' else open(args.output, "w")
+    numRecords = convert(trace, out, args.keepIdle)
+    if out is not sys.stdout:
+        out.close()
+        print("Converted", numRecords, "records to", args.output, file=sys.stderr)
+
+if __name__ == "__main__":
+    main()
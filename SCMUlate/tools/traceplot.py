@@ -296,6 +296,8 @@ def main():
     if fileName != "":
         data = load_file(fileName)
         for name, counter in data.items():
+            if name == "STATS":
+                continue
             tracePloter.addNewTrace(name)
             prevTime = None
             prevType = ""
@@ -322,6 +324,10 @@ def main():
             tracePloter.plotTrace(subText)
         else:
             stats.print()
+            for group, values in data.get("STATS", {}).items():
+                print(group)
+                for key, value in values.items():
+                    print("  " + key + ": " + value)
     else:
         print("No file specified")
         parser.print_help()
@@ -332,6 +338,8 @@ def jupyter(fileName = "",subText = "",):
     if fileName != "":
         data = load_file(fileName)
         for name, counter in data.items():
+            if name == "STATS":
+                continue
             tracePloter.addNewTrace(name)
             prevTime = None
             prevType = ""